@@ -44,6 +44,8 @@
 #include "config.h"
 #include "logger.h"
 #include "helper.h"
+#include "metrics.h"
+#include "stall.h"
 
 /* Import modules */
 #include "firmware/firmware_json_api.h"
@@ -53,6 +55,7 @@
 #include "gpio/gpio_json_api.h"
 #include "kunio/kunio_json_api.h"
 #include "bluecherry/bluecherry_json_api.h"
+#include "pwm/pwm_json_api.h"
 
 #include "rfid/pn532/rfid_pn532_json_api.h"
 
@@ -64,7 +67,7 @@ const struct http_response r_error 	= { 500, "Internal server error" };
 /**
  * The get handlers table
  */
-const struct f_entry get_handlers[8] = {
+const struct f_entry get_handlers[9] = {
     { "wifi", 5, wifi_get_router },
     { "firmware", 9, firmware_get_router },
     { "tempsensor", 11, tempsensor_get_router },
@@ -73,24 +76,28 @@ const struct f_entry get_handlers[8] = {
     { "system", 7, system_get_router },
     { "bluecherry", 11, bluecherry_get_router },
     { "rfid", 5, rfid_pn532_get_router },
+    { "pwm", 4, pwm_get_router },
 };
 
 /**
  * The post handlers table
  */
-const struct f_entry post_handlers[4] = {
+const struct f_entry post_handlers[6] = {
+    { "batch", 5, api_post_batch },
     { "wifi", 5, wifi_post_router },
     { "firmware", 9, firmware_post_router },
     { "tempsensor", 11, tempsensor_post_router },
     { "bluecherry", 11, bluecherry_post_router },
+    { "gpio", 5, gpio_post_router },
 };
 
 /**
  * The put handlers table
  */
-const struct f_entry put_handlers[2] = {
+const struct f_entry put_handlers[3] = {
     { "gpio", 5, gpio_put_router },
     { "kunio", 6, kunio_put_router },
+    { "pwm", 4, pwm_put_router },
 };
 
 /* Lookup table for method handle lookup */
@@ -100,6 +107,10 @@ const struct f_entry* handlers[] = {
     [UH_HTTP_MSG_PUT] = put_handlers
 };
 
+/* True while the operations of a batch run, they can't be parked */
+static bool in_batch = false;
+
+static void api_write_json(struct client *cl, json_object *response);
 
 static void write_response(struct client *cl, int code, const char *summary)
 {
@@ -121,6 +132,27 @@ static void write_response(struct client *cl, int code, const char *summary)
         return;
 }
 
+/**
+ * Search the handler for a given method in the handler tables.
+ * @method the HTTP method of the request.
+ * @url the request URL.
+ * @offset the offset at which the module name starts in the url.
+ * @return a handler struct if any, NULL otherways.
+ */
+static const struct f_entry* api_find_handler(int method, char *url, size_t offset)
+{
+	switch(method) {
+		case UH_HTTP_MSG_GET:
+			return api_get_function(url, offset, get_handlers, sizeof(get_handlers)/sizeof(struct f_entry));
+		case UH_HTTP_MSG_POST:
+			return api_get_function(url, offset, post_handlers, sizeof(post_handlers)/sizeof(struct f_entry));
+		case UH_HTTP_MSG_PUT:
+			return api_get_function(url, offset, put_handlers, sizeof(put_handlers)/sizeof(struct f_entry));
+		default:
+			return NULL;
+	}
+}
+
 /**
  * Handle api requests
  * @cl the client who sent the request
@@ -133,28 +165,74 @@ void api_handle_request(struct client *cl, char *url)
         const struct f_entry* api_handler = NULL;                           /* The handler structure */
         json_object* (*handler)(struct client *, char *request) = NULL;     /* The handler function */
 
-	/* Search the correct handler */
-	switch(cl->request.method) {
-		case UH_HTTP_MSG_GET:
-			api_handler = api_get_function(url, conf->api_str_len, get_handlers, sizeof(get_handlers)/sizeof(struct f_entry));
-			break;
-		case UH_HTTP_MSG_POST:
-			api_handler = api_get_function(url, conf->api_str_len, post_handlers, sizeof(post_handlers)/sizeof(struct f_entry));
-			break;
-		case UH_HTTP_MSG_PUT:
-			api_handler = api_get_function(url, conf->api_str_len, put_handlers, sizeof(put_handlers)/sizeof(struct f_entry));
-			break;
-		default:
-			api_handler = NULL;
-			break;
+	/* Metrics are served in the Prometheus text format instead of JSON */
+	if (cl->request.method == UH_HTTP_MSG_GET && strcmp(url + conf->api_str_len, "metrics") == 0) {
+		metrics_handle_request(cl);
+		return;
 	}
+
+	/* Search the correct handler */
+	api_handler = api_find_handler(cl->request.method, url, conf->api_str_len);
         
 	/* If a handler is found execute it */
 	if(api_handler){
+            STALL_SCOPE("route", api_handler->name);
+            cl->route = metrics_route(api_handler, http_methods[cl->request.method], api_handler->name);
             handler = api_handler->function;
+            cl->timing.handler_start = metrics_now();
             response = handler(cl, url + conf->api_str_len + api_handler->url_offset);
+            cl->timing.handler_end = metrics_now();
 	}
 
+	/* A parked request is answered later by api_respond() */
+	if(!response && cl->dispatch.parked)
+		return;
+
+	api_write_json(cl, response);
+}
+
+/**
+ * Park the current request instead of answering it. The handler returns
+ * NULL and answers the request later with api_respond(). 
+ * @cl the client who made the request.
+ * @release called when the client goes away while the request is parked.
+ * @data the data of the parked request, kept in the dispatch request data.
+ * @return false when the request can't be parked and must be answered now.
+ */
+bool api_park(struct client *cl, void (*release)(struct client *cl), void *data)
+{
+	if(in_batch)
+		return false;
+
+	cl->dispatch.parked = true;
+	cl->dispatch.req_data = data;
+	cl->dispatch.req_free = release;
+	return true;
+}
+
+/**
+ * Answer a parked request. 
+ * @cl the client whose request is parked.
+ * @response the JSON response, NULL for a bad request. Ownership is taken.
+ */
+void api_respond(struct client *cl, json_object *response)
+{
+	/* The request is answered, there is nothing to release anymore */
+	cl->dispatch.parked = false;
+	cl->dispatch.req_data = NULL;
+	cl->dispatch.req_free = NULL;
+
+	cl->timing.handler_end = metrics_now();
+	api_write_json(cl, response);
+}
+
+/**
+ * Write the JSON response of an API request.
+ * @cl the client who made the request.
+ * @response the JSON response, NULL for a bad request. Ownership is taken.
+ */
+static void api_write_json(struct client *cl, json_object *response)
+{
 	/* Write response when there is one */
 	if(response){
 		/* Get the string representation of the JSON object */
@@ -199,3 +277,137 @@ const struct f_entry* api_get_function(char* url, size_t offset, const struct f_
     /* Return NULL when no request could be found */
     return NULL;
 }
+
+/**
+ * Execute one operation of a batch request through the normal API routers.
+ * @cl the client who sent the batch request.
+ * @op the JSON description of the operation: {method, path, body}.
+ * @return a JSON object containing the status and the body of the result.
+ */
+static json_object* api_batch_execute(struct client *cl, json_object *op)
+{
+	json_object *j_method = NULL;
+	json_object *j_path = NULL;
+	json_object *j_body = NULL;
+	json_object *response = NULL;
+	json_object *result = json_object_new_object();
+	const struct f_entry* api_handler = NULL;
+	json_object* (*handler)(struct client *, char *request) = NULL;
+	char path[API_BATCH_PATH_LEN];
+	const char *method_str;
+	const char *path_str;
+	int method = -1;
+	int i;
+
+	/* Method and path are mandatory strings, the body is optional */
+	if(!json_object_is_type(op, json_type_object) ||
+	   !json_object_object_get_ex(op, "method", &j_method) ||
+	   !json_object_object_get_ex(op, "path", &j_path) ||
+	   !json_object_is_type(j_method, json_type_string) ||
+	   !json_object_is_type(j_path, json_type_string))
+	{
+		json_object_object_add(result, "status", json_object_new_int(r_bad_req.code));
+		json_object_object_add(result, "message", json_object_new_string("Operation needs a method and a path."));
+		return result;
+	}
+	json_object_object_get_ex(op, "body", &j_body);
+
+	/* Translate the method, nested batches are not allowed */
+	method_str = json_object_get_string(j_method);
+	for(i = UH_HTTP_MSG_GET; i <= UH_HTTP_MSG_PUT; ++i) {
+		if(!strcasecmp(http_methods[i], method_str)) {
+			method = i;
+			break;
+		}
+	}
+
+	/* Strip the API prefix from the path if it is given */
+	path_str = json_object_get_string(j_path);
+	if(uh_path_match(conf->api_prefix, path_str))
+		path_str += conf->api_str_len - 1;
+	while(*path_str == '/')
+		++path_str;
+	snprintf(path, sizeof(path), "%s", path_str);
+
+	api_handler = api_find_handler(method, path, 0);
+	if(api_handler && api_handler->function != api_post_batch) {
+		STALL_SCOPE("route", api_handler->name);
+
+		/* The handler reads the body of the operation as post data */
+		cl->postdata = j_body ? (char*) json_object_get_string(j_body) : "";
+		cl->http_status = r_ok;
+
+		handler = api_handler->function;
+		in_batch = true;
+		response = handler(cl, path + api_handler->url_offset);
+		in_batch = false;
+	}
+
+	if(response) {
+		json_object_object_add(result, "status", json_object_new_int(cl->http_status.code));
+		json_object_object_add(result, "body", response);
+	} else {
+		/* Handlers do not always set an error status when failing */
+		if(!api_handler || cl->http_status.code == r_ok.code)
+			cl->http_status = r_bad_req;
+
+		json_object_object_add(result, "status", json_object_new_int(cl->http_status.code));
+		json_object_object_add(result, "message", json_object_new_string("Request not supported by server."));
+	}
+
+	return result;
+}
+
+/**
+ * Execute an array of API operations in one request. Every operation is
+ * dispatched through the normal routers in one request. GPIO pins stay
+ * claimed once reserved, so the operations need no grouping, and several
+ * pins change in one operation with a single gpio/states operation. 
+ * @cl the client who made the request.
+ * @request the request part of the url.
+ * @return an array with the result of every operation, in order.
+ */
+json_object* api_post_batch(struct client *cl, char *request)
+{
+	char *postdata = cl->postdata;
+	json_object *results;
+	json_object *in_obj;
+	int nr_ops;
+	int i;
+
+	/* Parse JSON post data */
+	in_obj = cl->postdata ? json_tokener_parse(cl->postdata) : NULL;
+	if(!in_obj || !json_object_is_type(in_obj, json_type_array)) {
+		log_message(LOG_WARNING, "Batch request does not contain an array of operations\r\n");
+		if(in_obj)
+			json_object_put(in_obj);
+		cl->http_status = r_bad_req;
+		return NULL;
+	}
+
+	nr_ops = json_object_array_length(in_obj);
+	if(nr_ops > API_BATCH_MAX_OPS) {
+		log_message(LOG_WARNING, "Batch request contains %d operations, maximum is %d\r\n", nr_ops, API_BATCH_MAX_OPS);
+		json_object_put(in_obj);
+		cl->http_status = r_bad_req;
+		return NULL;
+	}
+
+	/* Execute all operations in order */
+	results = json_object_new_array();
+	for(i = 0; i < nr_ops; ++i) {
+		json_object_array_add(results, api_batch_execute(cl, json_object_array_get_idx(in_obj, i)));
+	}
+
+	/* Restore the post data of the batch request itself */
+	cl->postdata = postdata;
+
+	/* Release parsed json object */
+	if(json_object_put(in_obj) != 1) {
+		log_message(LOG_WARNING, "[memleak] Memory of parsed JSON object is not freed\r\n");
+	}
+
+	/* Return status ok */
+	cl->http_status = r_ok;
+	return results;
+}
@@ -32,6 +32,7 @@
 #define API_H
 
 #include <sys/types.h>
+#include <json-c/json.h>
 
 #include "uhttpd.h"
 #include "config.h"
@@ -45,6 +46,13 @@ struct f_entry {
 	void* function;
 };
 
+/**
+ * The handler tables of the GET, POST and PUT methods
+ */
+extern const struct f_entry get_handlers[9];
+extern const struct f_entry post_handlers[6];
+extern const struct f_entry put_handlers[3];
+
 /**
  * Handle api requests
  * @cl the client who sent the request
@@ -52,6 +60,23 @@ struct f_entry {
  */
 void api_handle_request(struct client *cl, char *url);
 
+/**
+ * Park the current request instead of answering it. The handler returns
+ * NULL and answers the request later with api_respond(). 
+ * @cl the client who made the request.
+ * @release called when the client goes away while the request is parked.
+ * @data the data of the parked request, kept in the dispatch request data.
+ * @return false when the request can't be parked and must be answered now.
+ */
+bool api_park(struct client *cl, void (*release)(struct client *cl), void *data);
+
+/**
+ * Answer a parked request. 
+ * @cl the client whose request is parked.
+ * @response the JSON response, NULL for a bad request. Ownership is taken.
+ */
+void api_respond(struct client *cl, json_object *response);
+
 /**
  * Get the API handler structure if any. 
  * @name the request url.
@@ -62,4 +87,15 @@ void api_handle_request(struct client *cl, char *url);
  */
 const struct f_entry* api_get_function(char* url, size_t offset, const struct f_entry* table, size_t table_size);
 
+/**
+ * Execute an array of API operations in one request. Every operation is
+ * dispatched through the normal routers in one request. GPIO pins stay
+ * claimed once reserved, so the operations need no grouping, and several
+ * pins change in one operation with a single gpio/states operation. 
+ * @cl the client who made the request.
+ * @request the request part of the url.
+ * @return an array with the result of every operation, in order.
+ */
+json_object* api_post_batch(struct client *cl, char *request);
+
 #endif
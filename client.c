@@ -28,6 +28,10 @@
  * Created on May 10, 2014, 5:28 PM
  */
 
+#define _GNU_SOURCE
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
 #include <libubox/blobmsg.h>
 #include <ctype.h>
 
@@ -35,6 +39,9 @@
 #include "listen.h"
 #include "uhttpd.h"
 #include "client.h"
+#include "h2.h"
+#include "metrics.h"
+#include "stall.h"
 
 /* The list of connected clients */
 static LIST_HEAD(clients);
@@ -60,6 +67,33 @@ const char * const http_methods[] = {
 	[UH_HTTP_MSG_PUT] = "PUT",
 };
 
+/**
+ * Write the Server-Timing header with the phases of the request
+ * completed so far, in milliseconds.
+ * @cl the client to write the header to
+ */
+static void write_server_timing(struct client *cl)
+{
+	struct metrics_timing *t = &cl->timing;
+	uint64_t now = metrics_now();
+	uint64_t handler_end;
+
+	if (!t->first_byte || !t->header)
+		return;
+
+	ustream_printf(cl->us, "Server-Timing: read;dur=%.3f",
+		(t->header - t->first_byte) / 1e3);
+
+	/* Handlers that write their own header are still running */
+	if (t->handler_start) {
+		handler_end = t->handler_end ? t->handler_end : now;
+		ustream_printf(cl->us, ", handler;dur=%.3f, respond;dur=%.3f",
+			(handler_end - t->handler_start) / 1e3, (now - handler_end) / 1e3);
+	}
+
+	ustream_printf(cl->us, ", total;dur=%.3f\r\n", (now - t->first_byte) / 1e3);
+}
+
 /**
  * Write a http header to a client
  * @client the client to write the header to
@@ -86,17 +120,21 @@ void write_http_header(struct client *cl, int code, const char *summary)
 	ustream_printf(cl->us, "%s %03i %s\r\n%s\r\n%s",
 		http_versions[cl->request.version],
 		code, summary, conn, enc);
+	cl->status = code;
 
 	/* If this is a Keep-Alive connection, send the keep alive time */
 	if (!r->connection_close)
 		ustream_printf(cl->us, "Keep-Alive: timeout=%d\r\n", conf->keep_alive_time);
+
+	if (conf->server_timing)
+		write_server_timing(cl);
 }
 
 /**
  * Close this client connection
  * @client the client to close the connection from
  */
-static void close_connection(struct client *cl)
+void close_connection(struct client *cl)
 {
 	cl->state = CLIENT_STATE_CLOSE;
 	cl->us->eof = true;
@@ -124,6 +162,7 @@ static void timeout_event_handler(struct uloop_timeout *timeout)
 {
 	/* Get the client that caused the timeout event */
 	struct client *cl = container_of(timeout, struct client, timeout);
+	STALL_SCOPE("timer", "client timeout");
 
 	/* Close the connection */
 	close_connection(cl);
@@ -139,6 +178,7 @@ static void polling_event_handler(struct uloop_timeout *timeout)
 {
 	/* Get the client that caused the timeout event */
 	struct client *cl = container_of(timeout, struct client, timeout);
+	STALL_SCOPE("timer", "client poll");
 
 	/* Set timeout when the client had made request, network timeout otherwise */
 	int msec = cl->requests > 0 ? conf->keep_alive_time : conf->network_timeout;
@@ -159,6 +199,24 @@ static void poll_connection(struct client *cl)
 	uloop_timeout_set(&cl->timeout, 1);
 }
 
+/**
+ * Record the phases of the last response once it is written to the socket.
+ * @cl the client that is sending the response
+ */
+static void client_check_flushed(struct client *cl)
+{
+	if (!cl->flush_pending || cl->us->w.data_bytes)
+		return;
+
+#ifdef HAVE_TLS
+	if (cl->tls && cl->ssl.conn && cl->ssl.conn->w.data_bytes)
+		return;
+#endif
+
+	cl->flush_pending = false;
+	metrics_timing(&cl->sending, metrics_now());
+}
+
 /**
  * Signal a request is done and set the connection to wait
  * for another request from the client.
@@ -170,6 +228,20 @@ void request_done(struct client *cl)
 	uh_chunk_eof(cl);
 	dispatch_done(cl);
 
+	/* Account the request before the client can be closed */
+	cl->timing.done = metrics_now();
+	metrics_request(cl->route, cl->status, cl->timing.done - cl->timing.header);
+	cl->route = NULL;
+	cl->status = 0;
+
+	/* The send phase ends when the response left the write buffer */
+	if (cl->flush_pending)
+		metrics_timing(&cl->sending, cl->timing.done);
+	cl->sending = cl->timing;
+	cl->flush_pending = true;
+	memset(&cl->timing, 0, sizeof(cl->timing));
+	client_check_flushed(cl);
+
 	/* Set the dispatch pointers to zero */
 	memset(&cl->dispatch, 0, sizeof(cl->dispatch));
 
@@ -282,7 +354,7 @@ static int find_idx(const char * const *list, int max, const char *str)
  * @cl: the client that sent the request
  * @data: the request data
  */
-static int parse_client_request(struct client *cl, char *data)
+int parse_client_request(struct client *cl, char *data)
 {
 	struct http_request *req = &cl->request;
 	char *type, *path, *version;
@@ -334,6 +406,20 @@ static bool client_init_handler(struct client *cl, char *buf, int len)
 {
 	char *newline;
 
+	/* Switch to HTTP/2 on the connection preface, sent with prior
+	 * knowledge or after TLS ALPN negotiated h2 */
+	if (conf->http2) {
+		switch (h2_check_preface(buf, len)) {
+		case H2_PREFACE_PARTIAL:
+			return false;
+		case H2_PREFACE_MATCH:
+			cl->timeout.cb = timeout_event_handler;
+			return h2_conn_start(cl);
+		default:
+			break;
+		}
+	}
+
 	/* Get the first newline in the the header, if there is no newlien
 	 * the header is faulty */
 	newline = strstr(buf, "\r\n");
@@ -390,6 +476,7 @@ static void client_header_complete(struct client *cl)
 		break;
 	}
 
+	cl->timing.header = metrics_now();
 	uh_handle_request(cl);
 }
 
@@ -650,9 +737,16 @@ void read_from_client(struct client *cl)
 	struct ustream *us = cl->us;
 	char *str;
 	int len;
+	STALL_SCOPE("read", NULL);
 
 	client_done = false;
 	do {
+		/* Multiplexed connections are parsed by the HTTP/2 layer */
+		if (cl->h2) {
+			h2_read(cl);
+			break;
+		}
+
 		/* Read sata if there is any */
 		str = ustream_get_read_buf(us, &len);
 		if (!str || !len)
@@ -661,6 +755,9 @@ void read_from_client(struct client *cl)
 		if (cl->state >= array_size(read_cbs) || !read_cbs[cl->state])
 			break;
 
+		if (cl->state == CLIENT_STATE_INIT && !cl->timing.first_byte)
+			cl->timing.first_byte = metrics_now();
+
 		/* Call different handlers and parse */
 		if (!read_cbs[cl->state](cl, str, len)) {
 			if (len == us->r.buffer_len &&
@@ -683,13 +780,32 @@ static void client_close(struct client *cl)
 		return;
 	}
 
+	/* A response cut off by the close ends its send phase */
+	if (cl->flush_pending) {
+		cl->flush_pending = false;
+		metrics_timing(&cl->sending, metrics_now());
+	}
+
 	/* Free all resources */
 	if(cl->ispostdata)
 		free(cl->postdata);
 	client_done = true;
-	n_clients--;
 	dispatch_done(cl);
 	uloop_timeout_cancel(&cl->timeout);
+
+	/* Virtual clients only own their stream */
+	if (cl->close_virtual) {
+		cl->close_virtual(cl);
+		blob_buf_free(&cl->hdr);
+		free(cl);
+		return;
+	}
+
+	n_clients--;
+	if (cl->h2)
+		h2_conn_free(cl);
+	if (cl->tls)
+		uh_tls_client_detach(cl);
 	ustream_free(&cl->sfd.stream);
 	close(cl->sfd.fd.fd);
 	list_del(&cl->list);
@@ -709,6 +825,7 @@ static void client_close(struct client *cl)
 void client_notify_state(struct client *cl)
 {
 	struct ustream *s = cl->us;
+	STALL_SCOPE("state", NULL);
 
 	/* Do not close in cleanup or DATA state */
 	if (!s->write_error && cl->state != CLIENT_STATE_CLEANUP) {
@@ -718,11 +835,35 @@ void client_notify_state(struct client *cl)
 		/* Dont close when the stream is not fully read */
 		if (!s->eof || s->w.data_bytes)
 			return;
+
+#ifdef HAVE_TLS
+		/* Flush the encrypted data before closing a TLS connection */
+		if (cl->tls && cl->ssl.conn && cl->ssl.conn->w.data_bytes) {
+			cl->ssl.conn->eof = s->eof;
+			if (!ustream_write_pending(cl->ssl.conn))
+				return;
+		}
+#endif
 	}
 
 	return client_close(cl);
 }
 
+/**
+ * Account a finished response and call the write dispatcher
+ * when the client stream has room for more data.
+ * @cl the client that can write.
+ */
+void client_notify_write(struct client *cl)
+{
+	STALL_SCOPE("write", NULL);
+
+	client_check_flushed(cl);
+
+	if (cl->dispatch.write_cb)
+		cl->dispatch.write_cb(cl);
+}
+
 /**
  * Read from a ustream.
  * @s the stream to read from.
@@ -732,6 +873,7 @@ static void client_ustream_read_handler(struct ustream *s, int bytes)
 {
 	struct client *cl = container_of(s, struct client, sfd.stream);
 
+	metrics_add(&metrics.bytes_in, bytes);
 	read_from_client(cl);
 }
 
@@ -745,8 +887,7 @@ static void client_ustream_write_handler(struct ustream *s, int bytes)
 {
 	struct client *cl = container_of(s, struct client, sfd.stream);
 
-	if (cl->dispatch.write_cb)
-		cl->dispatch.write_cb(cl);
+	client_notify_write(cl);
 }
 
 /**
@@ -760,6 +901,26 @@ static void client_notify_state_handler(struct ustream *s)
 	client_notify_state(cl);
 }
 
+/* The write function of socket streams */
+static int (*fd_write)(struct ustream *s, const char *buf, int len, bool more);
+
+/**
+ * Write to a client socket and count the written bytes.
+ * @s the socket stream.
+ * @buf the data to write.
+ * @len the length of the data.
+ * @more true if more data follows.
+ */
+static int client_fd_write(struct ustream *s, const char *buf, int len, bool more)
+{
+	int wr = fd_write(s, buf, len, more);
+
+	if (wr > 0)
+		metrics_add(&metrics.bytes_out, wr);
+
+	return wr;
+}
+
 /**
  * Set the address to reply to
  * @addr the address to set
@@ -784,8 +945,9 @@ static void set_addr(struct uh_addr *addr, void *src)
  * Accept a new client
  * @fd the socket to accept the client on
  * @tls true if this client has https
+ * @local true if the socket is a unix domain socket
  */
-bool accept_client(int fd, bool tls)
+bool accept_client(int fd, bool tls, bool local)
 {
 	static struct client *next_client;
 	struct client *cl;
@@ -793,6 +955,8 @@ bool accept_client(int fd, bool tls)
 	int sfd;
 	static int client_id = 0;
 	struct sockaddr_in6 addr;
+	struct ucred cred;
+	int yes = 1;
 
 	/* If the list has no space enlarge it with one */
 	if (!next_client)
@@ -802,25 +966,56 @@ bool accept_client(int fd, bool tls)
 
 	/* Set all the correct addresses */
 	sl = sizeof(addr);
-	sfd = accept(fd, (struct sockaddr *) &addr, &sl);
+	sfd = accept(fd, local ? NULL : (struct sockaddr *) &addr, local ? NULL : &sl);
 	if (sfd < 0)
 		return false;
 
-	set_addr(&cl->peer_addr, &addr);
-	sl = sizeof(addr);
-	getsockname(sfd, (struct sockaddr *) &addr, &sl);
-	set_addr(&cl->srv_addr, &addr);
+	/* Local clients are identified by their process credentials */
+	cl->local = local;
+	if (local) {
+		sl = sizeof(cred);
+		if (getsockopt(sfd, SOL_SOCKET, SO_PEERCRED, &cred, &sl) < 0) {
+			close(sfd);
+			return false;
+		}
+
+		cl->peer_cred.pid = cred.pid;
+		cl->peer_cred.uid = cred.uid;
+		cl->peer_cred.gid = cred.gid;
+		memset(&cl->peer_addr, 0, sizeof(cl->peer_addr));
+		memset(&cl->srv_addr, 0, sizeof(cl->srv_addr));
+		cl->peer_addr.family = cl->srv_addr.family = AF_UNIX;
+	} else {
+		set_addr(&cl->peer_addr, &addr);
+		sl = sizeof(addr);
+		getsockname(sfd, (struct sockaddr *) &addr, &sl);
+		set_addr(&cl->srv_addr, &addr);
+
+		/* Headers and body are separate writes, Nagle would hold the body until the delayed ACK of the peer */
+		setsockopt(sfd, IPPROTO_TCP, TCP_NODELAY, &yes, sizeof(yes));
+	}
 
-	/* Attach all handlers */
+	/* Attach all handlers, TLS clients are handled by the TLS stream */
+	cl->tls = tls;
 	cl->us = &cl->sfd.stream;
-	cl->us->notify_read = client_ustream_read_handler;
-	cl->us->notify_write = client_ustream_write_handler;
-	cl->us->notify_state = client_notify_state_handler;
+	if (tls) {
+		uh_tls_client_attach(cl);
+	} else {
+		cl->us->notify_read = client_ustream_read_handler;
+		cl->us->notify_write = client_ustream_write_handler;
+		cl->us->notify_state = client_notify_state_handler;
+	}
 
 	/* Initialise stream for string data */
 	cl->us->string_data = true;
 	ustream_fd_init(&cl->sfd, sfd);
 
+	/* Count the bytes written to the socket */
+	fd_write = cl->sfd.stream.write;
+	cl->sfd.stream.write = client_fd_write;
+	metrics_add(&metrics.connections, 1);
+	cl->timing.accept = metrics_now();
+
 	/* Add the client to the list and poll connection */
 	poll_connection(cl);
 	list_add_tail(&cl->list, &clients);
@@ -833,6 +1028,46 @@ bool accept_client(int fd, bool tls)
 	return true;
 }
 
+/**
+ * Create a virtual client that runs a single request read from and
+ * answered on the given stream instead of a socket.
+ * @parent the client of the connection carrying the stream
+ * @us the stream of the virtual client
+ * @close_cb called when the virtual client closes to release the stream
+ * @return the virtual client, NULL when out of memory
+ */
+struct client* client_create_virtual(struct client *parent, struct ustream *us, void (*close_cb)(struct client *cl))
+{
+	struct client *cl = calloc(1, sizeof(*cl));
+
+	if (!cl)
+		return NULL;
+
+	cl->us = us;
+	cl->tls = parent->tls;
+	cl->id = parent->id;
+	cl->peer_addr = parent->peer_addr;
+	cl->srv_addr = parent->srv_addr;
+	cl->local = parent->local;
+	cl->peer_cred = parent->peer_cred;
+	cl->close_virtual = close_cb;
+
+	/* Virtual clients do not wait for new requests */
+	cl->timeout.cb = timeout_event_handler;
+	uloop_timeout_set(&cl->timeout, conf->network_timeout * 1000);
+
+	return cl;
+}
+
+/**
+ * Close a virtual client immediately.
+ * @cl the virtual client
+ */
+void client_close_virtual(struct client *cl)
+{
+	client_close(cl);
+}
+
 /**
  * Close all clients
  */
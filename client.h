@@ -70,6 +70,15 @@ void __printf(4,5) client_send_error(struct client *cl, int code, const char *su
  */
 void client_post_data(struct client *cl);
 
+/**
+ * Parse the request line of a client request into the client
+ * request info, the URL is added to the client header data.
+ * @cl the client that sent the request
+ * @data the request line, it is modified while parsing
+ * @return CLIENT_STATE_HEADER on success, CLIENT_STATE_DONE when malformed
+ */
+int parse_client_request(struct client *cl, char *data);
+
 /**
  * Read data from client. Read the request and parse
  * all headers and data.
@@ -83,12 +92,41 @@ void read_from_client(struct client *cl);
  */
 void client_notify_state(struct client *cl);
 
+/**
+ * Account a finished response and call the write dispatcher
+ * @cl the client that can write
+ */
+void client_notify_write(struct client *cl);
+
 /**
  * Accept a new client
  * @fd the socket to accept the client on
  * @tls true if this client has https
+ * @local true if the socket is a unix domain socket
+ */
+bool accept_client(int fd, bool tls, bool local);
+
+/**
+ * Close this client connection
+ * @client the client to close the connection from
+ */
+void close_connection(struct client *cl);
+
+/**
+ * Create a virtual client that runs a single request read from and
+ * answered on the given stream instead of a socket.
+ * @parent the client of the connection carrying the stream
+ * @us the stream of the virtual client
+ * @close_cb called when the virtual client closes to release the stream
+ * @return the virtual client, NULL when out of memory
+ */
+struct client* client_create_virtual(struct client *parent, struct ustream *us, void (*close_cb)(struct client *cl));
+
+/**
+ * Close a virtual client immediately.
+ * @cl the virtual client
  */
-bool accept_client(int fd, bool tls);
+void client_close_virtual(struct client *cl);
 
 /**
  * Close all clients
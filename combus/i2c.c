@@ -42,6 +42,9 @@
 
 #include "i2c.h"
 #include "../logger.h"
+#include "../metrics.h"
+#include "../helper.h"
+#include "../config.h"
 
 /* 
  * Array containing file descriptors for i2c-buses. This 
@@ -102,6 +105,11 @@ bool i2c_enable_device(int busno, int sda, int scl)
 {
     char buff[256];
     
+    // A simulated board has its buses already, there are no modules to load
+    if(conf->hardware_root) {
+        return true;
+    }
+    
     // Generate the insmod command
     sprintf(buff, "insmod i2c-gpio-custom bus%d=%d,%d,%d", busno, busno, sda, scl);
     log_message(LOG_DEBUG, "executing: %s\r\n", buff);
@@ -118,7 +126,7 @@ bool i2c_enable_device(int busno, int sda, int scl)
  */
 bool i2c_open_bus(int busno)
 {
-    char buff[16];
+    char buff[HW_PATH_MAX];
     int fd;
     
     if(!_i2c_busno_in_range(busno)) {
@@ -127,7 +135,7 @@ bool i2c_open_bus(int busno)
     }
     
     // Generate the bus file path
-    sprintf(buff, "/dev/i2c-%d", busno);
+    helper_hw_path(buff, sizeof(buff), "/dev/i2c-%d", busno);
 
     // Try to open the I2C device 
     fd = open(buff, O_RDWR);
@@ -180,6 +188,7 @@ bool i2c_set_slave_address(int busno, uint8_t address)
  */
 bool i2c_write_bytes(int busno, uint8_t* byte, int len)
 {
+    METRICS_TIME(METRICS_CALL_I2C);
     int fd = _i2c_get_fd(busno);
     if(fd <= 0) {
         log_message(LOG_ERROR, "i2c_write_bytes: the bus number (%d) is out of range or the bus is not yet open\r\n", busno);
@@ -206,6 +215,7 @@ bool i2c_write_bytes(int busno, uint8_t* byte, int len)
  */
 int i2c_read(int busno, uint8_t* buffer, int len)
 {
+    METRICS_TIME(METRICS_CALL_I2C);
     int fd = _i2c_get_fd(busno);
     if(fd <= 0) {
         log_message(LOG_ERROR, "i2c_write_bytes: the bus number (%d) is out of range or the bus is not yet open\r\n", busno);
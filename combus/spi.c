@@ -31,6 +31,7 @@
 #include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <unistd.h>
 #include <fcntl.h>
 #include <sys/ioctl.h>
@@ -38,287 +39,204 @@
 
 #include "spi.h"
 #include "../config.h"
+#include "../metrics.h"
+#include "../helper.h"
 
-/* Initialise the SPI device.
+/* The SPI device of the server */
+static spi_handle device = { .fd = -1 };
+
+/**
+ * Get the SPI device with the given settings. The device is opened on
+ * first use and only reconfigured when the settings change.
  * @mode select the SPI mode (mode 0 = 0b00, mode 1 = 0b01, mode 2 = 0b01, mode 3 = 0b11)
- * @bits the number of bits to read from the device
- *
- * @return the SPI device file descriptor or -1 on error.
+ * @bits the number of bits per word
+ * @speed the maximum bus speed in Hz
+ * @return the SPI device or NULL on error.
  */
-int spi_init(uint32_t mode, uint8_t bits, uint32_t speed)
+spi_handle* spi_init(uint8_t mode, uint8_t bits, uint32_t speed)
 {
-	/* The SPI device file descriptor */
-	int dev;
+	char path[HW_PATH_MAX];
 
-	/* Try to open the SPI device */
-	dev = open(SPI_DEVICE, O_RDWR);
-	if(dev < 0) {
-		return -1;
+	/* Try to open the SPI device, the settings are unknown */
+	if(device.fd < 0) {
+		device.fd = open(helper_hw_path(path, sizeof(path), SPI_DEVICE), O_RDWR | O_CLOEXEC);
+		if(device.fd < 0) {
+			return NULL;
+		}
+
+		/* Set the SPI mode */
+		if(ioctl(device.fd, SPI_IOC_WR_MODE, &mode) == -1) {
+			goto error;
+		}
+
+		/* Set the number of bits per word */
+		if(ioctl(device.fd, SPI_IOC_WR_BITS_PER_WORD, &bits) == -1) {
+			goto error;
+		}
+
+		/* Set the maximum bus speed in Hz */
+		if(ioctl(device.fd, SPI_IOC_WR_MAX_SPEED_HZ, &speed) == -1) {
+			goto error;
+		}
+
+		device.mode = mode;
+		device.bits = bits;
+		device.speed = speed;
+		return &device;
 	}
 
-	/* Set the SPI mode */
-	if(ioctl(dev, SPI_IOC_WR_MODE, &mode) == -1) {
-		return -1;
+	/* Only the settings that changed are written */
+	if(mode != device.mode) {
+		if(ioctl(device.fd, SPI_IOC_WR_MODE, &mode) == -1) {
+			goto error;
+		}
+		device.mode = mode;
 	}
 
-	/* Set the number of bits per word */
-	if(ioctl(dev, SPI_IOC_WR_BITS_PER_WORD, &bits) == -1) {
-		return -1;
+	if(bits != device.bits) {
+		if(ioctl(device.fd, SPI_IOC_WR_BITS_PER_WORD, &bits) == -1) {
+			goto error;
+		}
+		device.bits = bits;
 	}
 
-	/* Set the maximum bus speed in Hz */
-	if(ioctl(dev, SPI_IOC_WR_MAX_SPEED_HZ, &speed) == -1) {
-		return -1;
+	if(speed != device.speed) {
+		if(ioctl(device.fd, SPI_IOC_WR_MAX_SPEED_HZ, &speed) == -1) {
+			goto error;
+		}
+		device.speed = speed;
 	}
 
-	return dev;
+	return &device;
+
+error:
+	/* The device is opened and configured again on next use */
+	close(device.fd);
+	device.fd = -1;
+	return NULL;
 }
 
 /**
- * Send a byte to the SPI device
- * @dev the SPI device to use.
- * @byte the byte to send
+ * Close the SPI device and free its buffers.
  */
-int spi_byte_send_8(int dev, uint8_t byte)
+void spi_close(void)
 {
-	uint32_t speed;
-	uint8_t bits;
-
-	/* Temporary receive buffer */
-	uint8_t rx;
-
-	/* Get speed settings for the device */
-	if(ioctl(dev, SPI_IOC_RD_MAX_SPEED_HZ, &speed) == -1) {
-		return -1;
-	}
-
-	/* Get bits per word settings for the device */
-	if(ioctl(dev, SPI_IOC_RD_BITS_PER_WORD, &bits) == -1) {
-		return -1;
-	}
-
-	/* Prepare the transfer structure */
-	struct spi_ioc_transfer tr = {
-			.tx_buf = (unsigned long) &byte,
-			.rx_buf = (unsigned long) &rx,
-			.len = 1,
-			.delay_usecs = 0,
-			.speed_hz = speed,
-			.bits_per_word = bits,
-	};
-
-	/* Try to transfer the data */
-	if(ioctl(dev, SPI_IOC_MESSAGE(1), &tr) < 1){
-		return -1;
+	if(device.fd >= 0) {
+		close(device.fd);
+		device.fd = -1;
 	}
 
-	/* Close the SPI device */
-	close(dev);
-
-	/* Transfer complete */
-	return 0;
+	free(device.scratch);
+	device.scratch = NULL;
+	device.scratch_size = 0;
 }
 
 /**
- * Send data of maximum 8 bits to the SPI device.
- * @dev the SPI device to use.
- * @data an array of bytes to send.
- * @size the number of bytes to send.
+ * Run one transfer with the settings of the device.
+ * @spi the SPI device to use.
+ * @tx the bytes to send, NULL to send zeros.
+ * @rx the buffer that receives the bytes, NULL to ignore them.
+ * @len the number of bytes to transfer.
+ * @return 0 on success, -1 on error.
  */
-int spi_data_send_8(int dev, uint8_t data[], int size)
+static int spi_transfer(spi_handle *spi, const void *tx, void *rx, size_t len)
 {
-	uint32_t speed;
-	uint8_t bits;
-
-	/* Make a receive buffer ready of the same length of send buffer */
-	uint8_t *rx = (uint8_t*) malloc(size*sizeof(uint8_t));
-
-	/* Get speed settings for the device */
-	if(ioctl(dev, SPI_IOC_RD_MAX_SPEED_HZ, &speed) == -1) {
-		return -1;
-	}
-
-	/* Get bits per word settings for the device */
-	if(ioctl(dev, SPI_IOC_RD_BITS_PER_WORD, &bits) == -1) {
-		return -1;
+	/* A read shifts out zeros from the scratch buffer, it only grows */
+	if(tx == NULL) {
+		if(len > spi->scratch_size) {
+			uint8_t *scratch = (uint8_t*) calloc(len, 1);
+			if(scratch == NULL) {
+				return -1;
+			}
+			free(spi->scratch);
+			spi->scratch = scratch;
+			spi->scratch_size = len;
+		}
+		tx = spi->scratch;
 	}
 
 	/* Prepare the transfer structure */
 	struct spi_ioc_transfer tr = {
-			.tx_buf = (unsigned long) data,
+			.tx_buf = (unsigned long) tx,
 			.rx_buf = (unsigned long) rx,
-			.len = size,
+			.len = len,
 			.delay_usecs = 0,
-			.speed_hz = speed,
-			.bits_per_word = bits,
+			.speed_hz = spi->speed,
+			.bits_per_word = spi->bits,
 	};
 
 	/* Try to transfer the data */
-	if(ioctl(dev, SPI_IOC_MESSAGE(1), &tr) < 1){
+	if(ioctl(spi->fd, SPI_IOC_MESSAGE(1), &tr) < 1){
 		return -1;
 	}
 
-	/* Close the SPI device */
-	close(dev);
-
-	/* Free the rx buffer */
-	free(rx);
-
 	/* Transfer complete */
 	return 0;
 }
 
 /**
- * Send data bigger than 8 bits to the SPI device.
- * @dev the SPI device to use.
+ * Send a byte to the SPI device
+ * @spi the SPI device to use.
+ * @byte the byte to send
+ * @return 0 on success, -1 on error.
+ */
+int spi_byte_send_8(spi_handle *spi, uint8_t byte)
+{
+	return spi_transfer(spi, &byte, NULL, 1);
+}
+
+/**
+ * Send data of maximum 8 bits to the SPI device.
+ * @spi the SPI device to use.
  * @data an array of bytes to send.
  * @size the number of bytes to send.
+ * @return 0 on success, -1 on error.
  */
-int spi_data_send_16(int dev, uint16_t data[], int size)
+int spi_data_send_8(spi_handle *spi, const uint8_t data[], int size)
 {
-	uint32_t speed;
-	uint8_t bits;
-
-	/* Make a receive buffer ready of the same length of send buffer */
-	uint16_t *rx = (uint16_t*) malloc(size*sizeof(uint16_t));
-
-	/* Get speed settings for the device */
-	if(ioctl(dev, SPI_IOC_RD_MAX_SPEED_HZ, &speed) == -1) {
-		return -1;
-	}
-
-	/* Get bits per word settings for the device */
-	if(ioctl(dev, SPI_IOC_RD_BITS_PER_WORD, &bits) == -1) {
-		return -1;
-	}
-
-	/* Prepare the transfer structure */
-	struct spi_ioc_transfer tr = {
-			.tx_buf = (unsigned long) data,
-			.rx_buf = (unsigned long) rx,
-			.len = size,
-			.delay_usecs = 0,
-			.speed_hz = speed,
-			.bits_per_word = bits,
-	};
-
-	/* Try to transfer the data */
-	if(ioctl(dev, SPI_IOC_MESSAGE(1), &tr) < 1){
-		return -1;
-	}
+	METRICS_TIME(METRICS_CALL_SPI);
 
-	/* Close the SPI device */
-	close(dev);
+	return spi_transfer(spi, data, NULL, size);
+}
 
-	/* Free the rx buffer */
-	free(rx);
+/**
+ * Send data bigger than 8 bits to the SPI device.
+ * @spi the SPI device to use.
+ * @data an array of words to send.
+ * @size the number of words to send.
+ * @return 0 on success, -1 on error.
+ */
+int spi_data_send_16(spi_handle *spi, const uint16_t data[], int size)
+{
+	METRICS_TIME(METRICS_CALL_SPI);
 
-	/* Transfer complete */
-	return 0;
+	return spi_transfer(spi, data, NULL, size * sizeof(uint16_t));
 }
 
 /**
  * Read data of maximum 8 bits from the SPI device.
- * @dev the SPI device to use.
+ * @spi the SPI device to use.
+ * @data the buffer that receives the bytes.
  * @size the number of bytes to read.
+ * @return 0 on success, -1 on error.
  */
-spidata_8* spi_data_read_8(int dev, uint32_t size)
+int spi_data_read_8(spi_handle *spi, uint8_t data[], int size)
 {
-	uint32_t speed;
-	uint8_t bits;
-
-	/* Prepare the spidata structure */
-	spidata_8 *data = (spidata_8*) malloc(sizeof(spidata_8));
-	data->data = (uint8_t*) calloc(size, sizeof(uint8_t));
-	data->size = size;
-
-	/* Prepare empty data transmit buffer */
-	uint8_t *tx = (uint8_t*) calloc(size, sizeof(uint8_t));
-
-	/* Get speed settings for the device */
-	if(ioctl(dev, SPI_IOC_RD_MAX_SPEED_HZ, &speed) == -1) {
-		return NULL;
-	}
-
-	/* Get bits per word settings for the device */
-	if(ioctl(dev, SPI_IOC_RD_BITS_PER_WORD, &bits) == -1) {
-		return NULL;
-	}
-
-	/* Prepare the transfer structure */
-	struct spi_ioc_transfer tr = {
-			.tx_buf = (unsigned long) tx,
-			.rx_buf = (unsigned long) data->data,
-			.len = size,
-			.delay_usecs = 0,
-			.speed_hz = speed,
-			.bits_per_word = bits,
-	};
-
-	/* Try to transfer the data */
-	if(ioctl(dev, SPI_IOC_MESSAGE(1), &tr) < 1){
-		return NULL;
-	}
-
-	/* Close the SPI device */
-	close(dev);
+	METRICS_TIME(METRICS_CALL_SPI);
 
-	/* Free the rx buffer */
-	free(tx);
-
-	/* Return the data */
-	return data;
+	return spi_transfer(spi, NULL, data, size);
 }
 
 /**
  * Read data bigger than 8 bits from the SPI device.
- * @dev the SPI device to use.
- * @size the number of bytes to read.
+ * @spi the SPI device to use.
+ * @data the buffer that receives the words.
+ * @size the number of words to read.
+ * @return 0 on success, -1 on error.
  */
-spidata_16* spi_data_read_16(int dev, uint32_t size)
+int spi_data_read_16(spi_handle *spi, uint16_t data[], int size)
 {
-	uint32_t speed;
-	uint8_t bits;
-
-	/* Prepare the spidata structure */
-	spidata_16 *data = (spidata_16*) malloc(sizeof(spidata_16));
-	data->data = (uint16_t*) calloc(size, sizeof(uint16_t));
-	data->size = size;
-
-	/* Prepare empty data transmit buffer */
-	uint16_t *tx = (uint16_t*) calloc(size, sizeof(uint16_t));
-
-	/* Get speed settings for the device */
-	if(ioctl(dev, SPI_IOC_RD_MAX_SPEED_HZ, &speed) == -1) {
-		return NULL;
-	}
-
-	/* Get bits per word settings for the device */
-	if(ioctl(dev, SPI_IOC_RD_BITS_PER_WORD, &bits) == -1) {
-		return NULL;
-	}
-
-	/* Prepare the transfer structure */
-	struct spi_ioc_transfer tr = {
-			.tx_buf = (unsigned long) tx,
-			.rx_buf = (unsigned long) data->data,
-			.len = size,
-			.delay_usecs = 0,
-			.speed_hz = speed,
-			.bits_per_word = bits,
-	};
-
-	/* Try to transfer the data */
-	if(ioctl(dev, SPI_IOC_MESSAGE(1), &tr) < 1){
-		return NULL;
-	}
-
-	/* Close the SPI device */
-	close(dev);
-
-	/* Free the rx buffer */
-	free(tx);
+	METRICS_TIME(METRICS_CALL_SPI);
 
-	/* Return the data */
-	return data;
+	return spi_transfer(spi, NULL, data, size * sizeof(uint16_t));
 }
@@ -32,61 +32,75 @@
 #define SPI_H_
 
 #include <stdint.h>
+#include <stddef.h>
 
-/* SPI data structure for maximum 8 bit words */
-typedef struct spi_data_8 {
-	uint32_t size;
-	uint8_t* data;
-} spidata_8;
-
-/* SPI data structure for more than 8 bit words*/
-typedef struct spi_data_16 {
-	uint32_t size;
-	uint16_t* data;
-} spidata_16;
+/* An open SPI device, it stays open between transfers */
+typedef struct spi_handle {
+	int fd;				/* The device file descriptor, -1 when closed */
+	uint8_t mode;			/* The configured SPI mode */
+	uint8_t bits;			/* The configured number of bits per word */
+	uint32_t speed;			/* The configured bus speed in Hz */
+	uint8_t *scratch;		/* Zeroed transmit buffer for reads */
+	size_t scratch_size;		/* The size of the scratch buffer in bytes */
+} spi_handle;
 
 /**
- * Initialise the SPI device.
+ * Get the SPI device with the given settings. The device is opened on
+ * first use and only reconfigured when the settings change.
  * @mode select the SPI mode (mode 0 = 0b00, mode 1 = 0b01, mode 2 = 0b01, mode 3 = 0b11)
- * @bits the number of bits to read from the device
+ * @bits the number of bits per word
+ * @speed the maximum bus speed in Hz
+ * @return the SPI device or NULL on error.
+ */
+spi_handle* spi_init(uint8_t mode, uint8_t bits, uint32_t speed);
+
+/**
+ * Close the SPI device and free its buffers.
  */
-int spi_init(uint32_t mode, uint8_t bits, uint32_t speed);
+void spi_close(void);
 
 /**
  * Send a byte to the SPI device
- * @dev the SPI device to use.
+ * @spi the SPI device to use.
  * @byte the byte to send
+ * @return 0 on success, -1 on error.
  */
-int spi_byte_send_8(int dev, uint8_t byte);
+int spi_byte_send_8(spi_handle *spi, uint8_t byte);
 
 /**
  * Send data of maximum 8 bits to the SPI device.
- * @dev the SPI device to use.
+ * @spi the SPI device to use.
  * @data an array of bytes to send.
  * @size the number of bytes to send.
+ * @return 0 on success, -1 on error.
  */
-int spi_data_send_8(int dev, uint8_t data[], int size);
+int spi_data_send_8(spi_handle *spi, const uint8_t data[], int size);
 
 /**
  * Send data bigger than 8 bits to the SPI device.
- * @dev the SPI device to use.
- * @data an array of bytes to send.
- * @size the number of bytes to send.
+ * @spi the SPI device to use.
+ * @data an array of words to send.
+ * @size the number of words to send.
+ * @return 0 on success, -1 on error.
  */
-int spi_data_send_16(int dev, uint16_t data[], int size);
+int spi_data_send_16(spi_handle *spi, const uint16_t data[], int size);
 
 /**
  * Read data of maximum 8 bits from the SPI device.
- * @dev the SPI device to use.
+ * @spi the SPI device to use.
+ * @data the buffer that receives the bytes.
  * @size the number of bytes to read.
+ * @return 0 on success, -1 on error.
  */
-spidata_8* spi_data_read_8(int dev, uint32_t size);
+int spi_data_read_8(spi_handle *spi, uint8_t data[], int size);
 
 /**
  * Read data bigger than 8 bits from the SPI device.
- * @dev the SPI device to use.
- * @size the number of bytes to read.
+ * @spi the SPI device to use.
+ * @data the buffer that receives the words.
+ * @size the number of words to read.
+ * @return 0 on success, -1 on error.
  */
-spidata_16* spi_data_read_16(int dev, uint32_t size);
+int spi_data_read_16(spi_handle *spi, uint16_t data[], int size);
 
 #endif /* SPI_H_ */
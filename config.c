@@ -109,7 +109,7 @@ static int parseint(char* string, bool unsignedint, int fallback) {
     
     if(unsignedint) {
         /* Parse as unsigned integer */
-        if ((!isdigit(string) || *string=='+') || *end) {
+        if ((!isdigit(*string) || *string=='+') || *end) {
             log_message(LOG_WARNING, "Configuration parameter 'buff_size' is not a valid integer, falling back to default\r\n");
             return fallback;
         }
@@ -124,13 +124,37 @@ static int parseint(char* string, bool unsignedint, int fallback) {
     return result;
 }
 
+/**
+ * Parse a comma separated list of GPIO pins.
+ * @param string the list to parse, it is modified.
+ * @return the mask with bit n set for GPIO n, invalid pins are left out.
+ */
+static uint32_t parsepins(char* string) {
+    uint32_t mask = 0;
+    char* pin = strtok(string, ",");
+    
+    while (pin != NULL) {
+        int gpio = parseint(pin, true, -1);
+        
+        if (gpio >= 0 && gpio < 28) {
+            mask |= 1u << gpio;
+        } else {
+            log_message(LOG_WARNING, "Configuration parameter '%s' is not a GPIO pin, ignoring it\r\n", pin);
+        }
+        pin = strtok(NULL, ",");
+    }
+    
+    return mask;
+}
+
 config* conf = NULL;
 
 /**
- * Parse configuration file at /etc/config/dpt-connector
+ * Parse the configuration file.
+ * @file the configuration file, NULL for CONFIGURATION_FILE
  * @return true when parse was successfull
  */
-bool config_parse() {
+bool config_parse(const char *file) {
     /* Read buffer */
     char buffer[512];
     FILE * fd;
@@ -138,15 +162,34 @@ bool config_parse() {
     char* value;
     
     /* Reserve memory for configuration and null terminate every string*/
-    conf = (config*) malloc(sizeof(config));
+    conf = (config*) calloc(1, sizeof(config));
     
     /* Put in default configuration */
     conf->daemon = FORK_ON_START;
+    conf->log_level = LOG_LEVEL;
+    conf->trace_file = NULL;
+    conf->trace_size = TRACE_SIZE;
+    conf->trace_level = TRACE_LEVEL;
     
     conf->listen_port = strmalloc(NULL, LISTEN_PORT);
     conf->database = strmalloc(NULL, DB_LOCATION);
     conf->keep_alive_time = KEEP_ALIVE_TIME;
     conf->network_timeout = NETWORK_TIMEOUT;
+    conf->http2 = HTTP2_ENABLED;
+    conf->server_timing = SERVER_TIMING;
+    conf->stall_threshold = STALL_THRESHOLD;
+    conf->stall_backtrace = STALL_BACKTRACE;
+    
+    conf->unix_socket = NULL;
+    conf->unix_socket_mode = UNIX_SOCKET_MODE;
+    
+    conf->tls_port = NULL;
+    conf->tls_cert = strmalloc(NULL, TLS_CERT);
+    conf->tls_key = strmalloc(NULL, TLS_KEY);
+    conf->tls_ciphers = strmalloc(NULL, TLS_CIPHERS);
+    conf->tls_session_cache = TLS_SESSION_CACHE;
+    conf->tls_session_timeout = TLS_SESSION_TIMEOUT;
+    conf->tls_tickets = TLS_TICKETS;
     
     conf->index_file = strmalloc(NULL, INDEX_FILE);
     conf->document_root = strmalloc(NULL, DOCUMENT_ROOT);
@@ -158,26 +201,128 @@ bool config_parse() {
     conf->firmware_file_name = strmalloc(NULL, FIRMWARE_FILE_NAME);
     
     conf->ubus_timeout = UBUS_TIMEOUT;
+    conf->hardware_root = NULL;
+    conf->gpio_backend = strmalloc(NULL, GPIO_BACKEND);
+    conf->gpio_chip = strmalloc(NULL, GPIO_CHIP);
+    conf->gpio_monitor = GPIO_MONITOR;
+    conf->gpio_pulse_priority = GPIO_PULSE_PRIORITY;
+    conf->gpio_pulse_cpu = GPIO_PULSE_CPU;
+    conf->pwm_priority = PWM_PRIORITY;
+    conf->pwm_cpu = PWM_CPU;
+    conf->gpio_wave_priority = GPIO_WAVE_PRIORITY;
+    conf->gpio_wave_cpu = GPIO_WAVE_CPU;
+    conf->gpio_sample_rate = GPIO_SAMPLE_RATE;
+    conf->gpio_sample_priority = GPIO_SAMPLE_PRIORITY;
+    conf->gpio_sample_cpu = GPIO_SAMPLE_CPU;
+    conf->gpio_debounce = GPIO_DEBOUNCE;
+    conf->gpio_debounce_filter = GPIO_DEBOUNCE_FILTER;
+    conf->gpio_counters = GPIO_COUNTERS;
+    conf->gpio_counter_interval = GPIO_COUNTER_INTERVAL;
+    conf->gpio_counter_save = GPIO_COUNTER_SAVE;
     
     
     /* Parse configuration file if any */
-    if ((fd = fopen(CONFIGURATION_FILE, "r")) != NULL) {
+    if ((fd = fopen(file ? file : CONFIGURATION_FILE, "r")) != NULL) {
 
         while (fgets(buffer, CONFIG_BUFF_SIZE, fd) != NULL) {
             /* Ignore lines starting with '#', ';' or whitespace  */
             if (buffer[0] != '#' && buffer[0] != ';' && buffer[0] != ' ' && buffer[0] != '\t' && buffer[0] != '\r' && buffer[0] != '\n') {
                 char* trimmed = trimwhitespace(buffer);
                 key = strtok(trimmed, " \t");
-                value = strtok (NULL, " ,.-");
+                value = strtok (NULL, " \t");
+                if (value == NULL) {
+                    log_message(LOG_WARNING, "Configuration option '%s' has no value\r\n", key);
+                    continue;
+                }
                 
                 if(strcmp(key, "daemon") == 0) 
                 {
                     conf->daemon = value[0] == 't';
                 } 
+                else if (strcmp(key, "log_level") == 0) 
+                {
+                    int level = log_level_parse(value);
+                    
+                    if (level < 0) {
+                        log_message(LOG_WARNING, "Unknown log level '%s'\r\n", value);
+                    } else {
+                        conf->log_level = level;
+                    }
+                }
+                else if (strcmp(key, "trace_file") == 0) 
+                {
+                    conf->trace_file = strmalloc(conf->trace_file, value);
+                }
+                else if (strcmp(key, "trace_size") == 0) 
+                {
+                    conf->trace_size = parseint(value, true, TRACE_SIZE);
+                }
+                else if (strcmp(key, "trace_level") == 0) 
+                {
+                    int level = log_level_parse(value);
+                    
+                    if (level < 0) {
+                        log_message(LOG_WARNING, "Unknown trace level '%s'\r\n", value);
+                    } else {
+                        conf->trace_level = level;
+                    }
+                }
                 else if (strcmp(key, "listen_port") == 0) 
                 { 
                     conf->listen_port = strmalloc(conf->listen_port, value);
                 } 
+                else if (strcmp(key, "http2") == 0) 
+                {
+                    conf->http2 = value[0] == 't';
+                }
+                else if (strcmp(key, "server_timing") == 0) 
+                {
+                    conf->server_timing = value[0] == 't';
+                }
+                else if (strcmp(key, "stall_threshold") == 0) 
+                {
+                    conf->stall_threshold = parseint(value, true, STALL_THRESHOLD);
+                }
+                else if (strcmp(key, "stall_backtrace") == 0) 
+                {
+                    conf->stall_backtrace = value[0] == 't';
+                }
+                else if (strcmp(key, "unix_socket") == 0) 
+                {
+                    conf->unix_socket = strmalloc(conf->unix_socket, value);
+                }
+                else if (strcmp(key, "unix_socket_mode") == 0) 
+                {
+                    conf->unix_socket_mode = strtol(value, NULL, 8);
+                }
+                else if (strcmp(key, "tls_port") == 0) 
+                { 
+                    conf->tls_port = strmalloc(conf->tls_port, value);
+                } 
+                else if (strcmp(key, "tls_cert") == 0) 
+                { 
+                    conf->tls_cert = strmalloc(conf->tls_cert, value);
+                } 
+                else if (strcmp(key, "tls_key") == 0) 
+                { 
+                    conf->tls_key = strmalloc(conf->tls_key, value);
+                } 
+                else if (strcmp(key, "tls_ciphers") == 0) 
+                { 
+                    conf->tls_ciphers = strmalloc(conf->tls_ciphers, value);
+                } 
+                else if (strcmp(key, "tls_session_cache") == 0) 
+                {
+                    conf->tls_session_cache = parseint(value, true, TLS_SESSION_CACHE);
+                }
+                else if (strcmp(key, "tls_session_timeout") == 0) 
+                {
+                    conf->tls_session_timeout = parseint(value, true, TLS_SESSION_TIMEOUT);
+                }
+                else if (strcmp(key, "tls_tickets") == 0) 
+                {
+                    conf->tls_tickets = value[0] == 't';
+                }
                 else if (strcmp(key, "database") == 0)
                 {
                     conf->database = strmalloc(conf->database, value);
@@ -219,6 +364,80 @@ bool config_parse() {
                 {
                     conf->ubus_timeout = parseint(value, true, UBUS_TIMEOUT);
                 }
+                else if (strcmp(key, "hardware_root") == 0) 
+                {
+                    conf->hardware_root = strmalloc(conf->hardware_root, value);
+                }
+                else if (strcmp(key, "gpio_backend") == 0) 
+                {
+                    conf->gpio_backend = strmalloc(conf->gpio_backend, value);
+                }
+                else if (strcmp(key, "gpio_chip") == 0) 
+                {
+                    conf->gpio_chip = strmalloc(conf->gpio_chip, value);
+                }
+                else if (strcmp(key, "gpio_monitor") == 0) 
+                {
+                    conf->gpio_monitor = value[0] == 't';
+                }
+                else if (strcmp(key, "gpio_pulse_priority") == 0) 
+                {
+                    conf->gpio_pulse_priority = parseint(value, true, GPIO_PULSE_PRIORITY);
+                }
+                else if (strcmp(key, "gpio_pulse_cpu") == 0) 
+                {
+                    conf->gpio_pulse_cpu = parseint(value, false, GPIO_PULSE_CPU);
+                }
+                else if (strcmp(key, "pwm_priority") == 0) 
+                {
+                    conf->pwm_priority = parseint(value, true, PWM_PRIORITY);
+                }
+                else if (strcmp(key, "pwm_cpu") == 0) 
+                {
+                    conf->pwm_cpu = parseint(value, false, PWM_CPU);
+                }
+                else if (strcmp(key, "gpio_wave_priority") == 0) 
+                {
+                    conf->gpio_wave_priority = parseint(value, true, GPIO_WAVE_PRIORITY);
+                }
+                else if (strcmp(key, "gpio_wave_cpu") == 0) 
+                {
+                    conf->gpio_wave_cpu = parseint(value, false, GPIO_WAVE_CPU);
+                }
+                else if (strcmp(key, "gpio_sample_rate") == 0) 
+                {
+                    conf->gpio_sample_rate = parseint(value, true, GPIO_SAMPLE_RATE);
+                }
+                else if (strcmp(key, "gpio_sample_priority") == 0) 
+                {
+                    conf->gpio_sample_priority = parseint(value, true, GPIO_SAMPLE_PRIORITY);
+                }
+                else if (strcmp(key, "gpio_sample_cpu") == 0) 
+                {
+                    conf->gpio_sample_cpu = parseint(value, false, GPIO_SAMPLE_CPU);
+                }
+                else if (strcmp(key, "gpio_debounce") == 0) 
+                {
+                    conf->gpio_debounce = parseint(value, true, GPIO_DEBOUNCE);
+                }
+                else if (strcmp(key, "gpio_debounce_filter") == 0) 
+                {
+                    conf->gpio_debounce_filter = strcmp(value, "shift") == 0 ? GPIO_FILTER_SHIFT : GPIO_FILTER_INTEGRATOR;
+                }
+                else if (strcmp(key, "gpio_counters") == 0) 
+                {
+                    conf->gpio_counters = parsepins(value);
+                }
+                else if (strcmp(key, "gpio_counter_interval") == 0) 
+                {
+                    conf->gpio_counter_interval = parseint(value, true, GPIO_COUNTER_INTERVAL);
+                    if (conf->gpio_counter_interval <= 0)
+                        conf->gpio_counter_interval = GPIO_COUNTER_INTERVAL;
+                }
+                else if (strcmp(key, "gpio_counter_save") == 0) 
+                {
+                    conf->gpio_counter_save = parseint(value, true, GPIO_COUNTER_SAVE);
+                }
                 else 
                 {
                     log_message(LOG_WARNING, "Unknown configuration option: '%s'\r\n", key);
@@ -254,12 +473,22 @@ void config_free() {
 void config_print() {
     printf("Breakout server configuration\r\n");
     printf("-----------------------------\r\n\r\n");
-    printf("Run as daemon: %s\r\n\r\n", conf->daemon ? "yes" : "no");
+    printf("Run as daemon: %s\r\n", conf->daemon ? "yes" : "no");
+    printf("Log level: %d\r\n", conf->log_level);
+    printf("Trace file: %s (%d bytes, level %d)\r\n\r\n", conf->trace_file ? conf->trace_file : "disabled", conf->trace_size, conf->trace_level);
     
     printf("Listen port: %s\r\n", conf->listen_port);
+    printf("Unix socket: %s (mode %03o)\r\n", conf->unix_socket ? conf->unix_socket : "disabled", conf->unix_socket_mode);
+    printf("TLS port: %s\r\n", conf->tls_port ? conf->tls_port : "disabled");
+    printf("TLS certificate: %s\r\n", conf->tls_cert);
+    printf("TLS session cache: %d sessions, %d seconds\r\n", conf->tls_session_cache, conf->tls_session_timeout);
+    printf("TLS session tickets: %s\r\n", conf->tls_tickets ? "yes" : "no");
     printf("Database location: %s\r\n", conf->database);
     printf("Keep alive time: %d\r\n", conf->keep_alive_time);
-    printf("Network timeout: %d\r\n\r\n", conf->network_timeout);
+    printf("Network timeout: %d\r\n", conf->network_timeout);
+    printf("HTTP/2: %s\r\n", conf->http2 ? "yes" : "no");
+    printf("Server-Timing header: %s\r\n", conf->server_timing ? "yes" : "no");
+    printf("Stall threshold: %d ms (backtrace %s)\r\n\r\n", conf->stall_threshold, conf->stall_backtrace ? "yes" : "no");
     
     printf("Index file: %s\r\n", conf->index_file);
     printf("Document root: %s\r\n", conf->document_root);
@@ -271,4 +500,14 @@ void config_print() {
     printf("Firmware file name: %s\r\n\r\n", conf->firmware_file_name);
     
     printf("µBus timeout: %d\r\n", conf->ubus_timeout);
+    printf("Hardware root: %s\r\n", conf->hardware_root ? conf->hardware_root : "/");
+    printf("GPIO backend: %s (%s), monitor %s\r\n", conf->gpio_backend, conf->gpio_chip, conf->gpio_monitor ? "on" : "off");
+    printf("GPIO pulse scheduler: priority %d, CPU %d\r\n", conf->gpio_pulse_priority, conf->gpio_pulse_cpu);
+    printf("PWM thread: priority %d, CPU %d\r\n", conf->pwm_priority, conf->pwm_cpu);
+    printf("GPIO waveform thread: priority %d, CPU %d\r\n", conf->gpio_wave_priority, conf->gpio_wave_cpu);
+    printf("GPIO counters: mask 0x%07x, interval %d s, saved every %d s\r\n", conf->gpio_counters,
+            conf->gpio_counter_interval, conf->gpio_counter_save);
+    printf("GPIO sampler: %d Hz, %s debounce over %d samples\r\n", conf->gpio_sample_rate,
+            conf->gpio_debounce_filter == GPIO_FILTER_SHIFT ? "shift" : "integrator", conf->gpio_debounce);
+    printf("GPIO sampler thread: priority %d, CPU %d\r\n", conf->gpio_sample_priority, conf->gpio_sample_cpu);
 }
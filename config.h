@@ -32,11 +32,29 @@
 #define CONFIG_H_
 
 #include <stdbool.h>
+#include <stdint.h>
 
 
 /* Compiled configuration */
 #define CONFIGURATION_FILE              "/etc/config/dpt-breakout-server" /* Configuration file location */
 #define API_CALL_MAX_LEN                50                          /* Maximum length of an API uri */
+#define API_BATCH_MAX_OPS               64                          /* Maximum number of operations in one batch request */
+#define API_BATCH_PATH_LEN              256                         /* Maximum length of the path of a batch operation */
+#define H2_MAX_STREAMS                  16                          /* Maximum number of concurrent HTTP/2 streams per connection */
+#define H2_MAX_REQUEST_HEADER           8192                        /* Maximum size of the HTTP/2 request headers */
+#define H2_MAX_REQUEST_BODY             65536                       /* Maximum size of an HTTP/2 request body */
+#define H2_MAX_RESPONSE_HEADER          4096                        /* Maximum size of the response headers of an HTTP/2 stream */
+#define H2_WRITE_BUFFER                 65536                       /* Pending connection bytes before HTTP/2 streams are paused */
+#define LOG_RING_SLOTS                  128                         /* Number of queued log messages, must be a power of two */
+#define LOG_LINE_MAX                    512                         /* Maximum length of a log message */
+#define TRACE_MIN_SIZE                  65536                       /* Minimum size of the trace ring */
+#define TRACE_STRING_MAX                128                         /* Maximum number of traced bytes of a string argument */
+#define METRICS_MAX_ROUTES              32                          /* Maximum number of API routes with their own metrics */
+#define METRICS_MAX_LONGRUNNERS         8                           /* Maximum number of longrunners with cycle time metrics */
+#define HW_PATH_MAX                     128                         /* Maximum length of a device or sysfs path */
+#define STALL_HISTORY                   16                          /* Number of recorded event loop stalls */
+#define STALL_MAX_SCOPES                4                           /* Maximum number of nested callbacks recorded per stall */
+#define STALL_MAX_FRAMES                24                          /* Maximum number of backtrace frames recorded per stall */
 #define CONFIG_BUFF_SIZE                1024                        /* Maximum length of a configuration line */
 #define LOCAL_FIRMWARE_FILE             "/etc/dpt-firmware-version" /* Location of the DPT-Firmware version file */ 
 #define CURL_USER_AGENT                 "dptboard-agent/1.0"        /* User agent fo the DPT-Board when accessing external services */
@@ -53,12 +71,70 @@
 #define DOCUMENT_ROOT			"/www"                  /* The document root */
 #define API_PATH			"/api"			/* The API uri */
 #define LISTEN_PORT			"80"			/* Port to listen to for incoming requests */
+#define LOG_LEVEL			LOG_INFO		/* Messages above this level are not logged */
+#define TRACE_SIZE			1048576			/* Size of the binary trace ring in bytes */
+#define TRACE_LEVEL			LOG_DEBUG		/* Messages above this level are not traced */
+#define HTTP2_ENABLED			true			/* True if HTTP/2 connections are accepted */
+#define UNIX_SOCKET_MODE		0660			/* Permissions of the local API socket */
+#define SERVER_TIMING			false			/* True if responses carry a Server-Timing header */
+#define STALL_THRESHOLD			100			/* Event loop callbacks running longer in ms are stalls, 0 to disable */
+#define STALL_BACKTRACE			false			/* True to take backtraces of stalls, ends a sleep of the stalled callback early */
+
+/* TLS settings */
+#define TLS_CERT                        "/etc/dpt-breakout-server.crt"  /* PEM certificate, ECDSA is preferred */
+#define TLS_KEY                         "/etc/dpt-breakout-server.key"  /* PEM private key */
+#define TLS_CIPHERS                     "ECDHE-ECDSA-CHACHA20-POLY1305:ECDHE-ECDSA-AES128-GCM-SHA256:ECDHE-RSA-CHACHA20-POLY1305:ECDHE-RSA-AES128-GCM-SHA256" /* TLS 1.2 ciphers */
+#define TLS_CIPHERSUITES                "TLS_CHACHA20_POLY1305_SHA256:TLS_AES_128_GCM_SHA256" /* TLS 1.3 cipher suites */
+#define TLS_GROUPS                      "X25519:P-256"          /* Key exchange groups */
+#define TLS_SESSION_CACHE		128			/* Number of cached TLS sessions */
+#define TLS_SESSION_TIMEOUT		3600			/* Lifetime of a TLS session in seconds */
+#define TLS_TICKETS			true			/* True if TLS session tickets are issued */
 
 /* Hardware SPI settings */
-#define SPI_DEVICE			"/dev/spidev0.1"	/* The SPI device the server should use */
+#define SPI_DEVICE			"/dev/spidev0.1"	/* The SPI device the server should use, below the hardware root */
 #define SPI_DEFAULT_BITS		8			/* Default number of bits per word */
 #define SPI_DEFAULT_SPEED		250000			/* Default bus speed of 250kHz */
 
+/* Hardware GPIO settings */
+#define GPIO_BACKEND			"auto"			/* GPIO access: 'cdev', 'sysfs', 'mmio' or 'auto' for cdev with sysfs fallback */
+#define GPIO_CHIP			"/dev/gpiochip0"	/* The GPIO character device, below the hardware root */
+#define GPIO_MONITOR			true			/* True to answer GPIO reads from memory, inputs report their edges */
+#define GPIO_EVENT_SLOTS		256			/* Number of input edges kept for /api/gpio/events, a power of two */
+#define GPIO_EVENT_MAX_WAIT		30000			/* Maximum time in ms an events request waits for an edge */
+#define GPIO_PULSE_PRIORITY		0			/* SCHED_FIFO priority of the pulse scheduler thread, 0 for normal scheduling */
+#define GPIO_PULSE_CPU			-1			/* The CPU the pulse scheduler thread runs on, -1 for any */
+#define GPIO_PULSE_STACK		65536			/* Stack size of the pulse scheduler thread */
+#define GPIO_WAVE_MAX_STEPS		4096			/* Maximum number of steps of a waveform */
+#define GPIO_WAVE_SPIN			100			/* Waits shorter than this many microseconds spin instead of sleeping, at most a quarter of a step */
+#define GPIO_WAVE_MIN_LOOP		1000			/* Shortest waveform in microseconds that may loop for ever */
+#define GPIO_WAVE_MAX_BUSY		10000			/* Longest time in ms a shorter waveform may play in total */
+#define GPIO_WAVE_PRIORITY		20			/* SCHED_FIFO priority of the waveform thread, below the PWM thread */
+#define GPIO_WAVE_CPU			-1			/* The CPU the waveform thread runs on, -1 for any */
+#define GPIO_WAVE_SLICE			10000			/* Longest sleep of the waveform thread in microseconds, bounds the latency of a stop */
+#define GPIO_WAVE_STACK			65536			/* Stack size of the waveform thread */
+#define GPIO_SAMPLE_RATE		0			/* Rate in Hz at which the inputs are sampled and debounced, 0 to report raw edges */
+#define GPIO_SAMPLE_MAX			10000			/* Highest sample rate in Hz */
+#define GPIO_SAMPLE_STACK		65536			/* Stack size of the sampler thread */
+#define GPIO_SAMPLE_PRIORITY		40			/* SCHED_FIFO priority of the sampler thread, below the PWM thread */
+#define GPIO_SAMPLE_CPU			-1			/* The CPU the sampler thread runs on, -1 for any */
+#define GPIO_DEBOUNCE			8			/* Number of samples an input must be stable, 1 up to 32 */
+#define GPIO_COUNTERS			0			/* Mask of the pins whose pulses are counted */
+#define GPIO_COUNTER_INTERVAL		60			/* Interval in seconds over which pulses are counted */
+#define GPIO_COUNTER_SAVE		300			/* Interval in seconds at which pulse totals are saved, 0 for never */
+#define GPIO_FILTER_INTEGRATOR		0			/* A counter moves towards the samples, the state flips at the ends */
+#define GPIO_FILTER_SHIFT		1			/* The state flips when the last samples all agree */
+#define GPIO_DEBOUNCE_FILTER		GPIO_FILTER_INTEGRATOR	/* Debounce filter, 'integrator' or 'shift' in the configuration file */
+
+/* Software PWM settings */
+#define PWM_CHANNELS			8			/* Number of PWM channels */
+#define PWM_MIN_PERIOD			100			/* Shortest PWM period in microseconds (10kHz) */
+#define PWM_MAX_PERIOD			1000000			/* Longest PWM period in microseconds (1Hz) */
+#define PWM_MAX_SLEEP			20000			/* Longest sleep of the PWM thread in microseconds, bounds the latency of a change */
+#define PWM_PRIORITY			50			/* SCHED_FIFO priority of the PWM thread, 0 for normal scheduling */
+#define PWM_CPU				-1			/* The CPU the PWM thread runs on, -1 for any */
+#define PWM_STACK			65536			/* Stack size of the PWM thread */
+#define PWM_SERVO_PERIOD		20000			/* Period of a servo signal in microseconds (50Hz) */
+
 /* Alfa IO module port settings */
 #define ALFA_STROBE_PORT		24			/* The AlfaSprint IO module strobe port */
 #define ALFA_ENABLE_PORT		20			/* The AlfaSprint IO module enable port */
@@ -87,12 +163,29 @@
 /* Dynamic configuration structure */
 typedef struct{
     bool daemon;                    /* When true the breakout server will run as a daemon */
+    int log_level;                  /* Messages above this level are not logged */
+    char* trace_file;               /* Binary trace file, NULL to disable tracing */
+    int trace_size;                 /* Size of the binary trace ring in bytes */
+    int trace_level;                /* Messages above this level are not traced */
     
     char* listen_port;              /* Port to listen to for incoming requests */
+    char* unix_socket;              /* Path of the local API socket, NULL to disable */
+    int unix_socket_mode;           /* Permissions of the local API socket */
+    char* tls_port;                 /* Port to listen to for TLS requests, NULL to disable */
+    char* tls_cert;                 /* The TLS certificate file */
+    char* tls_key;                  /* The TLS private key file */
+    char* tls_ciphers;              /* The TLS 1.2 cipher list */
+    int tls_session_cache;          /* Number of cached TLS sessions, 0 to disable */
+    int tls_session_timeout;        /* Lifetime of a TLS session in seconds */
+    bool tls_tickets;               /* True if TLS session tickets are issued */
     char* database;                 /* The database file to use */
     int keep_alive_time;            /* Time in seconds for Keep-Alive connections */
     int network_timeout;            /* The number of seconds before timeout is detected */
     int max_connections;            /* The maximum number of connections to this server */
+    bool http2;                     /* True if HTTP/2 connections are accepted */
+    bool server_timing;             /* True if responses carry a Server-Timing header */
+    int stall_threshold;            /* Event loop callbacks running longer in ms are stalls, 0 to disable */
+    bool stall_backtrace;           /* True to take backtraces of stalls */
     
     char* index_file;               /* The file that is served by default */
     char* document_root;            /* The document root */
@@ -106,16 +199,36 @@ typedef struct{
     int ubus_timeout;               /* Timeout in msecs for ubus communication */  
     
     bool no_symlinks;               /* True if symlinks should not be followed */
+    
+    char* hardware_root;            /* Prefix of device and sysfs paths, NULL for the board itself */
+    char* gpio_backend;             /* GPIO access: 'cdev', 'sysfs', 'mmio' or 'auto' */
+    char* gpio_chip;                /* The GPIO character device */
+    bool gpio_monitor;              /* True to answer GPIO reads from memory */
+    int gpio_sample_rate;           /* Input sample rate in Hz, 0 for none */
+    int gpio_debounce;              /* Number of samples an input must be stable */
+    int gpio_debounce_filter;       /* GPIO_FILTER_INTEGRATOR or GPIO_FILTER_SHIFT */
+    int gpio_sample_priority;       /* SCHED_FIFO priority of the sampler thread, 0 for none */
+    int gpio_sample_cpu;            /* The CPU of the sampler thread, -1 for any */
+    uint32_t gpio_counters;         /* Mask of the pins whose pulses are counted */
+    int gpio_counter_interval;      /* Pulse counting interval in seconds */
+    int gpio_counter_save;          /* Interval in seconds at which pulse totals are saved */
+    int gpio_pulse_priority;        /* SCHED_FIFO priority of the pulse scheduler, 0 for none */
+    int gpio_pulse_cpu;             /* The CPU of the pulse scheduler, -1 for any */
+    int pwm_priority;               /* SCHED_FIFO priority of the PWM thread, 0 for none */
+    int pwm_cpu;                    /* The CPU of the PWM thread, -1 for any */
+    int gpio_wave_priority;         /* SCHED_FIFO priority of the waveform thread, 0 for none */
+    int gpio_wave_cpu;              /* The CPU of the waveform thread, -1 for any */
 } config;
 
 /* Application wide configuration */
 extern config* conf;
 
 /**
- * Parse configuration file at /etc/config/dpt-connector
+ * Parse the configuration file.
+ * @file the configuration file, NULL for CONFIGURATION_FILE
  * @return true when parse was successfull
  */
-bool config_parse();
+bool config_parse(const char *file);
 
 /**
  * Free the parsed configuration data
@@ -39,6 +39,7 @@
 #include "database.h"
 #include "../config.h"
 #include "../logger.h"
+#include "../metrics.h"
 
 /* References to installed DAO modules for initializing*/
 #include "../firmware/firmware_dao.h"
@@ -138,6 +139,7 @@ void dao_destroy_db_text(db_text *value) {
  */
 int dao_easy_exec(sqlite3 *db, const char* sql)
 {
+    METRICS_TIME(METRICS_CALL_SQLITE);
     sqlite3_stmt *stmt;
     int rc = DB_OK;
 
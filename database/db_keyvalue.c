@@ -38,6 +38,7 @@
 
 #include "../config.h"
 #include "../logger.h"
+#include "../metrics.h"
 #include "database.h"
 #include "db_keyvalue.h"
 
@@ -74,6 +75,7 @@ int dao_keyvalue_init(sqlite3 *db) {
  * @value the value to wich to key points
  */
 int dao_keyvalue_put_int(const char* key, int value) {
+    METRICS_TIME(METRICS_CALL_SQLITE);
     sqlite3 *db;
     sqlite3_stmt *stmt;
     int rc = DB_OK;
@@ -140,6 +142,7 @@ finalize:
  * @value the value to which to key points
  */
 int dao_keyvalue_put_text(const char* key, const char* value) {
+    METRICS_TIME(METRICS_CALL_SQLITE);
     sqlite3 *db;
     sqlite3_stmt *stmt;
     int rc = DB_OK;
@@ -206,6 +209,7 @@ finalize:
  * @value the value to which to key points
  */
 int dao_keyvalue_edit_int(const char* key, int value) {
+    METRICS_TIME(METRICS_CALL_SQLITE);
     sqlite3 *db;
     sqlite3_stmt *stmt;
     int rc = DB_OK;
@@ -272,6 +276,7 @@ finalize:
  * @value the value to which to key points
  */
 int dao_keyvalue_edit_text(const char* key, const char* value) {
+    METRICS_TIME(METRICS_CALL_SQLITE);
     sqlite3 *db;
     sqlite3_stmt *stmt;
     int rc = DB_OK;
@@ -338,6 +343,7 @@ finalize:
  * @return the return value, with status, this should be freed after use
  */
 db_int* dao_keyvalue_get_int(const char* key) {
+    METRICS_TIME(METRICS_CALL_SQLITE);
     sqlite3 *db;
     sqlite3_stmt *stmt;
     db_int *retvalue = dao_create_db_int();
@@ -410,6 +416,7 @@ finalize:
  * @return the return value, with status, this should be freed after use
  */
 db_text* dao_keyvalue_get_text(const char* key) {
+    METRICS_TIME(METRICS_CALL_SQLITE);
     sqlite3 *db;
     sqlite3_stmt *stmt;
     db_text *retvalue = dao_create_db_text();
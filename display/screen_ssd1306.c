@@ -113,14 +113,16 @@ static uint8_t buffer[SSD1306_LCDHEIGHT * SSD1306_LCDWIDTH / 8] = {
  */
 void screen_ssd1306_send_command(uint8_t command)
 {
-	/* The SPI device pointer */
-	int dev = spi_init(0, 8, 25000);
+	/* The SPI device stays open between bytes */
+	spi_handle *spi = spi_init(0, 8, 25000);
 
 	/* Make the data command line low */
 	gpio_write_and_close(SCREEN_SSD1306_DC, 0);
 
-	/* Send the bytes and close the device */
-	spi_byte_send_8(dev, command);
+	/* Send the byte */
+	if(spi != NULL) {
+		spi_byte_send_8(spi, command);
+	}
 }
 
 /*
@@ -129,14 +131,16 @@ void screen_ssd1306_send_command(uint8_t command)
  */
 void screen_ssd1306_send_data(uint8_t data)
 {
-	/* The SPI device pointer */
-		int dev = spi_init(0, 8, 25000);
+	/* The SPI device stays open between bytes */
+	spi_handle *spi = spi_init(0, 8, 25000);
 
-		/* Make the data command line high */
-		gpio_write_and_close(SCREEN_SSD1306_DC, 1);
+	/* Make the data command line high */
+	gpio_write_and_close(SCREEN_SSD1306_DC, 1);
 
-		/* Send the bytes and close the device */
-		spi_byte_send_8(dev, data);
+	/* Send the byte */
+	if(spi != NULL) {
+		spi_byte_send_8(spi, data);
+	}
 }
 
 /*
@@ -35,6 +35,13 @@
 #include "config.h"
 #include "api.h"
 #include "logger.h"
+#include "metrics.h"
+#include "stall.h"
+
+/**
+ * The servers main working buffer.
+ */
+char uh_buf[WORKING_BUFF_SIZE];
 
 /* Pending HTTP requests */
 static LIST_HEAD(pending_requests);
@@ -60,7 +67,7 @@ enum file_hdr {
 /**
  * Try to normalize the a path to a canonical path
  */
-static char * canonpath(const char *path, char *path_resolved) {
+char * canonpath(const char *path, char *path_resolved) {
     const char *path_cpy = path;
     char *path_res = path_resolved;
 
@@ -262,7 +269,7 @@ static struct path_info *path_lookup(struct client *cl, const char *url) {
  * @path the full filepath
  * @return "application/octet-stream" when a mimetype could not be found
  */
-static const char * file_mime_lookup(const char *path) {
+const char * file_mime_lookup(const char *path) {
     const struct mimetype *m = &uh_mime_types[0];
     const char *e;
 
@@ -506,6 +513,9 @@ static void uh_file_data(struct client *cl, struct path_info *pi, int fd) {
 static void uh_file_request(struct client *cl, const char *url, struct path_info *pi, struct blob_attr **tb) {
     int fd;
 
+    /* The path is resolved, the rest of the request is the response */
+    cl->timing.handler_end = metrics_now();
+
     if (!(pi->stat.st_mode & S_IROTH))
         goto error;
 
@@ -576,9 +586,13 @@ void uh_handle_request(struct client *cl) {
         api_handle_request(cl, url);
         return;
     } else {
+        STALL_SCOPE("route", "static");
         cl->use_chunked = false;
+        cl->route = metrics_route(handle_file_request, "ANY", "static");
+        cl->timing.handler_start = metrics_now();
         if (handle_file_request(cl, url))
             return;
+        cl->timing.handler_end = metrics_now();
     }
 
     log_message(LOG_DEBUG, "A 404 is generated for request: '%s'\r\n", url);
@@ -31,10 +31,21 @@
 #include <stdio.h>
 #include <string.h>
 #include <stdlib.h>
+#include <pthread.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
 
 #include "../uhttpd.h"
+#include "../config.h"
 #include "../logger.h"
+#include "../metrics.h"
+#include "../helper.h"
 #include "gpio.h"
+#include "gpio_cdev.h"
+#include "gpio_mmio.h"
+#include "gpio_monitor.h"
+#include "gpio_pulse.h"
 
 /* GPIO configuration, true if GPIO is exposed */
 const bool gpio_config[28] = {
@@ -68,87 +79,270 @@ const bool gpio_config[28] = {
     false, /* GPIO 27 */
 };
 
-/*
- * Reserve a GPIO for this program's use.
- * @gpio the GPIO pin to reserve.
- * @return true if the reservation was successful.
+/* Sysfs files of a pin, pins stay exported and open once reserved */
+struct gpio_pin {
+    bool exported;      /* True if the pin is exported */
+    int value_fd;       /* The open value file, -1 if not open */
+    int direction_fd;   /* The open direction file, -1 if not open */
+    int direction;      /* The last direction written, GPIO_ERR if unknown */
+};
+
+static struct gpio_pin pins[28] = {
+    [0 ... 27] = { false, -1, -1, GPIO_ERR }
+};
+
+/* Protects the pin table, pins are used from the pulse threads as well */
+static pthread_mutex_t pins_lock = PTHREAD_MUTEX_INITIALIZER;
+
+/* The backend in use */
+static int backend = GPIO_BACKEND_SYSFS;
+
+/**
+ * Export a GPIO through the controller class. 
+ * @param gpio the GPIO pin to export.
+ * @return true if the pin is exported.
  */
-bool gpio_reserve(int gpio) {
+static bool gpio_export(int gpio)
+{
     int fd; /* File descriptor for GPIO controller class */
     char buf[3]; /* Write buffer */
-
-    /* Check if GPIO is valid */
-    if (gpio > 27 || !gpio_config[gpio]) {
-        return false;
-    }
+    char path[HW_PATH_MAX]; /* Path of the GPIO controller class */
+    bool ok;
 
     /* Try to open GPIO controller class */
-    fd = open("/sys/class/gpio/export", O_WRONLY);
+    fd = open(helper_hw_path(path, sizeof(path), "/sys/class/gpio/export"), O_WRONLY);
     if (fd < 0) {
         /* The file could not be opened */
-        log_message(LOG_DEBUG, "gpio_reserve: could not open /sys/class/gpio/export\r\n");
+        log_message(LOG_DEBUG, "gpio_export: could not open /sys/class/gpio/export\r\n");
         return false;
     }
 
     /* Prepare buffer */
     sprintf(buf, "%d", gpio);
 
-    /* Try to reserve GPIO */
+    /* A pin that is already exported is busy */
+    ok = write(fd, buf, strlen(buf)) >= 0 || errno == EBUSY;
+    if (!ok) {
+        log_message(LOG_DEBUG, "gpio_export: could not write '%s' to /sys/class/gpio/export\r\n", buf);
+    }
+
+    close(fd);
+    return ok;
+}
+
+/**
+ * Unexport a GPIO so its line can be requested through the character device. 
+ * @param gpio the GPIO pin to unexport.
+ */
+static void gpio_unexport(int gpio)
+{
+    int fd;
+    char buf[3];
+    char path[HW_PATH_MAX];
+
+    fd = open(helper_hw_path(path, sizeof(path), "/sys/class/gpio/unexport"), O_WRONLY);
+    if (fd < 0)
+        return;
+
+    /* Pins that are not exported fail, that is fine */
+    sprintf(buf, "%d", gpio);
     if (write(fd, buf, strlen(buf)) < 0) {
-        close(fd);
-        log_message(LOG_DEBUG, "gpio_reserve: could not write '%s' to /sys/class/gpio/export\r\n", buf);
-        return false;
+        log_message(LOG_DEBUG, "gpio_unexport: GPIO %d was not exported\r\n", gpio);
     }
 
-    /* Close the GPIO controller class */
-    if (close(fd) < 0) {
-        log_message(LOG_DEBUG, "gpio_reserve: could not close /sys/class/gpio/export\r\n");
+    close(fd);
+}
+
+/**
+ * Close the files of a pin, it is exported and opened again on next use. 
+ * The pin table must be locked.
+ * @param gpio the GPIO pin to close.
+ */
+static void gpio_pin_close(int gpio)
+{
+    struct gpio_pin *pin = &pins[gpio];
+
+    if (pin->value_fd >= 0)
+        close(pin->value_fd);
+    if (pin->direction_fd >= 0)
+        close(pin->direction_fd);
+
+    pin->exported = false;
+    pin->value_fd = -1;
+    pin->direction_fd = -1;
+    pin->direction = GPIO_ERR;
+}
+
+/**
+ * Make sure a pin is exported and its files are open. The pin
+ * table must be locked.
+ * @param gpio the GPIO pin to open.
+ * @return true if the pin is ready for use.
+ */
+static bool gpio_pin_open(int gpio)
+{
+    struct gpio_pin *pin = &pins[gpio];
+    char buf[HW_PATH_MAX];
+
+    if (pin->value_fd >= 0)
+        return true;
+
+    if (!pin->exported && !(pin->exported = gpio_export(gpio)))
+        return false;
+
+    helper_hw_path(buf, sizeof(buf), "/sys/class/gpio/gpio%d/value", gpio);
+    pin->value_fd = open(buf, O_RDWR);
+
+    helper_hw_path(buf, sizeof(buf), "/sys/class/gpio/gpio%d/direction", gpio);
+    pin->direction_fd = open(buf, O_RDWR);
+
+    if (pin->value_fd < 0 || pin->direction_fd < 0) {
+        log_message(LOG_DEBUG, "gpio_pin_open: could not open the files of GPIO %d\r\n", gpio);
+        gpio_pin_close(gpio);
         return false;
     }
 
-    /* Success */
     return true;
 }
 
-/*
- * Release a GPIO after use.
- * @gpio the GPIO pin to release.
- * @return true if the release was successful.
+/**
+ * Read or write the value or direction file of a pin at offset 0. 
+ * When another process unexported the pin meanwhile the access fails,
+ * the pin is then exported and opened again and the access is retried
+ * once. The pin table must be locked.
+ * @param gpio the GPIO pin.
+ * @param direction true for the direction file, false for the value file.
+ * @param data the data to write, NULL to read.
+ * @param buf the buffer to read into.
+ * @param len the number of bytes to read or write.
+ * @return the number of bytes read or written, -1 on error.
  */
-bool gpio_release(int gpio) {
-    int fd; /* File descriptor for GPIO controller class */
-    char buf[3]; /* Write buffer */
+static ssize_t gpio_pin_io(int gpio, bool direction, const char *data, char *buf, size_t len)
+{
+    ssize_t r = -1;
+    int fd;
 
-    /* Check if GPIO is valid */
-    if (gpio > 27 || !gpio_config[gpio]) {
-        return false;
+    for (int attempt = 0; attempt < 2; ++attempt) {
+        if (!gpio_pin_open(gpio))
+            return -1;
+
+        fd = direction ? pins[gpio].direction_fd : pins[gpio].value_fd;
+        r = data ? pwrite(fd, data, len, 0) : pread(fd, buf, len, 0);
+
+        /* Writing the value of an input is refused, that is no stale pin */
+        if (r >= 0 || errno == EPERM)
+            break;
+
+        gpio_pin_close(gpio);
     }
 
-    /* Try to open GPIO controller class */
-    fd = open("/sys/class/gpio/unexport", O_WRONLY);
-    if (fd < 0) {
-        /* The file could not be opened */
-        log_message(LOG_DEBUG, "gpio_release: could not open /sys/class/gpio/unexport\r\n");
-        return false;
+    return r;
+}
+
+/**
+ * Select the GPIO backend from the configuration. The registers are only
+ * used when 'mmio' is configured. The character device is used when it 
+ * is configured, 'auto' or the registers could not be mapped, and it can
+ * be opened, sysfs otherwise. Until this is called sysfs is used.
+ * @return the backend in use, one of the GPIO_BACKEND_* macros.
+ */
+int gpio_init(void)
+{
+    char chip[HW_PATH_MAX];
+    bool ok;
+
+    if (strcmp(conf->gpio_backend, "sysfs") == 0) {
+        backend = GPIO_BACKEND_SYSFS;
+        return backend;
     }
 
-    /* Prepare buffer */
-    sprintf(buf, "%d", gpio);
+    if (strcmp(conf->gpio_backend, "mmio") == 0) {
+        if (gpio_mmio_open(helper_hw_path(chip, sizeof(chip), "/dev/mem"))) {
+            backend = GPIO_BACKEND_MMIO;
+            log_message(LOG_INFO, "Using the GPIO registers through %s\r\n", chip);
+            return backend;
+        }
+        log_message(LOG_WARNING, "Could not map the GPIO registers through %s\r\n", chip);
+    } else if (strcmp(conf->gpio_backend, "cdev") != 0 && strcmp(conf->gpio_backend, "auto") != 0) {
+        log_message(LOG_WARNING, "Unknown GPIO backend '%s', trying the character device\r\n", conf->gpio_backend);
+    }
 
-    /* Try to release GPIO */
-    if (write(fd, buf, strlen(buf)) < 0) {
-        log_message(LOG_DEBUG, "gpio_release: could not write /sys/class/gpio/unexport\r\n");
-        return false;
+    helper_hw_path(chip, sizeof(chip), "%s", conf->gpio_chip);
+    ok = gpio_cdev_open(chip);
+
+    /* Pins left exported by an earlier run hold their lines */
+    if (!ok && errno == EBUSY) {
+        pthread_mutex_lock(&pins_lock);
+        for (int gpio = 0; gpio < 28; ++gpio) {
+            if (gpio_config[gpio]) {
+                gpio_pin_close(gpio);
+                gpio_unexport(gpio);
+            }
+        }
+        pthread_mutex_unlock(&pins_lock);
+
+        ok = gpio_cdev_open(chip);
+    }
+
+    if (ok) {
+        backend = GPIO_BACKEND_CDEV;
+        log_message(LOG_INFO, "Using GPIO character device %s\r\n", chip);
+    } else {
+        backend = GPIO_BACKEND_SYSFS;
+        if (strcmp(conf->gpio_backend, "auto") == 0) {
+            log_message(LOG_INFO, "GPIO character device %s is not usable, using sysfs\r\n", chip);
+        } else {
+            log_message(LOG_WARNING, "GPIO character device %s is not usable, using sysfs\r\n", chip);
+        }
     }
 
-    /* Close the GPIO controller class */
-    if (close(fd) < 0) {
-        log_message(LOG_DEBUG, "gpio_release: could not close /sys/class/gpio/unexport\r\n");
+    return backend;
+}
+
+/**
+ * Get the GPIO backend in use.
+ * @return one of the GPIO_BACKEND_* macros.
+ */
+int gpio_get_backend(void)
+{
+    return backend;
+}
+
+/*
+ * Reserve a GPIO for this program's use. The pin is exported and
+ * its files are opened the first time, later calls are free.
+ * @gpio the GPIO pin to reserve.
+ * @return true if the reservation was successful.
+ */
+bool gpio_reserve(int gpio) {
+    bool ok;
+
+    /* Check if GPIO is valid */
+    if (gpio > 27 || !gpio_config[gpio]) {
         return false;
     }
 
-    /* Success */
-    return true;
+    /* The line request holds every exposed pin, registers need no reservation */
+    if (backend != GPIO_BACKEND_SYSFS) {
+        return true;
+    }
+
+    pthread_mutex_lock(&pins_lock);
+    ok = gpio_pin_open(gpio);
+    pthread_mutex_unlock(&pins_lock);
+
+    return ok;
+}
+
+/*
+ * Release a GPIO after use. The pin stays exported and open so
+ * the next access does not have to export it again.
+ * @gpio the GPIO pin to release.
+ * @return true if the release was successful.
+ */
+bool gpio_release(int gpio) {
+    /* Check if GPIO is valid */
+    return gpio <= 27 && gpio_config[gpio];
 }
 
 /*
@@ -158,92 +352,197 @@ bool gpio_release(int gpio) {
  * @return true if the direction could be successfully set.
  */
 bool gpio_set_direction(int gpio, int direction) {
-    int fd; /* File descriptor for GPIO port */
-    char buf[33]; /* Write buffer */
+    bool ok = true;
 
     /* Check if GPIO is valid */
     if (gpio > 27 || !gpio_config[gpio]) {
         return false;
     }
 
-    /* Make the GPIO port path */
-    sprintf(buf, "/sys/class/gpio/gpio%d/direction", gpio);
+    /* A watched input must stop reporting edges first */
+    gpio_monitor_direction(gpio, direction);
+
+    if (backend == GPIO_BACKEND_CDEV) {
+        ok = gpio_cdev_set_direction(gpio, direction);
+        gpio_monitor_direction_done(gpio, ok ? direction : GPIO_ERR);
+        return ok;
+    } else if (backend == GPIO_BACKEND_MMIO) {
+        ok = gpio_mmio_set_direction(1u << gpio, direction);
+        gpio_monitor_direction_done(gpio, ok ? direction : GPIO_ERR);
+        return ok;
+    }
 
-    /* Try to open GPIO port for writing only */
-    fd = open(buf, O_WRONLY);
-    if (fd < 0) {
-        /* The file could not be opened */
-        return false;
+    pthread_mutex_lock(&pins_lock);
+
+    /* 
+     * Writing 'out' drives the pin low, skip it when the pin is known to be
+     * an output, a write refused by another process making it an input is
+     * retried by gpio_set_state. Writing 'in' is harmless and never skipped,
+     * another process may have made the pin an output.
+     */
+    if (direction == GPIO_IN) {
+        ok = gpio_pin_io(gpio, true, "in", NULL, 2) >= 0;
+        pins[gpio].direction = ok ? GPIO_IN : GPIO_ERR;
+    } else if (pins[gpio].direction != GPIO_OUT || pins[gpio].value_fd < 0) {
+        ok = gpio_pin_io(gpio, true, "out", NULL, 3) >= 0;
+        pins[gpio].direction = ok ? GPIO_OUT : GPIO_ERR;
     }
 
-    /* Set the port direction */
-    if (direction == GPIO_OUT) {
-        if (write(fd, "out", 3) < 0) {
+    pthread_mutex_unlock(&pins_lock);
+
+    gpio_monitor_direction_done(gpio, ok ? direction : GPIO_ERR);
+
+    return ok;
+}
+
+/**
+ * Set the direction of several GPIO ports. The character device and
+ * the registers change all of them in one operation.
+ * @param mask bit n set to change GPIO n, only exposed ports are allowed.
+ * @param outputs bit n set to make GPIO n an output, an input otherwise.
+ * @return true if all directions were set.
+ */
+bool gpio_set_directions(uint32_t mask, uint32_t outputs) {
+    bool ok = true;
+
+    /* Refuse ports that are not exposed */
+    for (int i = 0; i < 32; ++i) {
+        if ((mask & (1u << i)) && (i > 27 || !gpio_config[i])) {
             return false;
         }
+    }
+
+    if (backend == GPIO_BACKEND_SYSFS) {
+        for (int i = 0; i < 28; ++i) {
+            if (mask & (1u << i)) {
+                ok &= gpio_set_direction(i, outputs & (1u << i) ? GPIO_OUT : GPIO_IN);
+            }
+        }
+        return ok;
+    }
+
+    /* Watched inputs must stop reporting edges first */
+    for (int i = 0; i < 28; ++i) {
+        if (mask & (1u << i)) {
+            gpio_monitor_direction(i, outputs & (1u << i) ? GPIO_OUT : GPIO_IN);
+        }
+    }
+
+    if (backend == GPIO_BACKEND_MMIO) {
+        ok = gpio_mmio_set_direction(mask & outputs, GPIO_OUT) && 
+                gpio_mmio_set_direction(mask & ~outputs, GPIO_IN);
     } else {
-        if (write(fd, "in", 2) < 0) {
+        ok = gpio_cdev_set_directions(mask, outputs);
+    }
+
+    for (int i = 0; i < 28; ++i) {
+        if (mask & (1u << i)) {
+            gpio_monitor_direction_done(i, !ok ? GPIO_ERR : outputs & (1u << i) ? GPIO_OUT : GPIO_IN);
+        }
+    }
+
+    return ok;
+}
+
+/**
+ * Make several GPIO ports outputs driving the given levels. The level
+ * is set before a port drives it, an input never drives a stale level.
+ * @param mask bit n set to change GPIO n, only exposed ports are allowed.
+ * @param values bit n set to drive GPIO n high.
+ * @return true if all ports were set.
+ */
+bool gpio_set_outputs(uint32_t mask, uint32_t values) {
+    uint32_t failed = 0;
+
+    /* Refuse ports that are not exposed */
+    for (int i = 0; i < 32; ++i) {
+        if ((mask & (1u << i)) && (i > 27 || !gpio_config[i])) {
             return false;
         }
     }
 
-    /* Close the GPIO port */
-    if (close(fd) < 0) {
-        return false;
+    /* Watched inputs must stop reporting edges first */
+    for (int i = 0; i < 28; ++i) {
+        if (mask & (1u << i)) {
+            gpio_monitor_direction(i, GPIO_OUT);
+        }
     }
 
-    /* Success */
-    return true;
+    if (backend == GPIO_BACKEND_CDEV) {
+        /* The levels are part of the line configuration */
+        failed = gpio_cdev_set_outputs(mask, values) ? 0 : mask;
+    } else if (backend == GPIO_BACKEND_MMIO) {
+        /* The data register is written before the output enable */
+        failed = gpio_mmio_write(mask, values) && gpio_mmio_set_direction(mask, GPIO_OUT) ? 0 : mask;
+    } else {
+        pthread_mutex_lock(&pins_lock);
+
+        /* 'high' and 'low' make the pin an output at that level */
+        for (int i = 0; i < 28; ++i) {
+            if (mask & (1u << i)) {
+                bool high = values & (1u << i);
+                bool ok = gpio_pin_io(i, true, high ? "high" : "low", NULL, high ? 4 : 3) >= 0;
+
+                pins[i].direction = ok ? GPIO_OUT : GPIO_ERR;
+                if (!ok) {
+                    failed |= 1u << i;
+                }
+            }
+        }
+
+        pthread_mutex_unlock(&pins_lock);
+    }
+
+    for (int i = 0; i < 28; ++i) {
+        if (mask & (1u << i)) {
+            gpio_monitor_direction_done(i, failed & (1u << i) ? GPIO_ERR : GPIO_OUT);
+        }
+    }
+
+    if (backend != GPIO_BACKEND_MMIO && (mask & ~failed)) {
+        gpio_monitor_update(mask & ~failed, values, true);
+    }
+
+    return !failed;
 }
 
 
 /**
- * Get the direction of a GPIO port.
+ * Get the direction of a GPIO port. The direction file is read every
+ * time, another process may have changed the direction.
  * @param gpio the GPIO port to set the direction for. 
  * @return GPIO_IN if input, GPIO_OUT if output. GPIO_ERR when
  * an error occured.
  */
 int gpio_get_direction(int gpio)
 {
-    int fd; /* File descriptor for GPIO port */
-    char buf[33]; /* Write buffer */
     char dir;
-    int state;
+    int state = GPIO_ERR;
 
     /* Check if GPIO is valid */
     if (gpio > 27 || !gpio_config[gpio]) {
         return GPIO_ERR;
     }
 
-    /* Make the GPIO port path */
-    sprintf(buf, "/sys/class/gpio/gpio%d/direction", gpio);
-
-    /* Try to open GPIO port fro writing only */
-    fd = open(buf, O_RDONLY);
-    if (fd < 0) {
-        /* The file could not be opened */
-        log_message(LOG_DEBUG, "gpio_get_direction: could not open /sys/class/gpio/gpio%d/direction\r\n", gpio);
-        return GPIO_ERR;
-    }
-    
-    /* Read the port direction */
-    if (read(fd, &dir, 1) < 0) {
-        close(fd);
-        log_message(LOG_DEBUG, "gpio_get_direction: could not read /sys/class/gpio/gpio%d/direction\r\n", gpio);
-        return GPIO_ERR;
+    if (backend == GPIO_BACKEND_CDEV) {
+        return gpio_cdev_get_direction(gpio);
+    } else if (backend == GPIO_BACKEND_MMIO) {
+        return gpio_mmio_outputs() & (1u << gpio) ? GPIO_OUT : GPIO_IN;
     }
 
-    /* Translate the port state into API state */
-    state = dir == 'i' ? GPIO_IN : GPIO_OUT;
+    pthread_mutex_lock(&pins_lock);
 
-    /* Close the GPIO port */
-    if (close(fd) < 0) {
-        log_message(LOG_DEBUG, "gpio_get_direction: could not close /sys/class/gpio/gpio%d/direction\r\n", gpio);
-        return GPIO_ERR;
+    /* Read and translate the port direction into API direction */
+    if (gpio_pin_io(gpio, true, NULL, &dir, 1) == 1) {
+        state = dir == 'i' ? GPIO_IN : GPIO_OUT;
+        pins[gpio].direction = state;
+    } else {
+        log_message(LOG_DEBUG, "gpio_get_direction: could not read /sys/class/gpio/gpio%d/direction\r\n", gpio);
     }
 
-    /* Success */
-    return state;    
+    pthread_mutex_unlock(&pins_lock);
+
+    return state;
 }
 
 /*
@@ -253,36 +552,41 @@ int gpio_get_direction(int gpio)
  * @return true if the state change was successful.
  */
 bool gpio_set_state(int gpio, int state) {
-    int fd; /* File descriptor for GPIO port */
-    char buf[29]; /* Write buffer */
+    METRICS_TIME(METRICS_CALL_GPIO);
+    bool ok;
 
     /* Check if GPIO is valid */
     if (gpio > 27 || !gpio_config[gpio]) {
         return false;
     }
 
-    /* Make the GPIO port path */
-    sprintf(buf, "/sys/class/gpio/gpio%d/value", gpio);
-
-    /* Try to open GPIO port */
-    fd = open(buf, O_WRONLY);
-    if (fd < 0) {
-        /* The file could not be opened */
-        return false;
-    }
+    if (backend == GPIO_BACKEND_CDEV) {
+        ok = gpio_cdev_set_values(1u << gpio, state == GPIO_HIGH ? 1u << gpio : 0);
+    } else if (backend == GPIO_BACKEND_MMIO) {
+        return gpio_mmio_write(1u << gpio, state == GPIO_HIGH ? 1u << gpio : 0);
+    } else {
+        pthread_mutex_lock(&pins_lock);
+
+        ok = gpio_pin_io(gpio, false, state == GPIO_HIGH ? "1" : "0", NULL, 1) >= 0;
+
+        /* The pin was made an input by another process, 'high' and 'low' make it an output at that level */
+        if (!ok && errno == EPERM) {
+            if (state == GPIO_HIGH) {
+                ok = gpio_pin_io(gpio, true, "high", NULL, 4) >= 0;
+            } else {
+                ok = gpio_pin_io(gpio, true, "low", NULL, 3) >= 0;
+            }
+            pins[gpio].direction = ok ? GPIO_OUT : GPIO_ERR;
+        }
 
-    /* Set the port state */
-    if (write(fd, (state == GPIO_HIGH ? "1" : "0"), 1) < 0) {
-        return false;
+        pthread_mutex_unlock(&pins_lock);
     }
 
-    /* Close the GPIO port */
-    if (close(fd) < 0) {
-        return false;
+    if (ok) {
+        gpio_monitor_update(1u << gpio, state == GPIO_HIGH ? 1u << gpio : 0, true);
     }
 
-    /* Success */
-    return true;
+    return ok;
 }
 
 /*
@@ -292,41 +596,44 @@ bool gpio_set_state(int gpio, int state) {
  * when an error occured. 
  */
 int gpio_get_state(int gpio) {
-    int fd;             /* File descriptor for GPIO port */
-    char buf[29];       /* Write buffer */
+    METRICS_TIME(METRICS_CALL_GPIO);
     char port_state; /* Character indicating the port state */
-    int state; /* API integer indicating the port state */
+    int state = GPIO_ERR; /* API integer indicating the port state */
+    uint32_t values; /* Line values of the character device */
 
     /* Check if GPIO is valid */
     if (gpio > 27 || !gpio_config[gpio]) {
         return GPIO_ERR;
     }
 
-    /* Make the GPIO port path */
-    sprintf(buf, "/sys/class/gpio/gpio%d/value", gpio);
+    /* Watched inputs and written outputs are answered from memory */
+    if ((state = gpio_monitor_get(gpio, NULL)) != GPIO_ERR) {
+        return state;
+    }
 
-    /* Try to open GPIO port */
-    fd = open(buf, O_RDONLY);
-    if (fd < 0) {
-        /* The file could not be opened */
-        log_message(LOG_DEBUG, "gpio_get_state: could not open /sys/class/gpio/gpio%d/value\r\n", gpio);
-        return GPIO_ERR;
+    if (backend == GPIO_BACKEND_CDEV) {
+        state = gpio_cdev_get_values(&values) ? (values >> gpio) & 1 : GPIO_ERR;
+        if (state != GPIO_ERR) {
+            gpio_monitor_update(1u << gpio, values, false);
+        }
+        return state;
+    } else if (backend == GPIO_BACKEND_MMIO) {
+        return (gpio_mmio_read() >> gpio) & 1;
     }
 
-    /* Read the port state */
-    if (read(fd, &port_state, 1) < 0) {
-        close(fd);
+    pthread_mutex_lock(&pins_lock);
+
+    /* Read and translate the port state into API state */
+    if (gpio_pin_io(gpio, false, NULL, &port_state, 1) == 1) {
+        state = port_state == '1' ? GPIO_HIGH : GPIO_LOW;
+    } else {
         log_message(LOG_DEBUG, "gpio_get_state: could not read /sys/class/gpio/gpio%d/value\r\n", gpio);
-        return GPIO_ERR;
     }
 
-    /* Translate the port state into API state */
-    state = port_state == '1' ? GPIO_HIGH : GPIO_LOW;
+    pthread_mutex_unlock(&pins_lock);
 
-    /* Close the GPIO port */
-    if (close(fd) < 0) {
-        log_message(LOG_DEBUG, "gpio_get_state: could not close /sys/class/gpio/gpio%d/value\r\n", gpio);
-        return GPIO_ERR;
+    if (state != GPIO_ERR) {
+        gpio_monitor_update(1u << gpio, state == GPIO_HIGH ? 1u << gpio : 0, false);
     }
 
     /* Return the state */
@@ -374,42 +681,120 @@ int gpio_read_and_close(int gpio) {
 }
 
 /**
- * Arguments for the gpio pulse thread
+ * Read the states of all exposed GPIO ports at once. With the character
+ * device backend this is one system call, with the registers one read.
+ * @param states receives GPIO_HIGH or GPIO_LOW for every port, GPIO_ERR
+ * for ports that are not exposed or could not be read.
+ * @return true if all exposed ports could be read.
  */
-struct _gpio_pulse_args {
-    int port;
-    int useconds;
-    int mode;
-};
+bool gpio_get_states(int states[28])
+{
+    uint32_t missing = 0;
+    uint32_t values;
+    bool ok = true;
+
+    /* Watched inputs and written outputs are answered from memory */
+    for (int i = 0; i < 28; ++i) {
+        states[i] = gpio_config[i] ? gpio_monitor_get(i, NULL) : GPIO_ERR;
+        if (gpio_config[i] && states[i] == GPIO_ERR) {
+            missing |= 1u << i;
+        }
+    }
+
+    if (missing == 0) {
+        return true;
+    }
+
+    if (backend != GPIO_BACKEND_SYSFS) {
+        METRICS_TIME(METRICS_CALL_GPIO);
+
+        if (backend == GPIO_BACKEND_MMIO) {
+            values = gpio_mmio_read();
+        } else if ((ok = gpio_cdev_get_values(&values))) {
+            gpio_monitor_update(missing, values, false);
+        }
+        for (int i = 0; i < 28; ++i) {
+            if (missing & (1u << i)) {
+                states[i] = ok ? (values >> i) & 1 : GPIO_ERR;
+            }
+        }
+        return ok;
+    }
+
+    for (int i = 0; i < 28; ++i) {
+        if (missing & (1u << i)) {
+            states[i] = gpio_get_state(i);
+            ok &= states[i] != GPIO_ERR;
+        }
+    }
+
+    return ok;
+}
 
 /**
- * The entry point of the GPIO pulse thread.
- * @param args the arguments for this entry point. 
+ * Read the directions of all exposed GPIO ports at once. 
+ * @param directions receives GPIO_IN or GPIO_OUT for every port, GPIO_ERR
+ * for ports that are not exposed or could not be read.
+ * @return true if all exposed ports could be read.
  */
-static void* _gpio_pulse(void *arguments) {
-    struct _gpio_pulse_args *args = (struct _gpio_pulse_args*) arguments;
-    
-    /* Set port as output */
-    gpio_set_direction(args->port, GPIO_OUT);
-    
-    /* Execute the command */
-    if(args->mode == GPIO_ACT_HIGH) {
-        gpio_set_state(args->port, GPIO_HIGH);
-        usleep(args->useconds);
-        gpio_set_state(args->port, GPIO_LOW);
-        
-    } else {
-        gpio_set_state(args->port, GPIO_LOW);
-        usleep(args->useconds);
-        gpio_set_state(args->port, GPIO_HIGH);
-    }
-    
-    /* Release the port */
-    gpio_release(args->port);
-    
-    /* Free the arguments*/
-    free(arguments);
-    pthread_exit(NULL);
+bool gpio_get_directions(int directions[28])
+{
+    uint32_t outputs;
+    bool ok = true;
+
+    if (backend == GPIO_BACKEND_MMIO) {
+        outputs = gpio_mmio_outputs();
+        for (int i = 0; i < 28; ++i) {
+            directions[i] = !gpio_config[i] ? GPIO_ERR : outputs & (1u << i) ? GPIO_OUT : GPIO_IN;
+        }
+        return true;
+    }
+
+    for (int i = 0; i < 28; ++i) {
+        directions[i] = gpio_get_direction(i);
+        ok &= directions[i] != GPIO_ERR || !gpio_config[i];
+    }
+
+    return ok;
+}
+
+/**
+ * Set the states of several output ports at once. With the character
+ * device backend all ports change with one system call, with the
+ * registers with one write per level.
+ * @param mask bit n set to change GPIO n, only exposed ports are allowed.
+ * @param values bit n set to make GPIO n high.
+ * @return true if all ports were set.
+ */
+bool gpio_set_states(uint32_t mask, uint32_t values)
+{
+    bool ok = true;
+
+    /* Refuse ports that are not exposed */
+    for (int i = 0; i < 32; ++i) {
+        if ((mask & (1u << i)) && (i > 27 || !gpio_config[i])) {
+            return false;
+        }
+    }
+
+    if (backend == GPIO_BACKEND_CDEV) {
+        METRICS_TIME(METRICS_CALL_GPIO);
+        ok = gpio_cdev_set_values(mask, values);
+        if (ok) {
+            gpio_monitor_update(mask, values, true);
+        }
+        return ok;
+    } else if (backend == GPIO_BACKEND_MMIO) {
+        return gpio_mmio_write(mask, values);
+    }
+
+    for (int i = 0; i < 28; ++i) {
+        if (mask & (1u << i)) {
+            ok &= gpio_set_state(i, (values >> i) & 1 ? GPIO_HIGH : GPIO_LOW);
+        }
+    }
+
+    return ok;
 }
 
 /**
@@ -421,24 +806,10 @@ static void* _gpio_pulse(void *arguments) {
  */
 bool gpio_pulse(int gpio, int useconds, int mode)
 {
-    pthread_t thread;
-    struct _gpio_pulse_args *args = (struct _gpio_pulse_args*) calloc(1, sizeof(struct _gpio_pulse_args));
-
-    args->port = gpio;
-    args->useconds = useconds;
-    args->mode = mode;
-    
-    /* Reserve the port */
-    if(!gpio_reserve(gpio)){
+    if (useconds < 0) {
         return false;
     }
-    
-    /* Start the download */
-    if(pthread_create(&thread, NULL, _gpio_pulse, (void*) args) != 0) {
-        log_message(LOG_ERROR, "Could not start GPIO pulse thread\r\n");
-        return false;
-    }
-    pthread_detach(thread);
-    
-    return true;
+
+    /* The pulse scheduler makes the falling edge */
+    return gpio_pulse_train(gpio, mode, useconds, 0, 1);
 }
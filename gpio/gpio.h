@@ -32,6 +32,7 @@
 #define GPIO_H_
 
 #include <stdbool.h>
+#include <stdint.h>
 
 /* Direction macros */
 #define GPIO_OUT	0		/* GPIO output direction */
@@ -48,9 +49,29 @@
 #define GPIO_ACT_LOW    0               /* Use GPIO as active low mode */
 #define GPIO_ACT_HIGH   1               /* Use GPIO as active high mode */       
 
+/* GPIO backends */
+#define GPIO_BACKEND_SYSFS  0               /* One sysfs file access per pin */
+#define GPIO_BACKEND_CDEV   1               /* One line request for all pins */
+#define GPIO_BACKEND_MMIO   2               /* Direct access to the GPIO registers */
+
 /* GPIO layout map */
 extern const bool gpio_config[28];
 
+/**
+ * Select the GPIO backend from the configuration. The registers are only
+ * used when 'mmio' is configured. The character device is used when it 
+ * is configured, 'auto' or the registers could not be mapped, and it can
+ * be opened, sysfs otherwise. Until this is called sysfs is used.
+ * @return the backend in use, one of the GPIO_BACKEND_* macros.
+ */
+int gpio_init(void);
+
+/**
+ * Get the GPIO backend in use.
+ * @return one of the GPIO_BACKEND_* macros.
+ */
+int gpio_get_backend(void);
+
 /*
  * Reserve a GPIO for this program's use.
  * @gpio the GPIO pin to reserve.
@@ -73,6 +94,24 @@ bool gpio_release(int gpio);
  */
 bool gpio_set_direction(int gpio, int direction);
 
+/**
+ * Set the direction of several GPIO ports. The character device and
+ * the registers change all of them in one operation.
+ * @param mask bit n set to change GPIO n, only exposed ports are allowed.
+ * @param outputs bit n set to make GPIO n an output, an input otherwise.
+ * @return true if all directions were set.
+ */
+bool gpio_set_directions(uint32_t mask, uint32_t outputs);
+
+/**
+ * Make several GPIO ports outputs driving the given levels. The level
+ * is set before a port drives it, an input never drives a stale level.
+ * @param mask bit n set to change GPIO n, only exposed ports are allowed.
+ * @param values bit n set to drive GPIO n high.
+ * @return true if all ports were set.
+ */
+bool gpio_set_outputs(uint32_t mask, uint32_t values);
+
 /**
  * Get the direction of a GPIO port.
  * @param gpio the GPIO port to set the direction for. 
@@ -115,6 +154,33 @@ bool gpio_write_and_close(int gpio, int state);
  */
 int gpio_read_and_close(int gpio);
 
+/**
+ * Read the states of all exposed GPIO ports at once. With the character
+ * device backend this is one system call, with the registers one read.
+ * @param states receives GPIO_HIGH or GPIO_LOW for every port, GPIO_ERR
+ * for ports that are not exposed or could not be read.
+ * @return true if all exposed ports could be read.
+ */
+bool gpio_get_states(int states[28]);
+
+/**
+ * Read the directions of all exposed GPIO ports at once. 
+ * @param directions receives GPIO_IN or GPIO_OUT for every port, GPIO_ERR
+ * for ports that are not exposed or could not be read.
+ * @return true if all exposed ports could be read.
+ */
+bool gpio_get_directions(int directions[28]);
+
+/**
+ * Set the states of several output ports at once. With the character
+ * device backend all ports change with one system call, with the
+ * registers with one write per level.
+ * @param mask bit n set to change GPIO n, only exposed ports are allowed.
+ * @param values bit n set to make GPIO n high.
+ * @return true if all ports were set.
+ */
+bool gpio_set_states(uint32_t mask, uint32_t values);
+
 /**
  * Pulse a GPIO port for a certain number of micro seconcs. 
  * @param gpio the GPIO port to pulse
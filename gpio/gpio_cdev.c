@@ -0,0 +1,496 @@
+/* 
+ * Copyright (c) 2014, Daan Pape
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without 
+ * modification, are permitted provided that the following conditions are met:
+ * 
+ *     1. Redistributions of source code must retain the above copyright 
+ *        notice, this list of conditions and the following disclaimer.
+ *
+ *     2. Redistributions in binary form must reproduce the above copyright 
+ *        notice, this list of conditions and the following disclaimer in the 
+ *        documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" 
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE 
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE 
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE 
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR 
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF 
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS 
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN 
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) 
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE 
+ * POSSIBILITY OF SUCH DAMAGE.
+ * 
+ * File:   gpio_cdev.c
+ * Created on October 18, 2026, 10:12 AM
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <pthread.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+
+#include "../logger.h"
+#include "gpio.h"
+#include "gpio_cdev.h"
+
+#ifdef HAVE_GPIO_CDEV
+
+#include <linux/gpio.h>
+
+/* The line request holding all exposed GPIO lines, -1 if not requested */
+static int line_fd = -1;
+
+/* Index of a GPIO in the line request, -1 if it is not requested */
+static int line_index[28] = {
+    [0 ... 27] = -1
+};
+
+/* GPIO of each line in the line request */
+static int line_gpio[28];
+static int num_lines;
+
+/* Direction of every requested line */
+static int line_dir[28];
+
+/* True when input lines report their edges */
+static bool edges = false;
+
+/* Protects the line configuration, reconfiguring reads the values first */
+static pthread_mutex_t config_lock = PTHREAD_MUTEX_INITIALIZER;
+
+/**
+ * Translate a GPIO bitmap into a line request bitmap.
+ * @param gpios bit n set for GPIO n.
+ * @return the line bitmap, bits of GPIOs that are not requested are dropped.
+ */
+static uint64_t gpio_cdev_to_lines(uint32_t gpios)
+{
+    uint64_t lines = 0;
+
+    for (int i = 0; i < num_lines; ++i) {
+        if (gpios & (1u << line_gpio[i]))
+            lines |= 1ull << i;
+    }
+
+    return lines;
+}
+
+/**
+ * Apply the directions of all lines in one line configuration. A new
+ * configuration replaces the old one for every line, so outputs are given
+ * the level they drive now and inputs keep reporting their edges when
+ * watched. Lines with an unknown direction are left as is. The 
+ * configuration must be locked.
+ * @param mask bit n set to give output n the level in levels instead.
+ * @param levels bit n set to drive GPIO n high.
+ * @return true on success.
+ */
+static bool gpio_cdev_configure(uint32_t mask, uint32_t levels)
+{
+    struct gpio_v2_line_config config;
+    struct gpio_v2_line_config_attribute *attr;
+    uint64_t inputs = 0;
+    uint64_t outputs = 0;
+    uint32_t values;
+
+    for (int i = 0; i < num_lines; ++i) {
+        if (line_dir[line_gpio[i]] == GPIO_IN) {
+            inputs |= 1ull << i;
+        } else if (line_dir[line_gpio[i]] == GPIO_OUT) {
+            outputs |= 1ull << i;
+        }
+    }
+
+    if (!gpio_cdev_get_values(&values))
+        return false;
+    values = (values & ~mask) | (levels & mask);
+
+    memset(&config, 0, sizeof(config));
+    if (inputs) {
+        attr = &config.attrs[config.num_attrs++];
+        attr->mask = inputs;
+        attr->attr.id = GPIO_V2_LINE_ATTR_ID_FLAGS;
+        attr->attr.flags = GPIO_V2_LINE_FLAG_INPUT;
+        if (edges)
+            attr->attr.flags |= GPIO_V2_LINE_FLAG_EDGE_RISING | GPIO_V2_LINE_FLAG_EDGE_FALLING;
+    }
+    if (outputs) {
+        attr = &config.attrs[config.num_attrs++];
+        attr->mask = outputs;
+        attr->attr.id = GPIO_V2_LINE_ATTR_ID_FLAGS;
+        attr->attr.flags = GPIO_V2_LINE_FLAG_OUTPUT;
+
+        attr = &config.attrs[config.num_attrs++];
+        attr->mask = outputs;
+        attr->attr.id = GPIO_V2_LINE_ATTR_ID_OUTPUT_VALUES;
+        attr->attr.values = gpio_cdev_to_lines(values) & outputs;
+    }
+
+    if (ioctl(line_fd, GPIO_V2_LINE_SET_CONFIG_IOCTL, &config) < 0) {
+        log_message(LOG_DEBUG, "gpio_cdev_configure: could not configure the lines\r\n");
+        return false;
+    }
+
+    return true;
+}
+
+/**
+ * Request all exposed GPIO lines of a GPIO character device in one
+ * line request. The lines keep their current direction and value.
+ * @param chip the path of the GPIO character device.
+ * @return true on success, errno is EBUSY when a line is in use.
+ */
+bool gpio_cdev_open(const char *chip)
+{
+    struct gpio_v2_line_request req;
+    struct gpio_v2_line_info info;
+    int chip_fd;
+    int err;
+
+    if (line_fd >= 0)
+        return true;
+
+    chip_fd = open(chip, O_RDWR | O_CLOEXEC);
+    if (chip_fd < 0) {
+        log_message(LOG_DEBUG, "gpio_cdev_open: could not open %s\r\n", chip);
+        return false;
+    }
+
+    /* Request every exposed line, without flags the direction is left as is */
+    memset(&req, 0, sizeof(req));
+    strncpy(req.consumer, "dpt-breakout-server", sizeof(req.consumer) - 1);
+    num_lines = 0;
+    for (int gpio = 0; gpio < 28; ++gpio) {
+        if (gpio_config[gpio]) {
+            req.offsets[num_lines] = gpio;
+            line_gpio[num_lines++] = gpio;
+        }
+    }
+    req.num_lines = num_lines;
+
+    if (ioctl(chip_fd, GPIO_V2_GET_LINE_IOCTL, &req) < 0) {
+        err = errno;
+        log_message(LOG_DEBUG, "gpio_cdev_open: could not request the lines of %s\r\n", chip);
+        close(chip_fd);
+        errno = err;
+        return false;
+    }
+
+    /* Learn the direction of every line once, nobody else can change it now */
+    for (int i = 0; i < num_lines; ++i) {
+        memset(&info, 0, sizeof(info));
+        info.offset = line_gpio[i];
+        if (ioctl(chip_fd, GPIO_V2_GET_LINEINFO_IOCTL, &info) < 0) {
+            log_message(LOG_DEBUG, "gpio_cdev_open: could not get the info of line %d\r\n", line_gpio[i]);
+            line_dir[line_gpio[i]] = GPIO_ERR;
+        } else {
+            line_dir[line_gpio[i]] = info.flags & GPIO_V2_LINE_FLAG_OUTPUT ? GPIO_OUT : GPIO_IN;
+        }
+        line_index[line_gpio[i]] = i;
+    }
+
+    close(chip_fd);
+    line_fd = req.fd;
+
+    return true;
+}
+
+/**
+ * Release the line request.
+ */
+void gpio_cdev_close(void)
+{
+    if (line_fd < 0)
+        return;
+
+    close(line_fd);
+    line_fd = -1;
+    edges = false;
+
+    for (int gpio = 0; gpio < 28; ++gpio)
+        line_index[gpio] = -1;
+    num_lines = 0;
+}
+
+/**
+ * Read the values of all requested lines with one system call.
+ * @param values receives bit n set when GPIO n is high.
+ * @return true on success.
+ */
+bool gpio_cdev_get_values(uint32_t *values)
+{
+    struct gpio_v2_line_values lv;
+
+    if (line_fd < 0)
+        return false;
+
+    lv.bits = 0;
+    lv.mask = num_lines == 64 ? ~0ull : (1ull << num_lines) - 1;
+    if (ioctl(line_fd, GPIO_V2_LINE_GET_VALUES_IOCTL, &lv) < 0) {
+        log_message(LOG_DEBUG, "gpio_cdev_get_values: could not read the line values\r\n");
+        return false;
+    }
+
+    *values = 0;
+    for (int i = 0; i < num_lines; ++i) {
+        if (lv.bits & (1ull << i))
+            *values |= 1u << line_gpio[i];
+    }
+
+    return true;
+}
+
+/**
+ * Set the values of several output lines with one system call.
+ * @param mask bit n set to change GPIO n.
+ * @param values bit n set to drive GPIO n high.
+ * @return true on success, errno is EPERM when a line is an input.
+ */
+bool gpio_cdev_set_values(uint32_t mask, uint32_t values)
+{
+    struct gpio_v2_line_values lv;
+    bool ok = true;
+
+    if (line_fd < 0)
+        return false;
+
+    lv.mask = gpio_cdev_to_lines(mask);
+    lv.bits = gpio_cdev_to_lines(values & mask);
+
+    /* A reconfiguration must not restore the levels from before this write */
+    pthread_mutex_lock(&config_lock);
+    if (ioctl(line_fd, GPIO_V2_LINE_SET_VALUES_IOCTL, &lv) < 0) {
+        log_message(LOG_DEBUG, "gpio_cdev_set_values: could not set the line values\r\n");
+        ok = false;
+    }
+    pthread_mutex_unlock(&config_lock);
+
+    return ok;
+}
+
+/**
+ * Get the direction of a requested line. Requested lines can't be
+ * changed by other processes so the direction is kept in memory.
+ * @param gpio the GPIO pin.
+ * @return GPIO_IN, GPIO_OUT or GPIO_ERR when the line is not requested.
+ */
+int gpio_cdev_get_direction(int gpio)
+{
+    int dir;
+
+    if (gpio < 0 || gpio > 27 || line_index[gpio] < 0)
+        return GPIO_ERR;
+
+    pthread_mutex_lock(&config_lock);
+    dir = line_dir[gpio];
+    pthread_mutex_unlock(&config_lock);
+
+    return dir;
+}
+
+/**
+ * Set the direction of a requested line. An output keeps
+ * driving the level the line had.
+ * @param gpio the GPIO pin.
+ * @param direction GPIO_IN or GPIO_OUT.
+ * @return true on success.
+ */
+bool gpio_cdev_set_direction(int gpio, int direction)
+{
+    if (gpio < 0 || gpio > 27)
+        return false;
+
+    return gpio_cdev_set_directions(1u << gpio, direction == GPIO_OUT ? 1u << gpio : 0);
+}
+
+/**
+ * Set the direction of several requested lines with one line
+ * configuration. Outputs keep driving the level the lines had.
+ * @param mask bit n set to change GPIO n.
+ * @param outputs bit n set to make GPIO n an output, an input otherwise.
+ * @return true on success, no direction is changed on failure.
+ */
+bool gpio_cdev_set_directions(uint32_t mask, uint32_t outputs)
+{
+    int old[28];
+    bool changed = false;
+    bool ok = true;
+
+    for (int gpio = 0; gpio < 28; ++gpio) {
+        if ((mask & (1u << gpio)) && line_index[gpio] < 0)
+            return false;
+    }
+
+    pthread_mutex_lock(&config_lock);
+
+    memcpy(old, line_dir, sizeof(old));
+    for (int gpio = 0; gpio < 28; ++gpio) {
+        int direction = outputs & (1u << gpio) ? GPIO_OUT : GPIO_IN;
+
+        if ((mask & (1u << gpio)) && line_dir[gpio] != direction) {
+            line_dir[gpio] = direction;
+            changed = true;
+        }
+    }
+
+    if (changed && !(ok = gpio_cdev_configure(0, 0))) {
+        memcpy(line_dir, old, sizeof(old));
+    }
+
+    pthread_mutex_unlock(&config_lock);
+
+    return ok;
+}
+
+/**
+ * Make several requested lines outputs with one line configuration.
+ * The lines drive the given levels from the start.
+ * @param mask bit n set to change GPIO n.
+ * @param values bit n set to drive GPIO n high.
+ * @return true on success, no line is changed on failure.
+ */
+bool gpio_cdev_set_outputs(uint32_t mask, uint32_t values)
+{
+    int old[28];
+    bool ok;
+
+    for (int gpio = 0; gpio < 28; ++gpio) {
+        if ((mask & (1u << gpio)) && line_index[gpio] < 0)
+            return false;
+    }
+
+    pthread_mutex_lock(&config_lock);
+
+    memcpy(old, line_dir, sizeof(old));
+    for (int gpio = 0; gpio < 28; ++gpio) {
+        if (mask & (1u << gpio))
+            line_dir[gpio] = GPIO_OUT;
+    }
+
+    if (!(ok = gpio_cdev_configure(mask, values))) {
+        memcpy(line_dir, old, sizeof(old));
+    }
+
+    pthread_mutex_unlock(&config_lock);
+
+    return ok;
+}
+
+/**
+ * Report edges of the input lines, or stop reporting them. The edges
+ * are read from the file descriptor of the line request.
+ * @param enable true to report edges.
+ * @return the file descriptor to watch, -1 on error.
+ */
+int gpio_cdev_watch(bool enable)
+{
+    bool ok;
+
+    if (line_fd < 0)
+        return -1;
+
+    pthread_mutex_lock(&config_lock);
+    edges = enable;
+    if (!(ok = gpio_cdev_configure(0, 0))) {
+        edges = false;
+    }
+    pthread_mutex_unlock(&config_lock);
+
+    return ok ? line_fd : -1;
+}
+
+/**
+ * Read the pending edges of the input lines without blocking. 
+ * @param events the buffer for the edges.
+ * @param max the size of the buffer.
+ * @return the number of edges read, 0 when none are pending.
+ */
+int gpio_cdev_read_events(struct gpio_cdev_event *events, int max)
+{
+    struct gpio_v2_line_event buf[16];
+    ssize_t len;
+    int n;
+
+    if (line_fd < 0 || max <= 0)
+        return 0;
+
+    if (max > 16)
+        max = 16;
+
+    len = read(line_fd, buf, max * sizeof(buf[0]));
+    if (len <= 0)
+        return 0;
+
+    n = len / sizeof(buf[0]);
+    for (int i = 0; i < n; ++i) {
+        events[i].gpio = buf[i].offset;
+        events[i].state = buf[i].id == GPIO_V2_LINE_EVENT_RISING_EDGE ? GPIO_HIGH : GPIO_LOW;
+        events[i].timestamp = buf[i].timestamp_ns;
+    }
+
+    return n;
+}
+
+#else
+
+bool gpio_cdev_open(const char *chip)
+{
+    log_message(LOG_DEBUG, "gpio_cdev_open: GPIO character device support is not compiled in\r\n");
+    errno = ENOTSUP;
+    return false;
+}
+
+void gpio_cdev_close(void)
+{
+}
+
+bool gpio_cdev_get_values(uint32_t *values)
+{
+    return false;
+}
+
+bool gpio_cdev_set_values(uint32_t mask, uint32_t values)
+{
+    return false;
+}
+
+int gpio_cdev_get_direction(int gpio)
+{
+    return GPIO_ERR;
+}
+
+bool gpio_cdev_set_direction(int gpio, int direction)
+{
+    return false;
+}
+
+bool gpio_cdev_set_directions(uint32_t mask, uint32_t outputs)
+{
+    return false;
+}
+
+bool gpio_cdev_set_outputs(uint32_t mask, uint32_t values)
+{
+    return false;
+}
+
+int gpio_cdev_watch(bool enable)
+{
+    return -1;
+}
+
+int gpio_cdev_read_events(struct gpio_cdev_event *events, int max)
+{
+    return 0;
+}
+
+#endif
@@ -0,0 +1,123 @@
+/* 
+ * Copyright (c) 2014, Daan Pape
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without 
+ * modification, are permitted provided that the following conditions are met:
+ * 
+ *     1. Redistributions of source code must retain the above copyright 
+ *        notice, this list of conditions and the following disclaimer.
+ *
+ *     2. Redistributions in binary form must reproduce the above copyright 
+ *        notice, this list of conditions and the following disclaimer in the 
+ *        documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" 
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE 
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE 
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE 
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR 
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF 
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS 
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN 
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) 
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE 
+ * POSSIBILITY OF SUCH DAMAGE.
+ * 
+ * File:   gpio_cdev.h
+ * Created on October 18, 2026, 10:12 AM
+ */
+
+#ifndef GPIO_CDEV_H
+#define	GPIO_CDEV_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/* A level change of a requested input line */
+struct gpio_cdev_event {
+    int gpio;       /* The GPIO pin */
+    int state;      /* GPIO_HIGH or GPIO_LOW */
+    uint64_t timestamp; /* CLOCK_MONOTONIC time of the edge in nanoseconds */
+};
+
+/**
+ * Request all exposed GPIO lines of a GPIO character device in one
+ * line request. The lines keep their current direction and value.
+ * @param chip the path of the GPIO character device.
+ * @return true on success, errno is EBUSY when a line is in use.
+ */
+bool gpio_cdev_open(const char *chip);
+
+/**
+ * Release the line request.
+ */
+void gpio_cdev_close(void);
+
+/**
+ * Read the values of all requested lines with one system call.
+ * @param values receives bit n set when GPIO n is high.
+ * @return true on success.
+ */
+bool gpio_cdev_get_values(uint32_t *values);
+
+/**
+ * Set the values of several output lines with one system call.
+ * @param mask bit n set to change GPIO n.
+ * @param values bit n set to drive GPIO n high.
+ * @return true on success, errno is EPERM when a line is an input.
+ */
+bool gpio_cdev_set_values(uint32_t mask, uint32_t values);
+
+/**
+ * Get the direction of a requested line. Requested lines can't be
+ * changed by other processes so the direction is kept in memory.
+ * @param gpio the GPIO pin.
+ * @return GPIO_IN, GPIO_OUT or GPIO_ERR when the line is not requested.
+ */
+int gpio_cdev_get_direction(int gpio);
+
+/**
+ * Set the direction of a requested line. An output keeps
+ * driving the level the line had.
+ * @param gpio the GPIO pin.
+ * @param direction GPIO_IN or GPIO_OUT.
+ * @return true on success.
+ */
+bool gpio_cdev_set_direction(int gpio, int direction);
+
+/**
+ * Set the direction of several requested lines with one line
+ * configuration. Outputs keep driving the level the lines had.
+ * @param mask bit n set to change GPIO n.
+ * @param outputs bit n set to make GPIO n an output, an input otherwise.
+ * @return true on success, no direction is changed on failure.
+ */
+bool gpio_cdev_set_directions(uint32_t mask, uint32_t outputs);
+
+/**
+ * Make several requested lines outputs with one line configuration.
+ * The lines drive the given levels from the start.
+ * @param mask bit n set to change GPIO n.
+ * @param values bit n set to drive GPIO n high.
+ * @return true on success, no line is changed on failure.
+ */
+bool gpio_cdev_set_outputs(uint32_t mask, uint32_t values);
+
+/**
+ * Report edges of the input lines, or stop reporting them. The edges
+ * are read from the file descriptor of the line request.
+ * @param enable true to report edges.
+ * @return the file descriptor to watch, -1 on error.
+ */
+int gpio_cdev_watch(bool enable);
+
+/**
+ * Read the pending edges of the input lines without blocking. 
+ * @param events the buffer for the edges.
+ * @param max the size of the buffer.
+ * @return the number of edges read, 0 when none are pending.
+ */
+int gpio_cdev_read_events(struct gpio_cdev_event *events, int max);
+
+#endif
@@ -0,0 +1,242 @@
+/* 
+ * Copyright (c) 2014, Daan Pape
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without 
+ * modification, are permitted provided that the following conditions are met:
+ * 
+ *     1. Redistributions of source code must retain the above copyright 
+ *        notice, this list of conditions and the following disclaimer.
+ *
+ *     2. Redistributions in binary form must reproduce the above copyright 
+ *        notice, this list of conditions and the following disclaimer in the 
+ *        documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" 
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE 
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE 
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE 
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR 
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF 
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS 
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN 
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) 
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE 
+ * POSSIBILITY OF SUCH DAMAGE.
+ * 
+ * File:   gpio_counter.c
+ * Created on October 18, 2026, 11:58 PM
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <pthread.h>
+#include <libubox/uloop.h>
+
+#include "../config.h"
+#include "../logger.h"
+#include "../helper.h"
+#include "../stall.h"
+#include "../database/database.h"
+#include "gpio.h"
+#include "gpio_dao.h"
+#include "gpio_monitor.h"
+#include "gpio_counter.h"
+
+/* The pulse counter of a pin */
+struct gpio_counter {
+    bool enabled;
+    uint64_t total;             /* Rising edges, including the saved total */
+    uint64_t saved;             /* The total in the database */
+    uint32_t interval_count;    /* Rising edges in the last complete interval */
+    uint32_t current_count;     /* Rising edges in the running interval */
+    uint64_t period;            /* Time between the last two rising edges */
+    uint64_t last_edge;         /* Time of the last rising edge, 0 before the first */
+};
+
+static struct gpio_counter counters[28];
+
+/* Edges are counted in the threads that report them */
+static pthread_mutex_t counter_lock = PTHREAD_MUTEX_INITIALIZER;
+
+/* Closes the counting intervals */
+static struct uloop_timeout interval_timer;
+
+/* Saves the totals */
+static struct uloop_timeout save_timer;
+
+/**
+ * Close the running interval of all counters.
+ * @param t the interval timer.
+ */
+static void gpio_counter_interval_cb(struct uloop_timeout *t)
+{
+    STALL_SCOPE("timer", "gpio counter interval");
+
+    pthread_mutex_lock(&counter_lock);
+    for (int gpio = 0; gpio < 28; ++gpio) {
+        counters[gpio].interval_count = counters[gpio].current_count;
+        counters[gpio].current_count = 0;
+    }
+    pthread_mutex_unlock(&counter_lock);
+
+    uloop_timeout_set(t, conf->gpio_counter_interval * 1000);
+}
+
+/**
+ * Save the totals now and then.
+ * @param t the save timer.
+ */
+static void gpio_counter_save_cb(struct uloop_timeout *t)
+{
+    STALL_SCOPE("timer", "gpio counter save");
+
+    gpio_counter_save();
+    uloop_timeout_set(t, conf->gpio_counter_save * 1000);
+}
+
+/**
+ * Start counting on the pins in conf->gpio_counters. The pins are made
+ * inputs and their saved totals are restored. Must be called after
+ * the GPIO monitor is started.
+ * @return true when any pin is counted.
+ */
+bool gpio_counter_init(void)
+{
+    int counted = 0;
+    int64_t total;
+
+    for (int gpio = 0; gpio < 28; ++gpio) {
+        if (!(conf->gpio_counters & (1u << gpio)))
+            continue;
+
+        if (!gpio_config[gpio] || !gpio_reserve(gpio)) {
+            log_message(LOG_WARNING, "GPIO %d can not be used as a pulse counter\r\n", gpio);
+            continue;
+        }
+
+        if (gpio_get_direction(gpio) != GPIO_IN && !gpio_set_direction(gpio, GPIO_IN)) {
+            log_message(LOG_WARNING, "Could not make GPIO %d an input for its pulse counter\r\n", gpio);
+            continue;
+        }
+
+        /* The pulses are counted from the edges of the mirror */
+        if (gpio_monitor_get(gpio, NULL) == GPIO_ERR)
+            log_message(LOG_WARNING, "GPIO %d is not mirrored, its pulses are not counted\r\n", gpio);
+
+        total = gpio_dao_get_counter(gpio);
+
+        pthread_mutex_lock(&counter_lock);
+        memset(&counters[gpio], 0, sizeof(counters[gpio]));
+        counters[gpio].total = counters[gpio].saved = total > 0 ? total : 0;
+        counters[gpio].enabled = true;
+        pthread_mutex_unlock(&counter_lock);
+
+        ++counted;
+    }
+
+    if (counted == 0)
+        return false;
+
+    interval_timer.cb = gpio_counter_interval_cb;
+    uloop_timeout_set(&interval_timer, conf->gpio_counter_interval * 1000);
+
+    if (conf->gpio_counter_save > 0) {
+        save_timer.cb = gpio_counter_save_cb;
+        uloop_timeout_set(&save_timer, conf->gpio_counter_save * 1000);
+    }
+
+    log_message(LOG_INFO, "Counting pulses on %d GPIO inputs\r\n", counted);
+    return true;
+}
+
+/**
+ * Stop the counting timers and save the totals. Called when the event
+ * loop ended.
+ */
+void gpio_counter_done(void)
+{
+    uloop_timeout_cancel(&interval_timer);
+    uloop_timeout_cancel(&save_timer);
+    gpio_counter_save();
+}
+
+/**
+ * Save the totals that changed since they were last saved.
+ */
+void gpio_counter_save(void)
+{
+    uint64_t total;
+
+    for (int gpio = 0; gpio < 28; ++gpio) {
+        pthread_mutex_lock(&counter_lock);
+        total = counters[gpio].total;
+        pthread_mutex_unlock(&counter_lock);
+
+        if (!counters[gpio].enabled || total == counters[gpio].saved)
+            continue;
+
+        /* The database is written outside the lock, edges keep being counted */
+        if (gpio_dao_save_counter(gpio, total) == DB_OK)
+            counters[gpio].saved = total;
+    }
+}
+
+/**
+ * Count an edge of a mirrored input. Called from any thread.
+ * @param gpio the GPIO pin.
+ * @param state the state after the edge.
+ * @param timestamp CLOCK_MONOTONIC time of the edge in nanoseconds.
+ */
+void gpio_counter_edge(int gpio, int state, uint64_t timestamp)
+{
+    struct gpio_counter *c = &counters[gpio];
+
+    if (state != GPIO_HIGH || !c->enabled)
+        return;
+
+    pthread_mutex_lock(&counter_lock);
+    c->total++;
+    c->current_count++;
+    if (c->last_edge != 0 && timestamp > c->last_edge)
+        c->period = timestamp - c->last_edge;
+    c->last_edge = timestamp;
+    pthread_mutex_unlock(&counter_lock);
+}
+
+/**
+ * Get the counted pulses of a pin.
+ * @param gpio the GPIO pin.
+ * @param info receives the counts.
+ * @return false when the pin is not counted.
+ */
+bool gpio_counter_get(int gpio, struct gpio_counter_info *info)
+{
+    uint64_t now = helper_now_ns();
+    uint64_t period;
+
+    if (gpio < 0 || gpio > 27 || !counters[gpio].enabled)
+        return false;
+
+    pthread_mutex_lock(&counter_lock);
+    info->total = counters[gpio].total;
+    info->interval_count = counters[gpio].interval_count;
+    info->current_count = counters[gpio].current_count;
+    info->period_ns = counters[gpio].period;
+    info->last_edge = counters[gpio].last_edge;
+    pthread_mutex_unlock(&counter_lock);
+
+    /* A pulse that is overdue lowers the frequency, a stopped meter reads 0 */
+    period = info->period_ns;
+    if (period != 0 && now - info->last_edge > period)
+        period = now - info->last_edge;
+
+    if (period == 0 || period > (uint64_t) conf->gpio_counter_interval * 1000000000ull)
+        info->frequency = 0;
+    else
+        info->frequency = 1e9 / period;
+
+    return true;
+}
@@ -0,0 +1,85 @@
+/* 
+ * Copyright (c) 2014, Daan Pape
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without 
+ * modification, are permitted provided that the following conditions are met:
+ * 
+ *     1. Redistributions of source code must retain the above copyright 
+ *        notice, this list of conditions and the following disclaimer.
+ *
+ *     2. Redistributions in binary form must reproduce the above copyright 
+ *        notice, this list of conditions and the following disclaimer in the 
+ *        documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" 
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE 
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE 
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE 
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR 
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF 
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS 
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN 
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) 
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE 
+ * POSSIBILITY OF SUCH DAMAGE.
+ * 
+ * File:   gpio_counter.h
+ * Created on October 18, 2026, 11:58 PM
+ * 
+ * Counts the pulses on input pins from their edges and measures their
+ * frequency. The totals are saved in the database now and then.
+ */
+
+#ifndef GPIO_COUNTER_H
+#define	GPIO_COUNTER_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/* The counted pulses of a pin */
+struct gpio_counter_info {
+    uint64_t total;             /* Rising edges ever counted */
+    uint32_t interval_count;    /* Rising edges in the last complete interval */
+    uint32_t current_count;     /* Rising edges in the running interval */
+    uint64_t period_ns;         /* Time between the last two rising edges, 0 when unknown */
+    double frequency;           /* Instantaneous frequency in Hz */
+    uint64_t last_edge;         /* CLOCK_MONOTONIC time of the last rising edge in nanoseconds */
+};
+
+/**
+ * Start counting on the pins in conf->gpio_counters. The pins are made
+ * inputs and their saved totals are restored. Must be called after
+ * the GPIO monitor is started.
+ * @return true when any pin is counted.
+ */
+bool gpio_counter_init(void);
+
+/**
+ * Stop the counting timers and save the totals. Called when the event
+ * loop ended.
+ */
+void gpio_counter_done(void);
+
+/**
+ * Save the totals that changed since they were last saved.
+ */
+void gpio_counter_save(void);
+
+/**
+ * Count an edge of a mirrored input. Called from any thread.
+ * @param gpio the GPIO pin.
+ * @param state the state after the edge.
+ * @param timestamp CLOCK_MONOTONIC time of the edge in nanoseconds.
+ */
+void gpio_counter_edge(int gpio, int state, uint64_t timestamp);
+
+/**
+ * Get the counted pulses of a pin.
+ * @param gpio the GPIO pin.
+ * @param info receives the counts.
+ * @return false when the pin is not counted.
+ */
+bool gpio_counter_get(int gpio, struct gpio_counter_info *info);
+
+#endif
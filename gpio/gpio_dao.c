@@ -39,6 +39,7 @@
 
 #include "../config.h"
 #include "../logger.h"
+#include "../metrics.h"
 #include "../database/database.h"
 #include "gpio_dao.h"
 
@@ -50,6 +51,15 @@
 int gpio_dao_init(sqlite3 *db) {
     char* err_msg;
     
+    /* The pulse counters are kept apart, existing databases get them as well */
+    if (dao_easy_exec(db, "CREATE TABLE IF NOT EXISTS gpio_counter ( \
+			number INTEGER PRIMARY KEY NOT NULL, \
+			total INTEGER NOT NULL \
+			);") != DB_OK) {
+        log_message(LOG_ERROR, "Could not create 'gpio_counter' table\r\n");
+        return DB_ERR;
+    }
+
     char* sql = "CREATE TABLE gpio ( \
 			id  INTEGER PRIMARY KEY	ASC NOT NULL, \
 			number INTEGER UNIQUE NOT NULL, \
@@ -68,3 +78,137 @@ int gpio_dao_init(sqlite3 *db) {
     
     return DB_OK;
 }
+
+/**
+ * Get the stored pulse time of a GPIO
+ * @number the GPIO pin
+ * @return the pulse time in milliseconds, -1 when none is stored
+ */
+int gpio_dao_get_pulsetime(int number) {
+    METRICS_TIME(METRICS_CALL_SQLITE);
+    sqlite3 *db;
+    sqlite3_stmt *stmt = NULL;
+    int pulsetime = -1;
+    int rc;
+
+    /* Try to open the database */
+    if (sqlite3_open(conf->database, &db) != SQLITE_OK) {
+        log_message(LOG_ERROR, "Could not open database '%s': %s\r\n", conf->database, sqlite3_errmsg(db));
+        goto finalize;
+    }
+
+    /* Try to prepare statement */
+    if (sqlite3_prepare_v2(db, "SELECT pulsetime FROM gpio WHERE number = ? AND pulsetime IS NOT NULL", -1, &stmt, 0) != SQLITE_OK) {
+        log_message(LOG_ERROR, "Could not prepare SQL statement: %s\r\n", sqlite3_errmsg(db));
+        goto finalize;
+    }
+
+    /* Try to bind the GPIO number */
+    if (sqlite3_bind_int(stmt, 1, number) != SQLITE_OK) {
+        log_message(LOG_ERROR, "Could not bind GPIO number %d: %s\r\n", number, sqlite3_errmsg(db));
+        goto finalize;
+    }
+
+    /* The number is unique, there is at most one row */
+    rc = sqlite3_step(stmt);
+    if (rc == SQLITE_ROW) {
+        pulsetime = sqlite3_column_int(stmt, 0);
+    } else if (rc != SQLITE_DONE) {
+        log_message(LOG_ERROR, "Could not fetch data from table: %s\r\n", sqlite3_errmsg(db));
+    }
+
+finalize:
+    /* Finalize the statement */
+    dao_finalize(db, stmt);
+
+    return pulsetime;
+}
+
+/**
+ * Get the saved pulse count of a GPIO
+ * @number the GPIO pin
+ * @return the total number of pulses, -1 when none is saved
+ */
+int64_t gpio_dao_get_counter(int number) {
+    METRICS_TIME(METRICS_CALL_SQLITE);
+    sqlite3 *db;
+    sqlite3_stmt *stmt = NULL;
+    int64_t total = -1;
+    int rc;
+
+    /* Try to open the database */
+    if (sqlite3_open(conf->database, &db) != SQLITE_OK) {
+        log_message(LOG_ERROR, "Could not open database '%s': %s\r\n", conf->database, sqlite3_errmsg(db));
+        goto finalize;
+    }
+
+    /* Try to prepare statement */
+    if (sqlite3_prepare_v2(db, "SELECT total FROM gpio_counter WHERE number = ?", -1, &stmt, 0) != SQLITE_OK) {
+        log_message(LOG_ERROR, "Could not prepare SQL statement: %s\r\n", sqlite3_errmsg(db));
+        goto finalize;
+    }
+
+    /* Try to bind the GPIO number */
+    if (sqlite3_bind_int(stmt, 1, number) != SQLITE_OK) {
+        log_message(LOG_ERROR, "Could not bind GPIO number %d: %s\r\n", number, sqlite3_errmsg(db));
+        goto finalize;
+    }
+
+    /* The number is the key, there is at most one row */
+    rc = sqlite3_step(stmt);
+    if (rc == SQLITE_ROW) {
+        total = sqlite3_column_int64(stmt, 0);
+    } else if (rc != SQLITE_DONE) {
+        log_message(LOG_ERROR, "Could not fetch data from table: %s\r\n", sqlite3_errmsg(db));
+    }
+
+finalize:
+    /* Finalize the statement */
+    dao_finalize(db, stmt);
+
+    return total;
+}
+
+/**
+ * Save the pulse count of a GPIO
+ * @number the GPIO pin
+ * @total the total number of pulses
+ * @return DB_OK on success, DB_ERR on error
+ */
+int gpio_dao_save_counter(int number, uint64_t total) {
+    METRICS_TIME(METRICS_CALL_SQLITE);
+    sqlite3 *db;
+    sqlite3_stmt *stmt = NULL;
+    int rc = DB_ERR;
+
+    /* Try to open the database */
+    if (sqlite3_open(conf->database, &db) != SQLITE_OK) {
+        log_message(LOG_ERROR, "Could not open database '%s': %s\r\n", conf->database, sqlite3_errmsg(db));
+        goto finalize;
+    }
+
+    /* Try to prepare statement */
+    if (sqlite3_prepare_v2(db, "INSERT OR REPLACE INTO gpio_counter (number, total) VALUES (?, ?)", -1, &stmt, 0) != SQLITE_OK) {
+        log_message(LOG_ERROR, "Could not prepare SQL statement: %s\r\n", sqlite3_errmsg(db));
+        goto finalize;
+    }
+
+    /* Try to bind the GPIO number and the total */
+    if (sqlite3_bind_int(stmt, 1, number) != SQLITE_OK || sqlite3_bind_int64(stmt, 2, total) != SQLITE_OK) {
+        log_message(LOG_ERROR, "Could not bind pulse count of GPIO %d: %s\r\n", number, sqlite3_errmsg(db));
+        goto finalize;
+    }
+
+    if (sqlite3_step(stmt) != SQLITE_DONE) {
+        log_message(LOG_ERROR, "Could not save pulse count of GPIO %d: %s\r\n", number, sqlite3_errmsg(db));
+        goto finalize;
+    }
+
+    rc = DB_OK;
+
+finalize:
+    /* Finalize the statement */
+    dao_finalize(db, stmt);
+
+    return rc;
+}
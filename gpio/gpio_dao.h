@@ -31,6 +31,7 @@
 #ifndef DB_GPIO_H
 #define	DB_GPIO_H
 
+#include <stdint.h>
 #include <sqlite3.h>
 
 /* A GPIO value object */
@@ -48,5 +49,27 @@ typedef struct dbgpio {
  */
 int gpio_dao_init(sqlite3 *db);
 
+/**
+ * Get the stored pulse time of a GPIO
+ * @number the GPIO pin
+ * @return the pulse time in milliseconds, -1 when none is stored
+ */
+int gpio_dao_get_pulsetime(int number);
+
+/**
+ * Get the saved pulse count of a GPIO
+ * @number the GPIO pin
+ * @return the total number of pulses, -1 when none is saved
+ */
+int64_t gpio_dao_get_counter(int number);
+
+/**
+ * Save the pulse count of a GPIO
+ * @number the GPIO pin
+ * @total the total number of pulses
+ * @return DB_OK on success, DB_ERR on error
+ */
+int gpio_dao_save_counter(int number, uint64_t total);
+
 #endif
 
@@ -0,0 +1,256 @@
+/* 
+ * Copyright (c) 2014, Daan Pape
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without 
+ * modification, are permitted provided that the following conditions are met:
+ * 
+ *     1. Redistributions of source code must retain the above copyright 
+ *        notice, this list of conditions and the following disclaimer.
+ *
+ *     2. Redistributions in binary form must reproduce the above copyright 
+ *        notice, this list of conditions and the following disclaimer in the 
+ *        documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" 
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE 
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE 
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE 
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR 
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF 
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS 
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN 
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) 
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE 
+ * POSSIBILITY OF SUCH DAMAGE.
+ * 
+ * File:   gpio_events.c
+ * Created on October 18, 2026, 8:10 PM
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <unistd.h>
+#include <sys/eventfd.h>
+
+#include <libubox/list.h>
+#include <libubox/uloop.h>
+
+#include "../config.h"
+#include "../stall.h"
+#include "gpio_events.h"
+
+#define GPIO_EVENT_MASK     (GPIO_EVENT_SLOTS - 1)
+
+/* The slot of a sequence number is seq & GPIO_EVENT_MASK. A slot is
+ * published by storing its sequence number last, readers check it
+ * again after the copy to detect an edge that overwrote the slot. */
+static struct gpio_event ring[GPIO_EVENT_SLOTS];
+
+/* Sequence number of the last published edge */
+static uint32_t head = 0;
+
+/* The waits, only used from the event loop */
+static LIST_HEAD(waiters);
+static int num_waiters = 0;
+
+static void gpio_events_notify(struct uloop_fd *u, unsigned int events);
+
+/* Wakes the waits in the event loop once per burst of edges */
+static struct uloop_fd notify = { .fd = -1, .cb = gpio_events_notify };
+static bool notify_pending = false;
+
+/**
+ * Record an edge of an input pin. There may be one writer at a time,
+ * in any thread, readers may run in any thread.
+ * @param gpio the GPIO pin.
+ * @param state GPIO_HIGH or GPIO_LOW after the edge.
+ * @param timestamp CLOCK_MONOTONIC time of the edge in nanoseconds.
+ */
+void gpio_events_push(int gpio, int state, uint64_t timestamp)
+{
+    uint32_t seq = head + 1;
+    struct gpio_event *slot = &ring[seq & GPIO_EVENT_MASK];
+
+    /* Readers of the old edge see the slot change */
+    __atomic_store_n(&slot->seq, 0, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+
+    slot->gpio = gpio;
+    slot->state = state;
+    slot->timestamp = timestamp;
+
+    __atomic_store_n(&slot->seq, seq, __ATOMIC_RELEASE);
+    __atomic_store_n(&head, seq, __ATOMIC_SEQ_CST);
+
+    /* The waits are woken through the event loop, whatever thread pushes */
+    if (__atomic_load_n(&num_waiters, __ATOMIC_SEQ_CST) > 0 && !__atomic_exchange_n(&notify_pending, true, __ATOMIC_ACQ_REL)) {
+        uint64_t one = 1;
+
+        if (write(notify.fd, &one, sizeof(one)) < 0)
+            __atomic_store_n(&notify_pending, false, __ATOMIC_RELEASE);
+    }
+}
+
+/**
+ * Get the sequence number of the last recorded edge. 
+ * @return the sequence number, 0 before the first edge.
+ */
+uint32_t gpio_events_seq(void)
+{
+    return __atomic_load_n(&head, __ATOMIC_ACQUIRE);
+}
+
+/**
+ * Copy the recorded edges after a sequence number, oldest first.
+ * @param since the sequence number of the last edge already seen.
+ * @param events the buffer for the edges.
+ * @param max the size of the buffer.
+ * @param lost receives the number of edges after since that were
+ * overwritten before they could be read, may be NULL.
+ * @return the number of edges copied.
+ */
+int gpio_events_read(uint32_t since, struct gpio_event *events, int max, uint32_t *lost)
+{
+    uint32_t last = gpio_events_seq();
+    uint32_t seq = since + 1;
+    uint32_t missed = 0;
+    int n = 0;
+
+    /* A sequence number from the future, e.g. from before a restart */
+    if (since > last)
+        seq = last + 1;
+
+    /* Skip the edges that are overwritten already */
+    if (last - seq + 1 > GPIO_EVENT_SLOTS) {
+        missed = last - seq + 1 - GPIO_EVENT_SLOTS;
+        seq += missed;
+    }
+
+    for (; seq <= last && n < max; ++seq) {
+        struct gpio_event *slot = &ring[seq & GPIO_EVENT_MASK];
+
+        if (__atomic_load_n(&slot->seq, __ATOMIC_ACQUIRE) != seq) {
+            ++missed;
+            continue;
+        }
+
+        events[n] = *slot;
+        __atomic_thread_fence(__ATOMIC_ACQUIRE);
+
+        if (__atomic_load_n(&slot->seq, __ATOMIC_RELAXED) != seq) {
+            ++missed;
+            continue;
+        }
+
+        events[n++].seq = seq;
+    }
+
+    if (lost)
+        *lost = missed;
+
+    return n;
+}
+
+/**
+ * Called when a wait timed out.
+ * @param t the timeout of the wait.
+ */
+static void gpio_events_timeout(struct uloop_timeout *t)
+{
+    struct gpio_events_waiter *w = container_of(t, struct gpio_events_waiter, timeout);
+    STALL_SCOPE("timer", "gpio events timeout");
+
+    gpio_events_cancel(w);
+    w->cb(w, true);
+}
+
+/**
+ * Wake the waits that have edges after their sequence number.
+ * @param u the notify event file descriptor.
+ * @param events the event loop events.
+ */
+static void gpio_events_notify(struct uloop_fd *u, unsigned int events)
+{
+    struct gpio_events_waiter *w, *tmp;
+    uint32_t last;
+    uint64_t count;
+    STALL_SCOPE("read", "gpio events");
+
+    /* Edges pushed from here on write the event file descriptor again */
+    while (read(u->fd, &count, sizeof(count)) > 0)
+        ;
+    __atomic_store_n(&notify_pending, false, __ATOMIC_SEQ_CST);
+
+    last = gpio_events_seq();
+    list_for_each_entry_safe(w, tmp, &waiters, list) {
+        if (w->since == last)
+            continue;
+
+        gpio_events_cancel(w);
+        w->cb(w, false);
+    }
+}
+
+/**
+ * Wait in the event loop for the edges after w->since. The callback
+ * is only called from the event loop, never from this function.
+ * @param w the wait, with since and cb filled in.
+ * @param timeout the maximum time to wait in ms.
+ * @return false when the wait isn't made, because there are edges
+ * already, the timeout is 0 or the event file descriptor failed.
+ */
+bool gpio_events_wait(struct gpio_events_waiter *w, int timeout)
+{
+    INIT_LIST_HEAD(&w->list);
+    memset(&w->timeout, 0, sizeof(w->timeout));
+    w->timeout.cb = gpio_events_timeout;
+
+    /* A sequence number from the future, e.g. from before a restart */
+    if (w->since > gpio_events_seq())
+        w->since = gpio_events_seq();
+
+    if (w->since != gpio_events_seq() || timeout <= 0)
+        return false;
+
+    /* The event file descriptor is made by the first wait, in the event loop */
+    if (notify.fd < 0) {
+        notify.fd = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+        if (notify.fd < 0 || uloop_fd_add(&notify, ULOOP_READ) < 0) {
+            if (notify.fd >= 0)
+                close(notify.fd);
+            notify.fd = -1;
+            return false;
+        }
+    }
+
+    list_add_tail(&w->list, &waiters);
+    __atomic_add_fetch(&num_waiters, 1, __ATOMIC_SEQ_CST);
+    uloop_timeout_set(&w->timeout, timeout);
+
+    /* An edge pushed by another thread while the wait was added */
+    if (w->since != gpio_events_seq() && !__atomic_exchange_n(&notify_pending, true, __ATOMIC_ACQ_REL)) {
+        uint64_t one = 1;
+
+        if (write(notify.fd, &one, sizeof(one)) < 0)
+            __atomic_store_n(&notify_pending, false, __ATOMIC_RELEASE);
+    }
+
+    return true;
+}
+
+/**
+ * Stop a wait before its callback was called.
+ * @param w the wait.
+ */
+void gpio_events_cancel(struct gpio_events_waiter *w)
+{
+    if (list_empty(&w->list))
+        return;
+
+    list_del_init(&w->list);
+    uloop_timeout_cancel(&w->timeout);
+    __atomic_sub_fetch(&num_waiters, 1, __ATOMIC_SEQ_CST);
+}
@@ -0,0 +1,103 @@
+/* 
+ * Copyright (c) 2014, Daan Pape
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without 
+ * modification, are permitted provided that the following conditions are met:
+ * 
+ *     1. Redistributions of source code must retain the above copyright 
+ *        notice, this list of conditions and the following disclaimer.
+ *
+ *     2. Redistributions in binary form must reproduce the above copyright 
+ *        notice, this list of conditions and the following disclaimer in the 
+ *        documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" 
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE 
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE 
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE 
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR 
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF 
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS 
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN 
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) 
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE 
+ * POSSIBILITY OF SUCH DAMAGE.
+ * 
+ * File:   gpio_events.h
+ * Created on October 18, 2026, 8:10 PM
+ * 
+ * Ring of timestamped input edges, read by sequence number. Clients
+ * can wait in the event loop for the edges after a sequence number.
+ */
+
+#ifndef GPIO_EVENTS_H
+#define	GPIO_EVENTS_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include <libubox/list.h>
+#include <libubox/uloop.h>
+
+/* An edge of an input pin */
+struct gpio_event {
+    uint32_t seq;           /* Sequence number, the first edge is 1 */
+    int gpio;               /* The GPIO pin */
+    int state;              /* GPIO_HIGH or GPIO_LOW after the edge */
+    uint64_t timestamp;     /* CLOCK_MONOTONIC time of the edge in nanoseconds */
+};
+
+/* A wait for the edges after a sequence number */
+struct gpio_events_waiter {
+    struct list_head list;
+    struct uloop_timeout timeout;
+    uint32_t since;         /* Woken when an edge after this sequence number is recorded */
+
+    /* Called once, when there are edges or the wait timed out */
+    void (*cb)(struct gpio_events_waiter *w, bool timed_out);
+};
+
+/**
+ * Record an edge of an input pin. There may be one writer at a time,
+ * in any thread, readers may run in any thread.
+ * @param gpio the GPIO pin.
+ * @param state GPIO_HIGH or GPIO_LOW after the edge.
+ * @param timestamp CLOCK_MONOTONIC time of the edge in nanoseconds.
+ */
+void gpio_events_push(int gpio, int state, uint64_t timestamp);
+
+/**
+ * Get the sequence number of the last recorded edge. 
+ * @return the sequence number, 0 before the first edge.
+ */
+uint32_t gpio_events_seq(void);
+
+/**
+ * Copy the recorded edges after a sequence number, oldest first.
+ * @param since the sequence number of the last edge already seen.
+ * @param events the buffer for the edges.
+ * @param max the size of the buffer.
+ * @param lost receives the number of edges after since that were
+ * overwritten before they could be read, may be NULL.
+ * @return the number of edges copied.
+ */
+int gpio_events_read(uint32_t since, struct gpio_event *events, int max, uint32_t *lost);
+
+/**
+ * Wait in the event loop for the edges after w->since. The callback
+ * is only called from the event loop, never from this function.
+ * @param w the wait, with since and cb filled in.
+ * @param timeout the maximum time to wait in ms.
+ * @return false when the wait isn't made, because there are edges
+ * already, the timeout is 0 or the event file descriptor failed.
+ */
+bool gpio_events_wait(struct gpio_events_waiter *w, int timeout);
+
+/**
+ * Stop a wait before its callback was called.
+ * @param w the wait.
+ */
+void gpio_events_cancel(struct gpio_events_waiter *w);
+
+#endif
@@ -33,12 +33,29 @@
 #include <json-c/json.h>
 #include <string.h>
 #include <stdlib.h>
+#include <stdint.h>
+#include <limits.h>
+#include <math.h>
 
+#include "../config.h"
 #include "../logger.h"
 #include "../helper.h"
 #include "../uhttpd.h"
+#include "../api.h"
 #include "gpio_json_api.h"
 #include "gpio.h"
+#include "gpio_counter.h"
+#include "gpio_dao.h"
+#include "gpio_events.h"
+#include "gpio_monitor.h"
+#include "gpio_pulse.h"
+#include "gpio_wave.h"
+
+/* An events request waiting for edges */
+struct gpio_events_request {
+    struct gpio_events_waiter waiter;
+    struct client *cl;
+};
 
 /**
  * Route all get requests concerning the gpio module.
@@ -51,6 +68,10 @@ json_object* gpio_get_router(struct client *cl, char *request) {
     {
         return gpio_get_layout(cl, request + 7);
     } 
+    else if (helper_str_startswith(request, "states", 0))
+    {
+        return gpio_get_all_states(cl, request + 7);
+    }
     else if (helper_str_startswith(request, "state", 0))
     {
         return gpio_get_status(cl, request + 6);
@@ -59,9 +80,17 @@ json_object* gpio_get_router(struct client *cl, char *request) {
     {
         return gpio_get_overview(cl, request + 9);
     }
-    else if (helper_str_startswith(request, "states", 0))
+    else if (helper_str_startswith(request, "events", 0))
     {
-        return gpio_get_all_states(cl, request + 10);
+        return gpio_get_events(cl, request + 6);
+    }
+    else if (helper_str_startswith(request, "wave", 0))
+    {
+        return gpio_get_wave(cl, request + 4);
+    }
+    else if (helper_str_startswith(request, "counter", 0))
+    {
+        return gpio_get_counter(cl, request + 8);
     }
     else
     {
@@ -77,7 +106,15 @@ json_object* gpio_get_router(struct client *cl, char *request) {
  * @return the result of the called function.
  */
 json_object* gpio_post_router(struct client *cl, char *request) {
-    return NULL;
+    if (helper_str_startswith(request, "wave", 0)) 
+    {
+        return gpio_post_wave(cl, request + 4);
+    }
+    else
+    {
+        log_message(LOG_WARNING, "GPIO API got unknown POST request '%s'\r\n", request);
+        return NULL;
+    }
 }
 
 /**
@@ -87,18 +124,38 @@ json_object* gpio_post_router(struct client *cl, char *request) {
  * @return the result of the called function.
  */
 json_object* gpio_put_router(struct client *cl, char *request) {
-    if (helper_str_startswith(request, "state", 0)) 
+    if (helper_str_startswith(request, "states", 0)) 
+    {
+        return gpio_put_states(cl, request + 7);
+    } 
+    else if (helper_str_startswith(request, "state", 0)) 
     {
         return gpio_put_status(cl, request + 6);
     } 
+    else if (helper_str_startswith(request, "directions", 0))
+    {
+        return gpio_put_directions(cl, request + 11);
+    }
     else if (helper_str_startswith(request, "dir", 0))
     {
         return gpio_put_direction(cl, request + 4);
     }
+    else if (helper_str_startswith(request, "pulsetrain", 0))
+    {
+        return gpio_put_pulse_train(cl, request + 11);
+    }
+    else if (helper_str_startswith(request, "pulsecancel", 0))
+    {
+        return gpio_put_pulse_cancel(cl, request + 12);
+    }
     else if (helper_str_startswith(request, "pulse", 0))
     {
         return gpio_put_pulse_output(cl, request + 6);
     }
+    else if (helper_str_startswith(request, "wavestop", 0))
+    {
+        return gpio_put_wave_stop(cl, request + 8);
+    }
     else
     {
         log_message(LOG_WARNING, "GPIO API got unknown PUT request '%s'\r\n", request);
@@ -143,12 +200,18 @@ json_object* gpio_get_layout(struct client *cl, char *request) {
  */
 json_object* gpio_get_overview(struct client *cl, char *request) {
     int i;
+    int states[28];
+    int directions[28];
 
     /* Create the json object */
     json_object *jobj = json_object_new_object();
     json_object *jarray = json_object_new_array();
 
-    /* Check the state for every IO port */
+    /* Read all IO ports at once */
+    gpio_get_states(states);
+    gpio_get_directions(directions);
+
+    /* Add the state for every IO port */
     for(i = 0; i < (sizeof(gpio_config) / sizeof(bool)); ++i) {
         if(gpio_config[i]){
             json_object *j_gpio_port = json_object_new_object();
@@ -157,17 +220,9 @@ json_object* gpio_get_overview(struct client *cl, char *request) {
             json_object_object_add(j_gpio_port, "number", json_object_new_int(i));
             
             /* Add port direction and state */
-            int state = 2;
-            int dir = 2;
-            
-            if(gpio_reserve(i)) {
-                state = gpio_get_state(i);
-                dir = gpio_get_direction(i);
-                gpio_release(i);
-            }
-
-            json_object_object_add(j_gpio_port, "state", json_object_new_int(state));
-            json_object_object_add(j_gpio_port, "direction", json_object_new_int(dir));
+            json_object_object_add(j_gpio_port, "state", json_object_new_int(states[i]));
+            json_object_object_add(j_gpio_port, "direction", json_object_new_int(directions[i]));
+            json_object_object_add(j_gpio_port, "changes", json_object_new_int64(gpio_monitor_changes(i)));
             
             /* Add the port info to the array */
             json_object_array_add(jarray, j_gpio_port);
@@ -176,6 +231,7 @@ json_object* gpio_get_overview(struct client *cl, char *request) {
 
     /* Add the array to the json object */
     json_object_object_add(jobj, "ports", jarray);
+    json_object_object_add(jobj, "seq", json_object_new_int64(gpio_monitor_seq()));
 
     /* Return status ok */
     cl->http_status = r_ok;
@@ -183,34 +239,196 @@ json_object* gpio_get_overview(struct client *cl, char *request) {
 }
 
 /**
- * Get the states of all GPIO ports. 
+ * Get the states of all GPIO ports. The sequence number of a port
+ * is the one of its last change, clients can compare it with the
+ * sequence number of the whole response to skip unchanged ports. 
  * @param cl the client who made the request.
  * @param request the request part of the url. 
  */
 json_object* gpio_get_all_states(struct client *cl, char *request){   
     int i;
+    int states[28];
+    uint32_t seq;
 
     /* Create the json object */
     json_object *jobj = json_object_new_object();
     json_object *jarray = json_object_new_array();
 
-    /* Check the state for every IO port */
+    /* Read all IO ports at once */
+    gpio_get_states(states);
+
+    /* Add the state for every IO port */
     for(i = 0; i < (sizeof(gpio_config) / sizeof(bool)); ++i) {
-        if(gpio_reserve(i)){
+        if(gpio_config[i]){
             json_object *j_gpio_port = json_object_new_object();
             
             /* Add data */
             json_object_object_add(j_gpio_port, "port-number", json_object_new_int(i));
-            json_object_object_add(j_gpio_port, "port-state", json_object_new_int(gpio_get_state(i)));
+            json_object_object_add(j_gpio_port, "port-state", json_object_new_int(states[i]));
+            gpio_monitor_get(i, &seq);
+            json_object_object_add(j_gpio_port, "seq", json_object_new_int64(seq));
+            json_object_object_add(j_gpio_port, "changes", json_object_new_int64(gpio_monitor_changes(i)));
             json_object_array_add(jarray, j_gpio_port);
-            
-            /* Release the port */
-            gpio_release(i);
         }
     }
 
     /* Add the array to the json object */
     json_object_object_add(jobj, "ports", jarray);
+    json_object_object_add(jobj, "seq", json_object_new_int64(gpio_monitor_seq()));
+
+    /* Return status ok */
+    cl->http_status = r_ok;
+    return jobj;
+}
+
+/**
+ * Build the response of an events request.
+ * @param since the sequence number of the last edge the client has seen.
+ * @return the edges after since, as far as they are kept.
+ */
+static json_object* gpio_events_json(uint32_t since)
+{
+    struct gpio_event events[GPIO_EVENT_SLOTS];
+    uint32_t lost = 0;
+    uint32_t last = gpio_events_seq();
+    int n;
+
+    n = gpio_events_read(since, events, GPIO_EVENT_SLOTS, &lost);
+
+    json_object *jobj = json_object_new_object();
+    json_object *j_events = json_object_new_array();
+
+    for (int i = 0; i < n; ++i) {
+        json_object *j_event = json_object_new_object();
+
+        json_object_object_add(j_event, "seq", json_object_new_int64(events[i].seq));
+        json_object_object_add(j_event, "pin", json_object_new_int(events[i].gpio));
+        json_object_object_add(j_event, "state", json_object_new_int(events[i].state));
+        json_object_object_add(j_event, "ts", json_object_new_int64(events[i].timestamp));
+        json_object_array_add(j_events, j_event);
+    }
+
+    /* Edges pushed during the copy are in the next response */
+    if (n > 0)
+        last = events[n - 1].seq;
+
+    json_object_object_add(jobj, "seq", json_object_new_int64(last));
+    json_object_object_add(jobj, "lost", json_object_new_int64(lost));
+    json_object_object_add(jobj, "events", j_events);
+
+    return jobj;
+}
+
+/**
+ * Answer a waiting events request.
+ * @param w the wait of the request.
+ * @param timed_out true when no edge came in time.
+ */
+static void gpio_events_ready(struct gpio_events_waiter *w, bool timed_out)
+{
+    struct gpio_events_request *req = container_of(w, struct gpio_events_request, waiter);
+    struct client *cl = req->cl;
+    uint32_t since = w->since;
+
+    free(req);
+
+    cl->http_status = r_ok;
+    api_respond(cl, gpio_events_json(since));
+}
+
+/**
+ * Release a waiting events request when its client goes away.
+ * @param cl the client who made the request.
+ */
+static void gpio_events_release(struct client *cl)
+{
+    struct gpio_events_request *req = cl->dispatch.req_data;
+
+    gpio_events_cancel(&req->waiter);
+    free(req);
+}
+
+/**
+ * Get the input edges after a sequence number: events?since=<seq>&timeout=<ms>.
+ * Without new edges the request waits up to timeout ms for the first one.
+ * @param cl the client who made the request.
+ * @param request the request part of the url. 
+ */
+json_object* gpio_get_events(struct client *cl, char *request)
+{
+    struct gpio_events_request *req;
+    uint32_t since = 0;
+    long timeout = 0;
+    char *arg;
+
+    if ((arg = strstr(request, "since=")) != NULL)
+        since = strtoul(arg + 6, NULL, 10);
+
+    if ((arg = strstr(request, "timeout=")) != NULL)
+        timeout = strtol(arg + 8, NULL, 10);
+
+    if (timeout > GPIO_EVENT_MAX_WAIT)
+        timeout = GPIO_EVENT_MAX_WAIT;
+
+    cl->http_status = r_ok;
+
+    /* Answer right away when there are edges or the client won't wait */
+    if (timeout <= 0 || since < gpio_events_seq())
+        return gpio_events_json(since);
+
+    req = calloc(1, sizeof(*req));
+    if (!req)
+        return gpio_events_json(since);
+
+    req->cl = cl;
+    req->waiter.since = since;
+    req->waiter.cb = gpio_events_ready;
+
+    /* An edge since the check above or no event file descriptor, answer now */
+    if (!gpio_events_wait(&req->waiter, timeout)) {
+        since = req->waiter.since;
+        free(req);
+        return gpio_events_json(since);
+    }
+
+    /* The callback only runs from the event loop, after the request is parked */
+    if (!api_park(cl, gpio_events_release, req)) {
+        gpio_events_cancel(&req->waiter);
+        free(req);
+        return gpio_events_json(since);
+    }
+
+    return NULL;
+}
+
+/**
+ * Get the counted pulses and the frequency of a counter input.
+ * @cl the client who made the request.
+ * @request the request part of the url.
+ */
+json_object* gpio_get_counter(struct client *cl, char *request) 
+{
+    struct gpio_counter_info info;
+    int gpio_pin;
+
+    /* If sscanf fails the request is malformed */
+    if (sscanf(request, "%d", &gpio_pin) != 1 || !gpio_counter_get(gpio_pin, &info)) {
+        log_message(LOG_WARNING, "GPIO GET counter request failed, bad request\r\n");
+        cl->http_status = r_bad_req;
+        return NULL;
+    }
+
+    /* Put data in JSON object */
+    json_object *jobj = json_object_new_object();
+
+    json_object_object_add(jobj, "pin", json_object_new_int(gpio_pin));
+    json_object_object_add(jobj, "total", json_object_new_int64(info.total));
+    json_object_object_add(jobj, "interval", json_object_new_int(conf->gpio_counter_interval));
+    json_object_object_add(jobj, "interval_count", json_object_new_int64(info.interval_count));
+    json_object_object_add(jobj, "current_count", json_object_new_int64(info.current_count));
+    json_object_object_add(jobj, "frequency", json_object_new_double(info.frequency));
+    json_object_object_add(jobj, "period_us", json_object_new_int64(info.period_ns / 1000));
+    json_object_object_add(jobj, "last_edge", json_object_new_int64(info.last_edge));
 
     /* Return status ok */
     cl->http_status = r_ok;
@@ -226,6 +444,7 @@ json_object* gpio_get_status(struct client *cl, char *request)
 {
     int gpio_pin;
     int gpio_state;
+    uint32_t seq = 0;
 
     /* If sscanf fails the request is malformed */
     if(sscanf(request, "%d", &gpio_pin) != 1) {
@@ -250,6 +469,8 @@ json_object* gpio_get_status(struct client *cl, char *request)
 
     json_object_object_add(jobj, "pin", j_pin);
     json_object_object_add(jobj, "state", j_state);
+    gpio_monitor_get(gpio_pin, &seq);
+    json_object_object_add(jobj, "seq", json_object_new_int64(seq));
 
     /* Return status ok */
     cl->http_status = r_ok;
@@ -291,6 +512,202 @@ json_object* gpio_put_status(struct client *cl, char *request)
     return jobj;
 }
 
+/**
+ * Parse the pins of a bulk request, either {"mask": m, <bits>: b} or
+ * {"pins": {"<gpiopin>": <value>, ...}}.
+ * @param in_obj the parsed post data.
+ * @param bits_name the name of the bits next to the mask.
+ * @param pin_bit converts the value of a pin to its bit, -1 when invalid.
+ * @param mask receives the pins in the request.
+ * @param bits receives the bits of the pins.
+ * @return false when the request is malformed.
+ */
+static bool gpio_parse_bulk(json_object *in_obj, const char *bits_name, int (*pin_bit)(json_object *value),
+        uint32_t *mask, uint32_t *bits)
+{
+    json_object *j_mask = NULL;
+    json_object *j_bits = NULL;
+    json_object *j_pins = NULL;
+
+    *mask = 0;
+    *bits = 0;
+
+    if (json_object_object_get_ex(in_obj, "mask", &j_mask) && json_object_object_get_ex(in_obj, bits_name, &j_bits)) {
+        *mask = json_object_get_int64(j_mask);
+        *bits = json_object_get_int64(j_bits) & *mask;
+        return true;
+    }
+
+    if (!json_object_object_get_ex(in_obj, "pins", &j_pins) || !json_object_is_type(j_pins, json_type_object))
+        return false;
+
+    json_object_object_foreach(j_pins, key, value) {
+        char *end;
+        long gpio = strtol(key, &end, 10);
+        int bit = pin_bit(value);
+
+        if (*end || gpio < 0 || gpio > 31 || bit < 0)
+            return false;
+
+        *mask |= 1u << gpio;
+        *bits |= (uint32_t) bit << gpio;
+    }
+
+    return true;
+}
+
+/**
+ * Check that a bulk request only names exposed ports.
+ * @param mask bit n set for GPIO n.
+ * @return true when all ports are exposed.
+ */
+static bool gpio_bulk_exposed(uint32_t mask)
+{
+    for (int i = 0; i < 32; ++i) {
+        if ((mask & (1u << i)) && (i > 27 || !gpio_config[i]))
+            return false;
+    }
+
+    return true;
+}
+
+/**
+ * Convert the state of a pin in a bulk request.
+ * @param value 1 or 0.
+ * @return the bit of the pin.
+ */
+static int gpio_state_bit(json_object *value)
+{
+    return json_object_get_int(value) ? 1 : 0;
+}
+
+/**
+ * Convert the direction of a pin in a bulk request.
+ * @param value "out", "in", GPIO_OUT or GPIO_IN.
+ * @return 1 for an output, 0 for an input, -1 when invalid.
+ */
+static int gpio_direction_bit(json_object *value)
+{
+    if (json_object_is_type(value, json_type_string)) {
+        const char *dir = json_object_get_string(value);
+
+        return strcmp(dir, "out") == 0 ? 1 : strcmp(dir, "in") == 0 ? 0 : -1;
+    }
+
+    switch (json_object_get_int(value)) {
+        case GPIO_OUT:
+            return 1;
+        case GPIO_IN:
+            return 0;
+        default:
+            return -1;
+    }
+}
+
+/**
+ * Set the states of several outputs at once. The post data is 
+ * {"mask": m, "values": v} or {"pins": {"<gpiopin>": 0|1, ...}}. Pins 
+ * that are no output yet become outputs at their new level.
+ * @param cl the client who made the request.
+ * @param request the request part of the url.
+ */
+json_object* gpio_put_states(struct client *cl, char *request)
+{
+    json_object *in_obj = cl->postdata ? json_tokener_parse(cl->postdata) : NULL;
+    int directions[28];
+    uint32_t inputs = 0;
+    uint32_t mask;
+    uint32_t values;
+    bool ok;
+
+    ok = in_obj && gpio_parse_bulk(in_obj, "values", gpio_state_bit, &mask, &values) && mask;
+    if (in_obj)
+        json_object_put(in_obj);
+
+    if (!ok || !gpio_bulk_exposed(mask)) {
+        cl->http_status = r_bad_req;
+        return NULL;
+    }
+
+    for (int i = 0; i < 28; ++i) {
+        if ((mask & (1u << i)) && !gpio_reserve(i)) {
+            cl->http_status = r_error;
+            return NULL;
+        }
+    }
+
+    if (!gpio_get_directions(directions)) {
+        cl->http_status = r_error;
+        return NULL;
+    }
+
+    for (int i = 0; i < 28; ++i) {
+        if ((mask & (1u << i)) && directions[i] != GPIO_OUT)
+            inputs |= 1u << i;
+    }
+
+    /* All outputs change in one operation, inputs are given their level before they drive it */
+    if (!(inputs ? gpio_set_outputs(mask, values) : gpio_set_states(mask, values))) {
+        cl->http_status = r_error;
+        return NULL;
+    }
+
+    /* Put data in JSON object */
+    json_object *jobj = json_object_new_object();
+
+    json_object_object_add(jobj, "mask", json_object_new_int64(mask));
+    json_object_object_add(jobj, "values", json_object_new_int64(values));
+
+    /* Return status ok */
+    cl->http_status = r_ok;
+    return jobj;
+}
+
+/**
+ * Set the direction of several ports at once. The post data is 
+ * {"mask": m, "outputs": o} or {"pins": {"<gpiopin>": "in"|"out", ...}}.
+ * @param cl the client who made the request.
+ * @param request the request part of the url.
+ */
+json_object* gpio_put_directions(struct client *cl, char *request)
+{
+    json_object *in_obj = cl->postdata ? json_tokener_parse(cl->postdata) : NULL;
+    uint32_t mask;
+    uint32_t outputs;
+    bool ok;
+
+    ok = in_obj && gpio_parse_bulk(in_obj, "outputs", gpio_direction_bit, &mask, &outputs) && mask;
+    if (in_obj)
+        json_object_put(in_obj);
+
+    if (!ok || !gpio_bulk_exposed(mask)) {
+        cl->http_status = r_bad_req;
+        return NULL;
+    }
+
+    for (int i = 0; i < 28; ++i) {
+        if ((mask & (1u << i)) && !gpio_reserve(i)) {
+            cl->http_status = r_error;
+            return NULL;
+        }
+    }
+
+    if (!gpio_set_directions(mask, outputs)) {
+        cl->http_status = r_error;
+        return NULL;
+    }
+
+    /* Put data in JSON object */
+    json_object *jobj = json_object_new_object();
+
+    json_object_object_add(jobj, "mask", json_object_new_int64(mask));
+    json_object_object_add(jobj, "outputs", json_object_new_int64(outputs));
+
+    /* Return status ok */
+    cl->http_status = r_ok;
+    return jobj;
+}
+
 /**
  * Set-up the direction of a GPIO port. 
  * @param cl the client who made the request.
@@ -333,13 +750,27 @@ json_object* gpio_put_direction(struct client *cl, char *request)
  */
 json_object* gpio_put_pulse_output(struct client *cl, char *request)
 {
-    /* This functions expects the following request /<gpiopin>/<mode>/<nr_of_ms> */
+    /* This functions expects the following request /<gpiopin>/<mode>[/<nr_of_ms>] */
     int gpio_pin;
     int gpio_mode;
     int ms;
+    int fields;
 
     /* If sscanf fails the request is malformed */
-    if(sscanf(request, "%d/%d/%d", &gpio_pin, &gpio_mode, &ms) != 3) {
+    fields = sscanf(request, "%d/%d/%d", &gpio_pin, &gpio_mode, &ms);
+    if(fields < 2) {
+        cl->http_status = r_bad_req;
+        return NULL;
+    }
+
+    /* Without a time the stored pulse time of the pin is used */
+    if(fields == 2 && (ms = gpio_dao_get_pulsetime(gpio_pin)) < 0) {
+        cl->http_status = r_bad_req;
+        return NULL;
+    }
+
+    /* The time must fit in microseconds */
+    if(ms < 0 || ms > INT_MAX / 1000) {
         cl->http_status = r_bad_req;
         return NULL;
     }
@@ -361,3 +792,234 @@ json_object* gpio_put_pulse_output(struct client *cl, char *request)
     cl->http_status = r_ok;
     return jobj;
 }
+
+/**
+ * Start a pulse train on an output.
+ * @param cl the client who made the request.
+ * @param request the request part of the url. 
+ */
+json_object* gpio_put_pulse_train(struct client *cl, char *request)
+{
+    /* This functions expects the following request /<gpiopin>/<mode>/<on_ms>/<off_ms>/<count> */
+    int gpio_pin;
+    int gpio_mode;
+    int on_ms;
+    int off_ms;
+    int count;
+
+    /* If sscanf fails the request is malformed */
+    if(sscanf(request, "%d/%d/%d/%d/%d", &gpio_pin, &gpio_mode, &on_ms, &off_ms, &count) != 5 ||
+            on_ms < 0 || off_ms < 0 || count < 1 ||
+            (uint32_t) on_ms > UINT32_MAX / 1000 || (uint32_t) off_ms > UINT32_MAX / 1000) {
+        cl->http_status = r_bad_req;
+        return NULL;
+    }
+
+    if(!gpio_pulse_train(gpio_pin, gpio_mode, on_ms * 1000u, off_ms * 1000u, count)) {
+        cl->http_status = r_error;
+        return NULL;
+    }
+
+    /* Put data in JSON object */
+    json_object *jobj = json_object_new_object();
+    
+    json_object_object_add(jobj, "pin", json_object_new_int(gpio_pin));
+    json_object_object_add(jobj, "pulse_time", json_object_new_int(on_ms));
+    json_object_object_add(jobj, "pause_time", json_object_new_int(off_ms));
+    json_object_object_add(jobj, "count", json_object_new_int(count));
+
+    /* Return status ok */
+    cl->http_status = r_ok;
+    return jobj;
+}
+
+/**
+ * Cancel the pending pulses of an output.
+ * @param cl the client who made the request.
+ * @param request the request part of the url. 
+ */
+json_object* gpio_put_pulse_cancel(struct client *cl, char *request)
+{
+    /* This functions expects the following request /<gpiopin> */
+    int gpio_pin;
+
+    /* If sscanf fails the request is malformed */
+    if(sscanf(request, "%d", &gpio_pin) != 1) {
+        cl->http_status = r_bad_req;
+        return NULL;
+    }
+
+    /* Put data in JSON object */
+    json_object *jobj = json_object_new_object();
+
+    json_object_object_add(jobj, "pin", json_object_new_int(gpio_pin));
+    json_object_object_add(jobj, "cancelled", json_object_new_int(gpio_pulse_cancel(gpio_pin)));
+
+    /* Return status ok */
+    cl->http_status = r_ok;
+    return jobj;
+}
+
+/**
+ * Describe the waveform playback in JSON.
+ * @return the JSON object of the playback state.
+ */
+static json_object* gpio_wave_json(void)
+{
+    struct gpio_wave_status status;
+    json_object *jobj = json_object_new_object();
+
+    gpio_wave_get_status(&status);
+    json_object_object_add(jobj, "playing", json_object_new_boolean(status.playing));
+    json_object_object_add(jobj, "registers", json_object_new_boolean(status.registers));
+    json_object_object_add(jobj, "steps", json_object_new_int(status.steps));
+    json_object_object_add(jobj, "loop", json_object_new_int64(status.loops));
+    json_object_object_add(jobj, "loops_done", json_object_new_int64(status.loops_done));
+    json_object_object_add(jobj, "steps_done", json_object_new_int64(status.steps_done));
+    if (status.steps_done > 0) {
+        json_object_object_add(jobj, "latency_avg", json_object_new_double(status.late_total_ns / 1000.0 / status.steps_done));
+        json_object_object_add(jobj, "latency_max", json_object_new_double(status.late_max_ns / 1000.0));
+    }
+
+    return jobj;
+}
+
+/**
+ * Convert a JSON delay in microseconds to nanoseconds.
+ * @param j_delay the delay, fractions are allowed.
+ * @param delay_ns receives the delay.
+ * @return false when the delay is not a number, negative or too long.
+ */
+static bool gpio_wave_delay(json_object *j_delay, uint32_t *delay_ns)
+{
+    double delay = json_object_get_double(j_delay);
+
+    if (!isfinite(delay) || delay < 0 || delay * 1000 > UINT32_MAX)
+        return false;
+
+    *delay_ns = delay * 1000 + 0.5;
+    return true;
+}
+
+/**
+ * Play a waveform. The post data is either a list of steps,
+ * {"steps": [{"mask": m, "level": 0|1, "delay": us}, ...]}, or a
+ * sampled pattern, {"mask": m, "samples": [bits, ...], "period": us}.
+ * An optional "loop" plays it that many times, 0 for ever.
+ * @param cl the client who made the request.
+ * @param request the request part of the url.
+ */
+json_object* gpio_post_wave(struct client *cl, char *request)
+{
+    json_object *in_obj = cl->postdata ? json_tokener_parse(cl->postdata) : NULL;
+    json_object *j_steps = NULL;
+    json_object *j_samples = NULL;
+    json_object *j_mask = NULL;
+    json_object *j_period = NULL;
+    json_object *j_loop = NULL;
+    struct gpio_wave_step *steps = NULL;
+    int64_t loops = 1;
+    uint32_t period_ns;
+    uint32_t mask;
+    int num_steps;
+
+    if (!in_obj) {
+        cl->http_status = r_bad_req;
+        return NULL;
+    }
+
+    if (json_object_object_get_ex(in_obj, "loop", &j_loop))
+        loops = json_object_get_int64(j_loop);
+
+    if (loops < 0 || loops > UINT32_MAX)
+        goto bad_request;
+
+    if (json_object_object_get_ex(in_obj, "steps", &j_steps) && json_object_is_type(j_steps, json_type_array)) {
+        num_steps = json_object_array_length(j_steps);
+        if (num_steps == 0 || num_steps > GPIO_WAVE_MAX_STEPS)
+            goto bad_request;
+
+        steps = calloc(num_steps, sizeof(*steps));
+        for (int i = 0; i < num_steps; ++i) {
+            json_object *j_step = json_object_array_get_idx(j_steps, i);
+            json_object *j_level = NULL;
+            json_object *j_delay = NULL;
+
+            if (!json_object_object_get_ex(j_step, "mask", &j_mask) ||
+                    !json_object_object_get_ex(j_step, "level", &j_level) ||
+                    !json_object_object_get_ex(j_step, "delay", &j_delay) ||
+                    !gpio_wave_delay(j_delay, &steps[i].delay_ns))
+                goto bad_request;
+
+            mask = json_object_get_int64(j_mask);
+            if (json_object_get_int(j_level)) {
+                steps[i].set = mask;
+            } else {
+                steps[i].clear = mask;
+            }
+        }
+    } else if (json_object_object_get_ex(in_obj, "samples", &j_samples) && json_object_is_type(j_samples, json_type_array) &&
+            json_object_object_get_ex(in_obj, "mask", &j_mask) &&
+            json_object_object_get_ex(in_obj, "period", &j_period)) {
+        num_steps = json_object_array_length(j_samples);
+        if (num_steps == 0 || num_steps > GPIO_WAVE_MAX_STEPS || !gpio_wave_delay(j_period, &period_ns))
+            goto bad_request;
+
+        mask = json_object_get_int64(j_mask);
+        steps = calloc(num_steps, sizeof(*steps));
+        for (int i = 0; i < num_steps; ++i) {
+            uint32_t bits = json_object_get_int64(json_object_array_get_idx(j_samples, i));
+
+            steps[i].set = bits & mask;
+            steps[i].clear = ~bits & mask;
+            steps[i].delay_ns = period_ns;
+        }
+    } else {
+        goto bad_request;
+    }
+
+    json_object_put(in_obj);
+    in_obj = NULL;
+
+    if (!gpio_wave_check(steps, num_steps, loops))
+        goto bad_request;
+
+    /* The steps belong to the player now */
+    if (!gpio_wave_play(steps, num_steps, loops)) {
+        cl->http_status = r_error;
+        return NULL;
+    }
+
+    cl->http_status = r_ok;
+    return gpio_wave_json();
+
+bad_request:
+    free(steps);
+    json_object_put(in_obj);
+    cl->http_status = r_bad_req;
+    return NULL;
+}
+
+/**
+ * Get the state of the waveform playback.
+ * @param cl the client who made the request.
+ * @param request the request part of the url.
+ */
+json_object* gpio_get_wave(struct client *cl, char *request)
+{
+    cl->http_status = r_ok;
+    return gpio_wave_json();
+}
+
+/**
+ * Stop the waveform that is playing, the pins keep their level.
+ * @param cl the client who made the request.
+ * @param request the request part of the url.
+ */
+json_object* gpio_put_wave_stop(struct client *cl, char *request)
+{
+    gpio_wave_stop();
+
+    cl->http_status = r_ok;
+    return gpio_wave_json();
+}
@@ -80,6 +80,21 @@ json_object* gpio_get_overview(struct client *cl, char *request);
  */
 json_object* gpio_get_all_states(struct client *cl, char *request);
 
+/**
+ * Get the input edges after a sequence number: events?since=<seq>&timeout=<ms>.
+ * Without new edges the request waits up to timeout ms for the first one.
+ * @param cl the client who made the request.
+ * @param request the request part of the url. 
+ */
+json_object* gpio_get_events(struct client *cl, char *request);
+
+/**
+ * Get the counted pulses and the frequency of a counter input.
+ * @cl the client who made the request.
+ * @request the request part of the url.
+ */
+json_object* gpio_get_counter(struct client *cl, char *request);
+
 /**
  * Get the state of a given GPIO port.
  * @cl the client who made the request.
@@ -101,11 +116,66 @@ json_object* gpio_put_status(struct client *cl, char *request);
  */
 json_object* gpio_put_direction(struct client *cl, char *request);
 
+/**
+ * Set the states of several outputs at once. The post data is 
+ * {"mask": m, "values": v} or {"pins": {"<gpiopin>": 0|1, ...}}. Pins 
+ * that are no output yet are made outputs first.
+ * @param cl the client who made the request.
+ * @param request the request part of the url.
+ */
+json_object* gpio_put_states(struct client *cl, char *request);
+
+/**
+ * Set the direction of several ports at once. The post data is 
+ * {"mask": m, "outputs": o} or {"pins": {"<gpiopin>": "in"|"out", ...}}.
+ * @param cl the client who made the request.
+ * @param request the request part of the url.
+ */
+json_object* gpio_put_directions(struct client *cl, char *request);
+
 /**
  * Pulse an output for a number of milliseconds.
  * @param cl the client who made the request.
  * @param request the request part of the url. 
  */
 json_object* gpio_put_pulse_output(struct client *cl, char *request);
+
+/**
+ * Start a pulse train on an output.
+ * @param cl the client who made the request.
+ * @param request the request part of the url. 
+ */
+json_object* gpio_put_pulse_train(struct client *cl, char *request);
+
+/**
+ * Cancel the pending pulses of an output.
+ * @param cl the client who made the request.
+ * @param request the request part of the url. 
+ */
+json_object* gpio_put_pulse_cancel(struct client *cl, char *request);
+
+/**
+ * Play a waveform. The post data is either a list of steps,
+ * {"steps": [{"mask": m, "level": 0|1, "delay": us}, ...]}, or a
+ * sampled pattern, {"mask": m, "samples": [bits, ...], "period": us}.
+ * An optional "loop" plays it that many times, 0 for ever.
+ * @param cl the client who made the request.
+ * @param request the request part of the url.
+ */
+json_object* gpio_post_wave(struct client *cl, char *request);
+
+/**
+ * Get the state of the waveform playback.
+ * @param cl the client who made the request.
+ * @param request the request part of the url.
+ */
+json_object* gpio_get_wave(struct client *cl, char *request);
+
+/**
+ * Stop the waveform that is playing, the pins keep their level.
+ * @param cl the client who made the request.
+ * @param request the request part of the url.
+ */
+json_object* gpio_put_wave_stop(struct client *cl, char *request);
 #endif
 
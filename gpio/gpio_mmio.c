@@ -0,0 +1,197 @@
+/* 
+ * Copyright (c) 2014, Daan Pape
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without 
+ * modification, are permitted provided that the following conditions are met:
+ * 
+ *     1. Redistributions of source code must retain the above copyright 
+ *        notice, this list of conditions and the following disclaimer.
+ *
+ *     2. Redistributions in binary form must reproduce the above copyright 
+ *        notice, this list of conditions and the following disclaimer in the 
+ *        documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" 
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE 
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE 
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE 
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR 
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF 
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS 
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN 
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) 
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE 
+ * POSSIBILITY OF SUCH DAMAGE.
+ * 
+ * File:   gpio_mmio.c
+ * Created on October 18, 2026, 11:40 AM
+ */
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <pthread.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+
+#include "../logger.h"
+#include "gpio.h"
+#include "gpio_mmio.h"
+
+/* The mapped GPIO block, NULL if not mapped */
+static volatile uint32_t *regs = NULL;
+
+/* Mask of the exposed pins */
+static uint32_t exposed = 0;
+
+/* Protects read-modify-write cycles of the output enable register */
+static pthread_mutex_t oe_lock = PTHREAD_MUTEX_INITIALIZER;
+
+/**
+ * Map the GPIO block.
+ * @param device the memory device, /dev/mem or a file holding a fake 
+ * register block at GPIO_MMIO_BASE.
+ * @return true on success.
+ */
+bool gpio_mmio_open(const char *device)
+{
+    void *block;
+    int fd;
+
+    if (regs != NULL)
+        return true;
+
+    fd = open(device, O_RDWR | O_SYNC | O_CLOEXEC);
+    if (fd < 0) {
+        log_message(LOG_DEBUG, "gpio_mmio_open: could not open %s\r\n", device);
+        return false;
+    }
+
+    block = mmap(NULL, GPIO_MMIO_SIZE, PROT_READ | PROT_WRITE, MAP_SHARED, fd, GPIO_MMIO_BASE);
+    close(fd);
+
+    if (block == MAP_FAILED) {
+        log_message(LOG_DEBUG, "gpio_mmio_open: could not map the GPIO block of %s\r\n", device);
+        return false;
+    }
+
+    exposed = 0;
+    for (int gpio = 0; gpio < 28; ++gpio) {
+        if (gpio_config[gpio])
+            exposed |= 1u << gpio;
+    }
+
+    regs = block;
+    return true;
+}
+
+/**
+ * Unmap the GPIO block.
+ */
+void gpio_mmio_close(void)
+{
+    if (regs == NULL)
+        return;
+
+    munmap((void*) regs, GPIO_MMIO_SIZE);
+    regs = NULL;
+}
+
+/**
+ * Get the mask of the pins that may be touched.
+ * @return bit n set when GPIO n is exposed.
+ */
+uint32_t gpio_mmio_exposed(void)
+{
+    return exposed;
+}
+
+/**
+ * Read the levels of the exposed pins.
+ * @return bit n set when GPIO n is high.
+ */
+uint32_t gpio_mmio_read(void)
+{
+    return regs ? regs[GPIO_REG_IN] & exposed : 0;
+}
+
+/**
+ * Read the directions of the exposed pins.
+ * @return bit n set when GPIO n is an output.
+ */
+uint32_t gpio_mmio_outputs(void)
+{
+    return regs ? regs[GPIO_REG_OE] & exposed : 0;
+}
+
+/**
+ * Drive output pins high with one register write.
+ * @param mask bit n set to drive GPIO n high.
+ * @return false when the block is not mapped or a pin is not exposed.
+ */
+bool gpio_mmio_set(uint32_t mask)
+{
+    if (regs == NULL || (mask & ~exposed))
+        return false;
+
+    regs[GPIO_REG_SET] = mask;
+    return true;
+}
+
+/**
+ * Drive output pins low with one register write.
+ * @param mask bit n set to drive GPIO n low.
+ * @return false when the block is not mapped or a pin is not exposed.
+ */
+bool gpio_mmio_clear(uint32_t mask)
+{
+    if (regs == NULL || (mask & ~exposed))
+        return false;
+
+    regs[GPIO_REG_CLEAR] = mask;
+    return true;
+}
+
+/**
+ * Drive several output pins high or low. The high pins change
+ * first, the low pins right after.
+ * @param mask bit n set to change GPIO n.
+ * @param values bit n set to drive GPIO n high.
+ * @return false when the block is not mapped or a pin is not exposed.
+ */
+bool gpio_mmio_write(uint32_t mask, uint32_t values)
+{
+    if (regs == NULL || (mask & ~exposed))
+        return false;
+
+    if (mask & values)
+        regs[GPIO_REG_SET] = mask & values;
+    if (mask & ~values)
+        regs[GPIO_REG_CLEAR] = mask & ~values;
+    return true;
+}
+
+/**
+ * Set the direction of several pins. The output enable register has no
+ * set and clear companions, only the exposed bits are changed.
+ * @param mask bit n set to change GPIO n.
+ * @param direction GPIO_IN or GPIO_OUT.
+ * @return false when the block is not mapped or a pin is not exposed.
+ */
+bool gpio_mmio_set_direction(uint32_t mask, int direction)
+{
+    if (regs == NULL || (mask & ~exposed))
+        return false;
+
+    pthread_mutex_lock(&oe_lock);
+    if (direction == GPIO_OUT) {
+        regs[GPIO_REG_OE] |= mask;
+    } else {
+        regs[GPIO_REG_OE] &= ~mask;
+    }
+    pthread_mutex_unlock(&oe_lock);
+
+    return true;
+}
@@ -0,0 +1,111 @@
+/* 
+ * Copyright (c) 2014, Daan Pape
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without 
+ * modification, are permitted provided that the following conditions are met:
+ * 
+ *     1. Redistributions of source code must retain the above copyright 
+ *        notice, this list of conditions and the following disclaimer.
+ *
+ *     2. Redistributions in binary form must reproduce the above copyright 
+ *        notice, this list of conditions and the following disclaimer in the 
+ *        documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" 
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE 
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE 
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE 
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR 
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF 
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS 
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN 
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) 
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE 
+ * POSSIBILITY OF SUCH DAMAGE.
+ * 
+ * File:   gpio_mmio.h
+ * Created on October 18, 2026, 11:40 AM
+ * 
+ * Register level access to the GPIO block of the AR9331. Every call
+ * only touches the pins exposed in gpio_config.
+ */
+
+#ifndef GPIO_MMIO_H
+#define	GPIO_MMIO_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#define GPIO_MMIO_BASE      0x18040000      /* Physical address of the GPIO block */
+#define GPIO_MMIO_SIZE      48              /* Size of the GPIO block */
+
+/* GPIO registers, in 32-bit words from the base */
+#define GPIO_REG_OE         0               /* Output enable, a set bit is an output */
+#define GPIO_REG_IN         1               /* Input levels */
+#define GPIO_REG_OUT        2               /* Output levels */
+#define GPIO_REG_SET        3               /* Writing a bit drives the pin high */
+#define GPIO_REG_CLEAR      4               /* Writing a bit drives the pin low */
+
+/**
+ * Map the GPIO block.
+ * @param device the memory device, /dev/mem or a file holding a fake 
+ * register block at GPIO_MMIO_BASE.
+ * @return true on success.
+ */
+bool gpio_mmio_open(const char *device);
+
+/**
+ * Unmap the GPIO block.
+ */
+void gpio_mmio_close(void);
+
+/**
+ * Get the mask of the pins that may be touched.
+ * @return bit n set when GPIO n is exposed.
+ */
+uint32_t gpio_mmio_exposed(void);
+
+/**
+ * Read the levels of the exposed pins.
+ * @return bit n set when GPIO n is high.
+ */
+uint32_t gpio_mmio_read(void);
+
+/**
+ * Read the directions of the exposed pins.
+ * @return bit n set when GPIO n is an output.
+ */
+uint32_t gpio_mmio_outputs(void);
+
+/**
+ * Drive output pins high with one register write.
+ * @param mask bit n set to drive GPIO n high.
+ * @return false when the block is not mapped or a pin is not exposed.
+ */
+bool gpio_mmio_set(uint32_t mask);
+
+/**
+ * Drive output pins low with one register write.
+ * @param mask bit n set to drive GPIO n low.
+ * @return false when the block is not mapped or a pin is not exposed.
+ */
+bool gpio_mmio_clear(uint32_t mask);
+
+/**
+ * Drive several output pins high or low.
+ * @param mask bit n set to change GPIO n.
+ * @param values bit n set to drive GPIO n high.
+ * @return false when the block is not mapped or a pin is not exposed.
+ */
+bool gpio_mmio_write(uint32_t mask, uint32_t values);
+
+/**
+ * Set the direction of several pins.
+ * @param mask bit n set to change GPIO n.
+ * @param direction GPIO_IN or GPIO_OUT.
+ * @return false when the block is not mapped or a pin is not exposed.
+ */
+bool gpio_mmio_set_direction(uint32_t mask, int direction);
+
+#endif
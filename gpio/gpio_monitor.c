@@ -0,0 +1,487 @@
+/* 
+ * Copyright (c) 2014, Daan Pape
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without 
+ * modification, are permitted provided that the following conditions are met:
+ * 
+ *     1. Redistributions of source code must retain the above copyright 
+ *        notice, this list of conditions and the following disclaimer.
+ *
+ *     2. Redistributions in binary form must reproduce the above copyright 
+ *        notice, this list of conditions and the following disclaimer in the 
+ *        documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" 
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE 
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE 
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE 
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR 
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF 
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS 
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN 
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) 
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE 
+ * POSSIBILITY OF SUCH DAMAGE.
+ * 
+ * File:   gpio_monitor.c
+ * Created on October 18, 2026, 1:25 PM
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <pthread.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <time.h>
+
+#include <libubox/uloop.h>
+#include <libubox/utils.h>
+
+#include "../config.h"
+#include "../logger.h"
+#include "../helper.h"
+#include "../stall.h"
+#include "gpio.h"
+#include "gpio_cdev.h"
+#include "gpio_counter.h"
+#include "gpio_events.h"
+#include "gpio_monitor.h"
+#include "gpio_sampler.h"
+
+/* Mirrored state of a pin */
+struct gpio_mirror {
+    int state;              /* GPIO_HIGH, GPIO_LOW or GPIO_ERR when the pin must be read */
+    uint32_t seq;           /* Sequence number of the last change */
+    uint32_t changes;       /* Number of changes of the state */
+    bool input;             /* True when the edges of the input are watched or sampled */
+    struct uloop_fd fd;     /* The watched sysfs value file */
+};
+
+static struct gpio_mirror mirror[28] = {
+    [0 ... 27] = { GPIO_ERR, 0, 0, false, { .fd = -1 } }
+};
+
+/* Sequence number of the last change of any pin */
+static uint32_t seq = 0;
+
+/* True when the mirror is in use */
+static bool running = false;
+
+/* True when the sampler reports the inputs instead of their edges */
+static bool sampling = false;
+
+/* The line request reporting the edges with the character device backend */
+static struct uloop_fd line_watch = { .fd = -1 };
+
+/* Protects the mirror, outputs are also written from the pulse threads */
+static pthread_mutex_t mirror_lock = PTHREAD_MUTEX_INITIALIZER;
+
+/**
+ * Record the state of a pin. The mirror must be locked.
+ * @param gpio the GPIO pin.
+ * @param state GPIO_HIGH or GPIO_LOW.
+ */
+static void gpio_monitor_set(int gpio, int state)
+{
+    if (mirror[gpio].state != state) {
+        if (mirror[gpio].state != GPIO_ERR)
+            mirror[gpio].changes++;
+        mirror[gpio].state = state;
+        mirror[gpio].seq = ++seq;
+    }
+}
+
+/**
+ * Report an edge of a mirrored input to the event ring and the pulse
+ * counters. The mirror must not be locked.
+ * @param gpio the GPIO pin.
+ * @param state the state after the edge.
+ * @param timestamp CLOCK_MONOTONIC time of the edge in nanoseconds.
+ */
+static void gpio_monitor_edge(int gpio, int state, uint64_t timestamp)
+{
+    gpio_events_push(gpio, state, timestamp);
+    gpio_counter_edge(gpio, state, timestamp);
+}
+
+/**
+ * Write the edge file of a sysfs GPIO.
+ * @param gpio the GPIO pin.
+ * @param edge the edges to report, 'both' or 'none'.
+ * @return true on success.
+ */
+static bool gpio_monitor_sysfs_edge(int gpio, const char *edge)
+{
+    char path[HW_PATH_MAX];
+    bool ok;
+    int fd;
+
+    fd = open(helper_hw_path(path, sizeof(path), "/sys/class/gpio/gpio%d/edge", gpio), O_WRONLY | O_CLOEXEC);
+    if (fd < 0)
+        return false;
+
+    ok = write(fd, edge, strlen(edge)) >= 0;
+    close(fd);
+
+    return ok;
+}
+
+/**
+ * Called when a watched sysfs value file signals an edge.
+ * @param u the watched value file.
+ * @param events the event loop events.
+ */
+static void gpio_monitor_sysfs_cb(struct uloop_fd *u, unsigned int events)
+{
+    struct gpio_mirror *m = container_of(u, struct gpio_mirror, fd);
+    struct timespec now;
+    bool input;
+    char value;
+    STALL_SCOPE("read", "gpio sysfs edge");
+
+    /* The kernel gives no time for a sysfs edge, take it right away */
+    clock_gettime(CLOCK_MONOTONIC, &now);
+
+    if (pread(u->fd, &value, 1, 0) == 1) {
+        int state = value == '1' ? GPIO_HIGH : GPIO_LOW;
+
+        pthread_mutex_lock(&mirror_lock);
+        if ((input = m->input))
+            gpio_monitor_set(m - mirror, state);
+        pthread_mutex_unlock(&mirror_lock);
+
+        if (input)
+            gpio_monitor_edge(m - mirror, state, (uint64_t) now.tv_sec * 1000000000ull + now.tv_nsec);
+    }
+
+    /* The notification of a sysfs file is an error, that may unregister it */
+    u->error = false;
+    if (!u->registered)
+        uloop_fd_add(u, ULOOP_READ | ULOOP_EDGE_TRIGGER);
+}
+
+/**
+ * Report the edges of a sysfs GPIO through its value file. 
+ * @param gpio the GPIO pin, it must be exported.
+ * @return true when the edges are watched.
+ */
+static bool gpio_monitor_sysfs_watch(int gpio)
+{
+    struct gpio_mirror *m = &mirror[gpio];
+    char path[HW_PATH_MAX];
+
+    if (!gpio_monitor_sysfs_edge(gpio, "both"))
+        return false;
+
+    m->fd.fd = open(helper_hw_path(path, sizeof(path), "/sys/class/gpio/gpio%d/value", gpio), O_RDONLY | O_CLOEXEC);
+    m->fd.cb = gpio_monitor_sysfs_cb;
+
+    /* Regular files, like on a simulated board, can't be watched */
+    if (m->fd.fd < 0 || uloop_fd_add(&m->fd, ULOOP_READ | ULOOP_EDGE_TRIGGER) < 0) {
+        if (m->fd.fd >= 0)
+            close(m->fd.fd);
+        m->fd.fd = -1;
+        gpio_monitor_sysfs_edge(gpio, "none");
+        return false;
+    }
+
+    return true;
+}
+
+/**
+ * Stop reporting the edges of a sysfs GPIO. A GPIO with edges
+ * can't be made an output.
+ * @param gpio the GPIO pin.
+ */
+static void gpio_monitor_sysfs_unwatch(int gpio)
+{
+    struct gpio_mirror *m = &mirror[gpio];
+
+    if (m->fd.fd < 0)
+        return;
+
+    uloop_fd_delete(&m->fd);
+    close(m->fd.fd);
+    m->fd.fd = -1;
+    gpio_monitor_sysfs_edge(gpio, "none");
+}
+
+/**
+ * Called when the line request reports edges.
+ * @param u the watched line request.
+ * @param events the event loop events.
+ */
+static void gpio_monitor_line_cb(struct uloop_fd *u, unsigned int events)
+{
+    struct gpio_cdev_event ev[16];
+    int n;
+    STALL_SCOPE("read", "gpio line edges");
+
+    while ((n = gpio_cdev_read_events(ev, 16)) > 0) {
+        pthread_mutex_lock(&mirror_lock);
+        for (int i = 0; i < n; ++i) {
+            if (ev[i].gpio >= 0 && ev[i].gpio < 28 && mirror[ev[i].gpio].input) {
+                gpio_monitor_set(ev[i].gpio, ev[i].state);
+            } else {
+                ev[i].gpio = -1;
+            }
+        }
+        pthread_mutex_unlock(&mirror_lock);
+
+        for (int i = 0; i < n; ++i) {
+            if (ev[i].gpio >= 0)
+                gpio_monitor_edge(ev[i].gpio, ev[i].state, ev[i].timestamp);
+        }
+    }
+}
+
+/**
+ * Start watching the edges of the exposed input pins. Must be called
+ * after the GPIO backend is selected and the event loop is initialized.
+ * @return true when the input pins are mirrored.
+ */
+bool gpio_monitor_init(void)
+{
+    int watched = 0;
+
+    if (running || !conf->gpio_monitor)
+        return false;
+
+    /* Bouncing inputs are filtered by the sampler, their raw edges are not watched */
+    if (conf->gpio_sample_rate > 0)
+        sampling = gpio_sampler_start();
+
+    /* The registers are read in nanoseconds and have no edge interrupts */
+    if (!sampling && gpio_get_backend() == GPIO_BACKEND_MMIO)
+        return false;
+
+    running = true;
+
+    if (!sampling && gpio_get_backend() == GPIO_BACKEND_CDEV) {
+        line_watch.fd = gpio_cdev_watch(true);
+        line_watch.cb = gpio_monitor_line_cb;
+        if (line_watch.fd >= 0 && uloop_fd_add(&line_watch, ULOOP_READ) < 0) {
+            gpio_cdev_watch(false);
+            line_watch.fd = -1;
+        }
+    }
+
+    for (int gpio = 0; gpio < 28; ++gpio) {
+        if (gpio_config[gpio] && gpio_reserve(gpio) && gpio_get_direction(gpio) == GPIO_IN) {
+            gpio_monitor_direction_done(gpio, GPIO_IN);
+            watched += mirror[gpio].input;
+        }
+    }
+
+    log_message(LOG_INFO, "Mirroring %d GPIO inputs%s\r\n", watched, sampling ? " from the sampler" : "");
+    return watched > 0;
+}
+
+/**
+ * Stop watching the input pins and forget all mirrored states.
+ */
+void gpio_monitor_done(void)
+{
+    if (!running)
+        return;
+
+    if (sampling) {
+        gpio_sampler_stop();
+        sampling = false;
+    }
+
+    for (int gpio = 0; gpio < 28; ++gpio) {
+        gpio_monitor_sysfs_unwatch(gpio);
+        mirror[gpio].state = GPIO_ERR;
+        mirror[gpio].input = false;
+    }
+
+    if (line_watch.fd >= 0) {
+        uloop_fd_delete(&line_watch);
+        gpio_cdev_watch(false);
+        line_watch.fd = -1;
+    }
+
+    running = false;
+}
+
+/**
+ * Get the mirrored state of a pin.
+ * @param gpio the GPIO pin.
+ * @param pin_seq receives the sequence number of the last change, may be NULL.
+ * @return GPIO_HIGH or GPIO_LOW, GPIO_ERR when the pin must be read.
+ */
+int gpio_monitor_get(int gpio, uint32_t *pin_seq)
+{
+    int state;
+
+    if (!running || gpio < 0 || gpio > 27) {
+        if (pin_seq)
+            *pin_seq = 0;
+        return GPIO_ERR;
+    }
+
+    pthread_mutex_lock(&mirror_lock);
+    state = mirror[gpio].state;
+    if (pin_seq)
+        *pin_seq = mirror[gpio].seq;
+    pthread_mutex_unlock(&mirror_lock);
+
+    return state;
+}
+
+/**
+ * Get the sequence number of the last change of any pin.
+ * @return the sequence number, 0 before the first change.
+ */
+uint32_t gpio_monitor_seq(void)
+{
+    uint32_t last;
+
+    pthread_mutex_lock(&mirror_lock);
+    last = seq;
+    pthread_mutex_unlock(&mirror_lock);
+
+    return last;
+}
+
+/**
+ * Record states read from or written to the hardware. Input pins
+ * are only recorded when their edges are watched.
+ * @param mask bit n set for GPIO n.
+ * @param values bit n set when GPIO n is high.
+ * @param outputs true when the pins are outputs.
+ */
+void gpio_monitor_update(uint32_t mask, uint32_t values, bool outputs)
+{
+    if (!running)
+        return;
+
+    pthread_mutex_lock(&mirror_lock);
+    for (int gpio = 0; gpio < 28; ++gpio) {
+        if (!(mask & (1u << gpio)) || !(outputs || mirror[gpio].input))
+            continue;
+
+        /* A raw read only fills in a sampled input, the sampler has the debounced state */
+        if (!outputs && sampling && mirror[gpio].state != GPIO_ERR)
+            continue;
+
+        gpio_monitor_set(gpio, (values >> gpio) & 1 ? GPIO_HIGH : GPIO_LOW);
+    }
+    pthread_mutex_unlock(&mirror_lock);
+}
+
+/**
+ * Record the debounced states of the sampled inputs. Changes of
+ * known states are reported as edges.
+ * @param states bit n set when GPIO n is high.
+ * @param timestamp CLOCK_MONOTONIC time of the sample in nanoseconds.
+ */
+void gpio_monitor_sampled(uint32_t states, uint64_t timestamp)
+{
+    uint32_t edges = 0;
+
+    if (!running)
+        return;
+
+    pthread_mutex_lock(&mirror_lock);
+    for (int gpio = 0; gpio < 28; ++gpio) {
+        int state = (states >> gpio) & 1 ? GPIO_HIGH : GPIO_LOW;
+
+        if (!mirror[gpio].input || mirror[gpio].state == state)
+            continue;
+
+        if (mirror[gpio].state != GPIO_ERR)
+            edges |= 1u << gpio;
+        gpio_monitor_set(gpio, state);
+    }
+    pthread_mutex_unlock(&mirror_lock);
+
+    for (int gpio = 0; edges; ++gpio, edges >>= 1) {
+        if (edges & 1)
+            gpio_monitor_edge(gpio, (states >> gpio) & 1 ? GPIO_HIGH : GPIO_LOW, timestamp);
+    }
+}
+
+/**
+ * Get the number of changes of a pin.
+ * @param gpio the GPIO pin.
+ * @return the number of state changes since the pin was first mirrored.
+ */
+uint32_t gpio_monitor_changes(int gpio)
+{
+    uint32_t changes;
+
+    if (!running || gpio < 0 || gpio > 27)
+        return 0;
+
+    pthread_mutex_lock(&mirror_lock);
+    changes = mirror[gpio].changes;
+    pthread_mutex_unlock(&mirror_lock);
+
+    return changes;
+}
+
+/**
+ * Called before the direction of a pin changes. An input that
+ * becomes an output is no longer watched.
+ * @param gpio the GPIO pin.
+ * @param direction the new direction.
+ */
+void gpio_monitor_direction(int gpio, int direction)
+{
+    if (!running || direction != GPIO_OUT || !mirror[gpio].input)
+        return;
+
+    pthread_mutex_lock(&mirror_lock);
+    mirror[gpio].input = false;
+    mirror[gpio].state = GPIO_ERR;
+    pthread_mutex_unlock(&mirror_lock);
+
+    gpio_monitor_sysfs_unwatch(gpio);
+}
+
+/**
+ * Called after the direction of a pin changed. An input is watched
+ * and its current state is read.
+ * @param gpio the GPIO pin.
+ * @param direction the direction the pin has now, GPIO_ERR when unknown.
+ */
+void gpio_monitor_direction_done(int gpio, int direction)
+{
+    bool watched;
+
+    if (!running || mirror[gpio].input)
+        return;
+
+    /* An output keeps its mirrored state until it is written */
+    if (direction != GPIO_IN) {
+        if (direction == GPIO_ERR) {
+            pthread_mutex_lock(&mirror_lock);
+            mirror[gpio].state = GPIO_ERR;
+            pthread_mutex_unlock(&mirror_lock);
+        }
+        return;
+    }
+
+    /* The sampler reads all inputs, the line request reports the edges of all its inputs */
+    if (sampling) {
+        watched = true;
+    } else if (gpio_get_backend() == GPIO_BACKEND_CDEV) {
+        watched = line_watch.fd >= 0;
+    } else {
+        watched = gpio_monitor_sysfs_watch(gpio);
+    }
+
+    pthread_mutex_lock(&mirror_lock);
+    mirror[gpio].input = watched;
+    mirror[gpio].state = GPIO_ERR;
+    pthread_mutex_unlock(&mirror_lock);
+
+    /* Reading the pin fills in the mirror */
+    if (watched)
+        gpio_get_state(gpio);
+}
@@ -0,0 +1,105 @@
+/* 
+ * Copyright (c) 2014, Daan Pape
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without 
+ * modification, are permitted provided that the following conditions are met:
+ * 
+ *     1. Redistributions of source code must retain the above copyright 
+ *        notice, this list of conditions and the following disclaimer.
+ *
+ *     2. Redistributions in binary form must reproduce the above copyright 
+ *        notice, this list of conditions and the following disclaimer in the 
+ *        documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" 
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE 
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE 
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE 
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR 
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF 
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS 
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN 
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) 
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE 
+ * POSSIBILITY OF SUCH DAMAGE.
+ * 
+ * File:   gpio_monitor.h
+ * Created on October 18, 2026, 1:25 PM
+ * 
+ * In-memory mirror of the GPIO states. Input pins report their edges
+ * through the event loop or are debounced by the sampler, outputs are
+ * recorded when they are written.
+ */
+
+#ifndef GPIO_MONITOR_H
+#define	GPIO_MONITOR_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/**
+ * Start watching the edges of the exposed input pins. Must be called
+ * after the GPIO backend is selected and the event loop is initialized.
+ * @return true when the input pins are mirrored.
+ */
+bool gpio_monitor_init(void);
+
+/**
+ * Stop watching the input pins and forget all mirrored states.
+ */
+void gpio_monitor_done(void);
+
+/**
+ * Get the mirrored state of a pin.
+ * @param gpio the GPIO pin.
+ * @param seq receives the sequence number of the last change, may be NULL.
+ * @return GPIO_HIGH or GPIO_LOW, GPIO_ERR when the pin must be read.
+ */
+int gpio_monitor_get(int gpio, uint32_t *seq);
+
+/**
+ * Get the sequence number of the last change of any pin.
+ * @return the sequence number, 0 before the first change.
+ */
+uint32_t gpio_monitor_seq(void);
+
+/**
+ * Record states read from or written to the hardware. Input pins
+ * are only recorded when their edges are watched.
+ * @param mask bit n set for GPIO n.
+ * @param values bit n set when GPIO n is high.
+ * @param outputs true when the pins are outputs.
+ */
+void gpio_monitor_update(uint32_t mask, uint32_t values, bool outputs);
+
+/**
+ * Record the debounced states of the sampled inputs. Changes of
+ * known states are reported as edges.
+ * @param states bit n set when GPIO n is high.
+ * @param timestamp CLOCK_MONOTONIC time of the sample in nanoseconds.
+ */
+void gpio_monitor_sampled(uint32_t states, uint64_t timestamp);
+
+/**
+ * Get the number of changes of a pin.
+ * @param gpio the GPIO pin.
+ * @return the number of state changes since the pin was first mirrored.
+ */
+uint32_t gpio_monitor_changes(int gpio);
+
+/**
+ * Called before the direction of a pin changes. 
+ * @param gpio the GPIO pin.
+ * @param direction the new direction.
+ */
+void gpio_monitor_direction(int gpio, int direction);
+
+/**
+ * Called after the direction of a pin changed.
+ * @param gpio the GPIO pin.
+ * @param direction the direction the pin has now, GPIO_ERR when unknown.
+ */
+void gpio_monitor_direction_done(int gpio, int direction);
+
+#endif
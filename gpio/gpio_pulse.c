@@ -0,0 +1,329 @@
+/* 
+ * Copyright (c) 2014, Daan Pape
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without 
+ * modification, are permitted provided that the following conditions are met:
+ * 
+ *     1. Redistributions of source code must retain the above copyright 
+ *        notice, this list of conditions and the following disclaimer.
+ *
+ *     2. Redistributions in binary form must reproduce the above copyright 
+ *        notice, this list of conditions and the following disclaimer in the 
+ *        documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" 
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE 
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE 
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE 
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR 
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF 
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS 
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN 
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) 
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE 
+ * POSSIBILITY OF SUCH DAMAGE.
+ * 
+ * File:   gpio_pulse.c
+ * Created on October 18, 2026, 9:05 PM
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <pthread.h>
+#include <errno.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/timerfd.h>
+
+#include "../config.h"
+#include "../logger.h"
+#include "../helper.h"
+#include "gpio.h"
+#include "gpio_pulse.h"
+
+/* A pulse train with its next edge */
+struct gpio_pulse {
+    uint64_t when;          /* CLOCK_MONOTONIC time of the next edge in nanoseconds */
+    int gpio;               /* The GPIO pin */
+    int mode;               /* GPIO_ACT_HIGH or GPIO_ACT_LOW */
+    bool active;            /* True while the pin is active */
+    uint32_t on_us;         /* Active time of a pulse */
+    uint32_t off_us;        /* Time between two pulses */
+    uint32_t edges;         /* Number of edges still to make */
+};
+
+/* Min-heap of the pulse trains on the time of their next edge, a pin has at most one */
+static struct gpio_pulse heap[28];
+static int heap_size = 0;
+
+/* The timer of the first edge, -1 before the scheduler is started */
+static int timer_fd = -1;
+
+/* Protects the heap and the timer */
+static pthread_mutex_t pulse_lock = PTHREAD_MUTEX_INITIALIZER;
+
+/**
+ * Get the state of a pin in a pulse. 
+ * @param mode GPIO_ACT_HIGH or GPIO_ACT_LOW.
+ * @param active true for the state during the pulse.
+ * @return GPIO_HIGH or GPIO_LOW.
+ */
+static int gpio_pulse_state(int mode, bool active)
+{
+    return (mode == GPIO_ACT_HIGH) == active ? GPIO_HIGH : GPIO_LOW;
+}
+
+/**
+ * Move a heap entry up to its place. The heap must be locked.
+ * @param i the index of the entry.
+ */
+static void gpio_pulse_sift_up(int i)
+{
+    struct gpio_pulse p = heap[i];
+
+    while (i > 0 && heap[(i - 1) / 2].when > p.when) {
+        heap[i] = heap[(i - 1) / 2];
+        i = (i - 1) / 2;
+    }
+    heap[i] = p;
+}
+
+/**
+ * Move a heap entry down to its place. The heap must be locked.
+ * @param i the index of the entry.
+ */
+static void gpio_pulse_sift_down(int i)
+{
+    struct gpio_pulse p = heap[i];
+    int child;
+
+    while ((child = 2 * i + 1) < heap_size) {
+        if (child + 1 < heap_size && heap[child + 1].when < heap[child].when)
+            ++child;
+        if (heap[child].when >= p.when)
+            break;
+        heap[i] = heap[child];
+        i = child;
+    }
+    heap[i] = p;
+}
+
+/**
+ * Arm the timer for the first edge, or disarm it when there is none. 
+ * The heap must be locked.
+ */
+static void gpio_pulse_arm(void)
+{
+    struct itimerspec its;
+
+    memset(&its, 0, sizeof(its));
+    if (heap_size > 0) {
+        its.it_value.tv_sec = heap[0].when / 1000000000ull;
+        its.it_value.tv_nsec = heap[0].when % 1000000000ull;
+    }
+
+    timerfd_settime(timer_fd, TFD_TIMER_ABSTIME, &its, NULL);
+}
+
+/**
+ * Remove the pulse trains of a pin from the heap. The heap must be locked.
+ * @param gpio the GPIO pin.
+ * @param removed receives the last removed pulse train.
+ * @return the number of removed pulse trains.
+ */
+static int gpio_pulse_remove(int gpio, struct gpio_pulse *removed)
+{
+    int n = 0;
+
+    for (int i = 0; i < heap_size; ) {
+        if (heap[i].gpio != gpio) {
+            ++i;
+            continue;
+        }
+
+        *removed = heap[i];
+        heap[i] = heap[--heap_size];
+        ++n;
+    }
+
+    /* Rebuild the heap, cancelling is rare */
+    for (int i = heap_size / 2 - 1; i >= 0; --i)
+        gpio_pulse_sift_down(i);
+
+    return n;
+}
+
+/**
+ * The scheduler thread, makes the edges that are due.
+ * @param arg unused.
+ * @return never returns.
+ */
+static void* gpio_pulse_thread(void *arg)
+{
+    uint64_t expirations;
+
+    for (;;) {
+        if (read(timer_fd, &expirations, sizeof(expirations)) < 0 && errno != EAGAIN && errno != EINTR) {
+            log_message(LOG_ERROR, "GPIO pulse timer failed: %s\r\n", strerror(errno));
+            return NULL;
+        }
+
+        pthread_mutex_lock(&pulse_lock);
+        while (heap_size > 0 && heap[0].when <= helper_now_ns()) {
+            struct gpio_pulse *p = &heap[0];
+
+            p->active = !p->active;
+            gpio_set_state(p->gpio, gpio_pulse_state(p->mode, p->active));
+
+            if (--p->edges > 0) {
+                /* Count from the planned edge, a late edge does not shift the train */
+                p->when += (uint64_t) (p->active ? p->on_us : p->off_us) * 1000;
+            } else {
+                gpio_release(p->gpio);
+                heap[0] = heap[--heap_size];
+            }
+
+            if (heap_size > 0)
+                gpio_pulse_sift_down(0);
+        }
+        gpio_pulse_arm();
+        pthread_mutex_unlock(&pulse_lock);
+    }
+
+    return NULL;
+}
+
+/**
+ * Start the scheduler thread. The heap must be locked.
+ * @return true when the scheduler runs.
+ */
+static bool gpio_pulse_start(void)
+{
+    pthread_attr_t attr;
+    pthread_t thread;
+
+    if (timer_fd >= 0)
+        return true;
+
+    timer_fd = timerfd_create(CLOCK_MONOTONIC, TFD_CLOEXEC);
+    if (timer_fd < 0) {
+        log_message(LOG_ERROR, "Could not create the GPIO pulse timer: %s\r\n", strerror(errno));
+        return false;
+    }
+
+    pthread_attr_init(&attr);
+    pthread_attr_setstacksize(&attr, GPIO_PULSE_STACK);
+
+    if (pthread_create(&thread, &attr, gpio_pulse_thread, NULL) != 0) {
+        log_message(LOG_ERROR, "Could not start GPIO pulse thread\r\n");
+        pthread_attr_destroy(&attr);
+        close(timer_fd);
+        timer_fd = -1;
+        return false;
+    }
+    pthread_attr_destroy(&attr);
+    pthread_detach(thread);
+
+    helper_thread_realtime(thread, conf->gpio_pulse_priority, conf->gpio_pulse_cpu, "GPIO pulse");
+
+    return true;
+}
+
+/**
+ * Start a pulse train on a GPIO output. The pin is made active right
+ * away, a pending pulse on the same pin is cancelled first.
+ * @param gpio the GPIO pin.
+ * @param mode GPIO_ACT_HIGH or GPIO_ACT_LOW.
+ * @param on_us the time the pin is active in each pulse, in microseconds.
+ * @param off_us the time between two pulses, in microseconds.
+ * @param count the number of pulses.
+ * @return true when the pulses are scheduled.
+ */
+bool gpio_pulse_train(int gpio, int mode, uint32_t on_us, uint32_t off_us, uint32_t count)
+{
+    struct gpio_pulse removed;
+    struct gpio_pulse *p;
+    bool ok = false;
+
+    if (count == 0 || count > UINT32_MAX / 2)
+        return false;
+
+    /* Reserve the port and set it as output, the monitor must see direction changes in this thread */
+    if (!gpio_reserve(gpio) || !gpio_set_direction(gpio, GPIO_OUT))
+        return false;
+
+    pthread_mutex_lock(&pulse_lock);
+
+    if (!gpio_pulse_start())
+        goto out;
+
+    if (gpio_pulse_remove(gpio, &removed) > 0)
+        gpio_release(gpio);
+
+    if (!gpio_set_state(gpio, gpio_pulse_state(mode, true)))
+        goto out;
+
+    p = &heap[heap_size++];
+    p->when = helper_now_ns() + (uint64_t) on_us * 1000;
+    p->gpio = gpio;
+    p->mode = mode;
+    p->active = true;
+    p->on_us = on_us;
+    p->off_us = off_us;
+    p->edges = 2 * count - 1;
+    gpio_pulse_sift_up(heap_size - 1);
+
+    /* Only a new first edge moves the timer */
+    if (heap[0].gpio == gpio)
+        gpio_pulse_arm();
+
+    ok = true;
+
+out:
+    pthread_mutex_unlock(&pulse_lock);
+    if (!ok)
+        gpio_release(gpio);
+
+    return ok;
+}
+
+/**
+ * Cancel the pending pulses of a pin and make it inactive.
+ * @param gpio the GPIO pin.
+ * @return the number of cancelled pulse trains.
+ */
+int gpio_pulse_cancel(int gpio)
+{
+    struct gpio_pulse removed;
+    int n;
+
+    pthread_mutex_lock(&pulse_lock);
+    n = gpio_pulse_remove(gpio, &removed);
+    if (n > 0) {
+        gpio_set_state(gpio, gpio_pulse_state(removed.mode, false));
+        gpio_release(gpio);
+        gpio_pulse_arm();
+    }
+    pthread_mutex_unlock(&pulse_lock);
+
+    return n;
+}
+
+/**
+ * Get the number of pending pulse trains.
+ * @return the number of scheduled pulse trains.
+ */
+int gpio_pulse_pending(void)
+{
+    int n;
+
+    pthread_mutex_lock(&pulse_lock);
+    n = heap_size;
+    pthread_mutex_unlock(&pulse_lock);
+
+    return n;
+}
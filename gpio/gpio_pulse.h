@@ -0,0 +1,65 @@
+/* 
+ * Copyright (c) 2014, Daan Pape
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without 
+ * modification, are permitted provided that the following conditions are met:
+ * 
+ *     1. Redistributions of source code must retain the above copyright 
+ *        notice, this list of conditions and the following disclaimer.
+ *
+ *     2. Redistributions in binary form must reproduce the above copyright 
+ *        notice, this list of conditions and the following disclaimer in the 
+ *        documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" 
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE 
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE 
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE 
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR 
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF 
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS 
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN 
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) 
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE 
+ * POSSIBILITY OF SUCH DAMAGE.
+ * 
+ * File:   gpio_pulse.h
+ * Created on October 18, 2026, 9:05 PM
+ * 
+ * Pulses and pulse trains on GPIO outputs, timed by one scheduler
+ * thread on a timerfd and a min-heap of pending edges.
+ */
+
+#ifndef GPIO_PULSE_H
+#define	GPIO_PULSE_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/**
+ * Start a pulse train on a GPIO output. The pin is made active right
+ * away, a pending pulse on the same pin is cancelled first.
+ * @param gpio the GPIO pin.
+ * @param mode GPIO_ACT_HIGH or GPIO_ACT_LOW.
+ * @param on_us the time the pin is active in each pulse, in microseconds.
+ * @param off_us the time between two pulses, in microseconds.
+ * @param count the number of pulses.
+ * @return true when the pulses are scheduled.
+ */
+bool gpio_pulse_train(int gpio, int mode, uint32_t on_us, uint32_t off_us, uint32_t count);
+
+/**
+ * Cancel the pending pulses of a pin and make it inactive.
+ * @param gpio the GPIO pin.
+ * @return the number of cancelled pulse trains.
+ */
+int gpio_pulse_cancel(int gpio);
+
+/**
+ * Get the number of pending pulse trains.
+ * @return the number of scheduled pulse trains.
+ */
+int gpio_pulse_pending(void);
+
+#endif
@@ -0,0 +1,235 @@
+/* 
+ * Copyright (c) 2014, Daan Pape
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without 
+ * modification, are permitted provided that the following conditions are met:
+ * 
+ *     1. Redistributions of source code must retain the above copyright 
+ *        notice, this list of conditions and the following disclaimer.
+ *
+ *     2. Redistributions in binary form must reproduce the above copyright 
+ *        notice, this list of conditions and the following disclaimer in the 
+ *        documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" 
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE 
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE 
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE 
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR 
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF 
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS 
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN 
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) 
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE 
+ * POSSIBILITY OF SUCH DAMAGE.
+ * 
+ * File:   gpio_sampler.c
+ * Created on October 18, 2026, 11:50 PM
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <pthread.h>
+#include <errno.h>
+#include <time.h>
+#include <sys/prctl.h>
+
+#include "../config.h"
+#include "../logger.h"
+#include "../helper.h"
+#include "gpio.h"
+#include "gpio_cdev.h"
+#include "gpio_mmio.h"
+#include "gpio_monitor.h"
+#include "gpio_sampler.h"
+
+/* The sampling thread */
+static pthread_t thread;
+static bool running = false;
+static bool stop = false;
+
+/* True when the registers are read, the character device otherwise */
+static bool registers = false;
+
+/* A machine word, 64-bit atomics need libatomic on 32-bit targets */
+static unsigned long overruns = 0;
+
+/* Debounce state of every pin */
+static uint32_t history[28];
+static uint32_t debounced = 0;
+
+/**
+ * Read all pins through the fastest backend.
+ * @param values receives bit n set when GPIO n is high.
+ * @return true on success.
+ */
+static bool gpio_sampler_read(uint32_t *values)
+{
+    if (registers) {
+        *values = gpio_mmio_read();
+        return true;
+    }
+
+    return gpio_cdev_get_values(values);
+}
+
+/**
+ * Feed a sample to the debounce filters.
+ * @param values the sampled levels.
+ * @param samples the number of samples that must agree, 1 up to 32.
+ */
+static void gpio_sampler_filter(uint32_t values, int samples)
+{
+    uint32_t all = samples >= 32 ? UINT32_MAX : (1u << samples) - 1;
+
+    for (int gpio = 0; gpio < 28; ++gpio) {
+        uint32_t bit = 1u << gpio;
+        uint32_t *h = &history[gpio];
+
+        if (!gpio_config[gpio])
+            continue;
+
+        if (conf->gpio_debounce_filter == GPIO_FILTER_SHIFT) {
+            *h = ((*h << 1) | ((values & bit) != 0)) & all;
+            if (*h == all)
+                debounced |= bit;
+            else if (*h == 0)
+                debounced &= ~bit;
+        } else {
+            if (values & bit) {
+                if (*h < (uint32_t) samples && ++*h == (uint32_t) samples)
+                    debounced |= bit;
+            } else {
+                if (*h > 0 && --*h == 0)
+                    debounced &= ~bit;
+            }
+        }
+    }
+}
+
+/**
+ * The sampling thread.
+ * @param arg unused.
+ * @return NULL when stopped.
+ */
+static void* gpio_sampler_thread(void *arg)
+{
+    uint64_t period = 1000000000ull / conf->gpio_sample_rate;
+    int samples = conf->gpio_debounce;
+    uint32_t values = 0;
+    struct timespec ts;
+    uint64_t deadline;
+    uint64_t now;
+
+    prctl(PR_SET_TIMERSLACK, 1, 0, 0, 0);
+
+    if (samples < 1)
+        samples = 1;
+    else if (samples > 32)
+        samples = 32;
+
+    /* The filters start at the current levels */
+    gpio_sampler_read(&values);
+    debounced = values;
+    for (int gpio = 0; gpio < 28; ++gpio) {
+        if (conf->gpio_debounce_filter == GPIO_FILTER_SHIFT)
+            history[gpio] = values & (1u << gpio) ? UINT32_MAX : 0;
+        else
+            history[gpio] = values & (1u << gpio) ? samples : 0;
+    }
+
+    deadline = helper_now_ns();
+    while (!__atomic_load_n(&stop, __ATOMIC_RELAXED)) {
+        deadline += period;
+        ts.tv_sec = deadline / 1000000000ull;
+        ts.tv_nsec = deadline % 1000000000ull;
+        while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL) == EINTR)
+            ;
+
+        /* Keep the rate, skip the samples that are over already */
+        now = helper_now_ns();
+        if (now - deadline >= period) {
+            __atomic_add_fetch(&overruns, (unsigned long) ((now - deadline) / period), __ATOMIC_RELAXED);
+            deadline += (now - deadline) / period * period;
+        }
+
+        if (!gpio_sampler_read(&values))
+            continue;
+
+        gpio_sampler_filter(values, samples);
+        gpio_monitor_sampled(debounced, now);
+    }
+
+    return NULL;
+}
+
+/**
+ * Start sampling at conf->gpio_sample_rate. Needs the GPIO registers or
+ * the GPIO character device, sysfs is too slow.
+ * @return true when the sampler runs.
+ */
+bool gpio_sampler_start(void)
+{
+    pthread_attr_t attr;
+    char mem[HW_PATH_MAX];
+    uint32_t values;
+
+    if (running || conf->gpio_sample_rate <= 0)
+        return running;
+
+    if (conf->gpio_sample_rate > GPIO_SAMPLE_MAX) {
+        log_message(LOG_WARNING, "GPIO sample rate %d Hz is too high, using %d Hz\r\n", conf->gpio_sample_rate, GPIO_SAMPLE_MAX);
+        conf->gpio_sample_rate = GPIO_SAMPLE_MAX;
+    }
+
+    /* The input register is read in nanoseconds, the line request in one ioctl */
+    registers = gpio_mmio_open(helper_hw_path(mem, sizeof(mem), "/dev/mem"));
+    if (!registers && !gpio_cdev_get_values(&values)) {
+        log_message(LOG_WARNING, "GPIO sampling needs the GPIO registers or the GPIO character device\r\n");
+        return false;
+    }
+
+    pthread_attr_init(&attr);
+    pthread_attr_setstacksize(&attr, GPIO_SAMPLE_STACK);
+
+    stop = false;
+    if (pthread_create(&thread, &attr, gpio_sampler_thread, NULL) != 0) {
+        log_message(LOG_ERROR, "Could not start GPIO sampler thread\r\n");
+        pthread_attr_destroy(&attr);
+        return false;
+    }
+    pthread_attr_destroy(&attr);
+
+    helper_thread_realtime(thread, conf->gpio_sample_priority, conf->gpio_sample_cpu, "GPIO sampler");
+
+    log_message(LOG_INFO, "Sampling GPIO inputs at %d Hz through the %s\r\n", conf->gpio_sample_rate,
+            registers ? "registers" : "character device");
+
+    running = true;
+    return true;
+}
+
+/**
+ * Stop sampling.
+ */
+void gpio_sampler_stop(void)
+{
+    if (!running)
+        return;
+
+    __atomic_store_n(&stop, true, __ATOMIC_RELAXED);
+    pthread_join(thread, NULL);
+    running = false;
+}
+
+/**
+ * Get the number of samples that were taken too late to keep the rate.
+ * @return the number of late samples.
+ */
+unsigned long gpio_sampler_overruns(void)
+{
+    return __atomic_load_n(&overruns, __ATOMIC_RELAXED);
+}
@@ -0,0 +1,58 @@
+/* 
+ * Copyright (c) 2014, Daan Pape
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without 
+ * modification, are permitted provided that the following conditions are met:
+ * 
+ *     1. Redistributions of source code must retain the above copyright 
+ *        notice, this list of conditions and the following disclaimer.
+ *
+ *     2. Redistributions in binary form must reproduce the above copyright 
+ *        notice, this list of conditions and the following disclaimer in the 
+ *        documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" 
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE 
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE 
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE 
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR 
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF 
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS 
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN 
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) 
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE 
+ * POSSIBILITY OF SUCH DAMAGE.
+ * 
+ * File:   gpio_sampler.h
+ * Created on October 18, 2026, 11:50 PM
+ * 
+ * Reads all GPIO pins at a fixed rate and debounces them. The debounced
+ * states of the inputs are published in the GPIO mirror.
+ */
+
+#ifndef GPIO_SAMPLER_H
+#define	GPIO_SAMPLER_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/**
+ * Start sampling at conf->gpio_sample_rate. Needs the GPIO registers or
+ * the GPIO character device, sysfs is too slow.
+ * @return true when the sampler runs.
+ */
+bool gpio_sampler_start(void);
+
+/**
+ * Stop sampling.
+ */
+void gpio_sampler_stop(void);
+
+/**
+ * Get the number of samples that were taken too late to keep the rate.
+ * @return the number of late samples.
+ */
+unsigned long gpio_sampler_overruns(void);
+
+#endif
@@ -0,0 +1,342 @@
+/* 
+ * Copyright (c) 2014, Daan Pape
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without 
+ * modification, are permitted provided that the following conditions are met:
+ * 
+ *     1. Redistributions of source code must retain the above copyright 
+ *        notice, this list of conditions and the following disclaimer.
+ *
+ *     2. Redistributions in binary form must reproduce the above copyright 
+ *        notice, this list of conditions and the following disclaimer in the 
+ *        documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" 
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE 
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE 
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE 
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR 
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF 
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS 
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN 
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) 
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE 
+ * POSSIBILITY OF SUCH DAMAGE.
+ * 
+ * File:   gpio_wave.c
+ * Created on October 18, 2026, 11:30 PM
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <pthread.h>
+#include <errno.h>
+#include <time.h>
+#include <sys/prctl.h>
+
+#include "../config.h"
+#include "../logger.h"
+#include "../helper.h"
+#include "gpio.h"
+#include "gpio_mmio.h"
+#include "gpio_monitor.h"
+#include "gpio_pulse.h"
+#include "gpio_wave.h"
+
+/* The waveform that plays and the one that replaces it */
+static struct gpio_wave_step *wave = NULL;
+static struct gpio_wave_step *next_wave = NULL;
+static int next_steps = 0;
+static uint32_t next_loops = 0;
+
+/* Set to stop the waveform at the next step */
+static bool stop = false;
+
+static struct gpio_wave_status status;
+
+/* True when the playback thread runs */
+static bool running = false;
+
+/* Protects everything above, the thread waits on changed when idle */
+static pthread_mutex_t wave_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t changed = PTHREAD_COND_INITIALIZER;
+
+/**
+ * Wait until a deadline. The last part of the wait spins, a sleep would
+ * wake up later than the step needs. Long sleeps are cut in slices to
+ * notice a stop.
+ * @param deadline the CLOCK_MONOTONIC time in nanoseconds.
+ * @param spin the time to spin before the deadline in nanoseconds.
+ * @return false when the waveform was stopped during the wait.
+ */
+static bool gpio_wave_wait(uint64_t deadline, uint64_t spin)
+{
+    struct timespec ts;
+    uint64_t wake;
+    uint64_t now;
+
+    while ((now = helper_now_ns()) + spin < deadline) {
+        wake = deadline - spin;
+        if (wake > now + GPIO_WAVE_SLICE * 1000ull)
+            wake = now + GPIO_WAVE_SLICE * 1000ull;
+
+        ts.tv_sec = wake / 1000000000ull;
+        ts.tv_nsec = wake % 1000000000ull;
+        clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL);
+
+        if (__atomic_load_n(&stop, __ATOMIC_RELAXED))
+            return false;
+    }
+
+    while (helper_now_ns() < deadline)
+        ;
+
+    return true;
+}
+
+/**
+ * Write a step to the pins.
+ * @param step the step.
+ */
+static void gpio_wave_write(const struct gpio_wave_step *step)
+{
+    if (status.registers) {
+        if (step->clear)
+            gpio_mmio_clear(step->clear);
+        if (step->set)
+            gpio_mmio_set(step->set);
+    } else {
+        gpio_set_states(step->set | step->clear, step->set);
+    }
+}
+
+/**
+ * The playback thread.
+ * @param arg unused.
+ * @return never returns.
+ */
+static void* gpio_wave_thread(void *arg)
+{
+    struct gpio_wave_step *steps;
+    int num_steps;
+    uint32_t loops;
+    uint64_t deadline;
+    uint64_t late;
+    uint64_t spin;
+
+    prctl(PR_SET_TIMERSLACK, 1, 0, 0, 0);
+
+    pthread_mutex_lock(&wave_lock);
+    for (;;) {
+        while (next_wave == NULL)
+            pthread_cond_wait(&changed, &wave_lock);
+
+        /* Take the new waveform */
+        free(wave);
+        wave = steps = next_wave;
+        num_steps = next_steps;
+        loops = next_loops;
+        next_wave = NULL;
+        stop = false;
+
+        status.playing = true;
+        status.steps = num_steps;
+        status.loops = loops;
+        status.loops_done = 0;
+        status.steps_done = 0;
+        status.late_total_ns = 0;
+        status.late_max_ns = 0;
+        pthread_mutex_unlock(&wave_lock);
+
+        /* The steps are played without the lock, stop is checked per step */
+        deadline = helper_now_ns();
+        spin = 0;
+        for (uint32_t loop = 0; loops == 0 || loop < loops; ++loop) {
+            for (int i = 0; i < num_steps && !__atomic_load_n(&stop, __ATOMIC_RELAXED); ++i) {
+                if (!gpio_wave_wait(deadline, spin))
+                    break;
+                gpio_wave_write(&steps[i]);
+
+                late = helper_now_ns() - deadline;
+                deadline += steps[i].delay_ns;
+
+                /* Short steps sleep most of their time, the thread must not hog the CPU */
+                spin = steps[i].delay_ns / 4;
+                if (spin > GPIO_WAVE_SPIN * 1000ull)
+                    spin = GPIO_WAVE_SPIN * 1000ull;
+
+                pthread_mutex_lock(&wave_lock);
+                status.steps_done++;
+                status.late_total_ns += late;
+                if (late > status.late_max_ns)
+                    status.late_max_ns = late > UINT32_MAX ? UINT32_MAX : late;
+                pthread_mutex_unlock(&wave_lock);
+            }
+
+            if (__atomic_load_n(&stop, __ATOMIC_RELAXED))
+                break;
+
+            pthread_mutex_lock(&wave_lock);
+            status.loops_done++;
+            pthread_mutex_unlock(&wave_lock);
+        }
+
+        /* The last step keeps its level */
+        pthread_mutex_lock(&wave_lock);
+        status.playing = false;
+    }
+
+    return NULL;
+}
+
+/**
+ * Start the playback thread. The playback must be locked.
+ * @return true when the thread runs.
+ */
+static bool gpio_wave_start(void)
+{
+    pthread_attr_t attr;
+    pthread_t thread;
+    char mem[HW_PATH_MAX];
+
+    if (running)
+        return true;
+
+    /* The registers write a step in nanoseconds, other backends are a fallback */
+    status.registers = gpio_mmio_open(helper_hw_path(mem, sizeof(mem), "/dev/mem"));
+    if (!status.registers)
+        log_message(LOG_WARNING, "Could not map the GPIO registers, waveforms use the GPIO backend\r\n");
+
+    pthread_attr_init(&attr);
+    pthread_attr_setstacksize(&attr, GPIO_WAVE_STACK);
+
+    if (pthread_create(&thread, &attr, gpio_wave_thread, NULL) != 0) {
+        log_message(LOG_ERROR, "Could not start GPIO waveform thread\r\n");
+        pthread_attr_destroy(&attr);
+        return false;
+    }
+    pthread_attr_destroy(&attr);
+    pthread_detach(thread);
+
+    helper_thread_realtime(thread, conf->gpio_wave_priority, conf->gpio_wave_cpu, "GPIO waveform");
+
+    running = true;
+    return true;
+}
+
+/**
+ * Check that a waveform can be played, it only drives exposed pins. A
+ * waveform shorter than GPIO_WAVE_MIN_LOOP plays at most GPIO_WAVE_MAX_BUSY.
+ * @param steps the steps.
+ * @param num_steps the number of steps.
+ * @param loops the number of times to play the waveform, 0 for ever.
+ * @return true when the waveform is valid.
+ */
+bool gpio_wave_check(const struct gpio_wave_step *steps, int num_steps, uint32_t loops)
+{
+    uint32_t exposed = 0;
+    uint64_t length = 0;
+
+    if (num_steps <= 0 || num_steps > GPIO_WAVE_MAX_STEPS)
+        return false;
+
+    for (int gpio = 0; gpio < 28; ++gpio) {
+        if (gpio_config[gpio])
+            exposed |= 1u << gpio;
+    }
+
+    /* A step with a pin that can't be driven would be refused as a whole */
+    for (int i = 0; i < num_steps; ++i) {
+        if ((steps[i].set | steps[i].clear) & ~exposed)
+            return false;
+        length += steps[i].delay_ns;
+    }
+
+    /* A short waveform repeated for long would keep the real-time thread busy */
+    if (length >= GPIO_WAVE_MIN_LOOP * 1000ull)
+        return true;
+
+    return loops != 0 && loops * length <= GPIO_WAVE_MAX_BUSY * 1000000ull;
+}
+
+/**
+ * Play a waveform, a waveform that is playing is stopped first. The
+ * pins of the waveform are made outputs.
+ * @param steps the steps, ownership is taken, must be allocated with malloc.
+ * @param num_steps the number of steps, at most GPIO_WAVE_MAX_STEPS.
+ * @param loops the number of times to play the waveform, 0 for ever.
+ * @return true when the waveform plays, the steps are freed otherwise.
+ */
+bool gpio_wave_play(struct gpio_wave_step *steps, int num_steps, uint32_t loops)
+{
+    uint32_t pins = 0;
+    bool ok;
+
+    if (!gpio_wave_check(steps, num_steps, loops)) {
+        free(steps);
+        return false;
+    }
+
+    for (int i = 0; i < num_steps; ++i) {
+        pins |= steps[i].set | steps[i].clear;
+    }
+
+    /* Reserve the pins and set them as output, the monitor must see direction changes in this thread */
+    for (int gpio = 0; gpio < 28; ++gpio) {
+        if (!(pins & (1u << gpio)))
+            continue;
+
+        if (!gpio_reserve(gpio) || !gpio_set_direction(gpio, GPIO_OUT)) {
+            log_message(LOG_WARNING, "GPIO %d can't be used in a waveform\r\n", gpio);
+            free(steps);
+            return false;
+        }
+
+        /* The mirror does not follow the steps and no pulse may interfere */
+        gpio_pulse_cancel(gpio);
+        gpio_monitor_direction_done(gpio, GPIO_ERR);
+    }
+
+    pthread_mutex_lock(&wave_lock);
+    if ((ok = gpio_wave_start())) {
+        free(next_wave);
+        next_wave = steps;
+        next_steps = num_steps;
+        next_loops = loops;
+        __atomic_store_n(&stop, true, __ATOMIC_RELAXED);
+        pthread_cond_signal(&changed);
+    }
+    pthread_mutex_unlock(&wave_lock);
+
+    if (!ok)
+        free(steps);
+
+    return ok;
+}
+
+/**
+ * Stop the waveform that is playing. The pins keep their level.
+ */
+void gpio_wave_stop(void)
+{
+    pthread_mutex_lock(&wave_lock);
+    free(next_wave);
+    next_wave = NULL;
+    __atomic_store_n(&stop, true, __ATOMIC_RELAXED);
+    pthread_mutex_unlock(&wave_lock);
+}
+
+/**
+ * Get the playback state.
+ * @param out receives the state.
+ */
+void gpio_wave_get_status(struct gpio_wave_status *out)
+{
+    pthread_mutex_lock(&wave_lock);
+    *out = status;
+    pthread_mutex_unlock(&wave_lock);
+}
@@ -0,0 +1,90 @@
+/* 
+ * Copyright (c) 2014, Daan Pape
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without 
+ * modification, are permitted provided that the following conditions are met:
+ * 
+ *     1. Redistributions of source code must retain the above copyright 
+ *        notice, this list of conditions and the following disclaimer.
+ *
+ *     2. Redistributions in binary form must reproduce the above copyright 
+ *        notice, this list of conditions and the following disclaimer in the 
+ *        documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" 
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE 
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE 
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE 
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR 
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF 
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS 
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN 
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) 
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE 
+ * POSSIBILITY OF SUCH DAMAGE.
+ * 
+ * File:   gpio_wave.h
+ * Created on October 18, 2026, 11:30 PM
+ * 
+ * Playback of timed GPIO waveforms. A real-time thread writes each 
+ * step to the GPIO registers at an absolute deadline.
+ */
+
+#ifndef GPIO_WAVE_H
+#define	GPIO_WAVE_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/* A step of a waveform, the pins are written and the delay starts */
+struct gpio_wave_step {
+    uint32_t set;           /* Bit n set to drive GPIO n high */
+    uint32_t clear;         /* Bit n set to drive GPIO n low */
+    uint32_t delay_ns;      /* Time until the next step */
+};
+
+/* The playback state */
+struct gpio_wave_status {
+    bool playing;           /* True while a waveform plays */
+    bool registers;         /* True when the pins are driven through the registers */
+    int steps;              /* Number of steps of the waveform */
+    uint32_t loops;         /* Number of times the waveform plays, 0 for ever */
+    uint32_t loops_done;    /* Number of times the waveform was played */
+    uint64_t late_total_ns; /* Sum of the step latencies */
+    uint32_t late_max_ns;   /* Largest step latency */
+    uint64_t steps_done;    /* Number of steps written */
+};
+
+/**
+ * Check that a waveform can be played, it only drives exposed pins. A
+ * waveform shorter than GPIO_WAVE_MIN_LOOP plays at most GPIO_WAVE_MAX_BUSY.
+ * @param steps the steps.
+ * @param num_steps the number of steps.
+ * @param loops the number of times to play the waveform, 0 for ever.
+ * @return true when the waveform is valid.
+ */
+bool gpio_wave_check(const struct gpio_wave_step *steps, int num_steps, uint32_t loops);
+
+/**
+ * Play a waveform, a waveform that is playing is stopped first. The
+ * pins of the waveform are made outputs.
+ * @param steps the steps, ownership is taken, must be allocated with malloc.
+ * @param num_steps the number of steps, at most GPIO_WAVE_MAX_STEPS.
+ * @param loops the number of times to play the waveform, 0 for ever.
+ * @return true when the waveform plays, the steps are freed otherwise.
+ */
+bool gpio_wave_play(struct gpio_wave_step *steps, int num_steps, uint32_t loops);
+
+/**
+ * Stop the waveform that is playing. The pins keep their level.
+ */
+void gpio_wave_stop(void);
+
+/**
+ * Get the playback state.
+ * @param status receives the state.
+ */
+void gpio_wave_get_status(struct gpio_wave_status *status);
+
+#endif
@@ -0,0 +1,1253 @@
+/* 
+ * Copyright (c) 2014, Daan Pape
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without 
+ * modification, are permitted provided that the following conditions are met:
+ * 
+ *     1. Redistributions of source code must retain the above copyright 
+ *        notice, this list of conditions and the following disclaimer.
+ *
+ *     2. Redistributions in binary form must reproduce the above copyright 
+ *        notice, this list of conditions and the following disclaimer in the 
+ *        documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" 
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE 
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE 
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE 
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR 
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF 
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS 
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN 
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) 
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE 
+ * POSSIBILITY OF SUCH DAMAGE.
+ * 
+ * File:   h2.c
+ * Created on October 18, 2026, 11:58 AM
+ */
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+
+#include "uhttpd.h"
+#include "client.h"
+#include "config.h"
+#include "logger.h"
+#include "hpack.h"
+#include "h2.h"
+
+#define H2_PREFACE              "PRI * HTTP/2.0\r\n\r\nSM\r\n\r\n"
+#define H2_PREFACE_LEN          24
+#define H2_FRAME_HEADER_LEN     9
+#define H2_DEFAULT_WINDOW       65535
+#define H2_DEFAULT_FRAME_SIZE   16384
+#define H2_MAX_FRAME_SIZE       16777215
+#define H2_MAX_WINDOW           0x7fffffff
+#define H2_HEADER_TABLE_SIZE    4096
+
+/* Frame types */
+#define H2_DATA                 0x0
+#define H2_HEADERS              0x1
+#define H2_PRIORITY             0x2
+#define H2_RST_STREAM           0x3
+#define H2_SETTINGS             0x4
+#define H2_PUSH_PROMISE         0x5
+#define H2_PING                 0x6
+#define H2_GOAWAY               0x7
+#define H2_WINDOW_UPDATE        0x8
+#define H2_CONTINUATION         0x9
+
+/* Frame flags */
+#define H2_FLAG_END_STREAM      0x1
+#define H2_FLAG_ACK             0x1
+#define H2_FLAG_END_HEADERS     0x4
+#define H2_FLAG_PADDED          0x8
+#define H2_FLAG_PRIORITY        0x20
+
+/* Settings */
+#define H2_SETTINGS_HEADER_TABLE_SIZE       0x1
+#define H2_SETTINGS_MAX_CONCURRENT_STREAMS  0x3
+#define H2_SETTINGS_INITIAL_WINDOW_SIZE     0x4
+#define H2_SETTINGS_MAX_FRAME_SIZE          0x5
+
+/* Error codes */
+#define H2_NO_ERROR             0x0
+#define H2_PROTOCOL_ERROR       0x1
+#define H2_INTERNAL_ERROR       0x2
+#define H2_FLOW_CONTROL_ERROR   0x3
+#define H2_STREAM_CLOSED        0x5
+#define H2_FRAME_SIZE_ERROR     0x6
+#define H2_REFUSED_STREAM       0x7
+#define H2_COMPRESSION_ERROR    0x9
+
+/**
+ * Growable byte buffer.
+ */
+struct h2_buf {
+    char *data;
+    size_t len;
+    size_t cap;
+};
+
+/**
+ * A request/response exchange on an HTTP/2 connection. The request is
+ * run by a virtual client reading from and writing to a memory stream,
+ * its HTTP/1.1 response is translated back into HEADERS and DATA frames.
+ */
+struct h2_stream {
+    struct list_head list;          /* The stream list of the connection */
+    struct h2_conn *conn;           /* The connection, NULL when it is gone */
+    struct client *cl;              /* The virtual client running the request */
+    struct ustream us;              /* The stream of the virtual client */
+    uint32_t id;                    /* The stream identifier */
+    int32_t send_window;            /* The flow control window for DATA we send */
+
+    char method[8];                 /* The :method pseudo header */
+    char *path;                     /* The :path pseudo header */
+    char *authority;                /* The :authority pseudo header */
+    struct h2_buf headers;          /* The regular request headers in HTTP/1.1 form */
+    struct h2_buf body;             /* The request body */
+    struct h2_buf response;         /* The HTTP/1.1 response header until it is complete */
+    long long remaining;            /* Response body bytes left, -1 when unknown */
+
+    bool malformed;                 /* True when the request headers are invalid */
+    bool headers_done;              /* True when the request headers are received */
+    bool remote_closed;             /* True when END_STREAM is received */
+    bool headers_sent;              /* True when the response headers are sent */
+    bool ended;                     /* True when END_STREAM is sent */
+    bool reset;                     /* True when the stream is reset */
+};
+
+/**
+ * HTTP/2 connection state, hangs off the client of the connection.
+ */
+struct h2_conn {
+    struct client *cl;              /* The client of the connection */
+    struct list_head streams;       /* The open streams */
+    int n_streams;                  /* The number of open streams */
+    uint32_t last_stream_id;        /* The highest stream identifier seen */
+    int32_t send_window;            /* The connection flow control window for DATA we send */
+    int32_t initial_window;         /* The initial stream window set by the peer */
+    uint32_t max_frame_size;        /* The maximum frame size set by the peer */
+    bool closing;                   /* True when the connection is being closed */
+
+    uint8_t frame_header[H2_FRAME_HEADER_LEN];  /* The frame header being read */
+    int frame_header_len;           /* The number of header bytes read */
+    uint32_t frame_len;             /* The payload length of the current frame */
+    uint32_t payload_len;           /* The number of payload bytes read */
+    uint8_t payload[H2_DEFAULT_FRAME_SIZE];     /* The payload of the current frame */
+
+    struct h2_buf header_block;     /* The header block being received */
+    uint32_t header_stream;         /* The stream of the header block, 0 when none */
+    bool header_end_stream;         /* True when the header block ends the stream */
+
+    struct hpack_table hpack;       /* The HPACK decoder state */
+};
+
+/**
+ * Append data to a buffer.
+ * @param b the buffer.
+ * @param data the data to append.
+ * @param len the length of the data.
+ * @param max the maximum size of the buffer.
+ * @return true on success, false when the buffer would grow beyond max.
+ */
+static bool h2_buf_append(struct h2_buf *b, const void *data, size_t len, size_t max)
+{
+    if (b->len + len > max)
+        return false;
+
+    if (b->len + len + 1 > b->cap) {
+        size_t cap = b->cap ? b->cap : 256;
+        char *p;
+
+        while (cap < b->len + len + 1)
+            cap *= 2;
+
+        p = realloc(b->data, cap);
+        if (!p)
+            return false;
+
+        b->data = p;
+        b->cap = cap;
+    }
+
+    memcpy(b->data + b->len, data, len);
+    b->len += len;
+    b->data[b->len] = '\0';
+
+    return true;
+}
+
+/**
+ * Free the memory of a buffer.
+ * @param b the buffer.
+ */
+static void h2_buf_free(struct h2_buf *b)
+{
+    free(b->data);
+    memset(b, 0, sizeof(*b));
+}
+
+/**
+ * Read a 32 bit big endian integer.
+ */
+static uint32_t h2_get32(const uint8_t *p)
+{
+    return ((uint32_t) p[0] << 24) | ((uint32_t) p[1] << 16) | ((uint32_t) p[2] << 8) | p[3];
+}
+
+/**
+ * Write a 32 bit big endian integer.
+ */
+static void h2_put32(uint8_t *p, uint32_t v)
+{
+    p[0] = v >> 24;
+    p[1] = v >> 16;
+    p[2] = v >> 8;
+    p[3] = v;
+}
+
+/**
+ * Restart the idle timeout of the connection.
+ * @param c the connection.
+ */
+static void h2_touch(struct h2_conn *c)
+{
+    uloop_timeout_set(&c->cl->timeout, conf->keep_alive_time * 1000);
+}
+
+/**
+ * Send a frame on the connection.
+ * @param c the connection.
+ * @param type the frame type.
+ * @param flags the frame flags.
+ * @param id the stream identifier.
+ * @param payload the frame payload.
+ * @param len the length of the payload.
+ */
+static void h2_send_frame(struct h2_conn *c, uint8_t type, uint8_t flags, uint32_t id, const void *payload, uint32_t len)
+{
+    uint8_t hdr[H2_FRAME_HEADER_LEN];
+
+    hdr[0] = len >> 16;
+    hdr[1] = len >> 8;
+    hdr[2] = len;
+    hdr[3] = type;
+    hdr[4] = flags;
+    h2_put32(hdr + 5, id & H2_MAX_WINDOW);
+
+    ustream_write(c->cl->us, (const char *) hdr, sizeof(hdr), len > 0);
+    if (len)
+        ustream_write(c->cl->us, payload, len, false);
+
+    h2_touch(c);
+}
+
+/**
+ * Send a RST_STREAM frame.
+ */
+static void h2_send_rst(struct h2_conn *c, uint32_t id, uint32_t error)
+{
+    uint8_t payload[4];
+
+    h2_put32(payload, error);
+    h2_send_frame(c, H2_RST_STREAM, 0, id, payload, sizeof(payload));
+}
+
+/**
+ * Send a WINDOW_UPDATE frame.
+ */
+static void h2_send_window_update(struct h2_conn *c, uint32_t id, uint32_t increment)
+{
+    uint8_t payload[4];
+
+    h2_put32(payload, increment);
+    h2_send_frame(c, H2_WINDOW_UPDATE, 0, id, payload, sizeof(payload));
+}
+
+/**
+ * Send a header block, split into CONTINUATION frames when needed.
+ * @param c the connection.
+ * @param id the stream identifier.
+ * @param end_stream true if the header block ends the stream.
+ * @param block the encoded header block.
+ * @param len the length of the header block.
+ */
+static void h2_send_headers(struct h2_conn *c, uint32_t id, bool end_stream, const uint8_t *block, size_t len)
+{
+    uint8_t type = H2_HEADERS;
+    uint8_t flags = end_stream ? H2_FLAG_END_STREAM : 0;
+
+    do {
+        size_t n = min(len, c->max_frame_size);
+
+        h2_send_frame(c, type, flags | (n == len ? H2_FLAG_END_HEADERS : 0), id, block, n);
+        block += n;
+        len -= n;
+        type = H2_CONTINUATION;
+        flags = 0;
+    } while (len);
+}
+
+/**
+ * Fail the connection, a GOAWAY frame is sent and the client closed.
+ * @param c the connection.
+ * @param error the HTTP/2 error code.
+ */
+static void h2_conn_error(struct h2_conn *c, uint32_t error)
+{
+    uint8_t payload[8];
+
+    if (c->closing)
+        return;
+
+    log_message(LOG_DEBUG, "HTTP/2 connection error %u\r\n", error);
+
+    h2_put32(payload, c->last_stream_id);
+    h2_put32(payload + 4, error);
+    h2_send_frame(c, H2_GOAWAY, 0, 0, payload, sizeof(payload));
+
+    c->closing = true;
+    close_connection(c->cl);
+}
+
+/**
+ * Find an open stream.
+ * @param c the connection.
+ * @param id the stream identifier.
+ * @return the stream or NULL.
+ */
+static struct h2_stream* h2_stream_find(struct h2_conn *c, uint32_t id)
+{
+    struct h2_stream *st;
+
+    list_for_each_entry(st, &c->streams, list) {
+        if (st->id == id)
+            return st;
+    }
+
+    return NULL;
+}
+
+/**
+ * Free a stream that has no virtual client.
+ * @param st the stream.
+ */
+static void h2_stream_free(struct h2_stream *st)
+{
+    if (st->conn) {
+        list_del(&st->list);
+        st->conn->n_streams--;
+    }
+
+    free(st->path);
+    free(st->authority);
+    h2_buf_free(&st->headers);
+    h2_buf_free(&st->body);
+    h2_buf_free(&st->response);
+    free(st);
+}
+
+/**
+ * Answer a stream with a bodyless status and close it.
+ * @param st the stream.
+ * @param status the HTTP status code as string.
+ */
+static void h2_stream_respond(struct h2_stream *st, const char *status)
+{
+    struct h2_conn *c = st->conn;
+    uint8_t block[16];
+    size_t n = hpack_encode_header(block, sizeof(block), ":status", status);
+
+    h2_send_headers(c, st->id, true, block, n);
+    if (!st->remote_closed)
+        h2_send_rst(c, st->id, H2_NO_ERROR);
+
+    h2_stream_free(st);
+}
+
+/**
+ * Parse the completed HTTP/1.1 response header of the virtual client
+ * and send it as a HEADERS frame.
+ * @param st the stream.
+ * @return true on success.
+ */
+static bool h2_stream_send_response_headers(struct h2_stream *st)
+{
+    uint8_t block[H2_MAX_RESPONSE_HEADER];
+    char *line, *next, *value, *p;
+    char status[4];
+    size_t n, m;
+
+    /* Status line: HTTP/1.1 200 OK */
+    line = st->response.data;
+    next = strstr(line, "\r\n");
+    if (next) {
+        *next = '\0';
+        next += 2;
+    }
+
+    p = strchr(line, ' ');
+    if (!p || strlen(p + 1) < 3)
+        return false;
+
+    memcpy(status, p + 1, 3);
+    status[3] = '\0';
+
+    n = hpack_encode_header(block, sizeof(block), ":status", status);
+    if (!n)
+        return false;
+
+    /* Header lines: Name: value */
+    for (line = next; line && *line; line = next) {
+        next = strstr(line, "\r\n");
+        if (next) {
+            *next = '\0';
+            next += 2;
+        }
+
+        value = strchr(line, ':');
+        if (!value)
+            continue;
+
+        *value++ = '\0';
+        while (*value == ' ')
+            value++;
+
+        for (p = line; *p; p++)
+            *p = tolower(*p);
+
+        /* Connection specific headers do not exist in HTTP/2 */
+        if (!strcmp(line, "connection") || !strcmp(line, "keep-alive") ||
+            !strcmp(line, "transfer-encoding"))
+            continue;
+
+        if (!strcmp(line, "content-length"))
+            st->remaining = strtoll(value, NULL, 10);
+
+        m = hpack_encode_header(block + n, sizeof(block) - n, line, value);
+        if (!m)
+            return false;
+        n += m;
+    }
+
+    if (!strcmp(st->method, "HEAD") || st->remaining == 0)
+        st->ended = true;
+
+    h2_send_headers(st->conn, st->id, st->ended, block, n);
+    st->headers_sent = true;
+
+    return true;
+}
+
+/**
+ * Collect the HTTP/1.1 response header written by the virtual client.
+ * @param st the stream.
+ * @param buf the written data.
+ * @param len the length of the written data.
+ * @return the number of bytes that belong to the header, -1 on error.
+ */
+static int h2_stream_parse_response(struct h2_stream *st, const char *buf, int len)
+{
+    size_t old = st->response.len;
+    size_t start = old > 3 ? old - 3 : 0;
+    char *end;
+
+    if (!h2_buf_append(&st->response, buf, len, H2_MAX_RESPONSE_HEADER))
+        return -1;
+
+    end = strstr(st->response.data + start, "\r\n\r\n");
+    if (!end)
+        return len;
+
+    *end = '\0';
+    len = end + 4 - st->response.data - old;
+
+    /* Interim responses like 100 Continue are not forwarded */
+    if (strncmp(st->response.data + 9, "1", 1) == 0) {
+        st->response.len = 0;
+        return len;
+    }
+
+    if (!h2_stream_send_response_headers(st))
+        return -1;
+
+    h2_buf_free(&st->response);
+    return len;
+}
+
+/**
+ * Write callback of the virtual client stream, translates the HTTP/1.1
+ * response into frames. Data that does not fit in the flow control
+ * windows stays buffered in the stream until the windows open.
+ */
+static int h2_stream_write(struct ustream *s, const char *buf, int len, bool more)
+{
+    struct h2_stream *st = container_of(s, struct h2_stream, us);
+    struct h2_conn *c = st->conn;
+    int done = 0;
+    int n;
+
+    /* Discard everything nobody is waiting for */
+    if (!c || c->closing || st->reset || st->ended)
+        return len;
+
+    while (!st->headers_sent) {
+        n = h2_stream_parse_response(st, buf + done, len - done);
+        if (n < 0) {
+            h2_send_rst(c, st->id, H2_INTERNAL_ERROR);
+            st->reset = true;
+            return len;
+        }
+
+        done += n;
+        if (done == len)
+            return len;
+    }
+
+    while (done < len && !st->ended) {
+        n = len - done;
+        n = min(n, st->send_window);
+        n = min(n, c->send_window);
+        n = min(n, (int) c->max_frame_size);
+        if (st->remaining >= 0)
+            n = min(n, st->remaining);
+
+        /* Stop when the windows are closed or the socket is congested */
+        if (n <= 0 || c->cl->us->w.data_bytes > H2_WRITE_BUFFER)
+            break;
+
+        if (st->remaining >= 0) {
+            st->remaining -= n;
+            st->ended = st->remaining == 0;
+        }
+
+        h2_send_frame(c, H2_DATA, st->ended ? H2_FLAG_END_STREAM : 0, st->id, buf + done, n);
+        st->send_window -= n;
+        c->send_window -= n;
+        done += n;
+    }
+
+    /* Anything beyond the announced length is dropped */
+    return st->ended ? len : done;
+}
+
+/**
+ * Read callback of the virtual client stream.
+ */
+static void h2_stream_notify_read(struct ustream *s, int bytes)
+{
+    struct h2_stream *st = container_of(s, struct h2_stream, us);
+
+    read_from_client(st->cl);
+}
+
+/**
+ * Write callback of the virtual client stream.
+ */
+static void h2_stream_notify_write(struct ustream *s, int bytes)
+{
+    struct h2_stream *st = container_of(s, struct h2_stream, us);
+
+    client_notify_write(st->cl);
+}
+
+/**
+ * State change callback of the virtual client stream.
+ */
+static void h2_stream_notify_state(struct ustream *s)
+{
+    struct h2_stream *st = container_of(s, struct h2_stream, us);
+
+    client_notify_state(st->cl);
+}
+
+/**
+ * Resume streams with buffered response data.
+ * @param c the connection.
+ */
+static void h2_resume(struct h2_conn *c)
+{
+    struct h2_stream *st, *tmp;
+
+    list_for_each_entry_safe(st, tmp, &c->streams, list) {
+        if (st->cl && st->us.w.data_bytes)
+            ustream_write_pending(&st->us);
+
+        if (c->cl->us->w.data_bytes > H2_WRITE_BUFFER)
+            break;
+    }
+}
+
+/**
+ * Connection write callback, the socket has drained.
+ */
+static void h2_conn_write_cb(struct client *cl)
+{
+    if (cl->h2)
+        h2_resume(cl->h2);
+}
+
+/**
+ * Close callback of the virtual client of a stream.
+ */
+static void h2_stream_client_closed(struct client *cl)
+{
+    h2_stream_closed(cl->h2_stream);
+}
+
+/**
+ * Run a complete request on a virtual client.
+ * @param st the stream with the complete request.
+ */
+static void h2_stream_dispatch(struct h2_stream *st)
+{
+    struct h2_buf req = { 0 };
+    char line[48];
+    char *buf;
+    int maxlen;
+    bool ok;
+
+    if (st->malformed || !st->method[0] || !st->path) {
+        h2_stream_respond(st, "400");
+        return;
+    }
+
+    /* Rebuild the request in HTTP/1.1 form for the existing state machine */
+    ok = h2_buf_append(&req, st->method, strlen(st->method), SIZE_MAX) &&
+         h2_buf_append(&req, " ", 1, SIZE_MAX) &&
+         h2_buf_append(&req, st->path, strlen(st->path), SIZE_MAX) &&
+         h2_buf_append(&req, " HTTP/1.1\r\n", 11, SIZE_MAX);
+
+    if (ok && st->authority) {
+        ok = h2_buf_append(&req, "Host: ", 6, SIZE_MAX) &&
+             h2_buf_append(&req, st->authority, strlen(st->authority), SIZE_MAX) &&
+             h2_buf_append(&req, "\r\n", 2, SIZE_MAX);
+    }
+
+    if (ok && st->headers.len)
+        ok = h2_buf_append(&req, st->headers.data, st->headers.len, SIZE_MAX);
+
+    if (ok && st->body.len) {
+        snprintf(line, sizeof(line), "Content-Length: %zu\r\n", st->body.len);
+        ok = h2_buf_append(&req, line, strlen(line), SIZE_MAX);
+    }
+
+    /* Every virtual client handles exactly one request */
+    if (ok)
+        ok = h2_buf_append(&req, "Connection: close\r\n\r\n", 21, SIZE_MAX);
+
+    if (ok && st->body.len)
+        ok = h2_buf_append(&req, st->body.data, st->body.len, SIZE_MAX);
+
+    h2_buf_free(&st->headers);
+    h2_buf_free(&st->body);
+
+    if (ok)
+        st->cl = client_create_virtual(st->conn->cl, &st->us, h2_stream_client_closed);
+
+    if (!ok || !st->cl) {
+        h2_buf_free(&req);
+        h2_stream_respond(st, "500");
+        return;
+    }
+
+    st->cl->h2_stream = st;
+
+    /* The whole request must fit in one read buffer */
+    st->us.r.buffer_len = max((int) req.len + 1, WORKING_BUFF_SIZE);
+    ustream_init_defaults(&st->us);
+    st->us.string_data = true;
+    st->us.write = h2_stream_write;
+    st->us.notify_read = h2_stream_notify_read;
+    st->us.notify_write = h2_stream_notify_write;
+    st->us.notify_state = h2_stream_notify_state;
+
+    buf = ustream_reserve(&st->us, req.len, &maxlen);
+    if (!buf || maxlen < req.len) {
+        h2_buf_free(&req);
+        client_close_virtual(st->cl);
+        return;
+    }
+
+    memcpy(buf, req.data, req.len);
+    ustream_fill_read(&st->us, req.len);
+    h2_buf_free(&req);
+}
+
+/**
+ * Check if a header value is safe to pass on in an HTTP/1.1 header.
+ */
+static bool h2_header_valid(const char *value, size_t len)
+{
+    size_t i;
+
+    for (i = 0; i < len; ++i) {
+        if (value[i] == '\r' || value[i] == '\n' || value[i] == '\0')
+            return false;
+    }
+
+    return true;
+}
+
+/**
+ * HPACK callback, stores the pseudo headers and collects the
+ * regular headers of a request.
+ */
+static void h2_header_cb(void *priv, const char *name, size_t name_len, const char *value, size_t value_len)
+{
+    struct h2_stream *st = priv;
+
+    if (!st || st->malformed)
+        return;
+
+    if (!h2_header_valid(name, name_len) || !h2_header_valid(value, value_len)) {
+        st->malformed = true;
+        return;
+    }
+
+    if (name_len && name[0] == ':') {
+        if (name_len == 7 && !memcmp(name, ":method", 7)) {
+            if (value_len >= sizeof(st->method)) {
+                st->malformed = true;
+                return;
+            }
+            memcpy(st->method, value, value_len);
+            st->method[value_len] = '\0';
+        } else if (name_len == 5 && !memcmp(name, ":path", 5)) {
+            free(st->path);
+            st->path = strndup(value, value_len);
+        } else if (name_len == 10 && !memcmp(name, ":authority", 10)) {
+            free(st->authority);
+            st->authority = strndup(value, value_len);
+        }
+        return;
+    }
+
+    /* Connection specific headers and the length are set by us */
+    if ((name_len == 10 && !memcmp(name, "connection", 10)) ||
+        (name_len == 10 && !memcmp(name, "keep-alive", 10)) ||
+        (name_len == 17 && !memcmp(name, "transfer-encoding", 17)) ||
+        (name_len == 14 && !memcmp(name, "content-length", 14)))
+        return;
+
+    if (name_len == 4 && !memcmp(name, "host", 4)) {
+        if (!st->authority)
+            st->authority = strndup(value, value_len);
+        return;
+    }
+
+    if (!h2_buf_append(&st->headers, name, name_len, H2_MAX_REQUEST_HEADER) ||
+        !h2_buf_append(&st->headers, ": ", 2, H2_MAX_REQUEST_HEADER) ||
+        !h2_buf_append(&st->headers, value, value_len, H2_MAX_REQUEST_HEADER) ||
+        !h2_buf_append(&st->headers, "\r\n", 2, H2_MAX_REQUEST_HEADER))
+        st->malformed = true;
+}
+
+/**
+ * Handle a complete header block.
+ * @param c the connection.
+ */
+static void h2_end_headers(struct h2_conn *c)
+{
+    struct h2_stream *st = h2_stream_find(c, c->header_stream);
+    uint32_t id = c->header_stream;
+    bool trailers = st && st->headers_done;
+    int ret;
+
+    /* The block is always decoded to keep the HPACK state in sync */
+    ret = hpack_decode(&c->hpack, (const uint8_t *) c->header_block.data, c->header_block.len,
+            h2_header_cb, trailers ? NULL : st);
+
+    c->header_block.len = 0;
+    c->header_stream = 0;
+
+    if (ret < 0) {
+        h2_conn_error(c, H2_COMPRESSION_ERROR);
+        return;
+    }
+
+    if (!st) {
+        h2_send_rst(c, id, H2_REFUSED_STREAM);
+        return;
+    }
+
+    st->headers_done = true;
+    if (c->header_end_stream) {
+        st->remote_closed = true;
+        h2_stream_dispatch(st);
+    }
+}
+
+/**
+ * Strip the padding of a DATA or HEADERS frame.
+ * @return false when the padding is invalid.
+ */
+static bool h2_strip_padding(uint8_t flags, const uint8_t **p, uint32_t *len)
+{
+    uint8_t pad;
+
+    if (!(flags & H2_FLAG_PADDED))
+        return true;
+
+    if (*len < 1)
+        return false;
+
+    pad = **p;
+    (*p)++;
+    (*len)--;
+
+    if (pad > *len)
+        return false;
+
+    *len -= pad;
+    return true;
+}
+
+/**
+ * Handle a HEADERS frame.
+ */
+static void h2_on_headers(struct h2_conn *c, uint32_t id, uint8_t flags, const uint8_t *p, uint32_t len)
+{
+    struct h2_stream *st;
+
+    if (!id || !(id & 1) || !h2_strip_padding(flags, &p, &len)) {
+        h2_conn_error(c, H2_PROTOCOL_ERROR);
+        return;
+    }
+
+    if (flags & H2_FLAG_PRIORITY) {
+        if (len < 5) {
+            h2_conn_error(c, H2_FRAME_SIZE_ERROR);
+            return;
+        }
+        p += 5;
+        len -= 5;
+    }
+
+    st = h2_stream_find(c, id);
+    if (!st) {
+        if (id <= c->last_stream_id) {
+            h2_conn_error(c, H2_STREAM_CLOSED);
+            return;
+        }
+
+        c->last_stream_id = id;
+
+        /* Beyond the concurrency limit the block is decoded and refused */
+        if (c->n_streams < H2_MAX_STREAMS && (st = calloc(1, sizeof(*st))) != NULL) {
+            st->conn = c;
+            st->id = id;
+            st->send_window = c->initial_window;
+            st->remaining = -1;
+            list_add_tail(&st->list, &c->streams);
+            c->n_streams++;
+        }
+    } else if (st->remote_closed) {
+        h2_conn_error(c, H2_STREAM_CLOSED);
+        return;
+    }
+
+    if (!h2_buf_append(&c->header_block, p, len, H2_MAX_REQUEST_HEADER)) {
+        h2_conn_error(c, H2_PROTOCOL_ERROR);
+        return;
+    }
+
+    c->header_stream = id;
+    c->header_end_stream = flags & H2_FLAG_END_STREAM;
+
+    if (flags & H2_FLAG_END_HEADERS)
+        h2_end_headers(c);
+}
+
+/**
+ * Handle a CONTINUATION frame.
+ */
+static void h2_on_continuation(struct h2_conn *c, uint32_t id, uint8_t flags, const uint8_t *p, uint32_t len)
+{
+    if (!h2_buf_append(&c->header_block, p, len, H2_MAX_REQUEST_HEADER)) {
+        h2_conn_error(c, H2_PROTOCOL_ERROR);
+        return;
+    }
+
+    if (flags & H2_FLAG_END_HEADERS)
+        h2_end_headers(c);
+}
+
+/**
+ * Handle a DATA frame.
+ */
+static void h2_on_data(struct h2_conn *c, uint32_t id, uint8_t flags, const uint8_t *p, uint32_t len)
+{
+    uint32_t frame_len = len;
+    struct h2_stream *st;
+
+    if (!id || !h2_strip_padding(flags, &p, &len)) {
+        h2_conn_error(c, H2_PROTOCOL_ERROR);
+        return;
+    }
+
+    /* Request bodies are consumed right away, keep the connection window open */
+    if (frame_len)
+        h2_send_window_update(c, 0, frame_len);
+
+    st = h2_stream_find(c, id);
+    if (!st || st->remote_closed || !st->headers_done) {
+        h2_send_rst(c, id, H2_STREAM_CLOSED);
+        return;
+    }
+
+    if (!h2_buf_append(&st->body, p, len, H2_MAX_REQUEST_BODY)) {
+        h2_stream_respond(st, "413");
+        return;
+    }
+
+    if (flags & H2_FLAG_END_STREAM) {
+        st->remote_closed = true;
+        h2_stream_dispatch(st);
+    } else if (frame_len) {
+        h2_send_window_update(c, id, frame_len);
+    }
+}
+
+/**
+ * Handle a SETTINGS frame.
+ */
+static void h2_on_settings(struct h2_conn *c, uint32_t id, uint8_t flags, const uint8_t *p, uint32_t len)
+{
+    struct h2_stream *st;
+    uint32_t i, value;
+    int32_t delta;
+
+    if (id) {
+        h2_conn_error(c, H2_PROTOCOL_ERROR);
+        return;
+    }
+
+    if (flags & H2_FLAG_ACK)
+        return;
+
+    if (len % 6) {
+        h2_conn_error(c, H2_FRAME_SIZE_ERROR);
+        return;
+    }
+
+    for (i = 0; i < len; i += 6) {
+        value = h2_get32(p + i + 2);
+
+        switch ((p[i] << 8) | p[i + 1]) {
+        case H2_SETTINGS_INITIAL_WINDOW_SIZE:
+            if (value > H2_MAX_WINDOW) {
+                h2_conn_error(c, H2_FLOW_CONTROL_ERROR);
+                return;
+            }
+
+            delta = value - c->initial_window;
+            list_for_each_entry(st, &c->streams, list)
+                st->send_window += delta;
+            c->initial_window = value;
+            break;
+        case H2_SETTINGS_MAX_FRAME_SIZE:
+            if (value < H2_DEFAULT_FRAME_SIZE || value > H2_MAX_FRAME_SIZE) {
+                h2_conn_error(c, H2_PROTOCOL_ERROR);
+                return;
+            }
+
+            c->max_frame_size = value;
+            break;
+        default:
+            /* The encoder never uses the dynamic table, the rest does not apply */
+            break;
+        }
+    }
+
+    h2_send_frame(c, H2_SETTINGS, H2_FLAG_ACK, 0, NULL, 0);
+    h2_resume(c);
+}
+
+/**
+ * Handle a WINDOW_UPDATE frame.
+ */
+static void h2_on_window_update(struct h2_conn *c, uint32_t id, uint8_t flags, const uint8_t *p, uint32_t len)
+{
+    struct h2_stream *st;
+    uint32_t increment;
+
+    if (len != 4) {
+        h2_conn_error(c, H2_FRAME_SIZE_ERROR);
+        return;
+    }
+
+    increment = h2_get32(p) & H2_MAX_WINDOW;
+
+    if (!id) {
+        if (!increment || increment > H2_MAX_WINDOW - c->send_window) {
+            h2_conn_error(c, increment ? H2_FLOW_CONTROL_ERROR : H2_PROTOCOL_ERROR);
+            return;
+        }
+
+        c->send_window += increment;
+        h2_resume(c);
+        return;
+    }
+
+    st = h2_stream_find(c, id);
+    if (!st)
+        return;
+
+    if (!increment || increment > H2_MAX_WINDOW - st->send_window) {
+        h2_send_rst(c, id, increment ? H2_FLOW_CONTROL_ERROR : H2_PROTOCOL_ERROR);
+        st->reset = true;
+    } else {
+        st->send_window += increment;
+    }
+
+    if (st->cl && st->us.w.data_bytes)
+        ustream_write_pending(&st->us);
+}
+
+/**
+ * Handle a RST_STREAM frame.
+ */
+static void h2_on_rst_stream(struct h2_conn *c, uint32_t id, uint8_t flags, const uint8_t *p, uint32_t len)
+{
+    struct h2_stream *st;
+
+    if (len != 4) {
+        h2_conn_error(c, H2_FRAME_SIZE_ERROR);
+        return;
+    }
+
+    st = h2_stream_find(c, id);
+    if (!st)
+        return;
+
+    if (!st->cl) {
+        h2_stream_free(st);
+        return;
+    }
+
+    /* The virtual client finishes on its own, its output is dropped */
+    st->reset = true;
+    if (st->us.w.data_bytes)
+        ustream_write_pending(&st->us);
+}
+
+/**
+ * Handle a PING frame.
+ */
+static void h2_on_ping(struct h2_conn *c, uint32_t id, uint8_t flags, const uint8_t *p, uint32_t len)
+{
+    if (len != 8) {
+        h2_conn_error(c, H2_FRAME_SIZE_ERROR);
+        return;
+    }
+
+    if (!(flags & H2_FLAG_ACK))
+        h2_send_frame(c, H2_PING, H2_FLAG_ACK, 0, p, len);
+}
+
+/**
+ * Handle a complete frame.
+ * @param c the connection.
+ */
+static void h2_process_frame(struct h2_conn *c)
+{
+    uint8_t type = c->frame_header[3];
+    uint8_t flags = c->frame_header[4];
+    uint32_t id = h2_get32(c->frame_header + 5) & H2_MAX_WINDOW;
+
+    /* A header block may only be interrupted by its own continuation */
+    if (c->header_stream && (type != H2_CONTINUATION || id != c->header_stream)) {
+        h2_conn_error(c, H2_PROTOCOL_ERROR);
+        return;
+    }
+
+    switch (type) {
+    case H2_DATA:
+        h2_on_data(c, id, flags, c->payload, c->frame_len);
+        break;
+    case H2_HEADERS:
+        h2_on_headers(c, id, flags, c->payload, c->frame_len);
+        break;
+    case H2_CONTINUATION:
+        if (!c->header_stream) {
+            h2_conn_error(c, H2_PROTOCOL_ERROR);
+            break;
+        }
+        h2_on_continuation(c, id, flags, c->payload, c->frame_len);
+        break;
+    case H2_SETTINGS:
+        h2_on_settings(c, id, flags, c->payload, c->frame_len);
+        break;
+    case H2_WINDOW_UPDATE:
+        h2_on_window_update(c, id, flags, c->payload, c->frame_len);
+        break;
+    case H2_RST_STREAM:
+        h2_on_rst_stream(c, id, flags, c->payload, c->frame_len);
+        break;
+    case H2_PING:
+        h2_on_ping(c, id, flags, c->payload, c->frame_len);
+        break;
+    case H2_GOAWAY:
+        /* The peer closes the connection when it is done */
+        break;
+    case H2_PUSH_PROMISE:
+        h2_conn_error(c, H2_PROTOCOL_ERROR);
+        break;
+    default:
+        /* PRIORITY and unknown frames are ignored */
+        break;
+    }
+}
+
+/**
+ * Check if a connection starts with the HTTP/2 connection preface.
+ * @param buf the start of the connection data.
+ * @param len the length of the data.
+ * @return H2_PREFACE_NONE, H2_PREFACE_PARTIAL or H2_PREFACE_MATCH.
+ */
+int h2_check_preface(const char *buf, int len)
+{
+    if (memcmp(buf, H2_PREFACE, min(len, H2_PREFACE_LEN)))
+        return H2_PREFACE_NONE;
+
+    return len < H2_PREFACE_LEN ? H2_PREFACE_PARTIAL : H2_PREFACE_MATCH;
+}
+
+/**
+ * Switch a client to HTTP/2, the preface is consumed and the
+ * server settings are sent.
+ * @param cl the client that sent the connection preface.
+ * @return true on success.
+ */
+bool h2_conn_start(struct client *cl)
+{
+    struct h2_conn *c = calloc(1, sizeof(*c));
+    uint8_t settings[12];
+
+    if (!c) {
+        close_connection(cl);
+        return false;
+    }
+
+    c->cl = cl;
+    INIT_LIST_HEAD(&c->streams);
+    c->send_window = H2_DEFAULT_WINDOW;
+    c->initial_window = H2_DEFAULT_WINDOW;
+    c->max_frame_size = H2_DEFAULT_FRAME_SIZE;
+    hpack_table_init(&c->hpack, H2_HEADER_TABLE_SIZE);
+
+    cl->h2 = c;
+    cl->dispatch.write_cb = h2_conn_write_cb;
+    ustream_consume(cl->us, H2_PREFACE_LEN);
+
+    settings[0] = 0;
+    settings[1] = H2_SETTINGS_MAX_CONCURRENT_STREAMS;
+    h2_put32(settings + 2, H2_MAX_STREAMS);
+    settings[6] = 0;
+    settings[7] = H2_SETTINGS_HEADER_TABLE_SIZE;
+    h2_put32(settings + 8, H2_HEADER_TABLE_SIZE);
+    h2_send_frame(c, H2_SETTINGS, 0, 0, settings, sizeof(settings));
+
+    return true;
+}
+
+/**
+ * Read and handle all complete frames on an HTTP/2 connection.
+ * @param cl the HTTP/2 client.
+ */
+void h2_read(struct client *cl)
+{
+    struct h2_conn *c = cl->h2;
+    int n;
+
+    while (!c->closing) {
+        if (c->frame_header_len < H2_FRAME_HEADER_LEN) {
+            n = ustream_read(cl->us, (char *) c->frame_header + c->frame_header_len,
+                    H2_FRAME_HEADER_LEN - c->frame_header_len);
+            if (n <= 0)
+                break;
+
+            c->frame_header_len += n;
+            if (c->frame_header_len < H2_FRAME_HEADER_LEN)
+                break;
+
+            c->frame_len = (c->frame_header[0] << 16) | (c->frame_header[1] << 8) | c->frame_header[2];
+            c->payload_len = 0;
+
+            if (c->frame_len > H2_DEFAULT_FRAME_SIZE) {
+                h2_conn_error(c, H2_FRAME_SIZE_ERROR);
+                break;
+            }
+        }
+
+        if (c->payload_len < c->frame_len) {
+            n = ustream_read(cl->us, (char *) c->payload + c->payload_len, c->frame_len - c->payload_len);
+            if (n <= 0)
+                break;
+
+            c->payload_len += n;
+            if (c->payload_len < c->frame_len)
+                break;
+        }
+
+        c->frame_header_len = 0;
+        h2_touch(c);
+        h2_process_frame(c);
+    }
+}
+
+/**
+ * Free the HTTP/2 state of a client and close all its streams.
+ * @param cl the HTTP/2 client.
+ */
+void h2_conn_free(struct client *cl)
+{
+    struct h2_conn *c = cl->h2;
+    struct h2_stream *st, *tmp;
+
+    if (!c)
+        return;
+
+    cl->h2 = NULL;
+
+    list_for_each_entry_safe(st, tmp, &c->streams, list) {
+        list_del(&st->list);
+        st->conn = NULL;
+
+        if (st->cl)
+            client_close_virtual(st->cl);
+        else
+            h2_stream_free(st);
+    }
+
+    hpack_table_free(&c->hpack);
+    h2_buf_free(&c->header_block);
+    free(c);
+}
+
+/**
+ * Finish and free a stream when its virtual client is closed.
+ * @param st the stream of the virtual client.
+ */
+void h2_stream_closed(struct h2_stream *st)
+{
+    struct h2_conn *c = st->conn;
+
+    if (c && !c->closing && !st->reset && !st->ended) {
+        if (st->headers_sent)
+            h2_send_frame(c, H2_DATA, H2_FLAG_END_STREAM, st->id, NULL, 0);
+        else
+            h2_send_rst(c, st->id, H2_INTERNAL_ERROR);
+    }
+
+    st->cl = NULL;
+    ustream_free(&st->us);
+    h2_stream_free(st);
+}
@@ -0,0 +1,78 @@
+/* 
+ * Copyright (c) 2014, Daan Pape
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without 
+ * modification, are permitted provided that the following conditions are met:
+ * 
+ *     1. Redistributions of source code must retain the above copyright 
+ *        notice, this list of conditions and the following disclaimer.
+ *
+ *     2. Redistributions in binary form must reproduce the above copyright 
+ *        notice, this list of conditions and the following disclaimer in the 
+ *        documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" 
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE 
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE 
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE 
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR 
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF 
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS 
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN 
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) 
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE 
+ * POSSIBILITY OF SUCH DAMAGE.
+ * 
+ * File:   h2.h
+ * Created on October 18, 2026, 11:58 AM
+ */
+
+#ifndef H2_H_
+#define H2_H_
+
+#include <stdbool.h>
+
+struct client;
+struct h2_stream;
+
+/* Result of matching a buffer against the HTTP/2 connection preface */
+#define H2_PREFACE_NONE         0       /* Not an HTTP/2 connection */
+#define H2_PREFACE_PARTIAL      1       /* Prefix of the preface, more data needed */
+#define H2_PREFACE_MATCH        2       /* Complete connection preface */
+
+/**
+ * Check if a connection starts with the HTTP/2 connection preface.
+ * @param buf the start of the connection data.
+ * @param len the length of the data.
+ * @return H2_PREFACE_NONE, H2_PREFACE_PARTIAL or H2_PREFACE_MATCH.
+ */
+int h2_check_preface(const char *buf, int len);
+
+/**
+ * Switch a client to HTTP/2, the preface is consumed and the
+ * server settings are sent.
+ * @param cl the client that sent the connection preface.
+ * @return true on success.
+ */
+bool h2_conn_start(struct client *cl);
+
+/**
+ * Read and handle all complete frames on an HTTP/2 connection.
+ * @param cl the HTTP/2 client.
+ */
+void h2_read(struct client *cl);
+
+/**
+ * Free the HTTP/2 state of a client and close all its streams.
+ * @param cl the HTTP/2 client.
+ */
+void h2_conn_free(struct client *cl);
+
+/**
+ * Finish and free a stream when its virtual client is closed.
+ * @param st the stream of the virtual client.
+ */
+void h2_stream_closed(struct h2_stream *st);
+
+#endif /* H2_H_ */
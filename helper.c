@@ -28,10 +28,18 @@
  * Created on February 1, 2015, 4:08 PM
  */
 
+#define _GNU_SOURCE
+#include <stdarg.h>
+#include <stdio.h>
 #include <string.h>
 #include <stdlib.h>
+#include <stdint.h>
+#include <pthread.h>
+#include <sched.h>
+#include <time.h>
 
 #include "helper.h"
+#include "config.h"
 #include "logger.h"
 
 /* Use unit separator (31) as delimiter*/
@@ -84,6 +92,7 @@ struct chararray* helper_unserialize_str_array(char* str)
 {
     struct chararray* chr_array = (struct chararray*) malloc(sizeof(struct chararray));
     chr_array->len = 0;
+    chr_array->array = NULL;
     char *to_save;
     char *tmp = str;
     size_t i;
@@ -122,6 +131,7 @@ void helper_free_char_array(struct chararray *chr_array)
     for(i = 0; i < chr_array->len; ++i) {
         free(chr_array->array[i]);
     }
+    free(chr_array->array);
     free(chr_array);
 }
 
@@ -146,3 +156,76 @@ bool helper_str_startswith(const char* haystack, const char* needle, size_t offs
     
     return true;
 }
+
+/**
+ * Make the path of a device or sysfs file below the configured
+ * hardware root, which is '/' unless a simulated board is used.
+ * @param buf the buffer for the path. 
+ * @param size the size of the buffer. 
+ * @param format printf format of the absolute path on the board. 
+ * @return the buffer. 
+ */
+char* helper_hw_path(char *buf, size_t size, const char *format, ...)
+{
+    va_list ap;
+    int len = 0;
+
+    if (conf && conf->hardware_root) {
+        len = snprintf(buf, size, "%s", conf->hardware_root);
+        if ((size_t) len >= size)
+            len = size - 1;
+    }
+
+    va_start(ap, format);
+    vsnprintf(buf + len, size - len, format, ap);
+    va_end(ap);
+
+    return buf;
+}
+
+/**
+ * Get the current time.
+ * @return the CLOCK_MONOTONIC time in nanoseconds.
+ */
+uint64_t helper_now_ns(void)
+{
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (uint64_t) now.tv_sec * 1000000000ull + now.tv_nsec;
+}
+
+/**
+ * Give a timing thread real-time priority and pin it to a CPU. A
+ * setting that can't be applied is logged, the thread runs anyway.
+ * @param thread the thread.
+ * @param priority the SCHED_FIFO priority, 0 to keep normal scheduling.
+ * @param cpu the CPU to run on, -1 for any.
+ * @param name the name of the thread in the log.
+ * @return true when all settings were applied.
+ */
+bool helper_thread_realtime(pthread_t thread, int priority, int cpu, const char *name)
+{
+    struct sched_param param;
+    cpu_set_t cpus;
+    bool ok = true;
+
+    if (priority > 0) {
+        param.sched_priority = priority;
+        if (pthread_setschedparam(thread, SCHED_FIFO, &param) != 0) {
+            log_message(LOG_WARNING, "Could not give the %s thread real-time priority\r\n", name);
+            ok = false;
+        }
+    }
+
+    if (cpu >= 0) {
+        CPU_ZERO(&cpus);
+        CPU_SET(cpu, &cpus);
+        if (pthread_setaffinity_np(thread, sizeof(cpus), &cpus) != 0) {
+            log_message(LOG_WARNING, "Could not pin the %s thread to CPU %d\r\n", name, cpu);
+            ok = false;
+        }
+    }
+
+    return ok;
+}
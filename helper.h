@@ -33,6 +33,8 @@
 
 #include <stddef.h>
 #include <stdbool.h>
+#include <stdint.h>
+#include <pthread.h>
 
 /**
  * Structure used by unserialize
@@ -73,5 +75,33 @@ void helper_free_char_array(struct chararray *chr_array);
  */
 bool helper_str_startswith(const char* haystack, const char* needle, size_t offset);
 
+/**
+ * Make the path of a device or sysfs file below the configured
+ * hardware root, which is '/' unless a simulated board is used.
+ * @param buf the buffer for the path. 
+ * @param size the size of the buffer. 
+ * @param format printf format of the absolute path on the board. 
+ * @return the buffer. 
+ */
+char* helper_hw_path(char *buf, size_t size, const char *format, ...)
+    __attribute__((format(printf, 3, 4)));
+
+/**
+ * Get the current time.
+ * @return the CLOCK_MONOTONIC time in nanoseconds.
+ */
+uint64_t helper_now_ns(void);
+
+/**
+ * Give a timing thread real-time priority and pin it to a CPU. A
+ * setting that can't be applied is logged, the thread runs anyway.
+ * @param thread the thread.
+ * @param priority the SCHED_FIFO priority, 0 to keep normal scheduling.
+ * @param cpu the CPU to run on, -1 for any.
+ * @param name the name of the thread in the log.
+ * @return true when all settings were applied.
+ */
+bool helper_thread_realtime(pthread_t thread, int priority, int cpu, const char *name);
+
 #endif
 
@@ -0,0 +1,595 @@
+/* 
+ * Copyright (c) 2014, Daan Pape
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without 
+ * modification, are permitted provided that the following conditions are met:
+ * 
+ *     1. Redistributions of source code must retain the above copyright 
+ *        notice, this list of conditions and the following disclaimer.
+ *
+ *     2. Redistributions in binary form must reproduce the above copyright 
+ *        notice, this list of conditions and the following disclaimer in the 
+ *        documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" 
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE 
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE 
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE 
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR 
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF 
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS 
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN 
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) 
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE 
+ * POSSIBILITY OF SUCH DAMAGE.
+ * 
+ * File:   hpack.c
+ * Created on October 18, 2026, 11:04 AM
+ */
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "hpack.h"
+
+/* Size overhead of a dynamic table entry, RFC 7541 4.1 */
+#define HPACK_ENTRY_OVERHEAD    32
+
+/* Number of entries in the static table */
+#define HPACK_STATIC_ENTRIES    61
+
+/**
+ * The HPACK static table, RFC 7541 Appendix A. Index 0 is unused.
+ */
+static const struct {
+    const char *name;
+    const char *value;
+} static_table[HPACK_STATIC_ENTRIES + 1] = {
+    { NULL, NULL },
+    { ":authority", "" },
+    { ":method", "GET" },
+    { ":method", "POST" },
+    { ":path", "/" },
+    { ":path", "/index.html" },
+    { ":scheme", "http" },
+    { ":scheme", "https" },
+    { ":status", "200" },
+    { ":status", "204" },
+    { ":status", "206" },
+    { ":status", "304" },
+    { ":status", "400" },
+    { ":status", "404" },
+    { ":status", "500" },
+    { "accept-charset", "" },
+    { "accept-encoding", "gzip, deflate" },
+    { "accept-language", "" },
+    { "accept-ranges", "" },
+    { "accept", "" },
+    { "access-control-allow-origin", "" },
+    { "age", "" },
+    { "allow", "" },
+    { "authorization", "" },
+    { "cache-control", "" },
+    { "content-disposition", "" },
+    { "content-encoding", "" },
+    { "content-language", "" },
+    { "content-length", "" },
+    { "content-location", "" },
+    { "content-range", "" },
+    { "content-type", "" },
+    { "cookie", "" },
+    { "date", "" },
+    { "etag", "" },
+    { "expect", "" },
+    { "expires", "" },
+    { "from", "" },
+    { "host", "" },
+    { "if-match", "" },
+    { "if-modified-since", "" },
+    { "if-none-match", "" },
+    { "if-range", "" },
+    { "if-unmodified-since", "" },
+    { "last-modified", "" },
+    { "link", "" },
+    { "location", "" },
+    { "max-forwards", "" },
+    { "proxy-authenticate", "" },
+    { "proxy-authorization", "" },
+    { "range", "" },
+    { "referer", "" },
+    { "refresh", "" },
+    { "retry-after", "" },
+    { "server", "" },
+    { "set-cookie", "" },
+    { "strict-transport-security", "" },
+    { "transfer-encoding", "" },
+    { "user-agent", "" },
+    { "vary", "" },
+    { "via", "" },
+    { "www-authenticate", "" },
+};
+
+/**
+ * The HPACK Huffman code, RFC 7541 Appendix B.
+ */
+static const uint32_t huffman_codes[256] = {
+    0x00001ff8, 0x007fffd8, 0x0fffffe2, 0x0fffffe3, 0x0fffffe4, 0x0fffffe5, 0x0fffffe6, 0x0fffffe7,
+    0x0fffffe8, 0x00ffffea, 0x3ffffffc, 0x0fffffe9, 0x0fffffea, 0x3ffffffd, 0x0fffffeb, 0x0fffffec,
+    0x0fffffed, 0x0fffffee, 0x0fffffef, 0x0ffffff0, 0x0ffffff1, 0x0ffffff2, 0x3ffffffe, 0x0ffffff3,
+    0x0ffffff4, 0x0ffffff5, 0x0ffffff6, 0x0ffffff7, 0x0ffffff8, 0x0ffffff9, 0x0ffffffa, 0x0ffffffb,
+    0x00000014, 0x000003f8, 0x000003f9, 0x00000ffa, 0x00001ff9, 0x00000015, 0x000000f8, 0x000007fa,
+    0x000003fa, 0x000003fb, 0x000000f9, 0x000007fb, 0x000000fa, 0x00000016, 0x00000017, 0x00000018,
+    0x00000000, 0x00000001, 0x00000002, 0x00000019, 0x0000001a, 0x0000001b, 0x0000001c, 0x0000001d,
+    0x0000001e, 0x0000001f, 0x0000005c, 0x000000fb, 0x00007ffc, 0x00000020, 0x00000ffb, 0x000003fc,
+    0x00001ffa, 0x00000021, 0x0000005d, 0x0000005e, 0x0000005f, 0x00000060, 0x00000061, 0x00000062,
+    0x00000063, 0x00000064, 0x00000065, 0x00000066, 0x00000067, 0x00000068, 0x00000069, 0x0000006a,
+    0x0000006b, 0x0000006c, 0x0000006d, 0x0000006e, 0x0000006f, 0x00000070, 0x00000071, 0x00000072,
+    0x000000fc, 0x00000073, 0x000000fd, 0x00001ffb, 0x0007fff0, 0x00001ffc, 0x00003ffc, 0x00000022,
+    0x00007ffd, 0x00000003, 0x00000023, 0x00000004, 0x00000024, 0x00000005, 0x00000025, 0x00000026,
+    0x00000027, 0x00000006, 0x00000074, 0x00000075, 0x00000028, 0x00000029, 0x0000002a, 0x00000007,
+    0x0000002b, 0x00000076, 0x0000002c, 0x00000008, 0x00000009, 0x0000002d, 0x00000077, 0x00000078,
+    0x00000079, 0x0000007a, 0x0000007b, 0x00007ffe, 0x000007fc, 0x00003ffd, 0x00001ffd, 0x0ffffffc,
+    0x000fffe6, 0x003fffd2, 0x000fffe7, 0x000fffe8, 0x003fffd3, 0x003fffd4, 0x003fffd5, 0x007fffd9,
+    0x003fffd6, 0x007fffda, 0x007fffdb, 0x007fffdc, 0x007fffdd, 0x007fffde, 0x00ffffeb, 0x007fffdf,
+    0x00ffffec, 0x00ffffed, 0x003fffd7, 0x007fffe0, 0x00ffffee, 0x007fffe1, 0x007fffe2, 0x007fffe3,
+    0x007fffe4, 0x001fffdc, 0x003fffd8, 0x007fffe5, 0x003fffd9, 0x007fffe6, 0x007fffe7, 0x00ffffef,
+    0x003fffda, 0x001fffdd, 0x000fffe9, 0x003fffdb, 0x003fffdc, 0x007fffe8, 0x007fffe9, 0x001fffde,
+    0x007fffea, 0x003fffdd, 0x003fffde, 0x00fffff0, 0x001fffdf, 0x003fffdf, 0x007fffeb, 0x007fffec,
+    0x001fffe0, 0x001fffe1, 0x003fffe0, 0x001fffe2, 0x007fffed, 0x003fffe1, 0x007fffee, 0x007fffef,
+    0x000fffea, 0x003fffe2, 0x003fffe3, 0x003fffe4, 0x007ffff0, 0x003fffe5, 0x003fffe6, 0x007ffff1,
+    0x03ffffe0, 0x03ffffe1, 0x000fffeb, 0x0007fff1, 0x003fffe7, 0x007ffff2, 0x003fffe8, 0x01ffffec,
+    0x03ffffe2, 0x03ffffe3, 0x03ffffe4, 0x07ffffde, 0x07ffffdf, 0x03ffffe5, 0x00fffff1, 0x01ffffed,
+    0x0007fff2, 0x001fffe3, 0x03ffffe6, 0x07ffffe0, 0x07ffffe1, 0x03ffffe7, 0x07ffffe2, 0x00fffff2,
+    0x001fffe4, 0x001fffe5, 0x03ffffe8, 0x03ffffe9, 0x0ffffffd, 0x07ffffe3, 0x07ffffe4, 0x07ffffe5,
+    0x000fffec, 0x00fffff3, 0x000fffed, 0x001fffe6, 0x003fffe9, 0x001fffe7, 0x001fffe8, 0x007ffff3,
+    0x003fffea, 0x003fffeb, 0x01ffffee, 0x01ffffef, 0x00fffff4, 0x00fffff5, 0x03ffffea, 0x007ffff4,
+    0x03ffffeb, 0x07ffffe6, 0x03ffffec, 0x03ffffed, 0x07ffffe7, 0x07ffffe8, 0x07ffffe9, 0x07ffffea,
+    0x07ffffeb, 0x0ffffffe, 0x07ffffec, 0x07ffffed, 0x07ffffee, 0x07ffffef, 0x07fffff0, 0x03ffffee,
+};
+
+static const uint8_t huffman_code_len[256] = {
+    13, 23, 28, 28, 28, 28, 28, 28, 28, 24, 30, 28, 28, 30, 28, 28,
+    28, 28, 28, 28, 28, 28, 30, 28, 28, 28, 28, 28, 28, 28, 28, 28,
+    6, 10, 10, 12, 13, 6, 8, 11, 10, 10, 8, 11, 8, 6, 6, 6,
+    5, 5, 5, 6, 6, 6, 6, 6, 6, 6, 7, 8, 15, 6, 12, 10,
+    13, 6, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7,
+    7, 7, 7, 7, 7, 7, 7, 7, 8, 7, 8, 13, 19, 13, 14, 6,
+    15, 5, 6, 5, 6, 5, 6, 6, 6, 5, 7, 7, 6, 6, 6, 5,
+    6, 7, 6, 5, 5, 6, 7, 7, 7, 7, 7, 15, 11, 14, 13, 28,
+    20, 22, 20, 20, 22, 22, 22, 23, 22, 23, 23, 23, 23, 23, 24, 23,
+    24, 24, 22, 23, 24, 23, 23, 23, 23, 21, 22, 23, 22, 23, 23, 24,
+    22, 21, 20, 22, 22, 23, 23, 21, 23, 22, 22, 24, 21, 22, 23, 23,
+    21, 21, 22, 21, 23, 22, 23, 23, 20, 22, 22, 22, 23, 22, 22, 23,
+    26, 26, 20, 19, 22, 23, 22, 25, 26, 26, 26, 27, 27, 26, 24, 25,
+    19, 21, 26, 27, 27, 26, 27, 24, 21, 21, 26, 26, 28, 27, 27, 27,
+    20, 24, 20, 21, 22, 21, 21, 23, 22, 22, 25, 25, 24, 24, 26, 23,
+    26, 27, 26, 26, 27, 27, 27, 27, 27, 28, 27, 27, 27, 27, 27, 26,
+};
+
+/* Number of nodes in the Huffman decoding tree, 257 symbols including EOS */
+#define HUFFMAN_NODES   512
+
+/* Huffman decoding tree, a child > 0 is a node, < 0 the leaf of symbol -child - 1 */
+static int16_t huffman_tree[HUFFMAN_NODES][2];
+
+/* True when the Huffman decoding tree is built */
+static bool huffman_ready = false;
+
+/**
+ * Build the Huffman decoding tree from the code table. EOS is never
+ * added, a string containing it fails to decode.
+ */
+static void huffman_build(void)
+{
+    int nodes = 1;
+    int sym, bit, node;
+
+    memset(huffman_tree, 0, sizeof(huffman_tree));
+
+    for (sym = 0; sym < 256; ++sym) {
+        node = 0;
+        for (bit = huffman_code_len[sym] - 1; bit > 0; --bit) {
+            int b = (huffman_codes[sym] >> bit) & 1;
+
+            if (huffman_tree[node][b] == 0)
+                huffman_tree[node][b] = nodes++;
+            node = huffman_tree[node][b];
+        }
+        huffman_tree[node][huffman_codes[sym] & 1] = -sym - 1;
+    }
+
+    huffman_ready = true;
+}
+
+/**
+ * Decode a Huffman encoded string.
+ * @param in the encoded string.
+ * @param len the length of the encoded string.
+ * @param out the output buffer.
+ * @param outlen the size of the output buffer.
+ * @return the decoded length or -1 on error.
+ */
+static int huffman_decode(const uint8_t *in, size_t len, char *out, size_t outlen)
+{
+    size_t i, n = 0;
+    int node = 0, depth = 0, bit;
+
+    if (!huffman_ready)
+        huffman_build();
+
+    for (i = 0; i < len; ++i) {
+        for (bit = 7; bit >= 0; --bit) {
+            int next = huffman_tree[node][(in[i] >> bit) & 1];
+
+            if (next > 0) {
+                node = next;
+                ++depth;
+                continue;
+            }
+
+            /* Unused branches only lead to EOS */
+            if (next == 0 || n == outlen)
+                return -1;
+
+            out[n++] = (char) (-next - 1);
+            node = 0;
+            depth = 0;
+        }
+    }
+
+    /* Padding is a prefix of EOS, at most 7 one bits */
+    if (depth > 7)
+        return -1;
+
+    return n;
+}
+
+/**
+ * Decode a prefixed integer, RFC 7541 5.1.
+ * @param buf the input position, advanced past the integer.
+ * @param end the end of the input.
+ * @param prefix the number of prefix bits.
+ * @param value the decoded value.
+ * @return 0 on success, -1 on error.
+ */
+static int hpack_decode_int(const uint8_t **buf, const uint8_t *end, int prefix, uint32_t *value)
+{
+    const uint8_t *p = *buf;
+    uint32_t mask = (1 << prefix) - 1;
+    uint32_t v;
+    int shift = 0;
+
+    if (p >= end)
+        return -1;
+
+    v = *p++ & mask;
+    if (v == mask) {
+        do {
+            if (p >= end || shift > 21)
+                return -1;
+
+            v += (uint32_t) (*p & 0x7f) << shift;
+            shift += 7;
+        } while (*p++ & 0x80);
+    }
+
+    *buf = p;
+    *value = v;
+    return 0;
+}
+
+/**
+ * Decode a string literal, RFC 7541 5.2.
+ * @param buf the input position, advanced past the string.
+ * @param end the end of the input.
+ * @param out the output buffer.
+ * @param outlen the size of the output buffer.
+ * @return the string length or -1 on error.
+ */
+static int hpack_decode_string(const uint8_t **buf, const uint8_t *end, char *out, size_t outlen)
+{
+    bool huffman;
+    uint32_t len;
+    int n;
+
+    if (*buf >= end)
+        return -1;
+
+    huffman = **buf & 0x80;
+    if (hpack_decode_int(buf, end, 7, &len) < 0 || len > end - *buf)
+        return -1;
+
+    if (huffman) {
+        n = huffman_decode(*buf, len, out, outlen);
+    } else {
+        if (len > outlen)
+            return -1;
+        memcpy(out, *buf, len);
+        n = len;
+    }
+
+    *buf += len;
+    return n;
+}
+
+/**
+ * Evict entries from the dynamic table until it fits the given size.
+ * @param t the dynamic table.
+ * @param size the size the table should fit in.
+ */
+static void hpack_table_evict(struct hpack_table *t, size_t size)
+{
+    while (t->count && t->size > size) {
+        struct hpack_entry *e = &t->entries[--t->count];
+
+        t->size -= e->name_len + e->value_len + HPACK_ENTRY_OVERHEAD;
+        free(e->name);
+        e->name = NULL;
+    }
+}
+
+/**
+ * Add a header field to the dynamic table, RFC 7541 4.4.
+ * @param t the dynamic table.
+ * @return 0 on success, -1 when out of memory.
+ */
+static int hpack_table_add(struct hpack_table *t, const char *name, size_t name_len, const char *value, size_t value_len)
+{
+    size_t size = name_len + value_len + HPACK_ENTRY_OVERHEAD;
+    struct hpack_entry *e;
+    char *data;
+
+    /* An entry larger than the table empties it */
+    if (size > t->max_size) {
+        hpack_table_evict(t, 0);
+        return 0;
+    }
+
+    hpack_table_evict(t, t->max_size - size);
+    if (t->count == HPACK_MAX_ENTRIES)
+        hpack_table_evict(t, t->size - 1);
+
+    data = malloc(name_len + value_len + 2);
+    if (!data)
+        return -1;
+
+    memcpy(data, name, name_len);
+    data[name_len] = '\0';
+    memcpy(data + name_len + 1, value, value_len);
+    data[name_len + 1 + value_len] = '\0';
+
+    memmove(&t->entries[1], &t->entries[0], t->count * sizeof(*e));
+    e = &t->entries[0];
+    e->name = data;
+    e->value = data + name_len + 1;
+    e->name_len = name_len;
+    e->value_len = value_len;
+
+    t->count++;
+    t->size += size;
+
+    return 0;
+}
+
+/**
+ * Look up an index in the static and dynamic table.
+ * @return 0 on success, -1 for an invalid index.
+ */
+static int hpack_table_get(struct hpack_table *t, uint32_t index, const char **name, size_t *name_len, const char **value, size_t *value_len)
+{
+    if (index == 0)
+        return -1;
+
+    if (index <= HPACK_STATIC_ENTRIES) {
+        *name = static_table[index].name;
+        *name_len = strlen(*name);
+        *value = static_table[index].value;
+        *value_len = strlen(*value);
+        return 0;
+    }
+
+    index -= HPACK_STATIC_ENTRIES + 1;
+    if (index >= t->count)
+        return -1;
+
+    *name = t->entries[index].name;
+    *name_len = t->entries[index].name_len;
+    *value = t->entries[index].value;
+    *value_len = t->entries[index].value_len;
+    return 0;
+}
+
+/**
+ * Initialize a decoder dynamic table.
+ * @param t the table to initialize.
+ * @param limit the SETTINGS_HEADER_TABLE_SIZE advertised to the peer.
+ */
+void hpack_table_init(struct hpack_table *t, size_t limit)
+{
+    memset(t, 0, sizeof(*t));
+    t->max_size = limit;
+    t->limit = limit;
+}
+
+/**
+ * Free all entries of a dynamic table.
+ * @param t the table to free.
+ */
+void hpack_table_free(struct hpack_table *t)
+{
+    hpack_table_evict(t, 0);
+}
+
+/**
+ * Decode a complete header block.
+ * @param t the dynamic table of the connection.
+ * @param buf the header block.
+ * @param len the length of the header block.
+ * @param cb called for every header field.
+ * @param priv passed to the callback.
+ * @return 0 on success, -1 on a compression error.
+ */
+int hpack_decode(struct hpack_table *t, const uint8_t *buf, size_t len, hpack_header_cb cb, void *priv)
+{
+    static char name_buf[HPACK_MAX_STRING];
+    static char value_buf[HPACK_MAX_STRING];
+    const uint8_t *end = buf + len;
+    const char *name, *value;
+    size_t name_len, value_len;
+    uint32_t index;
+    int n;
+
+    while (buf < end) {
+        uint8_t b = *buf;
+
+        if (b & 0x80) {
+            /* Indexed header field */
+            if (hpack_decode_int(&buf, end, 7, &index) < 0 ||
+                hpack_table_get(t, index, &name, &name_len, &value, &value_len) < 0)
+                return -1;
+
+            cb(priv, name, name_len, value, value_len);
+            continue;
+        }
+
+        if ((b & 0xe0) == 0x20) {
+            /* Dynamic table size update */
+            if (hpack_decode_int(&buf, end, 5, &index) < 0 || index > t->limit)
+                return -1;
+
+            t->max_size = index;
+            hpack_table_evict(t, t->max_size);
+            continue;
+        }
+
+        /* Literal header field, with (01), without (0000) or never (0001) indexing */
+        if (hpack_decode_int(&buf, end, (b & 0x40) ? 6 : 4, &index) < 0)
+            return -1;
+
+        if (index) {
+            if (hpack_table_get(t, index, &name, &name_len, &value, &value_len) < 0)
+                return -1;
+
+            /* The name may live in the dynamic table which can be evicted on add */
+            if (name_len > sizeof(name_buf))
+                return -1;
+            memcpy(name_buf, name, name_len);
+        } else {
+            if ((n = hpack_decode_string(&buf, end, name_buf, sizeof(name_buf))) < 0)
+                return -1;
+            name_len = n;
+        }
+
+        if ((n = hpack_decode_string(&buf, end, value_buf, sizeof(value_buf))) < 0)
+            return -1;
+        value_len = n;
+
+        if ((b & 0x40) && hpack_table_add(t, name_buf, name_len, value_buf, value_len) < 0)
+            return -1;
+
+        cb(priv, name_buf, name_len, value_buf, value_len);
+    }
+
+    return 0;
+}
+
+/**
+ * Encode a prefixed integer, RFC 7541 5.1.
+ * @param out the output buffer.
+ * @param outlen the size of the output buffer.
+ * @param first the flag bits of the first byte.
+ * @param prefix the number of prefix bits.
+ * @param value the value to encode.
+ * @return the number of bytes written, 0 when the buffer is too small.
+ */
+static size_t hpack_encode_int(uint8_t *out, size_t outlen, uint8_t first, int prefix, uint32_t value)
+{
+    uint32_t mask = (1 << prefix) - 1;
+    size_t n = 0;
+
+    if (!outlen)
+        return 0;
+
+    if (value < mask) {
+        out[n++] = first | value;
+        return n;
+    }
+
+    out[n++] = first | mask;
+    value -= mask;
+    while (value >= 0x80) {
+        if (n == outlen)
+            return 0;
+        out[n++] = (value & 0x7f) | 0x80;
+        value >>= 7;
+    }
+
+    if (n == outlen)
+        return 0;
+    out[n++] = value;
+
+    return n;
+}
+
+/**
+ * Encode a raw string literal.
+ * @return the number of bytes written, 0 when the buffer is too small.
+ */
+static size_t hpack_encode_string(uint8_t *out, size_t outlen, const char *str)
+{
+    size_t len = strlen(str);
+    size_t n = hpack_encode_int(out, outlen, 0x00, 7, len);
+
+    if (!n || n + len > outlen)
+        return 0;
+
+    memcpy(out + n, str, len);
+    return n + len;
+}
+
+/**
+ * Encode a header field as a literal without indexing, the name is
+ * taken from the static table when possible. The encoder never uses
+ * the dynamic table so the peer does not need to keep state for us.
+ * @param out the output buffer.
+ * @param outlen the size of the output buffer.
+ * @param name the lowercase header name.
+ * @param value the header value.
+ * @return the number of bytes written, 0 when the buffer is too small.
+ */
+size_t hpack_encode_header(uint8_t *out, size_t outlen, const char *name, const char *value)
+{
+    int i, name_index = 0;
+    size_t n, m;
+
+    for (i = 1; i <= HPACK_STATIC_ENTRIES; ++i) {
+        if (strcmp(static_table[i].name, name))
+            continue;
+
+        /* Fully indexed field, used for the common status codes */
+        if (!strcmp(static_table[i].value, value) && *value)
+            return hpack_encode_int(out, outlen, 0x80, 7, i);
+
+        if (!name_index)
+            name_index = i;
+    }
+
+    if (name_index) {
+        n = hpack_encode_int(out, outlen, 0x00, 4, name_index);
+    } else {
+        n = hpack_encode_int(out, outlen, 0x00, 4, 0);
+        if (n) {
+            m = hpack_encode_string(out + n, outlen - n, name);
+            n = m ? n + m : 0;
+        }
+    }
+
+    if (!n)
+        return 0;
+
+    m = hpack_encode_string(out + n, outlen - n, value);
+    return m ? n + m : 0;
+}
@@ -0,0 +1,102 @@
+/* 
+ * Copyright (c) 2014, Daan Pape
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without 
+ * modification, are permitted provided that the following conditions are met:
+ * 
+ *     1. Redistributions of source code must retain the above copyright 
+ *        notice, this list of conditions and the following disclaimer.
+ *
+ *     2. Redistributions in binary form must reproduce the above copyright 
+ *        notice, this list of conditions and the following disclaimer in the 
+ *        documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" 
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE 
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE 
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE 
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR 
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF 
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS 
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN 
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) 
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE 
+ * POSSIBILITY OF SUCH DAMAGE.
+ * 
+ * File:   hpack.h
+ * Created on October 18, 2026, 11:04 AM
+ */
+
+#ifndef HPACK_H_
+#define HPACK_H_
+
+#include <stdint.h>
+#include <stddef.h>
+
+#define HPACK_MAX_ENTRIES       128     /* Maximum number of dynamic table entries (4096 / 32) */
+#define HPACK_MAX_STRING        8192    /* Maximum length of a decoded header name or value */
+
+/**
+ * Entry in the HPACK dynamic table.
+ */
+struct hpack_entry {
+    char *name;                     /* The header name, the value follows in the same allocation */
+    char *value;                    /* The header value */
+    uint32_t name_len;              /* The length of the name */
+    uint32_t value_len;             /* The length of the value */
+};
+
+/**
+ * HPACK dynamic table of the decoder, the newest entry is at index 0.
+ */
+struct hpack_table {
+    struct hpack_entry entries[HPACK_MAX_ENTRIES];
+    int count;                      /* The number of entries */
+    size_t size;                    /* The size of the table as defined in RFC 7541 4.1 */
+    size_t max_size;                /* The maximum size set by the encoder */
+    size_t limit;                   /* The maximum size we advertised */
+};
+
+/**
+ * Callback for every decoded header field.
+ */
+typedef void (*hpack_header_cb)(void *priv, const char *name, size_t name_len, const char *value, size_t value_len);
+
+/**
+ * Initialize a decoder dynamic table.
+ * @param t the table to initialize.
+ * @param limit the SETTINGS_HEADER_TABLE_SIZE advertised to the peer.
+ */
+void hpack_table_init(struct hpack_table *t, size_t limit);
+
+/**
+ * Free all entries of a dynamic table.
+ * @param t the table to free.
+ */
+void hpack_table_free(struct hpack_table *t);
+
+/**
+ * Decode a complete header block.
+ * @param t the dynamic table of the connection.
+ * @param buf the header block.
+ * @param len the length of the header block.
+ * @param cb called for every header field.
+ * @param priv passed to the callback.
+ * @return 0 on success, -1 on a compression error.
+ */
+int hpack_decode(struct hpack_table *t, const uint8_t *buf, size_t len, hpack_header_cb cb, void *priv);
+
+/**
+ * Encode a header field as a literal without indexing, the name is
+ * taken from the static table when possible. The encoder never uses
+ * the dynamic table so the peer does not need to keep state for us.
+ * @param out the output buffer.
+ * @param outlen the size of the output buffer.
+ * @param name the lowercase header name.
+ * @param value the header value.
+ * @return the number of bytes written, 0 when the buffer is too small.
+ */
+size_t hpack_encode_header(uint8_t *out, size_t outlen, const char *name, const char *value);
+
+#endif /* HPACK_H_ */
@@ -36,6 +36,7 @@ c
 #include "kunio.h"
 #include "../gpio/gpio.h"
 #include "../config.h"
+#include "../logger.h"
 #include "../combus/spi.h"
 
 #define BYTETOBINARYPATTERN "%d%d%d%d%d%d%d%d"
@@ -56,17 +57,19 @@ c
  */
 void alfa_set_output(uint8_t state[], uint8_t size)
 {
-	/* The SPI device pointer */
-	int dev;
+	/* The SPI device */
+	spi_handle *spi;
 
 	/* Disable outputs */
 	gpio_write_and_close(ALFA_ENABLE_PORT, 1);
 
 	/* Initialize the SPI device for the AlfaIO module */
-	dev = spi_init(0, 8, 2500);
+	spi = spi_init(0, 8, 2500);
 
 	/* Send the bytes */
-	spi_data_send_8(dev, state, size);
+	if(spi != NULL) {
+		spi_data_send_8(spi, state, size);
+	}
 
 	/* Hold time */
 	usleep(1);
@@ -84,12 +87,15 @@ void alfa_set_output(uint8_t state[], uint8_t size)
  */
 alfadata* alfa_read_input()
 {
-	/* The SPI device pointer */
-	int dev;
-	spidata_8 *data;
+	/* The SPI device */
+	spi_handle *spi;
+	uint8_t data = 0;
 
 	/* Initialize the SPI device for the AlfaIO module */
-	dev = spi_init(0, 8, 2500);
+	spi = spi_init(0, 8, 2500);
+	if(spi == NULL) {
+		return NULL;
+	}
 
 	/* Enable the clock (active low) */
 	gpio_write_and_close(ALFA_CLK_INH_PORT, 0);
@@ -101,14 +107,11 @@ alfadata* alfa_read_input()
 	usleep(1);
 
 	/* Read the data input */
-	data = spi_data_read_8(dev, 1);
+	if(spi_data_read_8(spi, &data, 1) != 0) {
+		return NULL;
+	}
 
-	/* DEBUG DEBUG DEBUG */
-	printf("received binary: "BYTETOBINARYPATTERN", received dec: %d\r\n", BYTETOBINARY(data->data[0]), data->data[0]);
-	/* DEBUG DEBUG DEBUG */
-
-	free(data->data);
-	free(data);
+	log_message(LOG_DEBUG, "received binary: "BYTETOBINARYPATTERN", received dec: %d\r\n", BYTETOBINARY(data), data);
 
 	return NULL;
 }
@@ -30,6 +30,8 @@
 
 #include <sys/types.h>
 #include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
 #include <netinet/tcp.h>
 #include <netdb.h>
 #include <stdbool.h>
@@ -38,6 +40,7 @@
 #include "uhttpd.h"
 #include "client.h"
 #include "config.h"
+#include "stall.h"
 
 /**
  * Listener structure
@@ -49,14 +52,16 @@ struct listener {
     int n_clients;              /* The number of clients */
     struct sockaddr_in6 addr;   /* The IPv6 socket address */
     bool tls;                   /* Flag for SSL support */
+    bool local;                 /* True for a unix domain socket */
+    char *path;                 /* The socket file of a unix domain socket */
     bool blocked;               /* True if this listener is blocked */
 };
 
 /* The list of listeners */
 static LIST_HEAD(listeners);
 
-/* The number of blocked clients */
-static int n_blocked;
+/* The number of blocked listeners */
+int n_blocked;
 
 /**
  * Close all listening sockets
@@ -69,12 +74,26 @@ void close_listeners(void) {
     close(l->fd.fd);
 }
 
+/**
+ * Remove the socket files of the unix domain listeners, on shutdown.
+ */
+void unlink_listeners(void) {
+    struct listener *l;
+
+    list_for_each_entry(l, &listeners, list) {
+        if (l->path) {
+            unlink(l->path);
+        }
+    }
+}
+
 /**
  * If there is room for new connections unblock them
  * until the queue is full again.
  */
 static void uh_poll_listeners(struct uloop_timeout *timeout) {
     struct listener *l;
+    STALL_SCOPE("timer", "listener poll");
 
     /* Check if there is room for new connections */
     if ((!n_blocked && conf->max_connections) || n_clients >= conf->max_connections) {
@@ -115,10 +134,11 @@ void unblock_listeners(void) {
 static void new_client_event(struct uloop_fd *fd, unsigned int events) {
     /* Get the listener that raised the event */
     struct listener *l = container_of(fd, struct listener, fd);
+    STALL_SCOPE("accept", NULL);
 
     /* Accept all clients */
     while (1) {
-        if (!accept_client(fd->fd, l->tls))
+        if (!accept_client(fd->fd, l->tls, l->local))
             break;
     }
 
@@ -143,7 +163,7 @@ void setup_listeners(void) {
         int sock = l->fd.fd;
 
         /* Set up TCP Keep Alive for Linux */
-        if (conf->keep_alive_time > 0) {
+        if (!l->local && conf->keep_alive_time > 0) {
             int tcp_ka_idl, tcp_ka_int, tcp_ka_cnt;
 
             tcp_ka_idl = 1;
@@ -253,3 +273,81 @@ error:
     freeaddrinfo(addrs);
     return true;
 }
+
+/**
+ * Bind a unix domain socket to listen for requests from local processes.
+ * A stale socket file left at the path is removed first, any other file
+ * is kept and the bind fails.
+ * @path the filesystem path of the socket
+ * @mode the permissions of the socket file
+ */
+bool bind_unix_listener_socket(const char *path, mode_t mode) {
+    int sock;
+    int err;
+    mode_t old_mask;
+    struct stat st;
+    struct listener *l;
+    struct sockaddr_un addr = {
+        .sun_family = AF_UNIX,
+    };
+
+    /* The path must fit in the socket address */
+    if (strlen(path) >= sizeof (addr.sun_path)) {
+        fprintf(stderr, "unix socket path too long: %s\n", path);
+        return false;
+    }
+    strcpy(addr.sun_path, path);
+
+    /* Create the socket */
+    sock = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (sock < 0) {
+        perror("socket()");
+        return false;
+    }
+
+    /* Remove a socket of a previous run, never a file that is no socket */
+    if (lstat(path, &st) == 0) {
+        if (!S_ISSOCK(st.st_mode)) {
+            fprintf(stderr, "not a unix socket: %s\n", path);
+            goto error;
+        }
+        unlink(path);
+    }
+
+    /* 
+     * Restrict the processes that can connect, the socket file is created
+     * with the mode so it is never open to others. No other thread runs yet
+     * to see the umask.
+     */
+    old_mask = umask(~mode & 0777);
+    err = bind(sock, (struct sockaddr *) &addr, sizeof (addr));
+    umask(old_mask);
+    if (err < 0) {
+        perror("bind()");
+        goto error;
+    }
+
+    /* Make a server socket  */
+    if (listen(sock, UH_LIMIT_CLIENTS) < 0) {
+        perror("listen()");
+        goto error;
+    }
+
+    fd_cloexec(sock);
+
+    /* Reserve memory space for the listener */
+    l = calloc(1, sizeof (*l));
+    if (!l) {
+        goto error;
+    }
+
+    l->fd.fd = sock;
+    l->local = true;
+    l->path = strdup(path);
+    list_add_tail(&l->list, &listeners);
+    return true;
+
+error:
+    close(sock);
+    return false;
+}
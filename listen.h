@@ -32,6 +32,10 @@
 #define LISTEN_H_
 
 #include <stdbool.h>
+#include <sys/types.h>
+
+/* The number of blocked listeners */
+extern int n_blocked;
 
 /**
  * Bind a socket to listen from request on a given host on a given host.
@@ -41,6 +45,13 @@
  */
 bool bind_listener_sockets(const char *host, const char *port, bool tls);
 
+/**
+ * Bind a unix domain socket to listen for requests from local processes.
+ * @path the filesystem path of the socket.
+ * @mode the permissions of the socket file.
+ */
+bool bind_unix_listener_socket(const char *path, mode_t mode);
+
 /**
  * Setup all listeners in the listener list and
  * bind them to the uloop event system.
@@ -57,4 +68,9 @@ void unblock_listeners(void);
  */
 void close_listeners(void);
 
+/**
+ * Remove the socket files of the unix domain listeners, on shutdown.
+ */
+void unlink_listeners(void);
+
 #endif /* LISTEN_H_ */
@@ -30,31 +30,400 @@
 
 #include <stdio.h>
 #include <stdarg.h>
+#include <stdbool.h>
+#include <stdlib.h>
 #include <time.h>
 #include <string.h>
+#include <strings.h>
+#include <pthread.h>
+#include <semaphore.h>
 
+#include "config.h"
 #include "logger.h"
+#include "trace.h"
+
+#define LOG_RING_MASK (LOG_RING_SLOTS - 1)
+
+/**
+ * A message in the log ring, the sequence number tells
+ * producers and the log thread who owns the slot.
+ */
+struct log_slot {
+    unsigned int seq;           /* Slot position + 1 when filled, position when free */
+    int level;                  /* The loglevel of the message */
+    time_t time;                /* Time the message was logged */
+    char line[LOG_LINE_MAX];    /* The formatted message */
+};
+
+/* Names of the loglevels, indexed by level */
+static const char * const log_levels[] = {
+    [LOG_ERROR] = "ERROR",
+    [LOG_WARNING] = "WARNING",
+    [LOG_INFO] = "INFO",
+    [LOG_DEBUG] = "DEBUG",
+};
+
+/* Messages with a level above this threshold are discarded */
+int log_threshold = LOG_DEBUG;
+
+/* Messages with a level above this threshold are not written as text */
+static int log_level = LOG_DEBUG;
+
+/* The log ring, filled by any thread and emptied by the log thread */
+static struct log_slot log_ring[LOG_RING_SLOTS];
+
+/* Next position to be claimed by a producer */
+static unsigned int log_head;
+
+/* Next position to be written by the log thread */
+static unsigned int log_tail;
+
+/* Number of messages dropped because the ring was full */
+static unsigned int log_dropped;
+
+/* Wakes the log thread */
+static sem_t log_sem;
+
+/* The log thread */
+static pthread_t log_thread;
+
+/* True while the log thread runs */
+static bool log_running;
+
+/* True when the log thread must stop */
+static bool log_stop;
+
+/**
+ * Output buffer for one stream of the log thread.
+ */
+struct log_out {
+    FILE *stream;
+    size_t len;
+    char buf[4096];
+};
+
+/**
+ * Write the buffered lines of an output.
+ * @param out the output to flush
+ */
+static void log_out_flush(struct log_out *out)
+{
+    if (out->len) {
+        fwrite(out->buf, 1, out->len, out->stream);
+        fflush(out->stream);
+        out->len = 0;
+    }
+}
+
+/**
+ * Format a message with its level and timestamp into an output.
+ * @param out the output buffer
+ * @param level the loglevel
+ * @param tm the time of the message
+ * @param line the message
+ */
+static void log_out_line(struct log_out *out, int level, const struct tm *tm, const char *line)
+{
+    char prefix[64];
+    size_t plen = snprintf(prefix, sizeof(prefix), "[%s][%d-%d-%d %d:%d:%d] ", log_levels[level],
+            tm->tm_year + 1900, tm->tm_mon + 1, tm->tm_mday, tm->tm_hour, tm->tm_min, tm->tm_sec);
+    size_t llen = strlen(line);
+
+    if (out->len + plen + llen > sizeof(out->buf))
+        log_out_flush(out);
+
+    /* Lines that never fit the buffer are written directly */
+    if (plen + llen > sizeof(out->buf)) {
+        fputs(prefix, out->stream);
+        fputs(line, out->stream);
+        return;
+    }
+
+    memcpy(out->buf + out->len, prefix, plen);
+    memcpy(out->buf + out->len + plen, line, llen);
+    out->len += plen + llen;
+}
 
 /**
- * Log message
- * @param level the loglevel to use
- * @format the format string
- * @args the arguments to log
+ * Log a message immediately, used when the log thread does not run.
+ * @param level the loglevel
+ * @param line the message
  */
-void log_message(const char* level, const char *format, ...)
+static void log_sync(int level, const char *line)
 {
     time_t t = time(NULL);
-    struct tm tm = *localtime(&t);
+    struct tm tm;
+    struct log_out out = {
+        .stream = level == LOG_ERROR ? stdout : stderr,
+    };
+
+    localtime_r(&t, &tm);
+    log_out_line(&out, level, &tm, line);
+    log_out_flush(&out);
+}
+
+/**
+ * Claim a free slot in the log ring.
+ * @param claimed the claimed ring position
+ * @return the slot, NULL when the ring is full
+ */
+static struct log_slot* log_claim(unsigned int *claimed)
+{
+    unsigned int pos = __atomic_load_n(&log_head, __ATOMIC_RELAXED);
+    struct log_slot *slot;
+    int diff;
+
+    while (1) {
+        slot = &log_ring[pos & LOG_RING_MASK];
+        diff = (int) (__atomic_load_n(&slot->seq, __ATOMIC_ACQUIRE) - pos);
+
+        if (diff == 0) {
+            /* The slot is free, try to claim the position */
+            if (__atomic_compare_exchange_n(&log_head, &pos, pos + 1, true,
+                    __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+                *claimed = pos;
+                return slot;
+            }
+        } else if (diff < 0) {
+            /* The log thread did not free the slot yet */
+            return NULL;
+        } else {
+            /* Another producer claimed the position */
+            pos = __atomic_load_n(&log_head, __ATOMIC_RELAXED);
+        }
+    }
+}
+
+/**
+ * Queue a formatted message for the log thread.
+ * @param level the loglevel
+ * @param format the format string
+ * @param args the arguments of the format string
+ */
+static void log_queue(int level, const char *format, va_list args)
+{
+    struct log_slot *slot;
+    unsigned int pos;
+
+    if (!__atomic_load_n(&log_running, __ATOMIC_ACQUIRE)) {
+        char line[LOG_LINE_MAX];
+
+        vsnprintf(line, sizeof(line), format, args);
+        log_sync(level, line);
+        return;
+    }
+
+    slot = log_claim(&pos);
+    if (!slot) {
+        __atomic_fetch_add(&log_dropped, 1, __ATOMIC_RELAXED);
+        return;
+    }
+
+    slot->level = level;
+    slot->time = time(NULL);
+    vsnprintf(slot->line, sizeof(slot->line), format, args);
+
+    /* Publish the slot to the log thread */
+    __atomic_store_n(&slot->seq, pos + 1, __ATOMIC_RELEASE);
+    sem_post(&log_sem);
+}
+
+/**
+ * Write a message to the log and the trace, use log_message instead.
+ * @param site the call site of the message
+ * @args the arguments of the format string
+ */
+void log_write(struct log_site *site, ...)
+{
     va_list args;
-    va_start(args, format);
-    
-    if(strcmp(level, LOG_ERROR) != 0){
-        fprintf(stderr, level, tm.tm_year + 1900, tm.tm_mon + 1, tm.tm_mday, tm.tm_hour, tm.tm_min, tm.tm_sec);
-        vfprintf(stderr, format, args);
-    } else {
-        printf(level, tm.tm_year + 1900, tm.tm_mon + 1, tm.tm_mday, tm.tm_hour, tm.tm_min, tm.tm_sec);
-        vprintf(format, args);
+
+    if (site->level <= trace_level) {
+        va_start(args, site);
+        trace_vwrite(site, args);
+        va_end(args);
+    }
+
+    if (site->level <= log_level) {
+        va_start(args, site);
+        log_queue(site->level, site->format, args);
+        va_end(args);
     }
+}
 
+/**
+ * Queue a message for the log thread.
+ * @param level the loglevel
+ * @param format the format string
+ * @args the arguments of the format string
+ */
+static void log_queue_line(int level, const char *format, ...)
+{
+    va_list args;
+
+    va_start(args, format);
+    log_queue(level, format, args);
     va_end(args);
 }
+
+/**
+ * Write a hexdump to the log and the trace, use log_hexdump instead.
+ * @param site the call site of the hexdump
+ * @param buf the bytes to log
+ * @param len the number of bytes
+ */
+void log_write_hex(struct log_site *site, const uint8_t *buf, int len)
+{
+    char hex[LOG_LINE_MAX / 2];
+    int i, n = 0;
+
+    if (site->level <= trace_level)
+        trace_write_blob(site, buf, len);
+
+    if (site->level > log_level)
+        return;
+
+    for (i = 0; i < len && n + 4 < (int) sizeof(hex); ++i)
+        n += sprintf(hex + n, "%02x ", buf[i]);
+    hex[n] = 0;
+
+    log_queue_line(site->level, "%s[ %s]\r\n", site->format, hex);
+}
+
+/**
+ * Parse a loglevel name (error, warning, info or debug).
+ * @param name the name of the level
+ * @return the loglevel, -1 for an unknown name
+ */
+int log_level_parse(const char *name)
+{
+    int i;
+
+    for (i = LOG_ERROR; i <= LOG_DEBUG; ++i) {
+        if (strcasecmp(name, log_levels[i]) == 0)
+            return i;
+    }
+
+    return -1;
+}
+
+/**
+ * Write all messages in the ring in batches.
+ * @param out the outputs for errors and other messages
+ * @return true when messages were written
+ */
+static bool log_drain(struct log_out *out)
+{
+    static time_t last;
+    static struct tm tm;
+    struct log_slot *slot;
+    unsigned int dropped;
+    bool written = false;
+
+    while (1) {
+        slot = &log_ring[log_tail & LOG_RING_MASK];
+        if (__atomic_load_n(&slot->seq, __ATOMIC_ACQUIRE) != log_tail + 1)
+            break;
+
+        /* Only convert the time when the second changed */
+        if (slot->time != last) {
+            last = slot->time;
+            localtime_r(&last, &tm);
+        }
+
+        log_out_line(&out[slot->level != LOG_ERROR], slot->level, &tm, slot->line);
+
+        /* Free the slot for the next round of the ring */
+        __atomic_store_n(&slot->seq, log_tail + LOG_RING_SLOTS, __ATOMIC_RELEASE);
+        ++log_tail;
+        written = true;
+    }
+
+    dropped = __atomic_exchange_n(&log_dropped, 0, __ATOMIC_RELAXED);
+    if (dropped) {
+        char line[64];
+
+        snprintf(line, sizeof(line), "Log ring full, dropped %u messages\r\n", dropped);
+        log_out_line(&out[1], LOG_WARNING, &tm, line);
+        written = true;
+    }
+
+    log_out_flush(&out[0]);
+    log_out_flush(&out[1]);
+    return written;
+}
+
+/**
+ * The log thread, writes queued messages until stopped.
+ * @param arg unused
+ */
+static void* log_thread_main(void *arg)
+{
+    static struct log_out out[2];
+
+    out[0].stream = stdout;
+    out[1].stream = stderr;
+
+    while (1) {
+        /* Collect everything that was queued while waiting */
+        while (sem_trywait(&log_sem) == 0)
+            ;
+
+        log_drain(out);
+
+        if (__atomic_load_n(&log_stop, __ATOMIC_ACQUIRE))
+            break;
+
+        sem_wait(&log_sem);
+    }
+
+    return NULL;
+}
+
+/**
+ * Start the log thread, messages are written synchronously
+ * until the thread runs. 
+ * @param level the loglevel threshold of the text log
+ * @return true when the log thread was started
+ */
+bool log_init(int level)
+{
+    unsigned int i;
+
+    log_level = level;
+    log_threshold = level > trace_level ? level : trace_level;
+
+    if (log_running)
+        return true;
+
+    for (i = 0; i < LOG_RING_SLOTS; ++i)
+        log_ring[i].seq = i;
+    log_head = log_tail = 0;
+    log_stop = false;
+
+    if (sem_init(&log_sem, 0, 0))
+        return false;
+
+    if (pthread_create(&log_thread, NULL, log_thread_main, NULL)) {
+        sem_destroy(&log_sem);
+        return false;
+    }
+
+    __atomic_store_n(&log_running, true, __ATOMIC_RELEASE);
+    atexit(log_close);
+    return true;
+}
+
+/**
+ * Write all queued messages and stop the log thread.
+ */
+void log_close(void)
+{
+    if (!log_running)
+        return;
+
+    __atomic_store_n(&log_running, false, __ATOMIC_RELEASE);
+    __atomic_store_n(&log_stop, true, __ATOMIC_RELEASE);
+    sem_post(&log_sem);
+    pthread_join(log_thread, NULL);
+    sem_destroy(&log_sem);
+}
@@ -31,18 +31,104 @@
 #ifndef LOGGER_H
 #define	LOGGER_H
 
-#define LOG_ERROR    "[ERROR][%d-%d-%d %d:%d:%d] "
-#define LOG_INFO     "[INFO][%d-%d-%d %d:%d:%d] "
-#define LOG_DEBUG    "[DEBUG][%d-%d-%d %d:%d:%d] "
-#define LOG_WARNING  "[WARNING][%d-%d-%d %d:%d:%d] "
+#include <stdbool.h>
+#include <stdint.h>
 
+#define LOG_ERROR    0
+#define LOG_WARNING  1
+#define LOG_INFO     2
+#define LOG_DEBUG    3
+
+/* Maximum number of arguments of a traced message */
+#define LOG_MAX_ARGS 8
 
 /**
- * Log message
+ * A log_message call site, every call site has one static descriptor.
+ * The descriptors are collected in the log_sites section so the trace
+ * file can describe all of them, the index in that section is the
+ * trace ID of the call site.
+ */
+struct log_site {
+    int level;                      /* The loglevel of the message */
+    const char *format;             /* The format string, the title of a hexdump */
+    const char *file;               /* The source file of the call site */
+    int line;                       /* The source line of the call site */
+    bool hexdump;                   /* True for a log_hexdump call site */
+    int id;                         /* Trace ID, assigned when tracing starts */
+    char args[LOG_MAX_ARGS + 1];    /* Argument types parsed from the format */
+};
+
+/* Messages with a level above this threshold are discarded */
+extern int log_threshold;
+
+/* Declare the descriptor of a call site and register it in the log_sites section */
+#define LOG_SITE(site, level, format, hexdump) \
+    static struct log_site site = { level, format, __FILE__, __LINE__, hexdump, 0, "" }; \
+    static struct log_site *site##_ref __attribute__((section("log_sites"), used)) = &site
+
+/**
+ * Log message, the arguments are not evaluated when the
+ * level is filtered out.
  * @param level the loglevel to use
  * @format the format string
  * @args the arguments to log
  */
-void log_message(const char* level, const char *format, ...);
+#define log_message(level, format, ...) \
+    do { \
+        if ((level) <= log_threshold) { \
+            LOG_SITE(log_site_, level, format, false); \
+            log_write(&log_site_, ##__VA_ARGS__); \
+        } \
+    } while (0)
+
+/**
+ * Log a buffer as a line of hexadecimal bytes.
+ * @param level the loglevel to use
+ * @param title the text in front of the bytes
+ * @param buf the bytes to log
+ * @param len the number of bytes
+ */
+#define log_hexdump(level, title, buf, len) \
+    do { \
+        if ((level) <= log_threshold) { \
+            LOG_SITE(log_site_, level, title, true); \
+            log_write_hex(&log_site_, buf, len); \
+        } \
+    } while (0)
+
+/**
+ * Write a message to the log and the trace, use log_message instead.
+ * @param site the call site of the message
+ * @args the arguments of the format string
+ */
+void log_write(struct log_site *site, ...);
+
+/**
+ * Write a hexdump to the log and the trace, use log_hexdump instead.
+ * @param site the call site of the hexdump
+ * @param buf the bytes to log
+ * @param len the number of bytes
+ */
+void log_write_hex(struct log_site *site, const uint8_t *buf, int len);
+
+/**
+ * Parse a loglevel name (error, warning, info or debug).
+ * @param name the name of the level
+ * @return the loglevel, -1 for an unknown name
+ */
+int log_level_parse(const char *name);
+
+/**
+ * Start the log thread, messages are written synchronously
+ * until the thread runs. 
+ * @param level the loglevel threshold of the text log
+ * @return true when the log thread was started
+ */
+bool log_init(int level);
+
+/**
+ * Write all queued messages and stop the log thread.
+ */
+void log_close(void);
 
 #endif
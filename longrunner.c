@@ -36,6 +36,7 @@
 
 #include "longrunner.h"
 #include "logger.h"
+#include "metrics.h"
 
 /**
  * Longrunner methods list
@@ -66,6 +67,7 @@ void longrunner_add(void* function, uint32_t timeout)
     longrunner_method* new_method =  (longrunner_method *) calloc(1, sizeof(longrunner_method));
     new_method->function = function;
     new_method->timeout_ms = timeout;
+    new_method->cycle = metrics_longrunner();
     l_anchor->next = new_method;
     l_anchor = new_method;
 }
@@ -109,7 +111,11 @@ void* longrunner_thread(void* args)
     
     while(true) {
         /* Run the longrunner task */
+        uint64_t start = metrics_now();
         function();
+        if (l_method->cycle) {
+            metrics_observe(l_method->cycle, metrics_now() - start);
+        }
         
         /* Wait for x ms after execution */
         usleep(l_method->timeout_ms*1000);
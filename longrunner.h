@@ -33,10 +33,13 @@
 
 #include <stdint.h>
 
+struct metrics_histogram;
+
 /* Linked list of longrunner methods */
 typedef struct l_method {
     void* function;             /* The longrunner function to execute */
     uint32_t timeout_ms;        /* Timeout to wait befor re-execution */
+    struct metrics_histogram* cycle; /* Cycle time metrics, NULL when not measured */
     struct l_method* next;    /* The next longrunner function */
 } longrunner_method;
 
@@ -35,6 +35,7 @@
 #include <sys/socket.h>
 #include <netinet/in.h>
 
+#include <stdio.h>
 #include <stdlib.h>
 #include <getopt.h>
 #include <errno.h>
@@ -51,15 +52,16 @@
 #include "api.h"
 #include "database/database.h"
 #include "logger.h"
+#include "trace.h"
+#include "stall.h"
 #include "longrunner.h"
+#include "tls.h"
+#include "gpio/gpio.h"
+#include "gpio/gpio_monitor.h"
+#include "gpio/gpio_counter.h"
 
 #include "wifi/wifi_longrunner.h"
 
-/**
- * The servers main working buffer.
- */
-char uh_buf[WORKING_BUFF_SIZE];
-
 /*
  * The UBUS connection context.
  */
@@ -74,11 +76,27 @@ int main(int argc, char **argv) {
     /* Current file descriptor for /dev/null */
     int cur_fd;
 
+    /* The configuration file, NULL for the default */
+    const char *config_file = NULL;
+    int opt;
+
     /* Prevent SIGPIPE errors */
     signal(SIGPIPE, SIG_IGN);
 
-    /* Load default configuration */
-    if (!load_configuration()) {
+    while ((opt = getopt(argc, argv, "c:")) != -1) {
+        switch (opt) {
+            case 'c':
+                config_file = optarg;
+                break;
+
+            default:
+                fprintf(stderr, "Usage: %s [-c configuration file]\n", argv[0]);
+                return EXIT_FAILURE;
+        }
+    }
+
+    /* Load configuration */
+    if (!load_configuration(config_file)) {
         return EXIT_FAILURE;
     }
 
@@ -108,6 +126,16 @@ int main(int argc, char **argv) {
         }
     }
 
+    /* Start logging from a background thread, after forking */
+    if (!log_init(conf->log_level)) {
+        log_message(LOG_WARNING, "Could not start the log thread, logging synchronously\r\n");
+    }
+
+    /* Start the binary trace when configured */
+    if (conf->trace_file && !trace_init(conf->trace_file, conf->trace_size, conf->trace_level)) {
+        log_message(LOG_WARNING, "Binary tracing is disabled\r\n");
+    }
+
     /* Initialize database */
     if (dao_create_db() != DB_OK) {
         /* The server can't run without database */
@@ -116,6 +144,9 @@ int main(int argc, char **argv) {
         return EXIT_FAILURE;
     }
 
+    /* Open the GPIO lines */
+    gpio_init();
+
     /* Initialize UBUS */
     ubus_ctx = ubus_connect(NULL);
     if (!ubus_ctx) {
@@ -131,21 +162,39 @@ int main(int argc, char **argv) {
     /* Initialize network event loop */
     uloop_init();
 
+    /* Mirror the GPIO inputs from their edges */
+    gpio_monitor_init();
+
+    /* Count the pulses of the configured inputs */
+    gpio_counter_init();
+
+    /* Watch the event loop for blocking callbacks */
+    if (conf->stall_threshold > 0 && !stall_init(conf->stall_threshold, conf->stall_backtrace)) {
+        log_message(LOG_WARNING, "Could not start the stall detector\r\n");
+    }
+
     /* Set up all listener sockets */
     setup_listeners();
 
     /* Start the network event loop */
     uloop_run();
 
+    /* Keep the pulses counted since the last save */
+    gpio_counter_done();
+
+    /* The local API socket is gone with the server */
+    unlink_listeners();
+
     return EXIT_SUCCESS;
 }
 
 /**
  * Create the server configuration and bind to socket.
+ * @file: the configuration file, NULL for the default.
  * @return: true if configuration was successful.
  */
-bool load_configuration(void) {
-    if (!config_parse()) {
+bool load_configuration(const char *file) {
+    if (!config_parse(file)) {
         log_message(LOG_ERROR, "Could not parse configuration file\r\n");
         return false;
     }
@@ -158,6 +207,31 @@ bool load_configuration(void) {
 
     log_message(LOG_INFO, "Breakout-server started listening on port %s\r\n", conf->listen_port);
 
+    /* Bind the local API socket when configured */
+    if (conf->unix_socket) {
+        if (!bind_unix_listener_socket(conf->unix_socket, conf->unix_socket_mode)) {
+            log_message(LOG_ERROR, "Could not bind unix socket %s\r\n", conf->unix_socket);
+            return false;
+        }
+
+        log_message(LOG_INFO, "Breakout-server started listening on %s\r\n", conf->unix_socket);
+    }
+
+    /* Bind a TLS socket to port when configured */
+    if (conf->tls_port) {
+        if (!uh_tls_init(conf->tls_cert, conf->tls_key)) {
+            log_message(LOG_ERROR, "Could not initialize TLS, is TLS support compiled in?\r\n");
+            return false;
+        }
+
+        if (!bind_listener_sockets(NULL, conf->tls_port, true)) {
+            log_message(LOG_ERROR, "Could not bind TLS socket to port %s\r\n", conf->tls_port);
+            return false;
+        }
+
+        log_message(LOG_INFO, "Breakout-server started listening for TLS on port %s\r\n", conf->tls_port);
+    }
+
     return true;
 }
 
@@ -36,9 +36,10 @@
 
 /**
  * Create the server configuration and bind to socket.
+ * @file: the configuration file, NULL for the default.
  * @return: true if configuration was successful.
  */
-bool load_configuration(void);
+bool load_configuration(const char *file);
 
 /**
  * Add all longrunner modules to the breakout-server
@@ -0,0 +1,485 @@
+/* 
+ * Copyright (c) 2014, Daan Pape
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without 
+ * modification, are permitted provided that the following conditions are met:
+ * 
+ *     1. Redistributions of source code must retain the above copyright 
+ *        notice, this list of conditions and the following disclaimer.
+ *
+ *     2. Redistributions in binary form must reproduce the above copyright 
+ *        notice, this list of conditions and the following disclaimer in the 
+ *        documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" 
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE 
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE 
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE 
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR 
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF 
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS 
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN 
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) 
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE 
+ * POSSIBILITY OF SUCH DAMAGE.
+ * 
+ * File:   metrics.c
+ * Created on October 18, 2026, 7:20 PM
+ */
+
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "uhttpd.h"
+#include "client.h"
+#include "listen.h"
+#include "metrics.h"
+#include "stall.h"
+
+/* Upper bounds of the histogram buckets in microseconds */
+static const uint32_t metrics_bounds[METRICS_BUCKETS] = {
+    100, 500, 1000, 2500, 5000, 10000, 25000, 50000, 100000, 250000, 1000000, 5000000
+};
+
+/* Names of the timed calls */
+static const char * const metrics_calls[] = {
+    [METRICS_CALL_SQLITE] = "sqlite",
+    [METRICS_CALL_GPIO] = "gpio",
+    [METRICS_CALL_SPI] = "spi",
+    [METRICS_CALL_I2C] = "i2c",
+};
+
+/* Names of the request phases */
+static const char * const metrics_phases[] = {
+    [METRICS_PHASE_CONNECT] = "connect",
+    [METRICS_PHASE_READ] = "read",
+    [METRICS_PHASE_HANDLER] = "handler",
+    [METRICS_PHASE_RESPOND] = "respond",
+    [METRICS_PHASE_SEND] = "send",
+    [METRICS_PHASE_TOTAL] = "total",
+};
+
+/* Exported quantiles of the request phases */
+static const double metrics_quantiles[] = { 0.5, 0.9, 0.99, 0.999 };
+
+/* The metrics registry */
+struct metrics metrics;
+
+/* The registered routes */
+static struct metrics_route metrics_routes[METRICS_MAX_ROUTES];
+static int n_routes;
+
+/* Requests that did not reach a route */
+static struct metrics_route metrics_other = {
+    .method = "ANY",
+    .name = "other",
+};
+
+/**
+ * Get the monotonic time.
+ * @return the time in microseconds.
+ */
+uint64_t metrics_now(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t) ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+/**
+ * Add an observation to a sum that carries into a second word when it wraps.
+ * @param sum the low word of the sum.
+ * @param wraps the number of times the low word wrapped.
+ * @param us the observed duration in microseconds.
+ */
+static void metrics_add_sum(metric_t *sum, metric_t *wraps, uint64_t us)
+{
+    metric_t value = us;
+
+    if (__atomic_fetch_add(sum, value, __ATOMIC_SEQ_CST) > ULONG_MAX - value)
+        __atomic_fetch_add(wraps, 1, __ATOMIC_SEQ_CST);
+}
+
+/**
+ * Get a sum kept by metrics_add_sum().
+ * @param sum the low word of the sum.
+ * @param wraps the number of times the low word wrapped.
+ * @return the sum in seconds.
+ */
+static double metrics_sum(const metric_t *sum, const metric_t *wraps)
+{
+    metric_t low, high;
+
+    /* Read again when the sum wrapped in between */
+    do {
+        high = __atomic_load_n(wraps, __ATOMIC_SEQ_CST);
+        low = __atomic_load_n(sum, __ATOMIC_SEQ_CST);
+    } while (high != __atomic_load_n(wraps, __ATOMIC_SEQ_CST));
+
+    return (high * ((double) ULONG_MAX + 1) + low) / 1e6;
+}
+
+/**
+ * Record an observation in a histogram.
+ * @param h the histogram.
+ * @param us the observed duration in microseconds.
+ */
+void metrics_observe(struct metrics_histogram *h, uint64_t us)
+{
+    int i;
+
+    for (i = 0; i < METRICS_BUCKETS && us > metrics_bounds[i]; ++i)
+        ;
+
+    metrics_add(&h->buckets[i], 1);
+    metrics_add(&h->count, 1);
+    metrics_add_sum(&h->sum_us, &h->sum_wraps, us);
+}
+
+/**
+ * Record the duration of a METRICS_TIME timer.
+ * @param timer the timer going out of scope.
+ */
+void metrics_timer_done(struct metrics_timer *timer)
+{
+    metrics_observe(timer->histogram, metrics_now() - timer->start);
+}
+
+/**
+ * Get the bucket of a value in a log-linear histogram.
+ * @param us the value in microseconds.
+ * @return the bucket index.
+ */
+static int metrics_hdr_index(uint64_t us)
+{
+    int bits;
+
+    if (us < METRICS_HDR_SUB)
+        return us;
+
+    bits = 63 - __builtin_clzll(us);
+    if (bits >= METRICS_HDR_MAX_BITS)
+        return METRICS_HDR_BUCKETS - 1;
+
+    return (bits - METRICS_HDR_SUB_BITS + 1) * METRICS_HDR_SUB +
+        (us >> (bits - METRICS_HDR_SUB_BITS)) - METRICS_HDR_SUB;
+}
+
+/**
+ * Get the highest value that falls in a bucket of a log-linear histogram.
+ * @param i the bucket index.
+ * @return the value in microseconds.
+ */
+static uint64_t metrics_hdr_value(int i)
+{
+    int shift;
+
+    if (i < METRICS_HDR_SUB)
+        return i;
+
+    shift = i / METRICS_HDR_SUB - 1;
+    return ((uint64_t) (METRICS_HDR_SUB + i % METRICS_HDR_SUB + 1) << shift) - 1;
+}
+
+/**
+ * Record an observation in a log-linear histogram.
+ * @param h the histogram.
+ * @param us the observed duration in microseconds.
+ */
+void metrics_hdr_observe(struct metrics_hdr *h, uint64_t us)
+{
+    metric_t max = __atomic_load_n(&h->max_us, __ATOMIC_RELAXED);
+
+    metrics_add(&h->buckets[metrics_hdr_index(us)], 1);
+    metrics_add(&h->count, 1);
+    metrics_add_sum(&h->sum_us, &h->sum_wraps, us);
+
+    while (us > max && !__atomic_compare_exchange_n(&h->max_us, &max, us, true,
+            __ATOMIC_RELAXED, __ATOMIC_RELAXED))
+        ;
+}
+
+/**
+ * Get a quantile of a log-linear histogram.
+ * @param h the histogram.
+ * @param q the quantile between 0 and 1.
+ * @return the quantile in microseconds, 0 when the histogram is empty.
+ */
+uint64_t metrics_hdr_quantile(struct metrics_hdr *h, double q)
+{
+    metric_t count = 0, total = 0, rank;
+    uint64_t max = __atomic_load_n(&h->max_us, __ATOMIC_RELAXED);
+    uint64_t value;
+    int i;
+
+    /* Sum the buckets instead of using the counter so the rank is always reached */
+    for (i = 0; i < METRICS_HDR_BUCKETS; ++i)
+        total += __atomic_load_n(&h->buckets[i], __ATOMIC_RELAXED);
+    if (!total)
+        return 0;
+
+    rank = q * total + 0.5;
+    if (rank < 1)
+        rank = 1;
+
+    for (i = 0; i < METRICS_HDR_BUCKETS - 1; ++i) {
+        count += __atomic_load_n(&h->buckets[i], __ATOMIC_RELAXED);
+        if (count >= rank)
+            break;
+    }
+
+    value = metrics_hdr_value(i);
+    return value < max ? value : max;
+}
+
+/**
+ * Record the phases of a finished request.
+ * @param t the time stamps of the request.
+ * @param flushed the time the response was written to the socket.
+ */
+void metrics_timing(const struct metrics_timing *t, uint64_t flushed)
+{
+    struct metrics_hdr *phases = metrics.phases;
+
+    /* Only requests read from a socket have a first byte */
+    if (!t->first_byte || !t->header || !t->done)
+        return;
+
+    if (t->accept)
+        metrics_hdr_observe(&phases[METRICS_PHASE_CONNECT], t->first_byte - t->accept);
+    metrics_hdr_observe(&phases[METRICS_PHASE_READ], t->header - t->first_byte);
+    if (t->handler_start && t->handler_end) {
+        metrics_hdr_observe(&phases[METRICS_PHASE_HANDLER], t->handler_end - t->handler_start);
+        metrics_hdr_observe(&phases[METRICS_PHASE_RESPOND], t->done - t->handler_end);
+    }
+    metrics_hdr_observe(&phases[METRICS_PHASE_SEND], flushed - t->done);
+    metrics_hdr_observe(&phases[METRICS_PHASE_TOTAL], flushed - t->first_byte);
+}
+
+/**
+ * Get the metrics of a route, the route is registered on first use.
+ * Routes are only registered from the event loop.
+ * @param key unique key of the route, the handler table entry.
+ * @param method the HTTP method label.
+ * @param name the route label.
+ * @return the route metrics.
+ */
+struct metrics_route* metrics_route(const void *key, const char *method, const char *name)
+{
+    struct metrics_route *route;
+    int i;
+
+    for (i = 0; i < n_routes; ++i) {
+        if (metrics_routes[i].key == key)
+            return &metrics_routes[i];
+    }
+
+    if (n_routes == METRICS_MAX_ROUTES)
+        return &metrics_other;
+
+    route = &metrics_routes[n_routes++];
+    route->key = key;
+    route->method = method;
+    route->name = name;
+    return route;
+}
+
+/**
+ * Get the cycle time histogram of a new longrunner.
+ * @return the histogram, NULL when there are too many longrunners.
+ */
+struct metrics_histogram* metrics_longrunner(void)
+{
+    if (metrics.n_longrunners == METRICS_MAX_LONGRUNNERS)
+        return NULL;
+
+    return &metrics.longrunners[metrics.n_longrunners++];
+}
+
+/**
+ * Record a finished request.
+ * @param route the route of the request, NULL when it had none.
+ * @param status the HTTP status code of the response.
+ * @param us the time the request took in microseconds.
+ */
+void metrics_request(struct metrics_route *route, int status, uint64_t us)
+{
+    if (!route)
+        route = &metrics_other;
+
+    if (status >= 100 && status < 600)
+        metrics_add(&route->status[status / 100 - 1], 1);
+
+    metrics_observe(&route->latency, us);
+}
+
+/**
+ * Write the series of a histogram.
+ * @param f the output.
+ * @param name the metric name.
+ * @param labels the labels of the histogram, without braces.
+ * @param h the histogram.
+ */
+static void metrics_print_histogram(FILE *f, const char *name, const char *labels, struct metrics_histogram *h)
+{
+    metric_t total = 0;
+    int i;
+
+    for (i = 0; i < METRICS_BUCKETS; ++i) {
+        total += __atomic_load_n(&h->buckets[i], __ATOMIC_RELAXED);
+        fprintf(f, "%s_bucket{%s,le=\"%g\"} %lu\n", name, labels, metrics_bounds[i] / 1e6, total);
+    }
+    total += __atomic_load_n(&h->buckets[i], __ATOMIC_RELAXED);
+    fprintf(f, "%s_bucket{%s,le=\"+Inf\"} %lu\n", name, labels, total);
+    fprintf(f, "%s_sum{%s} %.6f\n", name, labels, metrics_sum(&h->sum_us, &h->sum_wraps));
+    fprintf(f, "%s_count{%s} %lu\n", name, labels, total);
+}
+
+/**
+ * Write the series of a log-linear histogram as a summary.
+ * @param f the output.
+ * @param name the metric name.
+ * @param labels the labels of the summary, without braces.
+ * @param h the histogram.
+ */
+static void metrics_print_summary(FILE *f, const char *name, const char *labels, struct metrics_hdr *h)
+{
+    int i;
+
+    for (i = 0; i < array_size(metrics_quantiles); ++i) {
+        fprintf(f, "%s{%s,quantile=\"%g\"} %g\n", name, labels, metrics_quantiles[i],
+            metrics_hdr_quantile(h, metrics_quantiles[i]) / 1e6);
+    }
+    fprintf(f, "%s_sum{%s} %.6f\n", name, labels, metrics_sum(&h->sum_us, &h->sum_wraps));
+    fprintf(f, "%s_count{%s} %lu\n", name, labels, __atomic_load_n(&h->count, __ATOMIC_RELAXED));
+}
+
+/**
+ * Write the metrics of a route.
+ * @param f the output.
+ * @param route the route.
+ * @param requests true for the request counters, false for the latency.
+ */
+static void metrics_print_route(FILE *f, struct metrics_route *route, bool requests)
+{
+    char labels[128];
+    int i;
+
+    snprintf(labels, sizeof(labels), "method=\"%s\",route=\"%s\"", route->method, route->name);
+
+    if (!requests) {
+        metrics_print_histogram(f, "breakout_http_request_duration_seconds", labels, &route->latency);
+        return;
+    }
+
+    for (i = 0; i < 5; ++i) {
+        metric_t n = __atomic_load_n(&route->status[i], __ATOMIC_RELAXED);
+
+        if (n)
+            fprintf(f, "breakout_http_requests_total{%s,code=\"%dxx\"} %lu\n", labels, i + 1, n);
+    }
+}
+
+/**
+ * Write all metrics in the Prometheus text format.
+ * @param f the output.
+ */
+static void metrics_print(FILE *f)
+{
+    char labels[64];
+    int i;
+
+    fprintf(f, "# HELP breakout_http_requests_total HTTP responses by route and status class.\n");
+    fprintf(f, "# TYPE breakout_http_requests_total counter\n");
+    for (i = 0; i < n_routes; ++i)
+        metrics_print_route(f, &metrics_routes[i], true);
+    metrics_print_route(f, &metrics_other, true);
+
+    fprintf(f, "# HELP breakout_http_request_duration_seconds Time from request header to response.\n");
+    fprintf(f, "# TYPE breakout_http_request_duration_seconds histogram\n");
+    for (i = 0; i < n_routes; ++i)
+        metrics_print_route(f, &metrics_routes[i], false);
+    metrics_print_route(f, &metrics_other, false);
+
+    fprintf(f, "# HELP breakout_http_request_phase_seconds Time spent in each phase of a request.\n");
+    fprintf(f, "# TYPE breakout_http_request_phase_seconds summary\n");
+    for (i = 0; i < __METRICS_PHASE_MAX; ++i) {
+        snprintf(labels, sizeof(labels), "phase=\"%s\"", metrics_phases[i]);
+        metrics_print_summary(f, "breakout_http_request_phase_seconds", labels, &metrics.phases[i]);
+    }
+    fprintf(f, "# HELP breakout_http_request_phase_max_seconds Longest observed time of each phase of a request.\n");
+    fprintf(f, "# TYPE breakout_http_request_phase_max_seconds gauge\n");
+    for (i = 0; i < __METRICS_PHASE_MAX; ++i) {
+        fprintf(f, "breakout_http_request_phase_max_seconds{phase=\"%s\"} %g\n", metrics_phases[i],
+            __atomic_load_n(&metrics.phases[i].max_us, __ATOMIC_RELAXED) / 1e6);
+    }
+
+    fprintf(f, "# HELP breakout_bytes_received_total Bytes read from client sockets.\n");
+    fprintf(f, "# TYPE breakout_bytes_received_total counter\n");
+    fprintf(f, "breakout_bytes_received_total %lu\n", __atomic_load_n(&metrics.bytes_in, __ATOMIC_RELAXED));
+    fprintf(f, "# HELP breakout_bytes_sent_total Bytes written to client sockets.\n");
+    fprintf(f, "# TYPE breakout_bytes_sent_total counter\n");
+    fprintf(f, "breakout_bytes_sent_total %lu\n", __atomic_load_n(&metrics.bytes_out, __ATOMIC_RELAXED));
+
+    fprintf(f, "# HELP breakout_connections_accepted_total Accepted client connections.\n");
+    fprintf(f, "# TYPE breakout_connections_accepted_total counter\n");
+    fprintf(f, "breakout_connections_accepted_total %lu\n", __atomic_load_n(&metrics.connections, __ATOMIC_RELAXED));
+    fprintf(f, "# HELP breakout_connections_active Connected clients.\n");
+    fprintf(f, "# TYPE breakout_connections_active gauge\n");
+    fprintf(f, "breakout_connections_active %d\n", n_clients);
+    fprintf(f, "# HELP breakout_listeners_blocked Listeners not accepting because of the connection limit.\n");
+    fprintf(f, "# TYPE breakout_listeners_blocked gauge\n");
+    fprintf(f, "breakout_listeners_blocked %d\n", n_blocked);
+
+    fprintf(f, "# HELP breakout_longrunner_cycle_seconds Duration of one longrunner cycle.\n");
+    fprintf(f, "# TYPE breakout_longrunner_cycle_seconds histogram\n");
+    for (i = 0; i < metrics.n_longrunners; ++i) {
+        snprintf(labels, sizeof(labels), "longrunner=\"%d\"", i + 1);
+        metrics_print_histogram(f, "breakout_longrunner_cycle_seconds", labels, &metrics.longrunners[i]);
+    }
+
+    fprintf(f, "# HELP breakout_call_duration_seconds Duration of database and hardware calls.\n");
+    fprintf(f, "# TYPE breakout_call_duration_seconds histogram\n");
+    for (i = 0; i < __METRICS_CALL_MAX; ++i) {
+        snprintf(labels, sizeof(labels), "call=\"%s\"", metrics_calls[i]);
+        metrics_print_histogram(f, "breakout_call_duration_seconds", labels, &metrics.calls[i]);
+    }
+}
+
+/**
+ * Serve all metrics in the Prometheus text format.
+ * @param cl the client requesting the metrics.
+ */
+void metrics_handle_request(struct client *cl)
+{
+    char *body = NULL;
+    size_t len = 0;
+    FILE *f;
+    STALL_SCOPE("route", "metrics");
+
+    cl->route = metrics_route(metrics_handle_request, "GET", "metrics");
+
+    cl->timing.handler_start = metrics_now();
+    f = open_memstream(&body, &len);
+    if (!f) {
+        client_send_error(cl, 500, "Internal Server Error", "Out of memory");
+        return;
+    }
+    metrics_print(f);
+    fclose(f);
+    cl->timing.handler_end = metrics_now();
+
+    write_http_header(cl, 200, "OK");
+    ustream_printf(cl->us, "Content-Type: text/plain; version=0.0.4\r\n");
+    ustream_printf(cl->us, "Content-Length: %zu\r\n\r\n", len);
+    if (cl->request.method != UH_HTTP_MSG_HEAD)
+        ustream_write(cl->us, body, len, false);
+
+    free(body);
+    request_done(cl);
+}
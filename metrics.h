@@ -0,0 +1,236 @@
+/* 
+ * Copyright (c) 2014, Daan Pape
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without 
+ * modification, are permitted provided that the following conditions are met:
+ * 
+ *     1. Redistributions of source code must retain the above copyright 
+ *        notice, this list of conditions and the following disclaimer.
+ *
+ *     2. Redistributions in binary form must reproduce the above copyright 
+ *        notice, this list of conditions and the following disclaimer in the 
+ *        documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" 
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE 
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE 
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE 
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR 
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF 
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS 
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN 
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) 
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE 
+ * POSSIBILITY OF SUCH DAMAGE.
+ * 
+ * File:   metrics.h
+ * Created on October 18, 2026, 7:20 PM
+ */
+
+#ifndef METRICS_H_
+#define METRICS_H_
+
+#include <stdint.h>
+
+#include "config.h"
+
+struct client;
+
+/* Counters are machine words so they can be updated atomically without locks */
+typedef unsigned long metric_t;
+
+/* Number of finite histogram buckets, the last bucket is +Inf */
+#define METRICS_BUCKETS         12
+
+/**
+ * A latency histogram, bucket counts are not cumulative.
+ */
+struct metrics_histogram {
+    metric_t buckets[METRICS_BUCKETS + 1];  /* Observations per bucket */
+    metric_t count;                         /* Number of observations */
+    metric_t sum_us;                        /* Sum of all observations in microseconds */
+    metric_t sum_wraps;                     /* Times sum_us wrapped, it lasts 71 minutes in 32 bits */
+};
+
+/**
+ * Request metrics of one API route.
+ */
+struct metrics_route {
+    const void *key;                        /* The handler table entry of the route */
+    const char *method;                     /* The HTTP method label */
+    const char *name;                       /* The route label */
+    metric_t status[5];                     /* Responses per status class 1xx to 5xx */
+    struct metrics_histogram latency;       /* Time from request header to response */
+};
+
+/* Sub-buckets per power of two of the phase histograms, as a power of two */
+#define METRICS_HDR_SUB_BITS    3
+#define METRICS_HDR_SUB         (1 << METRICS_HDR_SUB_BITS)
+
+/* Highest power of two tracked by the phase histograms, 2^27 us is over two minutes */
+#define METRICS_HDR_MAX_BITS    27
+
+/* Number of buckets of the phase histograms */
+#define METRICS_HDR_BUCKETS     ((METRICS_HDR_MAX_BITS - METRICS_HDR_SUB_BITS + 1) * METRICS_HDR_SUB)
+
+/**
+ * A log-linear histogram for quantiles, every power of two is split
+ * in METRICS_HDR_SUB linear buckets which bounds the relative error.
+ */
+struct metrics_hdr {
+    metric_t buckets[METRICS_HDR_BUCKETS];  /* Observations per bucket */
+    metric_t count;                         /* Number of observations */
+    metric_t sum_us;                        /* Sum of all observations in microseconds */
+    metric_t sum_wraps;                     /* Times sum_us wrapped, it lasts 71 minutes in 32 bits */
+    metric_t max_us;                        /* Largest observation in microseconds */
+};
+
+/* Phases of a request */
+enum metrics_phase {
+    METRICS_PHASE_CONNECT,                  /* Accept to first byte of the first request */
+    METRICS_PHASE_READ,                     /* First byte to complete request header */
+    METRICS_PHASE_HANDLER,                  /* Running the request handler */
+    METRICS_PHASE_RESPOND,                  /* Handler end to response queued */
+    METRICS_PHASE_SEND,                     /* Response queued to written to the socket */
+    METRICS_PHASE_TOTAL,                    /* First byte to written to the socket */
+    __METRICS_PHASE_MAX
+};
+
+/**
+ * Time stamps of a request in monotonic microseconds, zero when
+ * the request did not reach the stamp.
+ */
+struct metrics_timing {
+    uint64_t accept;                        /* Connection accepted, first request only */
+    uint64_t first_byte;                    /* First byte of the request read */
+    uint64_t header;                        /* Request header complete */
+    uint64_t handler_start;                 /* Request handler called */
+    uint64_t handler_end;                   /* Request handler returned */
+    uint64_t done;                          /* Response queued */
+};
+
+/* Timed calls outside the HTTP server */
+enum metrics_call {
+    METRICS_CALL_SQLITE,
+    METRICS_CALL_GPIO,
+    METRICS_CALL_SPI,
+    METRICS_CALL_I2C,
+    __METRICS_CALL_MAX
+};
+
+/**
+ * All server wide metrics.
+ */
+struct metrics {
+    metric_t bytes_in;                      /* Bytes read from client sockets */
+    metric_t bytes_out;                     /* Bytes written to client sockets */
+    metric_t connections;                   /* Accepted connections */
+    struct metrics_histogram calls[__METRICS_CALL_MAX];
+    struct metrics_histogram longrunners[METRICS_MAX_LONGRUNNERS];
+    int n_longrunners;                      /* Number of registered longrunners */
+    struct metrics_hdr phases[__METRICS_PHASE_MAX];
+};
+
+/* The metrics registry */
+extern struct metrics metrics;
+
+/**
+ * A running timer, see METRICS_TIME.
+ */
+struct metrics_timer {
+    struct metrics_histogram *histogram;
+    uint64_t start;
+};
+
+/**
+ * Time the rest of the enclosing block, the duration is recorded
+ * on every return path.
+ * @param call the enum metrics_call to record the duration for.
+ */
+#define METRICS_TIME(call) \
+    struct metrics_timer metrics_timer_ __attribute__((cleanup(metrics_timer_done))) = \
+        { &metrics.calls[call], metrics_now() }
+
+/**
+ * Add a value to a counter.
+ * @param counter the counter.
+ * @param value the value to add.
+ */
+static inline void metrics_add(metric_t *counter, unsigned long value)
+{
+    __atomic_fetch_add(counter, value, __ATOMIC_RELAXED);
+}
+
+/**
+ * Get the monotonic time.
+ * @return the time in microseconds.
+ */
+uint64_t metrics_now(void);
+
+/**
+ * Record an observation in a histogram.
+ * @param h the histogram.
+ * @param us the observed duration in microseconds.
+ */
+void metrics_observe(struct metrics_histogram *h, uint64_t us);
+
+/**
+ * Record the duration of a METRICS_TIME timer.
+ * @param timer the timer going out of scope.
+ */
+void metrics_timer_done(struct metrics_timer *timer);
+
+/**
+ * Get the metrics of a route, the route is registered on first use.
+ * Routes are only registered from the event loop.
+ * @param key unique key of the route, the handler table entry.
+ * @param method the HTTP method label.
+ * @param name the route label.
+ * @return the route metrics.
+ */
+struct metrics_route* metrics_route(const void *key, const char *method, const char *name);
+
+/**
+ * Get the cycle time histogram of a new longrunner.
+ * @return the histogram, NULL when there are too many longrunners.
+ */
+struct metrics_histogram* metrics_longrunner(void);
+
+/**
+ * Record a finished request.
+ * @param route the route of the request, NULL when it had none.
+ * @param status the HTTP status code of the response.
+ * @param us the time the request took in microseconds.
+ */
+void metrics_request(struct metrics_route *route, int status, uint64_t us);
+
+/**
+ * Record an observation in a log-linear histogram.
+ * @param h the histogram.
+ * @param us the observed duration in microseconds.
+ */
+void metrics_hdr_observe(struct metrics_hdr *h, uint64_t us);
+
+/**
+ * Get a quantile of a log-linear histogram.
+ * @param h the histogram.
+ * @param q the quantile between 0 and 1.
+ * @return the quantile in microseconds, 0 when the histogram is empty.
+ */
+uint64_t metrics_hdr_quantile(struct metrics_hdr *h, double q);
+
+/**
+ * Record the phases of a finished request.
+ * @param t the time stamps of the request.
+ * @param flushed the time the response was written to the socket.
+ */
+void metrics_timing(const struct metrics_timing *t, uint64_t flushed);
+
+/**
+ * Serve all metrics in the Prometheus text format.
+ * @param cl the client requesting the metrics.
+ */
+void metrics_handle_request(struct client *cl);
+
+#endif /* METRICS_H_ */
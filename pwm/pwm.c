@@ -28,160 +28,357 @@
  * Created on September 12, 2015, 1:43 AM
  */
 
-
 #include <stdio.h>
-#include <sys/types.h>
-#include <sys/stat.h>
-#include <fcntl.h>
+#include <string.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <pthread.h>
+#include <errno.h>
 #include <time.h>
-#include <sys/mman.h>
-#include <signal.h>
-#include <sched.h>
-#include <unistd.h>
+#include <sys/prctl.h>
 
 #include "pwm.h"
+#include "../config.h"
+#include "../logger.h"
+#include "../helper.h"
 #include "../gpio/gpio.h"
+#include "../gpio/gpio_mmio.h"
+#include "../gpio/gpio_monitor.h"
+#include "../gpio/gpio_pulse.h"
 
-volatile unsigned long *gpioAddress;
+/* A running PWM channel */
+struct pwm_channel {
+    int gpio;               /* The GPIO pin, -1 when the channel is off */
+    uint64_t period;        /* The period in nanoseconds */
+    uint64_t duty;          /* The high time in nanoseconds */
+    uint64_t rise;          /* The time of the next rising edge */
+    uint64_t fall;          /* The time of the next falling edge */
+    bool high;              /* True while the pin is high */
+    uint64_t cycles;        /* The number of periods made */
+};
 
-static int gpioSetup()
-{
-    int  m_mfd;
-    if ((m_mfd = open("/dev/mem", O_RDWR)) < 0)
-    {
-        return -1;
-    }
-    gpioAddress = (unsigned long*)mmap(NULL, GPIO_BLOCK, PROT_READ|PROT_WRITE, MAP_SHARED, m_mfd, GPIO_ADDR);
-    close(m_mfd);
+static struct pwm_channel channels[PWM_CHANNELS] = {
+    [0 ... PWM_CHANNELS - 1] = { .gpio = -1 }
+};
 
-    if (gpioAddress == MAP_FAILED)
-    {
-        return -2;
-    }
+static struct pwm_stats stats = { .late_min_ns = UINT32_MAX };
 
-    return 0;
+/* True when the PWM thread runs */
+static bool running = false;
+
+/* Protects the channels and the statistics, the thread waits on changed when idle */
+static pthread_mutex_t pwm_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t changed = PTHREAD_COND_INITIALIZER;
+
+/**
+ * Check if a channel makes edges, a duty of 0% or 100% is a constant level.
+ * @param c the channel.
+ * @return true when the channel has edges.
+ */
+static bool pwm_has_edges(const struct pwm_channel *c)
+{
+    return c->gpio >= 0 && c->duty > 0 && c->duty < c->period;
 }
 
-static void gpioDirection(int gpio, int direction)
+/**
+ * Drive pins high and low at once.
+ * @param set bit n set to drive GPIO n high.
+ * @param clear bit n set to drive GPIO n low.
+ */
+static void pwm_write(uint32_t set, uint32_t clear)
 {
-    unsigned long value = *(gpioAddress + 0); // obtain current settings
-    if (direction == 1)
-    {
-        value |= (1 < gpio); // set bit to 1
+    if (stats.registers) {
+        if (clear)
+            gpio_mmio_clear(clear);
+        if (set)
+            gpio_mmio_set(set);
+    } else if (set | clear) {
+        gpio_set_states(set | clear, set);
     }
-    else
-    {
-        value &= ~(1 < gpio); // clear bit
-    }
-    *(gpioAddress + 0) = value;
-    
-    value = *(gpioAddress + 2); // obtain current settings
-    if (direction == 1)
-    {
-        value |= (1 < gpio); // set bit to 1
-    }
-    else
-    {
-        value &= ~(1 < gpio); // clear bit
-    }
-    *(gpioAddress + 2) = value;
 }
 
-static void gpioSet(int gpio, int value)
+/**
+ * Make the edges of a channel that are due. The channels must be locked.
+ * @param c the channel.
+ * @param now the current time.
+ * @param set collects the pins to drive high.
+ * @param clear collects the pins to drive low.
+ */
+static void pwm_edges(struct pwm_channel *c, uint64_t now, uint32_t *set, uint32_t *clear)
 {
-    if (value == 0)
-    {
-        *(gpioAddress + 4) = (1 < gpio);
-    }
-    else
-    {
-        *(gpioAddress + 3) = (1 < gpio);
+    uint32_t bit = 1u << c->gpio;
+
+    for (;;) {
+        if (c->high) {
+            if (c->fall > now)
+                return;
+            c->high = false;
+            *clear |= bit;
+            *set &= ~bit;
+        } else {
+            if (c->rise > now)
+                return;
+
+            /* Skip the periods that are over already */
+            if (now - c->rise >= c->period) {
+                uint64_t skipped = (now - c->rise) / c->period;
+
+                stats.overruns += skipped;
+                c->rise += skipped * c->period;
+            }
+
+            c->high = true;
+            c->fall = c->rise + c->duty;
+            c->rise += c->period;
+            c->cycles++;
+            *set |= bit;
+            *clear &= ~bit;
+        }
     }
 }
 
-int pwm_test() {
-  struct sched_param prio_struct;
-  int ret;
-
-  /* set real time priority for better accuracy */
-  prio_struct.__sched_priority = 99;
-
-  ret = sched_setscheduler(0, SCHED_FIFO, &prio_struct);
-  if(ret) {
-    printf("\n*** Warning ***\n");
-    perror("Could not set real time priority");
-    printf("This may reduce timing benchmark accuracy. ");
-    printf("Try running as super user (sudo).\n\n");
-  }
-
-  gpioSetup();
-  printf("Set up gpio ports\r\n");
-  gpioDirection(23, 1);
-  printf("GPIO is set to output\r\n");
-  gpioSet(23,0);
-  printf("GPIO port 23 is low\r\n");
-
- /*
-  while(1==1) {
-    
-    for(int i = 0; i < 25; ++i) {
-        gpioSet(23, 1);
-        usleep(1000);
-        gpioSet(23, 0);
-        usleep(20000);
-    }
-    printf("Servo LEFT\r\n");
-    
-    for(int i = 0; i < 25; ++i) {
-        gpioSet(23, 1);
-        usleep(1500);
-        gpioSet(23, 0);
-        usleep(1500);
+/**
+ * The PWM thread, makes the edges of all channels.
+ * @param arg unused.
+ * @return never returns.
+ */
+static void* pwm_thread(void *arg)
+{
+    struct timespec ts;
+    uint64_t deadline;
+    uint64_t now;
+    uint32_t set;
+    uint32_t clear;
+    uint32_t late;
+    bool edge;
+
+    /* The default timer slack of 50us would be the jitter of every edge */
+    prctl(PR_SET_TIMERSLACK, 1, 0, 0, 0);
+
+    pthread_mutex_lock(&pwm_lock);
+    for (;;) {
+        /* Find the first edge, changes are picked up at least every PWM_MAX_SLEEP */
+        now = helper_now_ns();
+        deadline = now + PWM_MAX_SLEEP * 1000ull;
+        edge = false;
+
+        for (int i = 0; i < PWM_CHANNELS; ++i) {
+            struct pwm_channel *c = &channels[i];
+            uint64_t next;
+
+            if (!pwm_has_edges(c))
+                continue;
+
+            next = c->high ? c->fall : c->rise;
+            if (next <= deadline) {
+                deadline = next;
+                edge = true;
+            }
+        }
+
+        if (!edge) {
+            pthread_cond_wait(&changed, &pwm_lock);
+            continue;
+        }
+
+        pthread_mutex_unlock(&pwm_lock);
+
+        ts.tv_sec = deadline / 1000000000ull;
+        ts.tv_nsec = deadline % 1000000000ull;
+        while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL) == EINTR)
+            ;
+
+        now = helper_now_ns();
+        pthread_mutex_lock(&pwm_lock);
+
+        late = now <= deadline ? 0 : now - deadline > UINT32_MAX ? UINT32_MAX : now - deadline;
+        stats.late_total_ns += late;
+        if (late < stats.late_min_ns)
+            stats.late_min_ns = late;
+        if (late > stats.late_max_ns)
+            stats.late_max_ns = late;
+        stats.wakeups++;
+
+        /* Make all due edges with one write per register */
+        set = 0;
+        clear = 0;
+        for (int i = 0; i < PWM_CHANNELS; ++i) {
+            if (pwm_has_edges(&channels[i]))
+                pwm_edges(&channels[i], now, &set, &clear);
+        }
+        pwm_write(set, clear);
     }
-    printf("Servo MIDDLE\r\n");
-    
-    for(int i = 0; i < 25; ++i) {
-        gpioSet(23, 1);
-        usleep(2000);
-        gpioSet(23, 0);
-        usleep(2000);
+
+    return NULL;
+}
+
+/**
+ * Start the PWM thread. The channels must be locked.
+ * @return true when the thread runs.
+ */
+static bool pwm_start(void)
+{
+    pthread_attr_t attr;
+    pthread_t thread;
+    char mem[HW_PATH_MAX];
+
+    if (running)
+        return true;
+
+    /* The registers make an edge in nanoseconds, other backends are a fallback */
+    stats.registers = gpio_mmio_open(helper_hw_path(mem, sizeof(mem), "/dev/mem"));
+    if (!stats.registers)
+        log_message(LOG_WARNING, "Could not map the GPIO registers, PWM uses the GPIO backend\r\n");
+
+    pthread_attr_init(&attr);
+    pthread_attr_setstacksize(&attr, PWM_STACK);
+
+    if (pthread_create(&thread, &attr, pwm_thread, NULL) != 0) {
+        log_message(LOG_ERROR, "Could not start PWM thread\r\n");
+        pthread_attr_destroy(&attr);
+        return false;
     }
-    printf("Servo RIGHT\r\n");
-    
-  };
-*/
-  gpio_reserve(23);
-  gpio_set_direction(23, GPIO_OUT);
-  
-    while(1==1) {
-    
-    for(int i = 0; i < 200; ++i) {
-        gpio_set_state(23, GPIO_HIGH);
-        usleep(900);
-        gpio_set_state(23, GPIO_LOW);
-        usleep(20000);
+    pthread_attr_destroy(&attr);
+    pthread_detach(thread);
+
+    helper_thread_realtime(thread, conf->pwm_priority, conf->pwm_cpu, "PWM");
+
+    running = true;
+    return true;
+}
+
+/**
+ * Drive a PWM signal on a GPIO pin. A channel that is already running
+ * changes its pin and signal at once.
+ * @param channel the channel, 0 up to PWM_CHANNELS.
+ * @param gpio the GPIO pin, it may not be used by another channel.
+ * @param period_us the period, PWM_MIN_PERIOD up to PWM_MAX_PERIOD microseconds.
+ * @param duty_us the time the pin is high in each period, at most the period.
+ * @return true when the signal runs.
+ */
+bool pwm_set(int channel, int gpio, uint32_t period_us, uint32_t duty_us)
+{
+    struct pwm_channel *c;
+    bool ok = false;
+
+    if (channel < 0 || channel >= PWM_CHANNELS || period_us < PWM_MIN_PERIOD || 
+            period_us > PWM_MAX_PERIOD || duty_us > period_us)
+        return false;
+
+    /* Reserve the port and set it as output, the monitor must see direction changes in this thread */
+    if (!gpio_reserve(gpio) || !gpio_set_direction(gpio, GPIO_OUT))
+        return false;
+
+    /* The pulse scheduler may not fight over the pin */
+    gpio_pulse_cancel(gpio);
+
+    pthread_mutex_lock(&pwm_lock);
+    c = &channels[channel];
+
+    for (int i = 0; i < PWM_CHANNELS; ++i) {
+        if (i != channel && channels[i].gpio == gpio) {
+            log_message(LOG_WARNING, "GPIO %d is already used by PWM channel %d\r\n", gpio, i);
+            goto out;
+        }
     }
-    printf("Servo LEFT\r\n");
-    
-    for(int i = 0; i < 200; ++i) {
-        gpio_set_state(23, GPIO_HIGH);
-        usleep(1400);
-        gpio_set_state(23, GPIO_LOW);
-        usleep(20000);
+
+    if (!pwm_start())
+        goto out;
+
+    /* The old pin of the channel is left low */
+    if (c->gpio >= 0 && c->gpio != gpio) {
+        pwm_write(0, 1u << c->gpio);
+        gpio_release(c->gpio);
     }
-    printf("Servo MIDDLE\r\n");
-    
-    sleep(2);
-    
-    for(int i = 0; i < 200; ++i) {
-        gpio_set_state(23, GPIO_HIGH);
-        usleep(2400);
-        gpio_set_state(23, GPIO_LOW);
-        usleep(20000);
+
+    c->gpio = gpio;
+    c->period = period_us * 1000ull;
+    c->duty = duty_us * 1000ull;
+    c->rise = helper_now_ns();
+    c->high = false;
+    c->cycles = 0;
+
+    /* A constant level is written once */
+    if (!pwm_has_edges(c))
+        pwm_write(duty_us ? 1u << gpio : 0, duty_us ? 0 : 1u << gpio);
+
+    /* The mirror does not follow the edges, the pin must be read */
+    gpio_monitor_direction_done(gpio, GPIO_ERR);
+
+    pthread_cond_signal(&changed);
+    ok = true;
+
+out:
+    pthread_mutex_unlock(&pwm_lock);
+    if (!ok)
+        gpio_release(gpio);
+
+    return ok;
+}
+
+/**
+ * Stop a PWM channel and drive its pin low.
+ * @param channel the channel.
+ * @return false when the channel does not exist.
+ */
+bool pwm_stop(int channel)
+{
+    struct pwm_channel *c;
+
+    if (channel < 0 || channel >= PWM_CHANNELS)
+        return false;
+
+    pthread_mutex_lock(&pwm_lock);
+    c = &channels[channel];
+    if (c->gpio >= 0) {
+        pwm_write(0, 1u << c->gpio);
+        gpio_release(c->gpio);
+        c->gpio = -1;
     }
-    printf("Servo RIGHT\r\n");
-    
-  };
+    pthread_mutex_unlock(&pwm_lock);
 
-  return 0;
-};
+    return true;
+}
+
+/**
+ * Get the settings of a PWM channel.
+ * @param channel the channel.
+ * @param info receives the settings.
+ * @return false when the channel does not exist.
+ */
+bool pwm_get(int channel, struct pwm_channel_info *info)
+{
+    struct pwm_channel *c;
+
+    if (channel < 0 || channel >= PWM_CHANNELS)
+        return false;
+
+    pthread_mutex_lock(&pwm_lock);
+    c = &channels[channel];
+    info->gpio = c->gpio;
+    info->period_us = c->period / 1000;
+    info->duty_us = c->duty / 1000;
+    info->cycles = c->cycles;
+    pthread_mutex_unlock(&pwm_lock);
+
+    return true;
+}
+
+/**
+ * Get the timing of the PWM thread.
+ * @param out receives the timing.
+ * @param reset true to start counting again.
+ */
+void pwm_get_stats(struct pwm_stats *out, bool reset)
+{
+    pthread_mutex_lock(&pwm_lock);
+    *out = stats;
+    if (reset) {
+        stats.wakeups = 0;
+        stats.overruns = 0;
+        stats.late_total_ns = 0;
+        stats.late_min_ns = UINT32_MAX;
+        stats.late_max_ns = 0;
+    }
+    pthread_mutex_unlock(&pwm_lock);
+}
@@ -26,15 +26,67 @@
  * 
  * File:   pwm.h
  * Created on September 12, 2015, 1:43 AM
+ * 
+ * Software PWM on the exposed GPIO pins. One real-time thread makes the
+ * edges of all channels with absolute deadlines, through the GPIO
+ * registers when they can be mapped.
  */
 
 #ifndef PWM_H
 #define	PWM_H
 
-#define GPIO_ADDR 0x18040000    // base address
-#define GPIO_BLOCK 48           // memory block size
+#include <stdbool.h>
+#include <stdint.h>
 
-int pwm_test();
+/* The settings of a PWM channel */
+struct pwm_channel_info {
+    int gpio;               /* The GPIO pin, -1 when the channel is off */
+    uint32_t period_us;     /* The period of the signal */
+    uint32_t duty_us;       /* The time the pin is high in each period */
+    uint64_t cycles;        /* The number of periods made */
+};
 
-#endif
+/* Timing of the PWM thread */
+struct pwm_stats {
+    uint64_t wakeups;       /* Number of edge deadlines the thread woke up for */
+    uint64_t overruns;      /* Number of periods skipped because the thread was too late */
+    uint64_t late_total_ns; /* Sum of the wakeup latencies */
+    uint32_t late_min_ns;   /* Smallest wakeup latency */
+    uint32_t late_max_ns;   /* Largest wakeup latency */
+    bool registers;         /* True when the pins are driven through the registers */
+};
+
+/**
+ * Drive a PWM signal on a GPIO pin. A channel that is already running
+ * changes its pin and signal at once.
+ * @param channel the channel, 0 up to PWM_CHANNELS.
+ * @param gpio the GPIO pin, it may not be used by another channel.
+ * @param period_us the period, PWM_MIN_PERIOD up to PWM_MAX_PERIOD microseconds.
+ * @param duty_us the time the pin is high in each period, at most the period.
+ * @return true when the signal runs.
+ */
+bool pwm_set(int channel, int gpio, uint32_t period_us, uint32_t duty_us);
+
+/**
+ * Stop a PWM channel and drive its pin low.
+ * @param channel the channel.
+ * @return false when the channel does not exist.
+ */
+bool pwm_stop(int channel);
 
+/**
+ * Get the settings of a PWM channel.
+ * @param channel the channel.
+ * @param info receives the settings.
+ * @return false when the channel does not exist.
+ */
+bool pwm_get(int channel, struct pwm_channel_info *info);
+
+/**
+ * Get the timing of the PWM thread.
+ * @param stats receives the timing.
+ * @param reset true to start counting again.
+ */
+void pwm_get_stats(struct pwm_stats *stats, bool reset);
+
+#endif
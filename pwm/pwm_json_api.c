@@ -0,0 +1,230 @@
+/* 
+ * Copyright (c) 2014, Daan Pape
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without 
+ * modification, are permitted provided that the following conditions are met:
+ * 
+ *     1. Redistributions of source code must retain the above copyright 
+ *        notice, this list of conditions and the following disclaimer.
+ *
+ *     2. Redistributions in binary form must reproduce the above copyright 
+ *        notice, this list of conditions and the following disclaimer in the 
+ *        documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" 
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE 
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE 
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE 
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR 
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF 
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS 
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN 
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) 
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE 
+ * POSSIBILITY OF SUCH DAMAGE.
+ * 
+ * File:   pwm_json_api.c
+ * Created on October 18, 2026, 10:20 PM
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+#include <json-c/json.h>
+
+#include "../config.h"
+#include "../logger.h"
+#include "../uhttpd.h"
+#include "../helper.h"
+#include "pwm.h"
+#include "pwm_json_api.h"
+
+/**
+ * Route all get requests concerning the pwm module.
+ * @param cl the client who made the request.
+ * @param request the request part of the url.
+ * @return the result of the called function.
+ */
+json_object* pwm_get_router(struct client *cl, char *request)
+{
+    if (helper_str_startswith(request, "status", 0)) 
+    {
+        return pwm_get_status(cl, request + 6);
+    } 
+    else
+    {
+        log_message(LOG_WARNING, "PWM API got unknown GET request '%s'\r\n", request);
+        return NULL;
+    }
+}
+
+/**
+ * Route all put requests concerning the pwm module.
+ * @param cl the client who made the request.
+ * @param request the request part of the url.
+ * @return the result of the called function.
+ */
+json_object* pwm_put_router(struct client *cl, char *request)
+{
+    if (helper_str_startswith(request, "channel", 0)) 
+    {
+        return pwm_put_channel(cl, request + 8);
+    } 
+    else if (helper_str_startswith(request, "servo", 0))
+    {
+        return pwm_put_servo(cl, request + 6);
+    }
+    else if (helper_str_startswith(request, "stop", 0))
+    {
+        return pwm_put_stop(cl, request + 5);
+    }
+    else
+    {
+        log_message(LOG_WARNING, "PWM API got unknown PUT request '%s'\r\n", request);
+        return NULL;
+    }
+}
+
+/**
+ * Describe a channel in JSON.
+ * @param channel the channel.
+ * @return the JSON object of the channel.
+ */
+static json_object* pwm_channel_json(int channel)
+{
+    struct pwm_channel_info info;
+    json_object *jobj = json_object_new_object();
+
+    pwm_get(channel, &info);
+    json_object_object_add(jobj, "channel", json_object_new_int(channel));
+    json_object_object_add(jobj, "pin", json_object_new_int(info.gpio));
+    if (info.gpio >= 0) {
+        json_object_object_add(jobj, "frequency", json_object_new_double(1000000.0 / info.period_us));
+        json_object_object_add(jobj, "duty", json_object_new_double(100.0 * info.duty_us / info.period_us));
+        json_object_object_add(jobj, "period_us", json_object_new_int(info.period_us));
+        json_object_object_add(jobj, "pulse_us", json_object_new_int(info.duty_us));
+        json_object_object_add(jobj, "cycles", json_object_new_int64(info.cycles));
+    }
+
+    return jobj;
+}
+
+/**
+ * Get the channels and the timing of the PWM thread, status?reset 
+ * starts counting the timing again.
+ * @param cl the client who made the request.
+ * @param request the request part of the url.
+ */
+json_object* pwm_get_status(struct client *cl, char *request)
+{
+    struct pwm_stats stats;
+    json_object *jobj = json_object_new_object();
+    json_object *j_channels = json_object_new_array();
+    json_object *j_timing = json_object_new_object();
+
+    for (int i = 0; i < PWM_CHANNELS; ++i) {
+        json_object_array_add(j_channels, pwm_channel_json(i));
+    }
+
+    pwm_get_stats(&stats, strstr(request, "reset") != NULL);
+
+    /* Latencies of the wakeups in microseconds */
+    json_object_object_add(j_timing, "registers", json_object_new_boolean(stats.registers));
+    json_object_object_add(j_timing, "wakeups", json_object_new_int64(stats.wakeups));
+    json_object_object_add(j_timing, "overruns", json_object_new_int64(stats.overruns));
+    if (stats.wakeups > 0) {
+        json_object_object_add(j_timing, "latency_min", json_object_new_double(stats.late_min_ns / 1000.0));
+        json_object_object_add(j_timing, "latency_avg", json_object_new_double(stats.late_total_ns / 1000.0 / stats.wakeups));
+        json_object_object_add(j_timing, "latency_max", json_object_new_double(stats.late_max_ns / 1000.0));
+    }
+
+    json_object_object_add(jobj, "channels", j_channels);
+    json_object_object_add(jobj, "timing", j_timing);
+
+    cl->http_status = r_ok;
+    return jobj;
+}
+
+/**
+ * Drive a channel: /<channel>/<gpiopin>/<frequency in Hz>/<duty in %>.
+ * @param cl the client who made the request.
+ * @param request the request part of the url.
+ */
+json_object* pwm_put_channel(struct client *cl, char *request)
+{
+    int channel;
+    int gpio_pin;
+    double frequency;
+    double duty;
+    double period;
+    uint32_t period_us;
+
+    /* If sscanf fails the request is malformed, %lf also accepts nan and inf */
+    if (sscanf(request, "%d/%d/%lf/%lf", &channel, &gpio_pin, &frequency, &duty) != 4 ||
+            !isfinite(frequency) || frequency <= 0 || !isfinite(duty) || duty < 0 || duty > 100) {
+        cl->http_status = r_bad_req;
+        return NULL;
+    }
+
+    /* Check the period before the conversion, a double out of range of uint32_t is undefined */
+    period = 1000000.0 / frequency;
+    if (period < PWM_MIN_PERIOD || period > PWM_MAX_PERIOD) {
+        cl->http_status = r_bad_req;
+        return NULL;
+    }
+
+    period_us = period + 0.5;
+    if (!pwm_set(channel, gpio_pin, period_us, period_us * duty / 100 + 0.5)) {
+        cl->http_status = r_error;
+        return NULL;
+    }
+
+    cl->http_status = r_ok;
+    return pwm_channel_json(channel);
+}
+
+/**
+ * Drive a servo at 50Hz: /<channel>/<gpiopin>/<pulse width in us>.
+ * @param cl the client who made the request.
+ * @param request the request part of the url.
+ */
+json_object* pwm_put_servo(struct client *cl, char *request)
+{
+    int channel;
+    int gpio_pin;
+    int pulse_us;
+
+    /* If sscanf fails the request is malformed */
+    if (sscanf(request, "%d/%d/%d", &channel, &gpio_pin, &pulse_us) != 3 || pulse_us < 0) {
+        cl->http_status = r_bad_req;
+        return NULL;
+    }
+
+    if (!pwm_set(channel, gpio_pin, PWM_SERVO_PERIOD, pulse_us)) {
+        cl->http_status = r_error;
+        return NULL;
+    }
+
+    cl->http_status = r_ok;
+    return pwm_channel_json(channel);
+}
+
+/**
+ * Stop a channel: /<channel>.
+ * @param cl the client who made the request.
+ * @param request the request part of the url.
+ */
+json_object* pwm_put_stop(struct client *cl, char *request)
+{
+    int channel;
+
+    /* If sscanf fails the request is malformed */
+    if (sscanf(request, "%d", &channel) != 1 || !pwm_stop(channel)) {
+        cl->http_status = r_bad_req;
+        return NULL;
+    }
+
+    cl->http_status = r_ok;
+    return pwm_channel_json(channel);
+}
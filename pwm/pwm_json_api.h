@@ -0,0 +1,82 @@
+/* 
+ * Copyright (c) 2014, Daan Pape
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without 
+ * modification, are permitted provided that the following conditions are met:
+ * 
+ *     1. Redistributions of source code must retain the above copyright 
+ *        notice, this list of conditions and the following disclaimer.
+ *
+ *     2. Redistributions in binary form must reproduce the above copyright 
+ *        notice, this list of conditions and the following disclaimer in the 
+ *        documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" 
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE 
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE 
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE 
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR 
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF 
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS 
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN 
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) 
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE 
+ * POSSIBILITY OF SUCH DAMAGE.
+ * 
+ * File:   pwm_json_api.h
+ * Created on October 18, 2026, 10:20 PM
+ */
+
+#ifndef PWM_JSON_API_H
+#define	PWM_JSON_API_H
+
+#include <json-c/json.h>
+#include "../uhttpd.h"
+
+/**
+ * Route all get requests concerning the pwm module.
+ * @param cl the client who made the request.
+ * @param request the request part of the url.
+ * @return the result of the called function.
+ */
+json_object* pwm_get_router(struct client *cl, char *request);
+
+/**
+ * Route all put requests concerning the pwm module.
+ * @param cl the client who made the request.
+ * @param request the request part of the url.
+ * @return the result of the called function.
+ */
+json_object* pwm_put_router(struct client *cl, char *request);
+
+/**
+ * Get the channels and the timing of the PWM thread, status?reset 
+ * starts counting the timing again.
+ * @param cl the client who made the request.
+ * @param request the request part of the url.
+ */
+json_object* pwm_get_status(struct client *cl, char *request);
+
+/**
+ * Drive a channel: /<channel>/<gpiopin>/<frequency in Hz>/<duty in %>.
+ * @param cl the client who made the request.
+ * @param request the request part of the url.
+ */
+json_object* pwm_put_channel(struct client *cl, char *request);
+
+/**
+ * Drive a servo at 50Hz: /<channel>/<gpiopin>/<pulse width in us>.
+ * @param cl the client who made the request.
+ * @param request the request part of the url.
+ */
+json_object* pwm_put_servo(struct client *cl, char *request);
+
+/**
+ * Stop a channel: /<channel>.
+ * @param cl the client who made the request.
+ * @param request the request part of the url.
+ */
+json_object* pwm_put_stop(struct client *cl, char *request);
+
+#endif
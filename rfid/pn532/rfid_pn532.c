@@ -156,11 +156,7 @@ bool rfid_pn532_write_command(uint8_t *cmd, uint8_t cmdlen)
     uint8_t outbuf[cmdlen + 8];
     int outindex = 0;
     
-    log_message(LOG_DEBUG, "Writing RFID_PN532 command: [ ");
-    for(int i = 0; i < cmdlen; ++i) {
-        printf("%02x ", cmd[i]);
-    }
-    printf("]\r\n");
+    log_hexdump(LOG_DEBUG, "Writing RFID_PN532 command: ", cmd, cmdlen);
     uint8_t checksum = 0;
     ++cmdlen;
     
@@ -218,12 +214,10 @@ bool rfid_pn532_read_data(uint8_t* buf, uint8_t n)
     }
     
     // Discard leading 0x01 and trailing 0x00
-    log_message(LOG_DEBUG, "rfid_pn532_read_data: [ ");
     for(int i = 0; i < n; ++i) {
         buf[i] = raw[i+1];
-        printf("%02x ", buf[i]);
     }
-    printf("]\r\n");
+    log_hexdump(LOG_DEBUG, "rfid_pn532_read_data: ", buf, n);
     
     return true;
 }
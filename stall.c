@@ -0,0 +1,380 @@
+/* 
+ * Copyright (c) 2014, Daan Pape
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without 
+ * modification, are permitted provided that the following conditions are met:
+ * 
+ *     1. Redistributions of source code must retain the above copyright 
+ *        notice, this list of conditions and the following disclaimer.
+ *
+ *     2. Redistributions in binary form must reproduce the above copyright 
+ *        notice, this list of conditions and the following disclaimer in the 
+ *        documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" 
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE 
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE 
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE 
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR 
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF 
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS 
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN 
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) 
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE 
+ * POSSIBILITY OF SUCH DAMAGE.
+ * File:   stall.c
+ * Created on October 18, 2026, 8:05 PM
+ */
+
+#define _GNU_SOURCE
+#include <dlfcn.h>
+#include <pthread.h>
+#include <signal.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <unwind.h>
+
+#include "logger.h"
+#include "metrics.h"
+#include "stall.h"
+
+/*
+ * The event loop thread marks its callbacks with STALL_SCOPE, the scopes
+ * are kept in a small stack and the outermost one publishes the time it
+ * started. A watchdog thread polls that time and records a stall with
+ * the callbacks on the stack when it runs longer than the threshold.
+ * The names on the stack are never freed, so the watchdog can read them
+ * while the loop changes the stack, the sequence number of the outermost
+ * callback tells if it did.
+ *
+ * A backtrace has to be taken on the stalled thread itself. When enabled
+ * the watchdog sends it a signal, which also ends a sleep of the stalled
+ * callback early. That is why backtraces are opt in.
+ */
+#define STALL_SIGNAL            SIGUSR2
+
+/* Time the watchdog waits for the backtrace of the loop thread in ms */
+#define STALL_BACKTRACE_WAIT    10
+
+/* Callbacks running longer than this in ms are stalls, 0 when disabled */
+static int stall_threshold;
+
+/* The event loop thread */
+static pthread_t stall_loop_thread;
+
+/* The callback stack of the event loop thread */
+static const char *stall_kinds[STALL_MAX_SCOPES];
+static const char *stall_names[STALL_MAX_SCOPES];
+static int stall_depth;
+
+/* Start of the outermost callback in ms, 0 when the loop is waiting */
+static unsigned long stall_busy_since;
+
+/* Number of outermost callbacks, a stall is reported once */
+static unsigned long stall_seq;
+
+/* The backtrace taken by the signal handler */
+static void *stall_frames[STALL_MAX_FRAMES];
+static int stall_n_frames;
+static unsigned long stall_frames_seq;
+static int stall_frames_ready;
+
+/* The recorded stalls */
+static pthread_mutex_t stall_lock = PTHREAD_MUTEX_INITIALIZER;
+static struct stall stalls[STALL_HISTORY];
+static unsigned int stall_next;
+
+/* The stall that did not end yet */
+static struct stall *stall_current;
+
+/**
+ * Get the monotonic time.
+ * @return the time in milliseconds.
+ */
+static unsigned long stall_now_ms(void)
+{
+    return metrics_now() / 1000;
+}
+
+/**
+ * Add a frame to the backtrace of the loop thread.
+ * @param ctx the unwind context of the frame.
+ * @param arg not used.
+ * @return _URC_END_OF_STACK when the backtrace is full.
+ */
+static _Unwind_Reason_Code stall_unwind(struct _Unwind_Context *ctx, void *arg)
+{
+    void *pc = (void *) _Unwind_GetIP(ctx);
+
+    if (stall_n_frames == STALL_MAX_FRAMES)
+        return _URC_END_OF_STACK;
+
+    if (pc)
+        stall_frames[stall_n_frames++] = pc;
+
+    return _URC_NO_REASON;
+}
+
+/**
+ * Take a backtrace, runs on the stalled event loop thread.
+ * @param sig the stall signal.
+ */
+static void stall_signal(int sig)
+{
+    stall_n_frames = 0;
+    stall_frames_seq = stall_seq;
+    _Unwind_Backtrace(stall_unwind, NULL);
+    __atomic_store_n(&stall_frames_ready, 1, __ATOMIC_RELEASE);
+}
+
+/**
+ * Get the backtrace of the event loop thread.
+ * @param s the stall to add the backtrace to.
+ * @param seq the sequence number of the stalled callback.
+ */
+static void stall_backtrace(struct stall *s, unsigned long seq)
+{
+    struct timespec tick = { 0, 1000000 };
+    int i;
+
+    __atomic_store_n(&stall_frames_ready, 0, __ATOMIC_RELAXED);
+    if (pthread_kill(stall_loop_thread, STALL_SIGNAL))
+        return;
+
+    for (i = 0; i < STALL_BACKTRACE_WAIT; ++i) {
+        if (__atomic_load_n(&stall_frames_ready, __ATOMIC_ACQUIRE)) {
+            /* The stalled callback returned before the signal arrived */
+            if (stall_frames_seq != seq)
+                return;
+
+            memcpy(s->frames, stall_frames, stall_n_frames * sizeof(void *));
+            s->n_frames = stall_n_frames;
+            return;
+        }
+        nanosleep(&tick, NULL);
+    }
+}
+
+/**
+ * End the current stall, from the thread that notices first.
+ * @param end_ms the time the loop returned.
+ */
+static void stall_finish(unsigned long end_ms)
+{
+    struct stall *s = __atomic_exchange_n(&stall_current, NULL, __ATOMIC_SEQ_CST);
+    const char *kind = "unknown", *name = NULL;
+    unsigned long duration;
+
+    if (!s)
+        return;
+
+    pthread_mutex_lock(&stall_lock);
+    duration = end_ms > s->start_ms ? end_ms - s->start_ms : 1;
+    s->duration_ms = duration;
+    if (s->n_scopes) {
+        kind = s->kinds[s->n_scopes - 1];
+        name = s->names[s->n_scopes - 1];
+    }
+    pthread_mutex_unlock(&stall_lock);
+
+    log_message(LOG_WARNING, "Event loop stalled for %lu ms in %s %s\r\n", duration, kind, name ? name : "");
+}
+
+/**
+ * Record a stall of the event loop.
+ * @param seq the sequence number of the stalled callback.
+ * @param since the time the stalled callback started.
+ * @param backtrace true to take a backtrace of the loop thread.
+ */
+static void stall_record(unsigned long seq, unsigned long since, bool backtrace)
+{
+    struct stall *s;
+    int i;
+
+    pthread_mutex_lock(&stall_lock);
+    s = &stalls[stall_next++ % STALL_HISTORY];
+    memset(s, 0, sizeof(*s));
+    s->start_ms = since;
+
+    s->n_scopes = __atomic_load_n(&stall_depth, __ATOMIC_ACQUIRE);
+    if (s->n_scopes > STALL_MAX_SCOPES)
+        s->n_scopes = STALL_MAX_SCOPES;
+    for (i = 0; i < s->n_scopes; ++i) {
+        s->kinds[i] = __atomic_load_n(&stall_kinds[i], __ATOMIC_RELAXED);
+        s->names[i] = __atomic_load_n(&stall_names[i], __ATOMIC_RELAXED);
+    }
+
+    /* The loop moved on while copying, the stack is of another callback */
+    if (__atomic_load_n(&stall_seq, __ATOMIC_ACQUIRE) != seq)
+        s->n_scopes = 0;
+
+    if (backtrace)
+        stall_backtrace(s, seq);
+
+    __atomic_store_n(&stall_current, s, __ATOMIC_SEQ_CST);
+    pthread_mutex_unlock(&stall_lock);
+
+    /* The loop did not see the stall when it returned in the meantime */
+    if (!__atomic_load_n(&stall_busy_since, __ATOMIC_SEQ_CST) ||
+            __atomic_load_n(&stall_seq, __ATOMIC_SEQ_CST) != seq)
+        stall_finish(stall_now_ms());
+}
+
+/**
+ * The watchdog thread, records a stall when a callback of the
+ * event loop runs too long.
+ * @param arg true to take backtraces.
+ * @return never returns.
+ */
+static void* stall_watchdog(void *arg)
+{
+    int period = stall_threshold > 4 ? stall_threshold / 4 : 1;
+    struct timespec tick = { period / 1000, (period % 1000) * 1000000 };
+    unsigned long reported = 0;
+    unsigned long seq, since;
+
+    while (true) {
+        nanosleep(&tick, NULL);
+
+        seq = __atomic_load_n(&stall_seq, __ATOMIC_ACQUIRE);
+        since = __atomic_load_n(&stall_busy_since, __ATOMIC_ACQUIRE);
+        if (!since || seq == reported || stall_now_ms() - since < stall_threshold)
+            continue;
+
+        /* The callback changed while reading */
+        if (__atomic_load_n(&stall_seq, __ATOMIC_ACQUIRE) != seq)
+            continue;
+
+        reported = seq;
+        stall_record(seq, since, arg != NULL);
+    }
+
+    return NULL;
+}
+
+/**
+ * Start the stall detector, must be called from the event loop thread.
+ * @param threshold_ms callbacks running longer than this are stalls.
+ * @param backtrace true to interrupt the loop thread for a backtrace.
+ * @return true when the watchdog thread is running.
+ */
+bool stall_init(int threshold_ms, bool backtrace)
+{
+    struct sigaction sa;
+    pthread_t thread;
+
+    if (threshold_ms <= 0)
+        return false;
+
+    if (backtrace) {
+        memset(&sa, 0, sizeof(sa));
+        sa.sa_handler = stall_signal;
+        sa.sa_flags = SA_RESTART;
+        sigemptyset(&sa.sa_mask);
+        if (sigaction(STALL_SIGNAL, &sa, NULL) < 0)
+            return false;
+    }
+
+    stall_loop_thread = pthread_self();
+    stall_threshold = threshold_ms;
+
+    if (pthread_create(&thread, NULL, stall_watchdog, backtrace ? &stall_loop_thread : NULL)) {
+        stall_threshold = 0;
+        return false;
+    }
+    pthread_detach(thread);
+
+    return true;
+}
+
+/**
+ * Enter an event loop callback, see STALL_SCOPE.
+ * @param kind the kind of callback.
+ * @param name the name of the callback.
+ * @return the number of enclosing callbacks.
+ */
+int stall_enter(const char *kind, const char *name)
+{
+    int depth = stall_depth;
+
+    if (!stall_threshold)
+        return depth;
+
+    if (depth < STALL_MAX_SCOPES) {
+        __atomic_store_n(&stall_kinds[depth], kind, __ATOMIC_RELAXED);
+        __atomic_store_n(&stall_names[depth], name, __ATOMIC_RELAXED);
+    }
+    __atomic_store_n(&stall_depth, depth + 1, __ATOMIC_RELEASE);
+
+    if (!depth) {
+        __atomic_store_n(&stall_seq, stall_seq + 1, __ATOMIC_RELEASE);
+        __atomic_store_n(&stall_busy_since, stall_now_ms(), __ATOMIC_RELEASE);
+    }
+
+    return depth;
+}
+
+/**
+ * Leave an event loop callback, see STALL_SCOPE.
+ * @param scope the scope going out of scope.
+ */
+void stall_leave(struct stall_scope *scope)
+{
+    if (!stall_threshold)
+        return;
+
+    __atomic_store_n(&stall_depth, scope->depth, __ATOMIC_RELEASE);
+    if (scope->depth)
+        return;
+
+    /* The loop is back, end the stall of this callback */
+    __atomic_store_n(&stall_busy_since, 0, __ATOMIC_SEQ_CST);
+    if (__atomic_load_n(&stall_current, __ATOMIC_SEQ_CST))
+        stall_finish(stall_now_ms());
+}
+
+/**
+ * Copy the recorded stalls.
+ * @param out the stalls, most recent first.
+ * @param n the maximum number of stalls to copy.
+ * @return the number of copied stalls.
+ */
+int stall_history(struct stall *out, int n)
+{
+    int i;
+
+    pthread_mutex_lock(&stall_lock);
+    for (i = 0; i < n && i < STALL_HISTORY && i < stall_next; ++i)
+        out[i] = stalls[(stall_next - 1 - i) % STALL_HISTORY];
+    pthread_mutex_unlock(&stall_lock);
+
+    return i;
+}
+
+/**
+ * Describe a backtrace frame as the object file and offset, with
+ * the symbol when it is exported.
+ * @param addr the return address.
+ * @param buf the output buffer.
+ * @param len the size of the output buffer.
+ */
+void stall_frame_name(void *addr, char *buf, size_t len)
+{
+    Dl_info info;
+
+    if (!dladdr(addr, &info) || !info.dli_fname) {
+        snprintf(buf, len, "%p", addr);
+        return;
+    }
+
+    if (info.dli_sname) {
+        snprintf(buf, len, "%s+%#lx (%s+%#lx)", info.dli_fname,
+            (unsigned long) ((char *) addr - (char *) info.dli_fbase), info.dli_sname,
+            (unsigned long) ((char *) addr - (char *) info.dli_saddr));
+    } else {
+        snprintf(buf, len, "%s+%#lx", info.dli_fname,
+            (unsigned long) ((char *) addr - (char *) info.dli_fbase));
+    }
+}
@@ -0,0 +1,108 @@
+/* 
+ * Copyright (c) 2014, Daan Pape
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without 
+ * modification, are permitted provided that the following conditions are met:
+ * 
+ *     1. Redistributions of source code must retain the above copyright 
+ *        notice, this list of conditions and the following disclaimer.
+ *
+ *     2. Redistributions in binary form must reproduce the above copyright 
+ *        notice, this list of conditions and the following disclaimer in the 
+ *        documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" 
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE 
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE 
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE 
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR 
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF 
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS 
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN 
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) 
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE 
+ * POSSIBILITY OF SUCH DAMAGE.
+ * File:   stall.h
+ * Created on October 18, 2026, 8:05 PM
+ */
+
+#ifndef STALL_H_
+#define STALL_H_
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "config.h"
+
+/**
+ * A callback running on the event loop thread, see STALL_SCOPE.
+ */
+struct stall_scope {
+    int depth;                              /* Number of enclosing callbacks */
+};
+
+/**
+ * An event loop callback that did not return within the threshold.
+ */
+struct stall {
+    unsigned long start_ms;                 /* Monotonic time the outermost callback started */
+    unsigned long duration_ms;              /* Time until the loop returned, 0 while still stalled */
+    int n_scopes;                           /* Number of recorded callbacks, outermost first */
+    const char *kinds[STALL_MAX_SCOPES];    /* The kind of callback: read, write, timer, route, ... */
+    const char *names[STALL_MAX_SCOPES];    /* Name of the callback, NULL when it has none */
+    int n_frames;                           /* Number of backtrace frames */
+    void *frames[STALL_MAX_FRAMES];         /* Return addresses of the stalled loop thread */
+};
+
+/**
+ * Mark the rest of the enclosing block as an event loop callback
+ * watched by the stall detector. Scopes nest, a stall in an API route
+ * is reported together with the read handler around it.
+ * @param kind the kind of callback, a string constant.
+ * @param name the name of the callback, a string that is never freed or NULL.
+ */
+#define STALL_SCOPE(kind, name) \
+    struct stall_scope stall_scope_ __attribute__((cleanup(stall_leave))) = \
+        { stall_enter(kind, name) }
+
+/**
+ * Start the stall detector, must be called from the event loop thread.
+ * @param threshold_ms callbacks running longer than this are stalls.
+ * @param backtrace true to interrupt the loop thread for a backtrace.
+ * @return true when the watchdog thread is running.
+ */
+bool stall_init(int threshold_ms, bool backtrace);
+
+/**
+ * Enter an event loop callback, see STALL_SCOPE.
+ * @param kind the kind of callback.
+ * @param name the name of the callback.
+ * @return the number of enclosing callbacks.
+ */
+int stall_enter(const char *kind, const char *name);
+
+/**
+ * Leave an event loop callback, see STALL_SCOPE.
+ * @param scope the scope going out of scope.
+ */
+void stall_leave(struct stall_scope *scope);
+
+/**
+ * Copy the recorded stalls.
+ * @param out the stalls, most recent first.
+ * @param n the maximum number of stalls to copy.
+ * @return the number of copied stalls.
+ */
+int stall_history(struct stall *out, int n);
+
+/**
+ * Describe a backtrace frame as the object file and offset, with
+ * the symbol when it is exported.
+ * @param addr the return address.
+ * @param buf the output buffer.
+ * @param len the size of the output buffer.
+ */
+void stall_frame_name(void *addr, char *buf, size_t len);
+
+#endif /* STALL_H_ */
@@ -36,6 +36,7 @@
 #include <sys/sysinfo.h>
 
 #include "../uhttpd.h"
+#include "../helper.h"
 #include "system.h"
 
 
@@ -58,9 +59,10 @@ char* system_get_model()
 {
 	FILE* fd;			/* File descriptor */
 	char *model = (char*) malloc(26*sizeof(char));	/* The system model, max 25 characters */
+	char path[HW_PATH_MAX];		/* Path of the model file */
 
 	/* Get the system model */
-	fd = fopen("/tmp/sysinfo/model", "r");
+	fd = fopen(helper_hw_path(path, sizeof(path), "/tmp/sysinfo/model"), "r");
 	if(fd == NULL || fgets(model, 25, fd) == NULL || fclose(fd) != 0){
 		return NULL;
 	}
@@ -79,11 +81,11 @@ char* system_get_model()
 bool system_is_eth_connected(int port)
 {
 	int fd;				/* File descriptor port state */
-	char buf[30];		/* Buffer for port path */
+	char buf[HW_PATH_MAX];	/* Buffer for port path */
 	bool state;			/* Character for reading the state */
 
 	/* Make the GPIO port path */
-	sprintf(buf, "/sys/class/net/eth%d/operstate", port);
+	helper_hw_path(buf, sizeof(buf), "/sys/class/net/eth%d/operstate", port);
 
 	/* Try to open device state file */
 	fd = open(buf, O_RDONLY);
@@ -121,9 +123,13 @@ const char* system_get_usb_storage_connection_state()
 	FILE *mounts = NULL;
 	struct mntent *mount_info;
 	bool is_mounted = false;
+	char sda[HW_PATH_MAX];
+	char sdb[HW_PATH_MAX];
 
 	/* Check if there is a sda or sdb device in '/dev' */
-	if(stat("/dev/sda", &s) == 0 || stat("/dev/sdb", &s) == 0){
+	helper_hw_path(sda, sizeof(sda), "/dev/sda");
+	helper_hw_path(sdb, sizeof(sdb), "/dev/sdb");
+	if(stat(sda, &s) == 0 || stat(sdb, &s) == 0){
 		/* A physical drive is connected, check if it is mounted on /mnt */
 		if((mounts = setmntent("/proc/mounts", "r")) != NULL){
 			while((mount_info = getmntent(mounts)) != NULL) {
@@ -33,6 +33,7 @@
 #include "../logger.h"
 #include "../uhttpd.h"
 #include "../helper.h"
+#include "../stall.h"
 
 #include "system.h"
 #include "system_json_api.h"
@@ -54,6 +55,10 @@ json_object* system_get_router(struct client *cl, char *request)
     {
         return system_get_overview(cl, request);
     }
+    else if (helper_str_startswith(request, "stalls", 0))
+    {
+        return system_get_stalls(cl, request);
+    }
     else
     {
         log_message(LOG_WARNING, "System API got unknown GET request '%s'\r\n", request);
@@ -140,3 +145,59 @@ json_object* system_get_overview(struct client *cl, char *request)
     cl->http_status = r_ok;
     return jobj;
 }
+
+/**
+ * Get the last event loop stalls, most recent first.
+ * @cl the client who made the request
+ * @request the request part of the url
+ */
+json_object* system_get_stalls(struct client *cl, char *request)
+{
+    struct stall *stalls = malloc(STALL_HISTORY * sizeof(struct stall));
+    json_object *jarr;
+    struct stall *s;
+    char frame[256];
+    int n, i, j;
+
+    if (!stalls) {
+        cl->http_status = r_error;
+        return NULL;
+    }
+
+    jarr = json_object_new_array();
+
+    n = stall_history(stalls, STALL_HISTORY);
+    for (i = 0; i < n; ++i) {
+        s = &stalls[i];
+        json_object *jobj = json_object_new_object();
+        json_object *j_callbacks = json_object_new_array();
+        json_object *j_backtrace = json_object_new_array();
+
+        /* Callbacks from the outermost to the innermost */
+        for (j = 0; j < s->n_scopes; ++j) {
+            json_object *j_callback = json_object_new_object();
+
+            json_object_object_add(j_callback, "kind", json_object_new_string(s->kinds[j]));
+            if (s->names[j])
+                json_object_object_add(j_callback, "name", json_object_new_string(s->names[j]));
+            json_object_array_add(j_callbacks, j_callback);
+        }
+
+        for (j = 0; j < s->n_frames; ++j) {
+            stall_frame_name(s->frames[j], frame, sizeof(frame));
+            json_object_array_add(j_backtrace, json_object_new_string(frame));
+        }
+
+        json_object_object_add(jobj, "start_ms", json_object_new_int64(s->start_ms));
+        json_object_object_add(jobj, "duration_ms", json_object_new_int64(s->duration_ms));
+        json_object_object_add(jobj, "ongoing", json_object_new_boolean(!s->duration_ms));
+        json_object_object_add(jobj, "callbacks", j_callbacks);
+        json_object_object_add(jobj, "backtrace", j_backtrace);
+        json_object_array_add(jarr, jobj);
+    }
+    free(stalls);
+
+    /* Return status ok */
+    cl->http_status = r_ok;
+    return jarr;
+}
@@ -57,5 +57,12 @@ json_object* system_get_free_disk_space(struct client *cl, char *request);
  */
 json_object* system_get_overview(struct client *cl, char *request);
 
+/**
+ * Get the last event loop stalls, most recent first.
+ * @cl the client who made the request
+ * @request the request part of the url
+ */
+json_object* system_get_stalls(struct client *cl, char *request);
+
 #endif
 
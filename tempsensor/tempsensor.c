@@ -34,7 +34,9 @@
 #include <fcntl.h>
 #include <unistd.h>
 
+#include "../config.h"
 #include "../logger.h"
+#include "../helper.h"
 #include "tempsensor.h"
 
 /**
@@ -48,9 +50,10 @@ float tempsensor_current_temp(int sensor)
     char buf[80];       /* Write buffer */
     int raw;            /* Temperature in RAW form */
     float temp;         /* Temperature in degrees celcius */
+    char path[HW_PATH_MAX]; /* Path of the sensor */
 
     /* Try to open GPIO port */
-    fd = open("/sys/devices/w1_bus_master1/28-000003ea41b5/w1_slave", O_RDONLY);
+    fd = open(helper_hw_path(path, sizeof(path), "/sys/devices/w1_bus_master1/28-000003ea41b5/w1_slave"), O_RDONLY);
     if(fd < 0) {
         /* The file could not be opened */
         return -1;
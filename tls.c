@@ -0,0 +1,507 @@
+/* 
+ * Copyright (c) 2014, Daan Pape
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without 
+ * modification, are permitted provided that the following conditions are met:
+ * 
+ *     1. Redistributions of source code must retain the above copyright 
+ *        notice, this list of conditions and the following disclaimer.
+ *
+ *     2. Redistributions in binary form must reproduce the above copyright 
+ *        notice, this list of conditions and the following disclaimer in the 
+ *        documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" 
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE 
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE 
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE 
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR 
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF 
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS 
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN 
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) 
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE 
+ * POSSIBILITY OF SUCH DAMAGE.
+ * 
+ * File:   tls.c
+ * Created on October 18, 2026, 9:12 AM
+ */
+
+#include <string.h>
+#include <openssl/ssl.h>
+#include <openssl/err.h>
+
+#include "uhttpd.h"
+#include "client.h"
+#include "config.h"
+#include "logger.h"
+#include "metrics.h"
+#include "stall.h"
+#include "tls.h"
+
+/* The session ID context, sessions are only resumed within this server */
+#define TLS_SESSION_ID_CONTEXT  "dpt-breakout-server"
+
+/* The server TLS context shared by all TLS clients */
+static SSL_CTX *ctx = NULL;
+
+/* The BIO method that moves encrypted data over a ustream */
+static BIO_METHOD *ustream_bio_method = NULL;
+
+/**
+ * Write encrypted data to the underlying connection.
+ * @param b the BIO that is written to.
+ * @param buf the data to write.
+ * @param len the length of the data.
+ * @return the number of bytes written.
+ */
+static int ustream_bio_write(BIO *b, const char *buf, int len)
+{
+    struct ustream *s = BIO_get_data(b);
+
+    BIO_clear_retry_flags(b);
+    return ustream_write(s, buf, len, false);
+}
+
+/**
+ * Read encrypted data from the underlying connection.
+ * @param b the BIO that is read from.
+ * @param buf the buffer to read into.
+ * @param len the size of the buffer.
+ * @return the number of bytes read, 0 on EOF and -1 when the read should be retried.
+ */
+static int ustream_bio_read(BIO *b, char *buf, int len)
+{
+    struct ustream *s = BIO_get_data(b);
+    char *sbuf;
+    int slen;
+
+    BIO_clear_retry_flags(b);
+
+    sbuf = ustream_get_read_buf(s, &slen);
+    slen = min(slen, len);
+    if (!sbuf || !slen) {
+        if (s->eof)
+            return 0;
+
+        BIO_set_retry_read(b);
+        return -1;
+    }
+
+    memcpy(buf, sbuf, slen);
+    ustream_consume(s, slen);
+
+    return slen;
+}
+
+/**
+ * Write a string to the underlying connection.
+ * @param b the BIO that is written to.
+ * @param str the string to write.
+ * @return the number of bytes written.
+ */
+static int ustream_bio_puts(BIO *b, const char *str)
+{
+    return ustream_bio_write(b, str, strlen(str));
+}
+
+/**
+ * Control the BIO, only flushing is supported and it is a no-op
+ * because ustream takes care of the write buffering.
+ */
+static long ustream_bio_ctrl(BIO *b, int cmd, long num, void *ptr)
+{
+    return cmd == BIO_CTRL_FLUSH;
+}
+
+/**
+ * Create a BIO on top of a ustream.
+ * @param s the stream carrying the encrypted data.
+ * @return the BIO or NULL on failure.
+ */
+static BIO* ustream_bio_new(struct ustream *s)
+{
+    BIO *b = BIO_new(ustream_bio_method);
+
+    if (!b)
+        return NULL;
+
+    BIO_set_data(b, s);
+    BIO_set_init(b, 1);
+
+    return b;
+}
+
+/**
+ * Notify the client about the error outside of the OpenSSL call stack.
+ */
+static void tls_error_timer_cb(struct uloop_timeout *t)
+{
+    struct uh_tls_stream *ts = container_of(t, struct uh_tls_stream, error_timer);
+
+    ts->stream.write_error = true;
+    ustream_state_change(&ts->stream);
+}
+
+/**
+ * Flag the TLS stream as failed.
+ * @param ts the failing TLS stream.
+ */
+static void tls_set_error(struct uh_tls_stream *ts)
+{
+    unsigned long err = ERR_get_error();
+
+    if (ts->error)
+        return;
+
+    if (err)
+        log_message(LOG_DEBUG, "TLS connection failed: %s\r\n", ERR_error_string(err, NULL));
+
+    ERR_clear_error();
+    ts->error = true;
+    uloop_timeout_set(&ts->error_timer, 0);
+}
+
+/**
+ * Drive the handshake of the TLS stream.
+ * @param ts the TLS stream.
+ * @return true when the handshake is completed.
+ */
+static bool tls_check_conn(struct uh_tls_stream *ts)
+{
+    int ret;
+
+    if (ts->connected)
+        return true;
+
+    ret = SSL_accept(ts->ssl);
+    if (ret == 1) {
+        ts->connected = true;
+        if (SSL_session_reused(ts->ssl))
+            log_message(LOG_DEBUG, "Resumed TLS session\r\n");
+
+        ustream_write_pending(&ts->stream);
+        return true;
+    }
+
+    switch (SSL_get_error(ts->ssl, ret)) {
+    case SSL_ERROR_WANT_READ:
+    case SSL_ERROR_WANT_WRITE:
+        return false;
+    default:
+        tls_set_error(ts);
+        return false;
+    }
+}
+
+/**
+ * Decrypt all available data from the connection into the
+ * read buffer of the TLS stream.
+ * @param ts the TLS stream.
+ */
+static void tls_check_read(struct uh_tls_stream *ts)
+{
+    char *buf;
+    int len, ret;
+
+    while (!ts->error) {
+        /* Stop when the plaintext buffer is full */
+        buf = ustream_reserve(&ts->stream, 1, &len);
+        if (!len)
+            break;
+
+        ret = SSL_read(ts->ssl, buf, len);
+        if (ret > 0) {
+            ustream_fill_read(&ts->stream, ret);
+            continue;
+        }
+
+        switch (SSL_get_error(ts->ssl, ret)) {
+        case SSL_ERROR_WANT_READ:
+        case SSL_ERROR_WANT_WRITE:
+            return;
+        case SSL_ERROR_ZERO_RETURN:
+            ts->stream.eof = true;
+            ustream_state_change(&ts->stream);
+            return;
+        default:
+            tls_set_error(ts);
+            return;
+        }
+    }
+}
+
+/**
+ * Handle encrypted data arriving on the connection.
+ */
+static void tls_conn_notify_read(struct ustream *s, int bytes)
+{
+    struct uh_tls_stream *ts = container_of(s->next, struct uh_tls_stream, stream);
+    STALL_SCOPE("read", "tls");
+
+    metrics_add(&metrics.bytes_in, bytes);
+    if (!tls_check_conn(ts))
+        return;
+
+    tls_check_read(ts);
+}
+
+/**
+ * Handle the connection write buffer draining, continue the
+ * handshake and push pending plaintext.
+ */
+static void tls_conn_notify_write(struct ustream *s, int bytes)
+{
+    struct uh_tls_stream *ts = container_of(s->next, struct uh_tls_stream, stream);
+    STALL_SCOPE("write", "tls");
+
+    if (!tls_check_conn(ts))
+        return;
+
+    ustream_write_pending(s->next);
+}
+
+/**
+ * Propagate a state change of the connection to the TLS stream.
+ */
+static void tls_conn_notify_state(struct ustream *s)
+{
+    s->next->write_error = true;
+    ustream_state_change(s->next);
+}
+
+/**
+ * Encrypt plaintext written to the TLS stream. Data is only accepted
+ * while the connection write buffer is empty, ustream keeps the rest
+ * buffered until tls_conn_notify_write.
+ */
+static int tls_stream_write(struct ustream *s, const char *buf, int len, bool more)
+{
+    struct uh_tls_stream *ts = container_of(s, struct uh_tls_stream, stream);
+    int ret;
+
+    if (!ts->connected || ts->error)
+        return 0;
+
+    if (ts->conn->w.data_bytes)
+        return 0;
+
+    ret = SSL_write(ts->ssl, buf, len);
+    if (ret < 0) {
+        switch (SSL_get_error(ts->ssl, ret)) {
+        case SSL_ERROR_WANT_READ:
+        case SSL_ERROR_WANT_WRITE:
+            return 0;
+        default:
+            tls_set_error(ts);
+            return -1;
+        }
+    }
+
+    return ret;
+}
+
+/**
+ * Forward read blocking of the TLS stream to the connection.
+ */
+static void tls_stream_set_read_blocked(struct ustream *s)
+{
+    struct uh_tls_stream *ts = container_of(s, struct uh_tls_stream, stream);
+
+    ustream_set_read_blocked(ts->conn, !!s->read_blocked);
+}
+
+/**
+ * Free the OpenSSL state of the TLS stream.
+ */
+static void tls_stream_free(struct ustream *s)
+{
+    struct uh_tls_stream *ts = container_of(s, struct uh_tls_stream, stream);
+
+    if (ts->conn) {
+        ts->conn->next = NULL;
+        ts->conn->notify_read = NULL;
+        ts->conn->notify_write = NULL;
+        ts->conn->notify_state = NULL;
+    }
+
+    uloop_timeout_cancel(&ts->error_timer);
+    SSL_free(ts->ssl);
+    ts->ssl = NULL;
+    ts->conn = NULL;
+    ts->connected = false;
+    ts->error = false;
+}
+
+/**
+ * Read callback of the TLS client stream.
+ */
+static void tls_client_read_cb(struct ustream *s, int bytes)
+{
+    struct client *cl = container_of(s, struct client, ssl.stream);
+
+    read_from_client(cl);
+}
+
+/**
+ * Write callback of the TLS client stream.
+ */
+static void tls_client_write_cb(struct ustream *s, int bytes)
+{
+    struct client *cl = container_of(s, struct client, ssl.stream);
+
+    client_notify_write(cl);
+}
+
+/**
+ * State change callback of the TLS client stream.
+ */
+static void tls_client_notify_state(struct ustream *s)
+{
+    struct client *cl = container_of(s, struct client, ssl.stream);
+
+    client_notify_state(cl);
+}
+
+/**
+ * Attach a TLS stream to a freshly accepted client, the
+ * client will read and write through the TLS stream.
+ * @param cl the client to attach the stream to.
+ */
+void uh_tls_client_attach(struct client *cl)
+{
+    struct uh_tls_stream *ts = &cl->ssl;
+    struct ustream *conn = &cl->sfd.stream;
+    BIO *bio;
+
+    memset(ts, 0, sizeof(*ts));
+    ts->conn = conn;
+    ts->error_timer.cb = tls_error_timer_cb;
+
+    ts->ssl = SSL_new(ctx);
+    bio = ts->ssl ? ustream_bio_new(conn) : NULL;
+    if (bio) {
+        SSL_set_bio(ts->ssl, bio, bio);
+        SSL_set_accept_state(ts->ssl);
+    } else {
+        tls_set_error(ts);
+    }
+
+    /* Chain the encrypted connection to the TLS stream */
+    conn->next = &ts->stream;
+    conn->notify_read = tls_conn_notify_read;
+    conn->notify_write = tls_conn_notify_write;
+    conn->notify_state = tls_conn_notify_state;
+    conn->r.max_buffers = 4;
+
+    ustream_init_defaults(&ts->stream);
+    ts->stream.write = tls_stream_write;
+    ts->stream.free = tls_stream_free;
+    ts->stream.set_read_blocked = tls_stream_set_read_blocked;
+
+    cl->us = &ts->stream;
+    cl->us->notify_read = tls_client_read_cb;
+    cl->us->notify_write = tls_client_write_cb;
+    cl->us->notify_state = tls_client_notify_state;
+}
+
+/**
+ * Detach and free the TLS stream of a client.
+ * @param cl the client to detach the stream from.
+ */
+void uh_tls_client_detach(struct client *cl)
+{
+    ustream_free(&cl->ssl.stream);
+}
+
+/**
+ * Select the application protocol, h2 is preferred when enabled.
+ */
+static int tls_alpn_select(SSL *ssl, const unsigned char **out, unsigned char *outlen,
+        const unsigned char *in, unsigned int inlen, void *arg)
+{
+    static const unsigned char protos[] = "\x02h2\x08http/1.1";
+    const unsigned char *list = conf->http2 ? protos : protos + 3;
+    unsigned int len = conf->http2 ? sizeof(protos) - 1 : sizeof(protos) - 4;
+
+    if (SSL_select_next_proto((unsigned char **) out, outlen, list, len, in, inlen) != OPENSSL_NPN_NEGOTIATED)
+        return SSL_TLSEXT_ERR_NOACK;
+
+    return SSL_TLSEXT_ERR_OK;
+}
+
+/**
+ * Create the server TLS context, load the certificate and key and
+ * set up the session cache and session tickets.
+ * @param cert the PEM certificate (chain) file, RSA or ECDSA.
+ * @param key the PEM private key file.
+ * @return true on success.
+ */
+bool uh_tls_init(const char *cert, const char *key)
+{
+    long options = SSL_OP_NO_COMPRESSION | SSL_OP_CIPHER_SERVER_PREFERENCE;
+
+    if (ctx)
+        return true;
+
+    ustream_bio_method = BIO_meth_new(BIO_get_new_index() | BIO_TYPE_SOURCE_SINK, "ustream");
+    if (!ustream_bio_method)
+        goto error;
+
+    BIO_meth_set_write(ustream_bio_method, ustream_bio_write);
+    BIO_meth_set_read(ustream_bio_method, ustream_bio_read);
+    BIO_meth_set_puts(ustream_bio_method, ustream_bio_puts);
+    BIO_meth_set_ctrl(ustream_bio_method, ustream_bio_ctrl);
+
+    ctx = SSL_CTX_new(TLS_server_method());
+    if (!ctx)
+        goto error;
+
+    SSL_CTX_set_min_proto_version(ctx, TLS1_2_VERSION);
+
+    /* The key type follows the certificate, ECDSA keeps full handshakes cheap */
+    if (SSL_CTX_use_certificate_chain_file(ctx, cert) != 1) {
+        log_message(LOG_ERROR, "Could not load TLS certificate '%s'\r\n", cert);
+        goto error;
+    }
+
+    if (SSL_CTX_use_PrivateKey_file(ctx, key, SSL_FILETYPE_PEM) != 1 || SSL_CTX_check_private_key(ctx) != 1) {
+        log_message(LOG_ERROR, "Could not load TLS private key '%s'\r\n", key);
+        goto error;
+    }
+
+    /* Prefer ciphers without AES hardware requirements and cheap key exchange */
+    if (SSL_CTX_set_cipher_list(ctx, conf->tls_ciphers) != 1)
+        log_message(LOG_WARNING, "Invalid TLS cipher list '%s', using defaults\r\n", conf->tls_ciphers);
+    SSL_CTX_set_ciphersuites(ctx, TLS_CIPHERSUITES);
+    SSL_CTX_set1_groups_list(ctx, TLS_GROUPS);
+
+    /* Session cache for session ID resumption (TLS 1.2) */
+    SSL_CTX_set_session_id_context(ctx, (const unsigned char *) TLS_SESSION_ID_CONTEXT, strlen(TLS_SESSION_ID_CONTEXT));
+    SSL_CTX_set_session_cache_mode(ctx, conf->tls_session_cache > 0 ? SSL_SESS_CACHE_SERVER : SSL_SESS_CACHE_OFF);
+    SSL_CTX_sess_set_cache_size(ctx, conf->tls_session_cache);
+    SSL_CTX_set_timeout(ctx, conf->tls_session_timeout);
+
+    /*
+     * Session tickets keep the resumption state at the client. The ticket
+     * keys are generated at startup and live as long as the server. One
+     * ticket per TLS 1.3 handshake is enough for a single client connection.
+     */
+    if (!conf->tls_tickets)
+        options |= SSL_OP_NO_TICKET;
+    SSL_CTX_set_num_tickets(ctx, 1);
+
+    SSL_CTX_set_options(ctx, options);
+    SSL_CTX_set_alpn_select_cb(ctx, tls_alpn_select, NULL);
+    SSL_CTX_set_mode(ctx, SSL_MODE_ENABLE_PARTIAL_WRITE | SSL_MODE_RELEASE_BUFFERS);
+
+    return true;
+
+error:
+    if (ctx)
+        SSL_CTX_free(ctx);
+    ctx = NULL;
+
+    return false;
+}
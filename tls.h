@@ -0,0 +1,91 @@
+/* 
+ * Copyright (c) 2014, Daan Pape
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without 
+ * modification, are permitted provided that the following conditions are met:
+ * 
+ *     1. Redistributions of source code must retain the above copyright 
+ *        notice, this list of conditions and the following disclaimer.
+ *
+ *     2. Redistributions in binary form must reproduce the above copyright 
+ *        notice, this list of conditions and the following disclaimer in the 
+ *        documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" 
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE 
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE 
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE 
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR 
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF 
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS 
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN 
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) 
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE 
+ * POSSIBILITY OF SUCH DAMAGE.
+ * 
+ * File:   tls.h
+ * Created on October 18, 2026, 9:12 AM
+ */
+
+#ifndef TLS_H_
+#define TLS_H_
+
+#include <stdbool.h>
+#include <libubox/uloop.h>
+#include <libubox/ustream.h>
+
+struct client;
+
+#ifdef HAVE_TLS
+
+/**
+ * TLS stream, wraps a connected ustream and presents the
+ * decrypted data as a ustream of its own.
+ */
+struct uh_tls_stream {
+    struct ustream stream;          /* The plaintext stream handed to the client */
+    struct ustream *conn;           /* The underlying encrypted connection */
+    struct uloop_timeout error_timer; /* Deferred error notification */
+    void *ssl;                      /* The OpenSSL connection object */
+    bool connected;                 /* True when the handshake is completed */
+    bool error;                     /* True when the connection failed */
+};
+
+/**
+ * Create the server TLS context, load the certificate and key and
+ * set up the session cache and session tickets.
+ * @param cert the PEM certificate (chain) file, RSA or ECDSA.
+ * @param key the PEM private key file.
+ * @return true on success.
+ */
+bool uh_tls_init(const char *cert, const char *key);
+
+/**
+ * Attach a TLS stream to a freshly accepted client, the
+ * client will read and write through the TLS stream.
+ * @param cl the client to attach the stream to.
+ */
+void uh_tls_client_attach(struct client *cl);
+
+/**
+ * Detach and free the TLS stream of a client.
+ * @param cl the client to detach the stream from.
+ */
+void uh_tls_client_detach(struct client *cl);
+
+#else
+
+static inline bool uh_tls_init(const char *cert, const char *key) {
+    return false;
+}
+
+static inline void uh_tls_client_attach(struct client *cl) {
+}
+
+static inline void uh_tls_client_detach(struct client *cl) {
+}
+
+#endif
+
+#endif /* TLS_H_ */
@@ -0,0 +1,131 @@
+#!/bin/sh
+# Copyright (c) 2014, Daan Pape
+# All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without 
+# modification, are permitted provided that the following conditions are met:
+# 
+#     1. Redistributions of source code must retain the above copyright 
+#        notice, this list of conditions and the following disclaimer.
+#
+#     2. Redistributions in binary form must reproduce the above copyright 
+#        notice, this list of conditions and the following disclaimer in the 
+#        documentation and/or other materials provided with the distribution.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" 
+# AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE 
+# IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE 
+# ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE 
+# LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR 
+# CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF 
+# SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS 
+# INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN 
+# CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) 
+# ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE 
+# POSSIBILITY OF SUCH DAMAGE.
+#
+# File:   bench.sh
+# Created on October 18, 2026, 8:40 PM
+#
+# Run the HTTP benchmark scenarios against a server started on a temporary
+# document root and configuration, the results are written as JSON.
+#
+# Usage: bench.sh <server binary> <bench-load binary> [output file]
+#
+# BENCH_PORT and BENCH_DURATION (seconds per scenario) override the defaults.
+# When BENCH_HWSIM names the shim of tools/hwsim_preload.c the server runs
+# on a simulated board and the hardware routes are benchmarked as well.
+
+SERVER=$1
+LOAD=$2
+OUTPUT=${3:-bench.json}
+PORT=${BENCH_PORT:-18480}
+DURATION=${BENCH_DURATION:-5}
+
+if [ ! -x "$SERVER" ] || [ ! -x "$LOAD" ]; then
+    echo "Usage: $0 <server binary> <bench-load binary> [output file]" >&2
+    exit 1
+fi
+
+DIR=$(mktemp -d)
+PID=
+
+cleanup() {
+    [ -n "$PID" ] && kill "$PID" 2>/dev/null
+    rm -rf "$DIR"
+}
+trap cleanup EXIT INT TERM
+
+# Document root with a small page and a large download
+mkdir "$DIR/www"
+head -c 1024 /dev/zero | tr '\0' 'a' > "$DIR/www/small.html"
+head -c 1048576 /dev/zero > "$DIR/www/large.bin"
+
+# A batch of API reads as POST body
+printf '[' > "$DIR/batch.json"
+for i in 1 2 3 4 5 6 7; do
+    printf '{"method":"GET","path":"/api/system/stalls"},' >> "$DIR/batch.json"
+done
+printf '{"method":"GET","path":"/api/system/stalls"}]' >> "$DIR/batch.json"
+
+cat > "$DIR/breakout.conf" <<CONF
+daemon false
+log_level error
+listen_port $PORT
+database $DIR/breakout.db
+document_root $DIR/www
+keep_alive_time 60
+network_timeout 60
+stall_threshold 0
+CONF
+
+if [ -n "$BENCH_HWSIM" ]; then
+    sh "$(dirname "$0")/hwsim.sh" "$DIR/hw" || exit 1
+    echo "hardware_root $DIR/hw" >> "$DIR/breakout.conf"
+    export HWSIM_ROOT="$DIR/hw"
+fi
+
+# The idle connections need a file descriptor each
+ulimit -n 4096 2>/dev/null
+
+LD_PRELOAD=${BENCH_HWSIM:+$(realpath "$BENCH_HWSIM")} \
+    "$SERVER" -c "$DIR/breakout.conf" > "$DIR/server.log" 2>&1 &
+PID=$!
+
+# Run one scenario and append its result
+FIRST=1
+run() {
+    RESULT=$("$LOAD" -p "$PORT" -d "$DURATION" "$@") || {
+        echo "Scenario failed: $*" >&2
+        cat "$DIR/server.log" >&2
+        exit 1
+    }
+    echo "$RESULT" >&2
+    [ $FIRST -eq 1 ] || printf ',\n' >> "$DIR/results"
+    printf '    %s' "$RESULT" >> "$DIR/results"
+    FIRST=0
+}
+
+: > "$DIR/results"
+run -n static-small-keepalive -c 32 -k -u /small.html
+run -n static-small-close -c 32 -u /small.html
+run -n static-large-keepalive -c 8 -k -u /large.bin
+run -n static-large-close -c 8 -u /large.bin
+run -n api-get-pipelined -c 8 -k -P 16 -u /api/system/stalls
+# The server closes the connection after a request with a body
+run -n api-post-batch -c 16 -m POST -b "$DIR/batch.json" -u /api/batch
+run -n idle-1k -c 16 -k -i 1000 -u /small.html
+
+if [ -n "$BENCH_HWSIM" ]; then
+    run -n gpio-state -c 8 -k -u /api/gpio/state/6
+    run -n gpio-direction -c 8 -k -m PUT -u /api/gpio/dir/6/0
+    run -n tempsensor-read -c 4 -k -u /api/tempsensor/read
+fi
+
+{
+    printf '{\n  "duration_s": %s,\n  "scenarios": [\n' "$DURATION"
+    cat "$DIR/results"
+    printf '\n  ]\n}\n'
+} > "$OUTPUT"
+
+echo "Benchmark results written to $OUTPUT" >&2
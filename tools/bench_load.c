@@ -0,0 +1,597 @@
+/* 
+ * Copyright (c) 2014, Daan Pape
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without 
+ * modification, are permitted provided that the following conditions are met:
+ * 
+ *     1. Redistributions of source code must retain the above copyright 
+ *        notice, this list of conditions and the following disclaimer.
+ *
+ *     2. Redistributions in binary form must reproduce the above copyright 
+ *        notice, this list of conditions and the following disclaimer in the 
+ *        documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" 
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE 
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE 
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE 
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR 
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF 
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS 
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN 
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) 
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE 
+ * POSSIBILITY OF SUCH DAMAGE.
+ * File:   bench_load.c
+ * Created on October 18, 2026, 8:40 PM
+ *
+ * Host side HTTP/1.1 load generator for the benchmark suite, it drives
+ * many connections from one epoll loop and prints the result of one
+ * scenario as a JSON object. Build it with the native compiler:
+ *
+ *   cc -std=gnu99 -O2 -o bench-load tools/bench_load.c
+ *
+ * Usage: bench-load [options]
+ *   -n name      scenario name in the output
+ *   -H host      server address, default 127.0.0.1
+ *   -p port      server port, default 80
+ *   -u path      request path, default /
+ *   -m method    request method, default GET
+ *   -b file      request body, sent with every request
+ *   -c conns     number of loaded connections, default 16
+ *   -k           keep connections alive, else one request per connection
+ *   -P depth     pipelined requests per connection, default 1
+ *   -i idle      number of extra idle connections held open
+ *   -d seconds   duration of the run, default 5
+ */
+
+#define _GNU_SOURCE
+#include <errno.h>
+#include <fcntl.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <time.h>
+#include <unistd.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/epoll.h>
+#include <sys/resource.h>
+#include <sys/socket.h>
+
+/* Maximum number of pipelined requests per connection */
+#define PIPELINE_MAX            64
+
+/* Sub-buckets per power of two of the latency histogram */
+#define HIST_SUB_BITS           4
+#define HIST_SUB                (1 << HIST_SUB_BITS)
+#define HIST_MAX_BITS           32
+#define HIST_BUCKETS            ((HIST_MAX_BITS - HIST_SUB_BITS + 1) * HIST_SUB)
+
+/* Time to wait for the server to accept connections in seconds */
+#define SERVER_WAIT             10
+
+/* Initial size of the receive buffer of a connection */
+#define RECV_BUFFER             16384
+
+/* States of a connection */
+enum conn_state {
+    CONN_CONNECTING,
+    CONN_ACTIVE,
+    CONN_IDLE,
+};
+
+/**
+ * A connection to the server.
+ */
+struct conn {
+    int fd;
+    enum conn_state state;
+    bool idle;                              /* True for connections that never send */
+    char *rbuf;                             /* Received bytes not parsed yet */
+    size_t rlen;
+    size_t rcap;
+    uint64_t written;                       /* Request bytes written on this connection */
+    uint64_t queued;                        /* Request bytes queued on this connection */
+    uint64_t sent[PIPELINE_MAX];            /* Queue time of the outstanding requests */
+    int head;                               /* Oldest outstanding request */
+    int inflight;                           /* Number of outstanding requests */
+};
+
+/**
+ * A log-linear latency histogram.
+ */
+struct hist {
+    uint64_t buckets[HIST_BUCKETS];
+    uint64_t count;
+    uint64_t max;
+};
+
+/* Options */
+static const char *name = "unnamed";
+static const char *host = "127.0.0.1";
+static int port = 80;
+static const char *path = "/";
+static const char *method = "GET";
+static const char *body_file;
+static int n_conns = 16;
+static bool keepalive;
+static int depth = 1;
+static int n_idle;
+static int duration = 5;
+
+/* The request repeated PIPELINE_MAX + 1 times, written from any offset */
+static char *requests;
+static size_t request_len;
+
+static struct sockaddr_in server;
+static int epfd;
+static struct hist latency;
+static uint64_t completed;
+static uint64_t errors;
+static uint64_t connects;
+static uint64_t idle_dropped;
+static uint64_t bytes_in;
+
+/**
+ * Get the monotonic time.
+ * @return the time in microseconds.
+ */
+static uint64_t now_us(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t) ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+/**
+ * Record a latency.
+ * @param h the histogram.
+ * @param us the latency in microseconds.
+ */
+static void hist_add(struct hist *h, uint64_t us)
+{
+    int bits, i;
+
+    if (us < HIST_SUB) {
+        i = us;
+    } else {
+        bits = 63 - __builtin_clzll(us);
+        if (bits >= HIST_MAX_BITS)
+            i = HIST_BUCKETS - 1;
+        else
+            i = (bits - HIST_SUB_BITS + 1) * HIST_SUB + (us >> (bits - HIST_SUB_BITS)) - HIST_SUB;
+    }
+
+    h->buckets[i]++;
+    h->count++;
+    if (us > h->max)
+        h->max = us;
+}
+
+/**
+ * Get a quantile of the latency.
+ * @param h the histogram.
+ * @param q the quantile between 0 and 1.
+ * @return the highest latency in the bucket of the quantile in microseconds.
+ */
+static uint64_t hist_quantile(struct hist *h, double q)
+{
+    uint64_t rank = q * h->count + 0.5, count = 0, value;
+    int i;
+
+    if (!h->count)
+        return 0;
+    if (rank < 1)
+        rank = 1;
+
+    for (i = 0; i < HIST_BUCKETS - 1; ++i) {
+        count += h->buckets[i];
+        if (count >= rank)
+            break;
+    }
+
+    if (i < HIST_SUB)
+        value = i;
+    else
+        value = ((uint64_t) (HIST_SUB + i % HIST_SUB + 1) << (i / HIST_SUB - 1)) - 1;
+
+    return value < h->max ? value : h->max;
+}
+
+/**
+ * Build the request that is sent on the connections.
+ * @return false when the body could not be read.
+ */
+static bool build_request(void)
+{
+    char *body = NULL, *req;
+    size_t body_len = 0;
+    FILE *f;
+    int i;
+
+    if (body_file) {
+        f = fopen(body_file, "r");
+        if (!f)
+            return false;
+        fseek(f, 0, SEEK_END);
+        body_len = ftell(f);
+        rewind(f);
+        body = malloc(body_len + 1);
+        if (!body || fread(body, 1, body_len, f) != body_len) {
+            fclose(f);
+            return false;
+        }
+        fclose(f);
+    }
+
+    req = malloc(512 + body_len);
+    if (!req)
+        return false;
+
+    request_len = sprintf(req, "%s %s HTTP/1.1\r\nHost: %s\r\nUser-Agent: bench-load\r\n%s",
+        method, path, host, keepalive ? "" : "Connection: close\r\n");
+    if (body) {
+        request_len += sprintf(req + request_len, "Content-Type: application/json\r\nContent-Length: %zu\r\n", body_len);
+    }
+    request_len += sprintf(req + request_len, "\r\n");
+    if (body) {
+        memcpy(req + request_len, body, body_len);
+        request_len += body_len;
+    }
+
+    requests = malloc(request_len * (PIPELINE_MAX + 1));
+    if (!requests)
+        return false;
+    for (i = 0; i <= PIPELINE_MAX; ++i)
+        memcpy(requests + i * request_len, req, request_len);
+
+    free(req);
+    free(body);
+    return true;
+}
+
+/**
+ * Open a connection to the server.
+ * @param c the connection.
+ * @return false when the socket could not be created.
+ */
+static bool conn_open(struct conn *c)
+{
+    struct epoll_event ev;
+    int one = 1;
+
+    c->fd = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK, 0);
+    if (c->fd < 0)
+        return false;
+    setsockopt(c->fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+
+    if (connect(c->fd, (struct sockaddr *) &server, sizeof(server)) < 0 && errno != EINPROGRESS) {
+        close(c->fd);
+        return false;
+    }
+
+    c->state = CONN_CONNECTING;
+    c->rlen = 0;
+    c->written = c->queued = 0;
+    c->head = c->inflight = 0;
+    connects++;
+
+    ev.events = EPOLLIN | EPOLLOUT;
+    ev.data.ptr = c;
+    epoll_ctl(epfd, EPOLL_CTL_ADD, c->fd, &ev);
+    return true;
+}
+
+/**
+ * Close a connection.
+ * @param c the connection.
+ */
+static void conn_close(struct conn *c)
+{
+    epoll_ctl(epfd, EPOLL_CTL_DEL, c->fd, NULL);
+    close(c->fd);
+    c->fd = -1;
+}
+
+/**
+ * Queue requests on a connection.
+ * @param c the connection.
+ * @param n the number of requests.
+ */
+static void conn_queue(struct conn *c, int n)
+{
+    uint64_t now = now_us();
+
+    while (n-- > 0) {
+        c->sent[(c->head + c->inflight) % PIPELINE_MAX] = now;
+        c->inflight++;
+        c->queued += request_len;
+    }
+}
+
+/**
+ * Write the queued requests of a connection.
+ * @param c the connection.
+ * @return false when the connection failed.
+ */
+static bool conn_write(struct conn *c)
+{
+    struct epoll_event ev;
+    ssize_t n;
+
+    while (c->written < c->queued) {
+        n = write(c->fd, requests + c->written % request_len, c->queued - c->written);
+        if (n < 0) {
+            if (errno == EAGAIN)
+                break;
+            return false;
+        }
+        c->written += n;
+    }
+
+    ev.events = EPOLLIN | (c->written < c->queued ? EPOLLOUT : 0);
+    ev.data.ptr = c;
+    epoll_ctl(epfd, EPOLL_CTL_MOD, c->fd, &ev);
+    return true;
+}
+
+/**
+ * Get the length of a complete response at the start of a buffer.
+ * @param buf the received bytes.
+ * @param len the number of received bytes.
+ * @param status set to the status code of the response.
+ * @param close set to true when the server closes the connection after it.
+ * @return the length of the response, 0 when it is not complete yet.
+ */
+static size_t response_length(char *buf, size_t len, int *status, bool *close)
+{
+    char *end, *p, *chunk;
+    size_t header_len, body_len = 0;
+
+    end = memmem(buf, len, "\r\n\r\n", 4);
+    if (!end)
+        return 0;
+    header_len = end + 4 - buf;
+
+    *status = 0;
+    if (len > 12)
+        *status = atoi(buf + 9);
+
+    /* Only the header is parsed as a string */
+    *end = 0;
+    p = strcasestr(buf, "\r\nContent-Length:");
+    if (p)
+        body_len = strtoul(p + 17, NULL, 10);
+    chunk = strcasestr(buf, "\r\nTransfer-Encoding: chunked");
+    *close = strcasestr(buf, "\r\nConnection: close") != NULL;
+    *end = '\r';
+
+    if (chunk) {
+        p = memmem(buf + header_len, len - header_len, "\r\n0\r\n\r\n", 7);
+        return p ? (size_t) (p + 7 - buf) : 0;
+    }
+
+    if (header_len + body_len > len)
+        return 0;
+
+    return header_len + body_len;
+}
+
+/**
+ * Read from a connection and account the complete responses.
+ * @param c the connection.
+ * @return false when the connection was closed.
+ */
+static bool conn_read(struct conn *c)
+{
+    size_t used;
+    ssize_t n;
+    int status;
+    bool close;
+
+    while (true) {
+        if (c->rcap - c->rlen < RECV_BUFFER / 2) {
+            c->rcap *= 2;
+            c->rbuf = realloc(c->rbuf, c->rcap);
+        }
+
+        n = read(c->fd, c->rbuf + c->rlen, c->rcap - c->rlen - 1);
+        if (n < 0)
+            return errno == EAGAIN;
+        if (!n)
+            return false;
+
+        bytes_in += n;
+        c->rlen += n;
+        if (c->idle)
+            c->rlen = 0;
+
+        while (c->inflight && (used = response_length(c->rbuf, c->rlen, &status, &close)) > 0) {
+            hist_add(&latency, now_us() - c->sent[c->head]);
+            c->head = (c->head + 1) % PIPELINE_MAX;
+            c->inflight--;
+            completed++;
+            if (status < 200 || status >= 400)
+                errors++;
+
+            memmove(c->rbuf, c->rbuf + used, c->rlen - used);
+            c->rlen -= used;
+
+            /* The server does not keep every request alive, POST requests for example */
+            if (!keepalive || close)
+                return false;
+
+            conn_queue(c, 1);
+        }
+    }
+}
+
+/**
+ * Handle an event on a connection.
+ * @param c the connection.
+ * @param events the epoll events.
+ */
+static void conn_event(struct conn *c, uint32_t events)
+{
+    int err = 0;
+    socklen_t sl = sizeof(err);
+
+    if (c->state == CONN_CONNECTING) {
+        if (!(events & (EPOLLOUT | EPOLLERR | EPOLLHUP)))
+            return;
+
+        getsockopt(c->fd, SOL_SOCKET, SO_ERROR, &err, &sl);
+        if (err) {
+            errors++;
+            conn_close(c);
+            conn_open(c);
+            return;
+        }
+
+        c->state = c->idle ? CONN_IDLE : CONN_ACTIVE;
+        if (!c->idle)
+            conn_queue(c, depth);
+    }
+
+    if ((events & (EPOLLIN | EPOLLERR | EPOLLHUP)) && !conn_read(c)) {
+        if (c->idle)
+            idle_dropped++;
+        else if (c->inflight)
+            errors++;
+        conn_close(c);
+        conn_open(c);
+        return;
+    }
+
+    if (!conn_write(c)) {
+        errors++;
+        conn_close(c);
+        conn_open(c);
+    }
+}
+
+/**
+ * Wait until the server accepts connections.
+ * @return false when it did not within SERVER_WAIT seconds.
+ */
+static bool wait_for_server(void)
+{
+    int i, fd;
+
+    for (i = 0; i < SERVER_WAIT * 10; ++i) {
+        fd = socket(AF_INET, SOCK_STREAM, 0);
+        if (fd < 0)
+            return false;
+        if (connect(fd, (struct sockaddr *) &server, sizeof(server)) == 0) {
+            close(fd);
+            return true;
+        }
+        close(fd);
+        usleep(100000);
+    }
+
+    return false;
+}
+
+int main(int argc, char **argv)
+{
+    struct epoll_event events[256];
+    struct rlimit rl;
+    struct conn *conns;
+    uint64_t start, end, elapsed;
+    int total, opt, i, n;
+
+    while ((opt = getopt(argc, argv, "n:H:p:u:m:b:c:kP:i:d:")) != -1) {
+        switch (opt) {
+            case 'n': name = optarg; break;
+            case 'H': host = optarg; break;
+            case 'p': port = atoi(optarg); break;
+            case 'u': path = optarg; break;
+            case 'm': method = optarg; break;
+            case 'b': body_file = optarg; break;
+            case 'c': n_conns = atoi(optarg); break;
+            case 'k': keepalive = true; break;
+            case 'P': depth = atoi(optarg); break;
+            case 'i': n_idle = atoi(optarg); break;
+            case 'd': duration = atoi(optarg); break;
+            default:
+                fprintf(stderr, "Usage: %s [-n name] [-H host] [-p port] [-u path] [-m method] [-b body file]\n"
+                    "       [-c connections] [-k] [-P pipeline depth] [-i idle connections] [-d seconds]\n", argv[0]);
+                return EXIT_FAILURE;
+        }
+    }
+
+    if (n_conns < 1 || depth < 1 || depth > PIPELINE_MAX || (!keepalive && depth > 1)) {
+        fprintf(stderr, "Invalid connection count or pipeline depth\n");
+        return EXIT_FAILURE;
+    }
+
+    memset(&server, 0, sizeof(server));
+    server.sin_family = AF_INET;
+    server.sin_port = htons(port);
+    if (inet_pton(AF_INET, host, &server.sin_addr) != 1) {
+        fprintf(stderr, "Invalid server address %s\n", host);
+        return EXIT_FAILURE;
+    }
+
+    if (!build_request()) {
+        fprintf(stderr, "Could not read the request body\n");
+        return EXIT_FAILURE;
+    }
+
+    /* Idle connections need a file descriptor each */
+    total = n_conns + n_idle;
+    if (!getrlimit(RLIMIT_NOFILE, &rl) && rl.rlim_cur < (rlim_t) total + 64) {
+        rl.rlim_cur = rl.rlim_max;
+        setrlimit(RLIMIT_NOFILE, &rl);
+    }
+
+    if (!wait_for_server()) {
+        fprintf(stderr, "Server %s:%d does not accept connections\n", host, port);
+        return EXIT_FAILURE;
+    }
+
+    epfd = epoll_create1(0);
+    conns = calloc(total, sizeof(*conns));
+    if (epfd < 0 || !conns)
+        return EXIT_FAILURE;
+
+    /* Open the idle connections first so the load runs next to them */
+    for (i = 0; i < total; ++i) {
+        conns[i].idle = i < n_idle;
+        conns[i].rcap = RECV_BUFFER;
+        conns[i].rbuf = malloc(RECV_BUFFER);
+        if (!conns[i].rbuf || !conn_open(&conns[i])) {
+            fprintf(stderr, "Could not open connection %d: %s\n", i, strerror(errno));
+            return EXIT_FAILURE;
+        }
+    }
+
+    start = now_us();
+    end = start + (uint64_t) duration * 1000000;
+    while (now_us() < end) {
+        n = epoll_wait(epfd, events, 256, 10);
+        for (i = 0; i < n; ++i)
+            conn_event(events[i].data.ptr, events[i].events);
+    }
+    elapsed = now_us() - start;
+
+    printf("{\"scenario\":\"%s\",\"connections\":%d,\"idle\":%d,\"keepalive\":%s,\"pipeline\":%d,"
+        "\"duration_s\":%.3f,\"requests\":%llu,\"errors\":%llu,\"connects\":%llu,\"idle_dropped\":%llu,"
+        "\"rps\":%.1f,\"mbps\":%.2f,\"p50_us\":%llu,\"p99_us\":%llu,\"p999_us\":%llu,\"max_us\":%llu}\n",
+        name, n_conns, n_idle, keepalive ? "true" : "false", depth,
+        elapsed / 1e6, (unsigned long long) completed, (unsigned long long) errors,
+        (unsigned long long) connects, (unsigned long long) idle_dropped,
+        completed * 1e6 / elapsed, bytes_in * 8.0 / elapsed,
+        (unsigned long long) hist_quantile(&latency, 0.5), (unsigned long long) hist_quantile(&latency, 0.99),
+        (unsigned long long) hist_quantile(&latency, 0.999), (unsigned long long) latency.max);
+
+    return EXIT_SUCCESS;
+}
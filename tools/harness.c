@@ -0,0 +1,354 @@
+/* 
+ * Copyright (c) 2014, Daan Pape
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without 
+ * modification, are permitted provided that the following conditions are met:
+ * 
+ *     1. Redistributions of source code must retain the above copyright 
+ *        notice, this list of conditions and the following disclaimer.
+ *
+ *     2. Redistributions in binary form must reproduce the above copyright 
+ *        notice, this list of conditions and the following disclaimer in the 
+ *        documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" 
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE 
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE 
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE 
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR 
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF 
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS 
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN 
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) 
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE 
+ * POSSIBILITY OF SUCH DAMAGE.
+ * 
+ * File:   harness.c
+ * Created on October 18, 2026, 10:50 PM
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <arpa/inet.h>
+#include <libubox/uloop.h>
+#include <libubox/ustream.h>
+
+#include "../uhttpd.h"
+#include "../client.h"
+#include "../config.h"
+#include "../logger.h"
+#include "../main.h"
+#include "../database/database.h"
+#include "../gpio/gpio.h"
+#include "../gpio/gpio_monitor.h"
+#include "harness.h"
+
+/* The memory stream of the virtual client */
+struct harness_stream {
+    struct ustream us;              /* The stream the client reads from and writes to */
+    struct client *cl;              /* The virtual client, NULL once closed */
+    struct metrics_timing timing;   /* Time stamps of the finished request */
+    char *buf;                      /* The captured response */
+    size_t len;                     /* Length of the captured response */
+    size_t size;                    /* Size of the response buffer */
+};
+
+static struct harness_stream hs;
+
+/* Connection the virtual clients inherit their addresses from */
+static struct client parent;
+
+/* True while the event loop runs for a request that did not finish at once */
+static bool in_loop;
+
+/* Allocation counters, only the thread running the request is counted */
+static __thread bool counting;
+static unsigned long n_allocs;
+static unsigned long n_alloc_bytes;
+static unsigned long n_frees;
+
+#ifdef __GLIBC__
+extern void *__libc_malloc(size_t size);
+extern void *__libc_calloc(size_t n, size_t size);
+extern void *__libc_realloc(void *ptr, size_t size);
+extern void __libc_free(void *ptr);
+
+/**
+ * Count an allocation of the request being run.
+ * @param size the allocated size.
+ */
+static inline void harness_count(size_t size)
+{
+    if (counting) {
+        n_allocs++;
+        n_alloc_bytes += size;
+    }
+}
+
+void *malloc(size_t size)
+{
+    harness_count(size);
+    return __libc_malloc(size);
+}
+
+void *calloc(size_t n, size_t size)
+{
+    harness_count(n * size);
+    return __libc_calloc(n, size);
+}
+
+void *realloc(void *ptr, size_t size)
+{
+    harness_count(size);
+    return __libc_realloc(ptr, size);
+}
+
+void free(void *ptr)
+{
+    if (counting && ptr)
+        n_frees++;
+    __libc_free(ptr);
+}
+#endif
+
+/**
+ * Check if heap allocations are counted, this needs the GNU C library.
+ * @return true when the allocation counts of the results are valid.
+ */
+bool harness_counts_allocs(void)
+{
+#ifdef __GLIBC__
+    return true;
+#else
+    return false;
+#endif
+}
+
+/**
+ * Get a monotonic time stamp.
+ * @return the time in nanoseconds.
+ */
+static uint64_t harness_ns(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t) ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+/**
+ * Write callback of the memory stream, the response is captured.
+ */
+static int harness_write(struct ustream *s, const char *buf, int len, bool more)
+{
+    bool was_counting = counting;
+    char *grown;
+
+    /* The capture buffer is not part of the request cost */
+    counting = false;
+    if (hs.len + len + 1 > hs.size) {
+        grown = realloc(hs.buf, max(hs.size * 2, hs.len + len + 1));
+        if (grown) {
+            hs.size = max(hs.size * 2, hs.len + len + 1);
+            hs.buf = grown;
+        }
+    }
+    counting = was_counting;
+
+    if (hs.len + len + 1 > hs.size)
+        return -1;
+
+    memcpy(hs.buf + hs.len, buf, len);
+    hs.len += len;
+    hs.buf[hs.len] = '\0';
+    return len;
+}
+
+/**
+ * Read callback of the memory stream.
+ */
+static void harness_notify_read(struct ustream *s, int bytes)
+{
+    if (hs.cl)
+        read_from_client(hs.cl);
+}
+
+/**
+ * Write callback of the memory stream.
+ */
+static void harness_notify_write(struct ustream *s, int bytes)
+{
+    if (hs.cl)
+        client_notify_write(hs.cl);
+}
+
+/**
+ * State change callback of the memory stream.
+ */
+static void harness_notify_state(struct ustream *s)
+{
+    if (hs.cl)
+        client_notify_state(hs.cl);
+}
+
+/**
+ * Close callback of the virtual client.
+ */
+static void harness_client_closed(struct client *cl)
+{
+    hs.timing = cl->sending;
+    hs.cl = NULL;
+    ustream_free(&hs.us);
+
+    if (in_loop)
+        uloop_end();
+}
+
+/**
+ * Drive the client until it closes. Handlers that answer at once
+ * are finished without the event loop, which only runs for handlers
+ * that wait for something.
+ */
+static void harness_finish(void)
+{
+    /* Responses written in parts, the memory stream never blocks */
+    while (hs.cl && hs.cl->dispatch.write_cb && hs.cl->state != CLIENT_STATE_CLOSE)
+        client_notify_write(hs.cl);
+
+    /* Run the deferred state change of a closed connection */
+    if (hs.cl && hs.cl->state == CLIENT_STATE_CLOSE)
+        client_notify_state(hs.cl);
+
+    /* The client timeout ends the loop when the handler never answers */
+    if (hs.cl) {
+        in_loop = true;
+        uloop_run();
+        in_loop = false;
+    }
+}
+
+/**
+ * Set up the server state the routes need: configuration, database,
+ * UBUS connection and event loop. No sockets are opened.
+ * @param config_file the configuration file, NULL for the default.
+ * @return true on success.
+ */
+bool harness_init(const char *config_file)
+{
+    if (!config_parse(config_file)) {
+        log_message(LOG_ERROR, "Could not parse configuration file\r\n");
+        return false;
+    }
+
+    if (dao_create_db() != DB_OK) {
+        log_message(LOG_ERROR, "Could not create breakout server database\r\n");
+        return false;
+    }
+
+    gpio_init();
+
+    /* Routes that need UBUS fail without it, the others still run */
+    ubus_ctx = ubus_connect(NULL);
+    if (!ubus_ctx) {
+        log_message(LOG_WARNING, "Could not connect to UBUS RPC daemon\r\n");
+    }
+
+    uloop_init();
+    gpio_monitor_init();
+
+    /* The requests come from a local peer */
+    parent.peer_addr.family = AF_INET;
+    parent.peer_addr.in.s_addr = htonl(INADDR_LOOPBACK);
+    parent.srv_addr = parent.peer_addr;
+
+    return true;
+}
+
+/**
+ * Run one raw HTTP/1.1 request on a fresh virtual client and wait
+ * until the client closes. 
+ * @param request the raw request bytes, headers and body.
+ * @param len the length of the request.
+ * @param res the result of the request.
+ * @return false when the request could not be fed to the client.
+ */
+bool harness_run(const char *request, size_t len, struct harness_result *res)
+{
+    struct metrics_timing *t = &hs.timing;
+    uint64_t start;
+    char *buf;
+    int maxlen;
+
+    memset(res, 0, sizeof(*res));
+    memset(&hs.timing, 0, sizeof(hs.timing));
+    memset(&hs.us, 0, sizeof(hs.us));
+    hs.len = 0;
+
+    /* The whole request must fit in one read buffer */
+    hs.us.r.buffer_len = max((int) len + 1, WORKING_BUFF_SIZE);
+    ustream_init_defaults(&hs.us);
+    hs.us.string_data = true;
+    hs.us.write = harness_write;
+    hs.us.notify_read = harness_notify_read;
+    hs.us.notify_write = harness_notify_write;
+    hs.us.notify_state = harness_notify_state;
+
+    hs.cl = client_create_virtual(&parent, &hs.us, harness_client_closed);
+    if (!hs.cl) {
+        ustream_free(&hs.us);
+        return false;
+    }
+
+    buf = ustream_reserve(&hs.us, len, &maxlen);
+    if (!buf || maxlen < len) {
+        client_close_virtual(hs.cl);
+        return false;
+    }
+    memcpy(buf, request, len);
+
+    n_allocs = n_alloc_bytes = n_frees = 0;
+    counting = true;
+    start = harness_ns();
+
+    ustream_fill_read(&hs.us, len);
+    harness_finish();
+
+    res->ns = harness_ns() - start;
+    counting = false;
+
+    res->allocs = n_allocs;
+    res->alloc_bytes = n_alloc_bytes;
+    res->frees = n_frees;
+    res->response = hs.buf ? hs.buf : "";
+    res->response_len = hs.len;
+    if (hs.buf)
+        sscanf(hs.buf, "HTTP/%*d.%*d %d", &res->status);
+
+    /* Phases of requests that reached a handler */
+    if (t->handler_start && t->first_byte)
+        res->parse_us = t->handler_start - t->first_byte;
+    if (t->handler_end && t->handler_start)
+        res->handler_us = t->handler_end - t->handler_start;
+    if (t->done && t->handler_end)
+        res->respond_us = t->done - t->handler_end;
+
+    return true;
+}
+
+/**
+ * Free the resources of the harness.
+ */
+void harness_free(void)
+{
+    if (ubus_ctx) {
+        ubus_free(ubus_ctx);
+        ubus_ctx = NULL;
+    }
+
+    free(hs.buf);
+    hs.buf = NULL;
+    hs.len = hs.size = 0;
+}
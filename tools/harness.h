@@ -0,0 +1,87 @@
+/* 
+ * Copyright (c) 2014, Daan Pape
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without 
+ * modification, are permitted provided that the following conditions are met:
+ * 
+ *     1. Redistributions of source code must retain the above copyright 
+ *        notice, this list of conditions and the following disclaimer.
+ *
+ *     2. Redistributions in binary form must reproduce the above copyright 
+ *        notice, this list of conditions and the following disclaimer in the 
+ *        documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" 
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE 
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE 
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE 
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR 
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF 
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS 
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN 
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) 
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE 
+ * POSSIBILITY OF SUCH DAMAGE.
+ * 
+ * File:   harness.h
+ * Created on October 18, 2026, 10:50 PM
+ *
+ * In-process request harness. Raw requests are fed through the normal
+ * client state machine on a virtual client with a memory stream, so
+ * routes can be profiled without sockets or the event loop.
+ */
+
+#ifndef HARNESS_H_
+#define HARNESS_H_
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "../metrics.h"
+
+/* Result of one request run through the harness */
+struct harness_result {
+    int status;                     /* HTTP status code of the response, 0 when there is none */
+    const char *response;           /* The raw response, valid until the next request */
+    size_t response_len;            /* Length of the raw response */
+    uint64_t ns;                    /* Time from feeding the request until the client closed */
+    metric_t parse_us;              /* Time from the first byte until the handler started */
+    metric_t handler_us;            /* Time spent in the route handler */
+    metric_t respond_us;            /* Time from the end of the handler until the request was done */
+    unsigned long allocs;           /* Number of heap allocations while the request ran */
+    unsigned long alloc_bytes;      /* Number of bytes allocated while the request ran */
+    unsigned long frees;            /* Number of heap blocks freed while the request ran */
+};
+
+/**
+ * Set up the server state the routes need: configuration, database,
+ * UBUS connection and event loop. No sockets are opened.
+ * @param config_file the configuration file, NULL for the default.
+ * @return true on success.
+ */
+bool harness_init(const char *config_file);
+
+/**
+ * Run one raw HTTP/1.1 request on a fresh virtual client and wait
+ * until the client closes. 
+ * @param request the raw request bytes, headers and body.
+ * @param len the length of the request.
+ * @param res the result of the request.
+ * @return false when the request could not be fed to the client.
+ */
+bool harness_run(const char *request, size_t len, struct harness_result *res);
+
+/**
+ * Check if heap allocations are counted, this needs the GNU C library.
+ * @return true when the allocation counts of the results are valid.
+ */
+bool harness_counts_allocs(void);
+
+/**
+ * Free the resources of the harness.
+ */
+void harness_free(void);
+
+#endif /* HARNESS_H_ */
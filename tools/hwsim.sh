@@ -0,0 +1,80 @@
+#!/bin/sh
+# Copyright (c) 2014, Daan Pape
+# All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without 
+# modification, are permitted provided that the following conditions are met:
+# 
+#     1. Redistributions of source code must retain the above copyright 
+#        notice, this list of conditions and the following disclaimer.
+#
+#     2. Redistributions in binary form must reproduce the above copyright 
+#        notice, this list of conditions and the following disclaimer in the 
+#        documentation and/or other materials provided with the distribution.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" 
+# AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE 
+# IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE 
+# ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE 
+# LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR 
+# CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF 
+# SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS 
+# INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN 
+# CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) 
+# ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE 
+# POSSIBILITY OF SUCH DAMAGE.
+#
+# File:   hwsim.sh
+# Created on October 18, 2026, 9:30 PM
+#
+# Create the file tree of a simulated board below a hardware root. Point
+# the 'hardware_root' setting of the server to it and preload the shim of
+# tools/hwsim_preload.c to simulate the device timing.
+#
+# Usage: hwsim.sh <hardware root>
+
+ROOT=$1
+
+if [ -z "$ROOT" ]; then
+    echo "Usage: $0 <hardware root>" >&2
+    exit 1
+fi
+
+# Exposed GPIO pins, see gpio_config in gpio/gpio.c
+GPIO_PINS="0 1 6 7 8 12 13 14 15 16 17 18 19 20 21 22 23 24"
+
+mkdir -p "$ROOT/sys/class/gpio" || exit 1
+: > "$ROOT/sys/class/gpio/export"
+: > "$ROOT/sys/class/gpio/unexport"
+for pin in $GPIO_PINS; do
+    mkdir -p "$ROOT/sys/class/gpio/gpio$pin"
+    echo in > "$ROOT/sys/class/gpio/gpio$pin/direction"
+    echo 0 > "$ROOT/sys/class/gpio/gpio$pin/value"
+done
+
+# 1-Wire temperature sensor, the shim replaces the contents with a conversion
+mkdir -p "$ROOT/sys/devices/w1_bus_master1/28-000003ea41b5"
+printf '72 01 4b 46 7f ff 0e 10 57 : crc=57 YES\n72 01 4b 46 7f ff 0e 10 57 t=21500\n' \
+    > "$ROOT/sys/devices/w1_bus_master1/28-000003ea41b5/w1_slave"
+
+# Both ethernet ports have a cable
+for port in 0 1; do
+    mkdir -p "$ROOT/sys/class/net/eth$port"
+    echo up > "$ROOT/sys/class/net/eth$port/operstate"
+done
+
+# SPI and I2C device nodes, plain files the shim turns into loopback devices
+# and the GPIO character device
+mkdir -p "$ROOT/dev"
+: > "$ROOT/dev/gpiochip0"
+: > "$ROOT/dev/spidev0.1"
+for bus in 0 1 2 3 4; do
+    : > "$ROOT/dev/i2c-$bus"
+done
+
+# Fake GPIO register block for gpio_backend 'mmio', a sparse file with one
+# page at the physical address of the GPIO block
+dd if=/dev/zero of="$ROOT/dev/mem" bs=4096 seek=$((0x18040000 / 4096)) count=1 2>/dev/null
+
+mkdir -p "$ROOT/tmp/sysinfo"
+echo "DPT-Board simulated" > "$ROOT/tmp/sysinfo/model"
@@ -0,0 +1,696 @@
+/* 
+ * Copyright (c) 2014, Daan Pape
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without 
+ * modification, are permitted provided that the following conditions are met:
+ * 
+ *     1. Redistributions of source code must retain the above copyright 
+ *        notice, this list of conditions and the following disclaimer.
+ *
+ *     2. Redistributions in binary form must reproduce the above copyright 
+ *        notice, this list of conditions and the following disclaimer in the 
+ *        documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" 
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE 
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE 
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE 
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR 
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF 
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS 
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN 
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) 
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE 
+ * POSSIBILITY OF SUCH DAMAGE.
+ * 
+ * File:   hwsim_preload.c
+ * Created on October 18, 2026, 9:30 PM
+ *
+ * Preload shim that gives the simulated board of tools/hwsim.sh its
+ * timing and device behaviour. File descriptors opened below the
+ * hardware root are tracked and their system calls are simulated:
+ *
+ *   - GPIO sysfs files cost HWSIM_GPIO_US microseconds per access.
+ *   - GPIO character devices accept v2 line requests, every ioctl
+ *     costs HWSIM_GPIO_US microseconds as well. With HWSIM_GPIO_TOGGLE_MS
+ *     set, inputs with edge detection toggle at that period and report
+ *     their edges.
+ *   - The 1-Wire slave takes HWSIM_W1_MS milliseconds to convert, one
+ *     conversion at a time, and reports HWSIM_TEMP millidegrees.
+ *   - SPI devices loop the transmit buffer back into the receive buffer
+ *     and take as long as the transfer at the configured clock.
+ *   - I2C buses loop the last write back on read at 100kHz.
+ *
+ * Build it as a shared library with the native compiler:
+ *
+ *   cc -std=gnu99 -O2 -shared -fPIC -o hwsim_preload.so tools/hwsim_preload.c -ldl -lpthread
+ *
+ * Usage: HWSIM_ROOT=<root> LD_PRELOAD=./hwsim_preload.so dpt-breakout-server
+ */
+
+#define _GNU_SOURCE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdarg.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <dlfcn.h>
+#include <pthread.h>
+#include <time.h>
+#include <sys/types.h>
+#include <sys/ioctl.h>
+#include <sys/eventfd.h>
+#include <linux/spi/spidev.h>
+#include <linux/i2c-dev.h>
+#include <linux/gpio.h>
+
+#define HWSIM_MAX_FDS       1024                /* Highest simulated file descriptor */
+#define HWSIM_I2C_BUF       256                 /* Size of the I2C loopback buffer */
+#define HWSIM_I2C_SPEED     100000              /* I2C bus clock in Hz */
+#define HWSIM_GPIO_EVENTS   8                   /* Queued edges per line request */
+
+/* Kinds of simulated file descriptors */
+enum hwsim_kind {
+    HWSIM_NONE = 0,
+    HWSIM_GPIO,
+    HWSIM_W1,
+    HWSIM_SPI,
+    HWSIM_I2C,
+    HWSIM_GPIOCHIP,
+    HWSIM_GPIOLINE,
+};
+
+/* State of a simulated file descriptor */
+struct hwsim_fd {
+    enum hwsim_kind kind;
+    
+    /* SPI settings */
+    uint8_t mode;
+    uint8_t bits;
+    uint32_t speed;
+    
+    /* I2C slave address and loopback buffer */
+    int address;
+    uint8_t i2c_buf[HWSIM_I2C_BUF];
+    size_t i2c_len;
+    
+    /* Bytes of the 1-Wire conversion already read */
+    size_t w1_pos;
+    
+    /* Chip offsets of a GPIO line request, the lines with edge
+     * detection and their queued edges */
+    uint32_t offsets[GPIO_V2_LINES_MAX];
+    uint32_t num_lines;
+    uint64_t edges;
+    struct gpio_v2_line_event events[HWSIM_GPIO_EVENTS];
+    int num_events;
+    uint32_t event_seq;
+};
+
+static struct hwsim_fd fds[HWSIM_MAX_FDS];
+
+/* Only one conversion can run on the 1-Wire bus */
+static pthread_mutex_t w1_bus = PTHREAD_MUTEX_INITIALIZER;
+
+/* Lines of the simulated GPIO chip, bit n is line n */
+static uint64_t chip_output;
+static uint64_t chip_values;
+static uint64_t chip_requested;
+static pthread_mutex_t chip_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_once_t toggle_once = PTHREAD_ONCE_INIT;
+
+/* Simulation settings from the environment */
+static char root[256];
+static size_t root_len;
+static long gpio_us = 15;
+static long w1_ms = 750;
+static long temp = 21500;
+static long toggle_ms = 0;
+
+static int (*real_open)(const char *path, int flags, ...);
+static int (*real_open64)(const char *path, int flags, ...);
+static int (*real_close)(int fd);
+static ssize_t (*real_read)(int fd, void *buf, size_t count);
+static ssize_t (*real_write)(int fd, const void *buf, size_t count);
+static ssize_t (*real_pread)(int fd, void *buf, size_t count, off_t offset);
+static ssize_t (*real_pwrite)(int fd, const void *buf, size_t count, off_t offset);
+static int (*real_ioctl)(int fd, unsigned long request, ...);
+
+/**
+ * Look up the real system calls and read the simulation settings.
+ */
+__attribute__((constructor))
+static void hwsim_init(void)
+{
+    const char *env;
+
+    real_open = dlsym(RTLD_NEXT, "open");
+    real_open64 = dlsym(RTLD_NEXT, "open64");
+    real_close = dlsym(RTLD_NEXT, "close");
+    real_read = dlsym(RTLD_NEXT, "read");
+    real_write = dlsym(RTLD_NEXT, "write");
+    real_pread = dlsym(RTLD_NEXT, "pread");
+    real_pwrite = dlsym(RTLD_NEXT, "pwrite");
+    real_ioctl = dlsym(RTLD_NEXT, "ioctl");
+
+    if ((env = getenv("HWSIM_ROOT")) != NULL) {
+        snprintf(root, sizeof(root), "%s", env);
+        root_len = strlen(root);
+        while (root_len > 0 && root[root_len - 1] == '/')
+            root[--root_len] = '\0';
+    }
+    if ((env = getenv("HWSIM_GPIO_US")) != NULL)
+        gpio_us = atol(env);
+    if ((env = getenv("HWSIM_W1_MS")) != NULL)
+        w1_ms = atol(env);
+    if ((env = getenv("HWSIM_TEMP")) != NULL)
+        temp = atol(env);
+    if ((env = getenv("HWSIM_GPIO_TOGGLE_MS")) != NULL)
+        toggle_ms = atol(env);
+}
+
+/**
+ * Sleep for the simulated duration of a hardware access.
+ * @param us the number of microseconds to sleep.
+ */
+static void hwsim_delay(long us)
+{
+    struct timespec ts;
+
+    if (us <= 0)
+        return;
+
+    ts.tv_sec = us / 1000000;
+    ts.tv_nsec = (us % 1000000) * 1000;
+    while (nanosleep(&ts, &ts) < 0 && errno == EINTR)
+        ;
+}
+
+/**
+ * Find out what kind of device a path below the hardware root is.
+ * @param path the opened path.
+ * @return the kind of simulated device, HWSIM_NONE for other files.
+ */
+static enum hwsim_kind hwsim_classify(const char *path)
+{
+    const char *rel;
+
+    if (root_len == 0 || strncmp(path, root, root_len) != 0 || path[root_len] != '/')
+        return HWSIM_NONE;
+
+    rel = path + root_len;
+    if (strncmp(rel, "/sys/class/gpio/", 16) == 0)
+        return HWSIM_GPIO;
+    if (strncmp(rel, "/sys/devices/w1_bus_master1/", 28) == 0)
+        return HWSIM_W1;
+    if (strncmp(rel, "/dev/spidev", 11) == 0)
+        return HWSIM_SPI;
+    if (strncmp(rel, "/dev/i2c-", 9) == 0)
+        return HWSIM_I2C;
+    if (strncmp(rel, "/dev/gpiochip", 13) == 0)
+        return HWSIM_GPIOCHIP;
+
+    return HWSIM_NONE;
+}
+
+/**
+ * Start tracking a newly opened file descriptor.
+ * @param fd the file descriptor, negative when the open failed.
+ * @param path the opened path.
+ * @return the file descriptor.
+ */
+static int hwsim_track(int fd, const char *path)
+{
+    enum hwsim_kind kind;
+
+    if (fd < 0 || fd >= HWSIM_MAX_FDS)
+        return fd;
+
+    kind = hwsim_classify(path);
+    memset(&fds[fd], 0, sizeof(fds[fd]));
+    fds[fd].kind = kind;
+    fds[fd].bits = 8;
+    fds[fd].speed = 500000;
+
+    if (kind == HWSIM_GPIO)
+        hwsim_delay(gpio_us);
+
+    return fd;
+}
+
+/**
+ * Get the simulation state of a file descriptor.
+ * @param fd the file descriptor.
+ * @return the state or NULL when the descriptor is not simulated.
+ */
+static struct hwsim_fd* hwsim_get(int fd)
+{
+    if (fd < 0 || fd >= HWSIM_MAX_FDS || fds[fd].kind == HWSIM_NONE)
+        return NULL;
+    return &fds[fd];
+}
+
+int open(const char *path, int flags, ...)
+{
+    mode_t mode = 0;
+    va_list ap;
+
+    if (flags & (O_CREAT | O_TMPFILE)) {
+        va_start(ap, flags);
+        mode = va_arg(ap, mode_t);
+        va_end(ap);
+    }
+
+    return hwsim_track(real_open(path, flags, mode), path);
+}
+
+int open64(const char *path, int flags, ...)
+{
+    mode_t mode = 0;
+    va_list ap;
+
+    if (flags & (O_CREAT | O_TMPFILE)) {
+        va_start(ap, flags);
+        mode = va_arg(ap, mode_t);
+        va_end(ap);
+    }
+
+    return hwsim_track(real_open64(path, flags, mode), path);
+}
+
+int close(int fd)
+{
+    if (fd >= 0 && fd < HWSIM_MAX_FDS) {
+        /* Closing a line request releases its lines */
+        if (fds[fd].kind == HWSIM_GPIOLINE) {
+            pthread_mutex_lock(&chip_lock);
+            for (uint32_t i = 0; i < fds[fd].num_lines; ++i)
+                chip_requested &= ~(1ull << fds[fd].offsets[i]);
+            pthread_mutex_unlock(&chip_lock);
+        }
+        fds[fd].kind = HWSIM_NONE;
+    }
+    return real_close(fd);
+}
+
+/**
+ * Apply a line configuration to the lines of a line request. Lines
+ * without a direction flag keep their direction. The chip must be locked.
+ * @param sim the simulated line request.
+ * @param config the line configuration.
+ */
+static void hwsim_gpio_configure(struct hwsim_fd *sim, struct gpio_v2_line_config *config)
+{
+    for (uint32_t i = 0; i < sim->num_lines; ++i) {
+        uint64_t line = 1ull << sim->offsets[i];
+        uint64_t flags = config->flags;
+        bool set_value = false;
+        bool value = false;
+
+        for (uint32_t a = 0; a < config->num_attrs && a < GPIO_V2_LINE_NUM_ATTRS_MAX; ++a) {
+            struct gpio_v2_line_config_attribute *attr = &config->attrs[a];
+
+            if (!(attr->mask & (1ull << i)))
+                continue;
+            if (attr->attr.id == GPIO_V2_LINE_ATTR_ID_FLAGS) {
+                flags = attr->attr.flags;
+            } else if (attr->attr.id == GPIO_V2_LINE_ATTR_ID_OUTPUT_VALUES) {
+                set_value = true;
+                value = attr->attr.values & (1ull << i);
+            }
+        }
+
+        if (flags & GPIO_V2_LINE_FLAG_OUTPUT) {
+            chip_output |= line;
+            if (set_value)
+                chip_values = value ? chip_values | line : chip_values & ~line;
+        } else if (flags & GPIO_V2_LINE_FLAG_INPUT) {
+            chip_output &= ~line;
+        }
+
+        if ((flags & GPIO_V2_LINE_FLAG_INPUT) && (flags & (GPIO_V2_LINE_FLAG_EDGE_RISING | GPIO_V2_LINE_FLAG_EDGE_FALLING)))
+            sim->edges |= 1ull << i;
+        else
+            sim->edges &= ~(1ull << i);
+    }
+}
+
+/**
+ * Toggle the inputs with edge detection and queue their edges.
+ * @param arg unused.
+ * @return never returns.
+ */
+static void* hwsim_gpio_toggle(void *arg)
+{
+    struct timespec ts = { toggle_ms / 1000, (toggle_ms % 1000) * 1000000L };
+    struct timespec now;
+    uint64_t one = 1;
+
+    for (;;) {
+        nanosleep(&ts, NULL);
+        clock_gettime(CLOCK_MONOTONIC, &now);
+
+        pthread_mutex_lock(&chip_lock);
+        for (int fd = 0; fd < HWSIM_MAX_FDS; ++fd) {
+            struct hwsim_fd *sim = &fds[fd];
+
+            if (sim->kind != HWSIM_GPIOLINE || sim->edges == 0)
+                continue;
+
+            for (uint32_t i = 0; i < sim->num_lines; ++i) {
+                struct gpio_v2_line_event *ev;
+                uint64_t line = 1ull << sim->offsets[i];
+
+                if (!(sim->edges & (1ull << i)))
+                    continue;
+
+                chip_values ^= line;
+                if (sim->num_events == HWSIM_GPIO_EVENTS)
+                    continue;
+
+                ev = &sim->events[sim->num_events++];
+                memset(ev, 0, sizeof(*ev));
+                ev->offset = sim->offsets[i];
+                ev->id = chip_values & line ? GPIO_V2_LINE_EVENT_RISING_EDGE : GPIO_V2_LINE_EVENT_FALLING_EDGE;
+                ev->timestamp_ns = (uint64_t) now.tv_sec * 1000000000ull + now.tv_nsec;
+                ev->seqno = ++sim->event_seq;
+                ev->line_seqno = ev->seqno;
+            }
+
+            if (sim->num_events)
+                real_write(fd, &one, sizeof(one));
+        }
+        pthread_mutex_unlock(&chip_lock);
+    }
+
+    return NULL;
+}
+
+/**
+ * Start toggling the inputs, once.
+ */
+static void hwsim_gpio_start_toggle(void)
+{
+    pthread_t thread;
+
+    if (toggle_ms > 0 && pthread_create(&thread, NULL, hwsim_gpio_toggle, NULL) == 0)
+        pthread_detach(thread);
+}
+
+/**
+ * Read the queued edges of a line request.
+ * @param fd the file descriptor of the line request.
+ * @param sim the simulated line request.
+ * @param buf the buffer for the edges.
+ * @param count the size of the buffer.
+ * @return the number of bytes read, -1 with EAGAIN when there are no edges.
+ */
+static ssize_t hwsim_gpio_read_events(int fd, struct hwsim_fd *sim, void *buf, size_t count)
+{
+    uint64_t pending;
+    int n;
+
+    pthread_mutex_lock(&chip_lock);
+
+    n = count / sizeof(struct gpio_v2_line_event);
+    if (n > sim->num_events)
+        n = sim->num_events;
+
+    memcpy(buf, sim->events, n * sizeof(struct gpio_v2_line_event));
+    memmove(sim->events, sim->events + n, (sim->num_events - n) * sizeof(struct gpio_v2_line_event));
+    sim->num_events -= n;
+
+    /* The event counter keeps the request readable while edges are queued */
+    if (sim->num_events == 0)
+        real_read(fd, &pending, sizeof(pending));
+
+    pthread_mutex_unlock(&chip_lock);
+
+    if (n == 0) {
+        errno = EAGAIN;
+        return -1;
+    }
+    return n * sizeof(struct gpio_v2_line_event);
+}
+
+/**
+ * Simulate the ioctls of a GPIO chip and its line requests.
+ * @param sim the simulated file descriptor.
+ * @param request the ioctl request.
+ * @param arg the ioctl argument.
+ * @return 0 on success, -1 with errno set on error.
+ */
+static int hwsim_gpio_ioctl(struct hwsim_fd *sim, unsigned long request, void *arg)
+{
+    int ret = 0;
+
+    hwsim_delay(gpio_us);
+    pthread_mutex_lock(&chip_lock);
+
+    if (sim->kind == HWSIM_GPIOCHIP && request == GPIO_V2_GET_LINEINFO_IOCTL) {
+        struct gpio_v2_line_info *info = arg;
+        uint64_t line = 1ull << (info->offset & 63);
+
+        info->flags = (chip_output & line ? GPIO_V2_LINE_FLAG_OUTPUT : GPIO_V2_LINE_FLAG_INPUT)
+                | (chip_requested & line ? GPIO_V2_LINE_FLAG_USED : 0);
+    } else if (sim->kind == HWSIM_GPIOCHIP && request == GPIO_V2_GET_LINE_IOCTL) {
+        struct gpio_v2_line_request *req = arg;
+        uint64_t lines = 0;
+        int fd;
+
+        for (uint32_t i = 0; i < req->num_lines && i < GPIO_V2_LINES_MAX; ++i)
+            lines |= 1ull << (req->offsets[i] & 63);
+
+        if (req->num_lines == 0 || req->num_lines > GPIO_V2_LINES_MAX) {
+            errno = EINVAL;
+            ret = -1;
+        } else if (chip_requested & lines) {
+            errno = EBUSY;
+            ret = -1;
+        } else if ((fd = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK)) < 0 || fd >= HWSIM_MAX_FDS) {
+            errno = EMFILE;
+            ret = -1;
+        } else {
+            memset(&fds[fd], 0, sizeof(fds[fd]));
+            fds[fd].kind = HWSIM_GPIOLINE;
+            fds[fd].num_lines = req->num_lines;
+            memcpy(fds[fd].offsets, req->offsets, sizeof(fds[fd].offsets));
+            hwsim_gpio_configure(&fds[fd], &req->config);
+            chip_requested |= lines;
+            req->fd = fd;
+            pthread_once(&toggle_once, hwsim_gpio_start_toggle);
+        }
+    } else if (sim->kind == HWSIM_GPIOLINE && request == GPIO_V2_LINE_GET_VALUES_IOCTL) {
+        struct gpio_v2_line_values *lv = arg;
+        uint64_t bits = 0;
+
+        for (uint32_t i = 0; i < sim->num_lines; ++i) {
+            if ((lv->mask & (1ull << i)) && (chip_values & (1ull << sim->offsets[i])))
+                bits |= 1ull << i;
+        }
+        lv->bits = bits;
+    } else if (sim->kind == HWSIM_GPIOLINE && request == GPIO_V2_LINE_SET_VALUES_IOCTL) {
+        struct gpio_v2_line_values *lv = arg;
+
+        /* Like the kernel, inputs can't be set */
+        for (uint32_t i = 0; i < sim->num_lines && ret == 0; ++i) {
+            if ((lv->mask & (1ull << i)) && !(chip_output & (1ull << sim->offsets[i]))) {
+                errno = EPERM;
+                ret = -1;
+            }
+        }
+
+        for (uint32_t i = 0; i < sim->num_lines && ret == 0; ++i) {
+            uint64_t line = 1ull << sim->offsets[i];
+
+            if (lv->mask & (1ull << i))
+                chip_values = lv->bits & (1ull << i) ? chip_values | line : chip_values & ~line;
+        }
+    } else if (sim->kind == HWSIM_GPIOLINE && request == GPIO_V2_LINE_SET_CONFIG_IOCTL) {
+        hwsim_gpio_configure(sim, arg);
+    } else {
+        errno = ENOTTY;
+        ret = -1;
+    }
+
+    pthread_mutex_unlock(&chip_lock);
+    return ret;
+}
+
+/**
+ * Read the 1-Wire slave, the first read waits for a conversion.
+ * @param sim the simulated file descriptor.
+ * @param buf the buffer to read into.
+ * @param count the size of the buffer.
+ * @return the number of bytes read.
+ */
+static ssize_t hwsim_w1_read(struct hwsim_fd *sim, void *buf, size_t count)
+{
+    char text[80];
+    int len;
+
+    if (sim->w1_pos == 0) {
+        pthread_mutex_lock(&w1_bus);
+        hwsim_delay(w1_ms * 1000);
+        pthread_mutex_unlock(&w1_bus);
+    }
+
+    len = snprintf(text, sizeof(text),
+            "72 01 4b 46 7f ff 0e 10 57 : crc=57 YES\n"
+            "72 01 4b 46 7f ff 0e 10 57 t=%05ld\n", temp);
+
+    if (sim->w1_pos >= (size_t) len)
+        return 0;
+    if (count > len - sim->w1_pos)
+        count = len - sim->w1_pos;
+
+    memcpy(buf, text + sim->w1_pos, count);
+    sim->w1_pos += count;
+    return count;
+}
+
+ssize_t read(int fd, void *buf, size_t count)
+{
+    struct hwsim_fd *sim = hwsim_get(fd);
+
+    if (sim == NULL)
+        return real_read(fd, buf, count);
+
+    switch (sim->kind) {
+    case HWSIM_GPIO:
+        hwsim_delay(gpio_us);
+        return real_read(fd, buf, count);
+
+    case HWSIM_W1:
+        return hwsim_w1_read(sim, buf, count);
+
+    case HWSIM_GPIOLINE:
+        return hwsim_gpio_read_events(fd, sim, buf, count);
+
+    case HWSIM_I2C:
+        /* Address byte plus data bytes of 9 clocks each */
+        hwsim_delay((count + 1) * 9 * 1000000L / HWSIM_I2C_SPEED);
+        for (size_t i = 0; i < count; ++i)
+            ((uint8_t*) buf)[i] = sim->i2c_len ? sim->i2c_buf[i % sim->i2c_len] : 0;
+        return count;
+
+    default:
+        errno = EINVAL;
+        return -1;
+    }
+}
+
+ssize_t write(int fd, const void *buf, size_t count)
+{
+    struct hwsim_fd *sim = hwsim_get(fd);
+
+    if (sim == NULL)
+        return real_write(fd, buf, count);
+
+    switch (sim->kind) {
+    case HWSIM_GPIO:
+        hwsim_delay(gpio_us);
+        return real_write(fd, buf, count);
+
+    case HWSIM_I2C:
+        hwsim_delay((count + 1) * 9 * 1000000L / HWSIM_I2C_SPEED);
+        sim->i2c_len = count < HWSIM_I2C_BUF ? count : HWSIM_I2C_BUF;
+        memcpy(sim->i2c_buf, buf, sim->i2c_len);
+        return count;
+
+    default:
+        errno = EINVAL;
+        return -1;
+    }
+}
+
+ssize_t pread(int fd, void *buf, size_t count, off_t offset)
+{
+    struct hwsim_fd *sim = hwsim_get(fd);
+
+    if (sim && sim->kind == HWSIM_GPIO)
+        hwsim_delay(gpio_us);
+    return real_pread(fd, buf, count, offset);
+}
+
+ssize_t pwrite(int fd, const void *buf, size_t count, off_t offset)
+{
+    struct hwsim_fd *sim = hwsim_get(fd);
+
+    if (sim && sim->kind == HWSIM_GPIO)
+        hwsim_delay(gpio_us);
+    return real_pwrite(fd, buf, count, offset);
+}
+
+/**
+ * Run SPI transfers, the transmitted bytes are looped back.
+ * @param sim the simulated file descriptor.
+ * @param xfer the transfers.
+ * @param n the number of transfers.
+ * @return the number of bytes transferred.
+ */
+static int hwsim_spi_transfer(struct hwsim_fd *sim, struct spi_ioc_transfer *xfer, int n)
+{
+    int total = 0;
+
+    for (int i = 0; i < n; ++i) {
+        uint32_t speed = xfer[i].speed_hz ? xfer[i].speed_hz : sim->speed;
+        uint8_t bits = xfer[i].bits_per_word ? xfer[i].bits_per_word : sim->bits;
+
+        if (xfer[i].rx_buf) {
+            if (xfer[i].tx_buf)
+                memmove((void*)(uintptr_t) xfer[i].rx_buf, (void*)(uintptr_t) xfer[i].tx_buf, xfer[i].len);
+            else
+                memset((void*)(uintptr_t) xfer[i].rx_buf, 0, xfer[i].len);
+        }
+
+        hwsim_delay((long) xfer[i].len * bits * 1000000L / (speed ? speed : 1) + xfer[i].delay_usecs);
+        total += xfer[i].len;
+    }
+
+    return total;
+}
+
+int ioctl(int fd, unsigned long request, ...)
+{
+    struct hwsim_fd *sim = hwsim_get(fd);
+    va_list ap;
+    void *arg;
+
+    va_start(ap, request);
+    arg = va_arg(ap, void*);
+    va_end(ap);
+
+    if (sim == NULL)
+        return real_ioctl(fd, request, arg);
+
+    if (sim->kind == HWSIM_GPIOCHIP || sim->kind == HWSIM_GPIOLINE) {
+        return hwsim_gpio_ioctl(sim, request, arg);
+    } else if (sim->kind == HWSIM_I2C) {
+        if (request == I2C_SLAVE || request == I2C_SLAVE_FORCE) {
+            sim->address = (int)(uintptr_t) arg;
+            return 0;
+        }
+    } else if (sim->kind == HWSIM_SPI) {
+        if (_IOC_TYPE(request) == SPI_IOC_MAGIC && _IOC_NR(request) == 0 && _IOC_DIR(request) == _IOC_WRITE)
+            return hwsim_spi_transfer(sim, arg, _IOC_SIZE(request) / sizeof(struct spi_ioc_transfer));
+
+        switch (request) {
+        case SPI_IOC_WR_MODE:           sim->mode = *(uint8_t*) arg; return 0;
+        case SPI_IOC_RD_MODE:           *(uint8_t*) arg = sim->mode; return 0;
+        case SPI_IOC_WR_BITS_PER_WORD:  sim->bits = *(uint8_t*) arg; return 0;
+        case SPI_IOC_RD_BITS_PER_WORD:  *(uint8_t*) arg = sim->bits; return 0;
+        case SPI_IOC_WR_MAX_SPEED_HZ:   sim->speed = *(uint32_t*) arg; return 0;
+        case SPI_IOC_RD_MAX_SPEED_HZ:   *(uint32_t*) arg = sim->speed; return 0;
+        }
+    }
+
+    errno = ENOTTY;
+    return -1;
+}
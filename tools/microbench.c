@@ -0,0 +1,422 @@
+/* 
+ * Copyright (c) 2014, Daan Pape
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without 
+ * modification, are permitted provided that the following conditions are met:
+ * 
+ *     1. Redistributions of source code must retain the above copyright 
+ *        notice, this list of conditions and the following disclaimer.
+ *
+ *     2. Redistributions in binary form must reproduce the above copyright 
+ *        notice, this list of conditions and the following disclaimer in the 
+ *        documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" 
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE 
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE 
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE 
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR 
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF 
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS 
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN 
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) 
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE 
+ * POSSIBILITY OF SUCH DAMAGE.
+ * 
+ * File:   microbench.c
+ * Created on October 18, 2026, 10:15 PM
+ *
+ * Microbenchmarks of the parsing and utility functions that run on every
+ * request. Every case is warmed up, calibrated to a minimum batch time and
+ * timed over a number of batches, the results are printed as JSON so runs
+ * of different builds can be compared. Cases that modify their input in
+ * place include copying the input in their time.
+ *
+ * Usage: microbench [-f filter] [-r repeats] [-t batch ms] [-w warm-up ms]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <unistd.h>
+#include <time.h>
+#include <limits.h>
+#include <libubox/blobmsg.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+#include "../uhttpd.h"
+#include "../config.h"
+#include "../client.h"
+#include "../helper.h"
+#include "../api.h"
+
+#define BENCH_MAX_REPEATS   64                  /* Maximum number of timed batches */
+#define BENCH_BUF_SIZE      1024                /* Size of the output and copy buffers */
+
+/* A benchmark case: one function on one input */
+struct bench_case {
+    const char *name;                           /* Name of the benchmarked function */
+    const char *corpus;                         /* Name of the input */
+    void (*op)(const struct bench_case *bc);    /* Run the function once */
+    const char *input;                          /* The input */
+    const char *arg;                            /* Second argument, if any */
+    size_t len;                                 /* Length of the input */
+};
+
+/* Results are written here so the calls can not be optimised away */
+static volatile size_t sink;
+
+/* Output and copy buffers of the cases */
+static char out[BENCH_BUF_SIZE];
+static char copy[BENCH_BUF_SIZE];
+
+/* Client of the request line parser */
+static struct client bench_client;
+
+/* Serialized string arrays */
+static char *serialized_small;
+static char *serialized_large;
+
+/* Base64 encoded 256 byte token */
+static char b64_token[400];
+
+/**
+ * Copy the input of a case into the copy buffer.
+ * @param bc the benchmark case.
+ * @return the copy.
+ */
+static inline char* bench_copy(const struct bench_case *bc)
+{
+    memcpy(copy, bc->input, bc->len + 1);
+    return copy;
+}
+
+static void op_empty(const struct bench_case *bc)
+{
+    sink += bc->len;
+}
+
+static void op_urldecode(const struct bench_case *bc)
+{
+    sink += uh_urldecode(out, sizeof(out) - 1, bc->input, bc->len);
+}
+
+static void op_urlencode(const struct bench_case *bc)
+{
+    sink += uh_urlencode(out, sizeof(out), bc->input, bc->len);
+}
+
+static void op_b64decode(const struct bench_case *bc)
+{
+    sink += uh_b64decode(out, sizeof(out), bc->input, bc->len);
+}
+
+static void op_canonpath(const struct bench_case *bc)
+{
+    static char resolved[PATH_MAX];
+
+    sink += (size_t) canonpath(bc->input, resolved);
+}
+
+static void op_mime_lookup(const struct bench_case *bc)
+{
+    sink += (size_t) file_mime_lookup(bc->input);
+}
+
+static void op_split_header(const struct bench_case *bc)
+{
+    sink += (size_t) uh_split_header(bench_copy(bc));
+}
+
+static void op_startswith(const struct bench_case *bc)
+{
+    sink += helper_str_startswith(bc->input, bc->arg, conf->api_str_len);
+}
+
+static void op_serialize(const struct bench_case *bc)
+{
+    char *array[32];
+    size_t n = 0;
+    char *s = bench_copy(bc);
+
+    /* The input holds the strings separated by spaces */
+    for (char *p = strtok(s, " "); p && n < 32; p = strtok(NULL, " "))
+        array[n++] = p;
+
+    s = helper_serialize_str_array(array, n);
+    sink += (size_t) s;
+    free(s);
+}
+
+static void op_unserialize(const struct bench_case *bc)
+{
+    struct chararray *a = helper_unserialize_str_array(bench_copy(bc));
+
+    sink += a->len;
+    helper_free_char_array(a);
+}
+
+static void op_parse_request(const struct bench_case *bc)
+{
+    blob_buf_init(&bench_client.hdr, 0);
+    sink += parse_client_request(&bench_client, bench_copy(bc));
+}
+
+static void op_api_get_function(const struct bench_case *bc)
+{
+    sink += (size_t) api_get_function((char*) bc->input, conf->api_str_len,
+            get_handlers, sizeof(get_handlers) / sizeof(struct f_entry));
+}
+
+/* All benchmark cases, the serialized inputs are filled in at start up */
+static struct bench_case cases[] = {
+    { "baseline", "empty", op_empty, "" },
+
+    { "uh_urldecode", "plain", op_urldecode, "/www/index.html" },
+    { "uh_urldecode", "api", op_urldecode, "/api/gpio/state/6" },
+    { "uh_urldecode", "escaped", op_urldecode, "/files/My%20Documents/r%C3%A9sum%C3%A9%20%282026%29%20final.pdf" },
+    { "uh_urldecode", "query", op_urldecode,
+        "/cgi-bin/luci?redirect=%2Fadmin%2Fnetwork%2Fwireless&ssid=My%20Home%20Network%20%235G"
+        "&key=p%40ssw0rd%21%24%25%5E%26&note=%E2%9C%93%20configured%20on%202026-10-18%2022%3A15" },
+
+    { "uh_urlencode", "plain", op_urlencode, "index.html" },
+    { "uh_urlencode", "spaces", op_urlencode, "/files/My Documents/résumé (2026) final.pdf" },
+
+    { "uh_b64decode", "basic-auth", op_b64decode, "YWRtaW46cGFzc3dvcmQ=" },
+    { "uh_b64decode", "token-256", op_b64decode, b64_token },
+
+    { "canonpath", "clean", op_canonpath, "/www/index.html" },
+    { "canonpath", "dotted", op_canonpath, "/www/./css/../js//lib/./app.min.js" },
+    { "canonpath", "deep", op_canonpath, "/www/a/b/c/d/e/f/g/h/../../../i/j/k/../../l/index.html" },
+
+    { "file_mime_lookup", "html", op_mime_lookup, "/www/index.html" },
+    { "file_mime_lookup", "js", op_mime_lookup, "/www/js/app.min.js" },
+    { "file_mime_lookup", "upper", op_mime_lookup, "/www/img/PHOTO.JPG" },
+    { "file_mime_lookup", "unknown", op_mime_lookup, "/www/firmware/dpt-board-1.2.3.bin.sig" },
+
+    { "uh_split_header", "host", op_split_header, "Host: 192.168.1.1" },
+    { "uh_split_header", "user-agent", op_split_header,
+        "User-Agent: Mozilla/5.0 (X11; Linux x86_64) AppleWebKit/537.36 (KHTML, like Gecko) Chrome/120.0 Safari/537.36" },
+
+    { "helper_str_startswith", "hit", op_startswith, "/api/gpio/state/6", "gpio" },
+    { "helper_str_startswith", "miss", op_startswith, "/api/gpio/state/6", "bluecherry" },
+    { "helper_str_startswith", "long-hit", op_startswith, "/api/tempsensor/read", "tempsensor" },
+
+    { "helper_serialize_str_array", "4", op_serialize, "wlan0 DPT-Board psk2 192.168.1.1" },
+    { "helper_serialize_str_array", "32", op_serialize,
+        "a0 b1 c2 d3 e4 f5 g6 h7 i8 j9 ka lb mc nd oe pf qg rh si tj uk vl wm xn yo zp aq br cs dt eu fv" },
+
+    { "helper_unserialize_str_array", "4", op_unserialize, NULL },
+    { "helper_unserialize_str_array", "32", op_unserialize, NULL },
+
+    { "parse_client_request", "static", op_parse_request, "GET /index.html HTTP/1.1" },
+    { "parse_client_request", "api", op_parse_request, "GET /api/gpio/state/6 HTTP/1.1" },
+    { "parse_client_request", "post", op_parse_request, "POST /api/batch HTTP/1.1" },
+    { "parse_client_request", "long-url", op_parse_request,
+        "GET /cgi-bin/luci?redirect=%2Fadmin%2Fnetwork%2Fwireless&ssid=My%20Home%20Network&key=secret HTTP/1.1" },
+
+    { "api_get_function", "first", op_api_get_function, "/api/wifi/scan" },
+    { "api_get_function", "middle", op_api_get_function, "/api/gpio/state/6" },
+    { "api_get_function", "last", op_api_get_function, "/api/rfid/read" },
+    { "api_get_function", "miss", op_api_get_function, "/api/unknown/call" },
+};
+
+/**
+ * Get a monotonic time stamp.
+ * @return the time in nanoseconds.
+ */
+static uint64_t bench_ns(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t) ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+/**
+ * Read the cycle counter when the processor has one usable from
+ * user space.
+ * @return the cycle count, 0 when not available.
+ */
+static inline uint64_t bench_cycles(void)
+{
+#if defined(__x86_64__) || defined(__i386__)
+    return __rdtsc();
+#else
+    return 0;
+#endif
+}
+
+/**
+ * Run a case a number of times.
+ * @param bc the benchmark case.
+ * @param n the number of runs.
+ */
+static void bench_run(const struct bench_case *bc, uint64_t n)
+{
+    void (*op)(const struct bench_case *) = bc->op;
+
+    while (n--)
+        op(bc);
+}
+
+static int compare_double(const void *a, const void *b)
+{
+    double x = *(const double*) a, y = *(const double*) b;
+
+    return (x > y) - (x < y);
+}
+
+/**
+ * Warm up, calibrate and time one case and print its result.
+ * @param bc the benchmark case.
+ * @param repeats the number of timed batches.
+ * @param batch_ns the minimum duration of a batch.
+ * @param warmup_ns the duration of the warm up.
+ * @param first true for the first printed case.
+ */
+static void bench_case_run(const struct bench_case *bc, int repeats, uint64_t batch_ns, uint64_t warmup_ns, bool first)
+{
+    double ns[BENCH_MAX_REPEATS], cycles[BENCH_MAX_REPEATS];
+    uint64_t n = 1, start, c;
+
+    /* Warm up caches and branch predictors */
+    start = bench_ns();
+    while (bench_ns() - start < warmup_ns)
+        bench_run(bc, 64);
+
+    /* Find the number of runs that takes at least one batch time */
+    for (;;) {
+        start = bench_ns();
+        bench_run(bc, n);
+        if (bench_ns() - start >= batch_ns)
+            break;
+        n *= 2;
+    }
+
+    for (int r = 0; r < repeats; ++r) {
+        start = bench_ns();
+        c = bench_cycles();
+        bench_run(bc, n);
+        cycles[r] = (double)(bench_cycles() - c) / n;
+        ns[r] = (double)(bench_ns() - start) / n;
+    }
+
+    qsort(ns, repeats, sizeof(double), compare_double);
+    qsort(cycles, repeats, sizeof(double), compare_double);
+
+    printf("%s    {\"name\": \"%s\", \"corpus\": \"%s\", \"bytes\": %zu, \"runs\": %llu, "
+            "\"ns_min\": %.2f, \"ns_median\": %.2f, \"ns_max\": %.2f, ",
+            first ? "" : ",\n", bc->name, bc->corpus, bc->len, (unsigned long long) n,
+            ns[0], ns[repeats / 2], ns[repeats - 1]);
+    if (cycles[repeats - 1] > 0)
+        printf("\"cycles_median\": %.1f}", cycles[repeats / 2]);
+    else
+        printf("\"cycles_median\": null}");
+    fflush(stdout);
+}
+
+/**
+ * Prepare the inputs that are generated at start up.
+ */
+static void bench_setup(void)
+{
+    static const char b64[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+    char *array[32];
+    char small[] = "wlan0 DPT-Board psk2 192.168.1.1";
+    char large[] = "a0 b1 c2 d3 e4 f5 g6 h7 i8 j9 ka lb mc nd oe pf qg rh si tj uk vl wm xn yo zp aq br cs dt eu fv";
+    size_t n;
+    char *p;
+
+    /* Base64 of the bytes 0 to 255 */
+    p = b64_token;
+    for (int i = 0; i < 256; i += 3) {
+        uint32_t v = i << 16 | (i + 1 < 256 ? (i + 1) << 8 : 0) | (i + 2 < 256 ? i + 2 : 0);
+
+        *p++ = b64[v >> 18 & 63];
+        *p++ = b64[v >> 12 & 63];
+        *p++ = i + 1 < 256 ? b64[v >> 6 & 63] : '=';
+        *p++ = i + 2 < 256 ? b64[v & 63] : '=';
+    }
+    *p = '\0';
+
+    n = 0;
+    for (p = strtok(small, " "); p; p = strtok(NULL, " "))
+        array[n++] = p;
+    serialized_small = helper_serialize_str_array(array, n);
+
+    n = 0;
+    for (p = strtok(large, " "); p; p = strtok(NULL, " "))
+        array[n++] = p;
+    serialized_large = helper_serialize_str_array(array, n);
+
+    for (size_t i = 0; i < sizeof(cases) / sizeof(cases[0]); ++i) {
+        if (cases[i].op == op_unserialize)
+            cases[i].input = strcmp(cases[i].corpus, "4") == 0 ? serialized_small : serialized_large;
+        cases[i].len = strlen(cases[i].input);
+    }
+
+    memset(&bench_client, 0, sizeof(bench_client));
+}
+
+int main(int argc, char **argv)
+{
+    const char *filter = NULL;
+    int repeats = 11;
+    int batch_ms = 20;
+    int warmup_ms = 50;
+    bool first = true;
+    int opt;
+
+    while ((opt = getopt(argc, argv, "f:r:t:w:")) != -1) {
+        switch (opt) {
+        case 'f':
+            filter = optarg;
+            break;
+        case 'r':
+            repeats = atoi(optarg);
+            break;
+        case 't':
+            batch_ms = atoi(optarg);
+            break;
+        case 'w':
+            warmup_ms = atoi(optarg);
+            break;
+        default:
+            fprintf(stderr, "Usage: %s [-f filter] [-r repeats] [-t batch ms] [-w warm-up ms]\n", argv[0]);
+            return 1;
+        }
+    }
+
+    if (repeats < 1 || repeats > BENCH_MAX_REPEATS) {
+        fprintf(stderr, "The number of repeats must be between 1 and %d\n", BENCH_MAX_REPEATS);
+        return 1;
+    }
+
+    /* The default configuration, the functions read the API prefix and symlink policy */
+    config_parse("/dev/null");
+    bench_setup();
+
+    printf("{\n  \"compiler\": \"%s\",\n  \"repeats\": %d,\n  \"batch_ms\": %d,\n  \"benchmarks\": [\n",
+            __VERSION__, repeats, batch_ms);
+
+    for (size_t i = 0; i < sizeof(cases) / sizeof(cases[0]); ++i) {
+        if (filter && !strstr(cases[i].name, filter))
+            continue;
+        bench_case_run(&cases[i], repeats, batch_ms * 1000000ULL, warmup_ms * 1000000ULL, first);
+        first = false;
+    }
+
+    printf("\n  ]\n}\n");
+
+    blob_buf_free(&bench_client.hdr);
+    free(serialized_small);
+    free(serialized_large);
+    return 0;
+}
@@ -0,0 +1,276 @@
+/* 
+ * Copyright (c) 2014, Daan Pape
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without 
+ * modification, are permitted provided that the following conditions are met:
+ * 
+ *     1. Redistributions of source code must retain the above copyright 
+ *        notice, this list of conditions and the following disclaimer.
+ *
+ *     2. Redistributions in binary form must reproduce the above copyright 
+ *        notice, this list of conditions and the following disclaimer in the 
+ *        documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" 
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE 
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE 
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE 
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR 
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF 
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS 
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN 
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) 
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE 
+ * POSSIBILITY OF SUCH DAMAGE.
+ * 
+ * File:   route_bench.c
+ * Created on October 18, 2026, 10:50 PM
+ *
+ * Profile API routes and static files in-process with the request
+ * harness. Every route is requested a number of times on a fresh
+ * virtual client, the timing and allocation counts are printed as JSON.
+ * Routes without a leading '/' are relative to the API prefix.
+ *
+ * Usage: route-bench [-c config] [-n iterations] [-w warm-up] [-m method]
+ *                    [-b body file] [-v] route...
+ *
+ * Example: route-bench -n 5000 gpio/overview system/overview wifi/scan
+ */
+
+#define _GNU_SOURCE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <unistd.h>
+
+#include "../config.h"
+#include "harness.h"
+
+static int compare_u64(const void *a, const void *b)
+{
+    uint64_t x = *(const uint64_t*) a, y = *(const uint64_t*) b;
+
+    return (x > y) - (x < y);
+}
+
+/**
+ * Read the request body from a file.
+ * @param file the file name.
+ * @param len the length of the body.
+ * @return the body or NULL on error.
+ */
+static char* read_body(const char *file, size_t *len)
+{
+    FILE *f = fopen(file, "r");
+    char *body;
+    long size;
+
+    if (!f)
+        return NULL;
+
+    fseek(f, 0, SEEK_END);
+    size = ftell(f);
+    fseek(f, 0, SEEK_SET);
+
+    body = malloc(size + 1);
+    if (!body || fread(body, 1, size, f) != (size_t) size) {
+        free(body);
+        fclose(f);
+        return NULL;
+    }
+
+    fclose(f);
+    *len = size;
+    return body;
+}
+
+/**
+ * Build the raw request of a route.
+ * @param method the HTTP method.
+ * @param route the route, relative to the API prefix without leading '/'.
+ * @param body the request body, NULL for none.
+ * @param body_len the length of the body.
+ * @param len the length of the request.
+ * @return the request, must be freed.
+ */
+static char* build_request(const char *method, const char *route, const char *body, size_t body_len, size_t *len)
+{
+    char *req;
+    int n;
+
+    n = asprintf(&req, "%s %s%s%s HTTP/1.1\r\nHost: localhost\r\nConnection: close\r\n",
+            method, route[0] == '/' ? "" : API_PATH, route[0] == '/' ? "" : "/", route);
+    if (n < 0)
+        return NULL;
+
+    if (body) {
+        char *full = malloc(n + body_len + 48);
+
+        if (!full) {
+            free(req);
+            return NULL;
+        }
+
+        n = sprintf(full, "%sContent-Length: %zu\r\n\r\n", req, body_len);
+        memcpy(full + n, body, body_len);
+        free(req);
+        *len = n + body_len;
+        return full;
+    }
+
+    req = realloc(req, n + 3);
+    strcpy(req + n, "\r\n");
+    *len = n + 2;
+    return req;
+}
+
+/**
+ * Benchmark one route and print its result.
+ * @param route the route.
+ * @param request the raw request.
+ * @param len the length of the request.
+ * @param iterations the number of timed requests.
+ * @param warmup the number of untimed requests first.
+ * @param verbose print the first response on stderr.
+ * @param first true for the first printed route.
+ * @return false when the request could not run.
+ */
+static bool bench_route(const char *route, const char *method, const char *request, size_t len,
+        int iterations, int warmup, bool verbose, bool first)
+{
+    struct harness_result res;
+    uint64_t *ns = malloc(iterations * sizeof(uint64_t));
+    uint64_t total = 0;
+    double parse = 0, handler = 0, respond = 0;
+    double allocs = 0, alloc_bytes = 0, frees = 0;
+
+    if (!ns)
+        return false;
+
+    for (int i = 0; i < warmup; ++i) {
+        if (!harness_run(request, len, &res)) {
+            free(ns);
+            return false;
+        }
+        if (i == 0 && verbose)
+            fprintf(stderr, "%s\n", res.response);
+    }
+
+    for (int i = 0; i < iterations; ++i) {
+        if (!harness_run(request, len, &res)) {
+            free(ns);
+            return false;
+        }
+
+        ns[i] = res.ns;
+        total += res.ns;
+        parse += res.parse_us;
+        handler += res.handler_us;
+        respond += res.respond_us;
+        allocs += res.allocs;
+        alloc_bytes += res.alloc_bytes;
+        frees += res.frees;
+    }
+
+    qsort(ns, iterations, sizeof(uint64_t), compare_u64);
+
+    printf("%s    {\"route\": \"%s\", \"method\": \"%s\", \"status\": %d, \"response_bytes\": %zu, "
+            "\"iterations\": %d, \"ns_mean\": %.0f, \"ns_min\": %llu, \"ns_median\": %llu, \"ns_p99\": %llu, "
+            "\"parse_us_mean\": %.2f, \"handler_us_mean\": %.2f, \"respond_us_mean\": %.2f, ",
+            first ? "" : ",\n", route, method, res.status, res.response_len, iterations,
+            (double) total / iterations, (unsigned long long) ns[0],
+            (unsigned long long) ns[iterations / 2], (unsigned long long) ns[iterations * 99 / 100],
+            parse / iterations, handler / iterations, respond / iterations);
+
+    if (harness_counts_allocs())
+        printf("\"allocs\": %.1f, \"alloc_bytes\": %.0f, \"frees\": %.1f}",
+                allocs / iterations, alloc_bytes / iterations, frees / iterations);
+    else
+        printf("\"allocs\": null, \"alloc_bytes\": null, \"frees\": null}");
+
+    fflush(stdout);
+    free(ns);
+    return true;
+}
+
+int main(int argc, char **argv)
+{
+    const char *config_file = NULL;
+    const char *method = "GET";
+    const char *body_file = NULL;
+    char *body = NULL;
+    size_t body_len = 0;
+    int iterations = 1000;
+    int warmup = 100;
+    bool verbose = false;
+    bool ok = true;
+    bool first = true;
+    int opt;
+
+    while ((opt = getopt(argc, argv, "c:n:w:m:b:v")) != -1) {
+        switch (opt) {
+        case 'c':
+            config_file = optarg;
+            break;
+        case 'n':
+            iterations = atoi(optarg);
+            break;
+        case 'w':
+            warmup = atoi(optarg);
+            break;
+        case 'm':
+            method = optarg;
+            break;
+        case 'b':
+            body_file = optarg;
+            break;
+        case 'v':
+            verbose = true;
+            break;
+        default:
+            optind = argc + 1;
+            break;
+        }
+    }
+
+    if (optind >= argc || iterations < 1 || warmup < 0) {
+        fprintf(stderr, "Usage: %s [-c config] [-n iterations] [-w warm-up] [-m method] [-b body file] [-v] route...\n", argv[0]);
+        return 1;
+    }
+
+    if (body_file && !(body = read_body(body_file, &body_len))) {
+        fprintf(stderr, "Could not read %s\n", body_file);
+        return 1;
+    }
+
+    /* A verbose run shows the first response, also without warm-up */
+    if (verbose && warmup == 0)
+        warmup = 1;
+
+    if (!harness_init(config_file))
+        return 1;
+
+    printf("{\n  \"iterations\": %d,\n  \"routes\": [\n", iterations);
+
+    for (int i = optind; i < argc; ++i) {
+        size_t len;
+        char *request = build_request(method, argv[i], body, body_len, &len);
+
+        if (request && bench_route(argv[i], method, request, len, iterations, warmup, verbose, first)) {
+            first = false;
+        } else {
+            fprintf(stderr, "Could not run %s %s\n", method, argv[i]);
+            ok = false;
+        }
+        free(request);
+    }
+
+    printf("\n  ]\n}\n");
+
+    harness_free();
+    free(body);
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,393 @@
+/* 
+ * Copyright (c) 2014, Daan Pape
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without 
+ * modification, are permitted provided that the following conditions are met:
+ * 
+ *     1. Redistributions of source code must retain the above copyright 
+ *        notice, this list of conditions and the following disclaimer.
+ *
+ *     2. Redistributions in binary form must reproduce the above copyright 
+ *        notice, this list of conditions and the following disclaimer in the 
+ *        documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" 
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE 
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE 
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE 
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR 
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF 
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS 
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN 
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) 
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE 
+ * POSSIBILITY OF SUCH DAMAGE.
+ * 
+ * File:   trace_decode.c
+ * Created on October 18, 2026, 7:05 PM
+ *
+ * Host side decoder for the binary trace file of the breakout server,
+ * build it with the native compiler:
+ *
+ *   cc -std=gnu99 -O2 -o trace_decode tools/trace_decode.c
+ *
+ * Usage: trace_decode <trace file>
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <time.h>
+
+#include "../trace.h"
+
+/**
+ * A call site read from the site table.
+ */
+struct site {
+    int level;
+    bool hexdump;
+    int line;
+    char *file;
+    char *format;
+    char *args;
+};
+
+/* Names of the loglevels, indexed by level */
+static const char * const levels[] = {
+    [LOG_ERROR] = "ERROR",
+    [LOG_WARNING] = "WARNING",
+    [LOG_INFO] = "INFO",
+    [LOG_DEBUG] = "DEBUG",
+};
+
+/* True when the trace was written with the other byte order */
+static bool swap;
+
+static uint8_t *ring;
+static uint32_t ring_size;
+static struct site *sites;
+static uint32_t nsites;
+
+/**
+ * Read an uint16 in the byte order of the trace.
+ */
+static uint16_t get16(const void *p)
+{
+    uint16_t v;
+
+    memcpy(&v, p, sizeof(v));
+    return swap ? __builtin_bswap16(v) : v;
+}
+
+/**
+ * Read an uint32 in the byte order of the trace.
+ */
+static uint32_t get32(const void *p)
+{
+    uint32_t v;
+
+    memcpy(&v, p, sizeof(v));
+    return swap ? __builtin_bswap32(v) : v;
+}
+
+/**
+ * Read an uint64 in the byte order of the trace.
+ */
+static uint64_t get64(const void *p)
+{
+    uint64_t v;
+
+    memcpy(&v, p, sizeof(v));
+    return swap ? __builtin_bswap64(v) : v;
+}
+
+/**
+ * Copy a string that is not zero terminated.
+ */
+static char* strndup_raw(const uint8_t *p, int len)
+{
+    char *s = malloc(len + 1);
+
+    memcpy(s, p, len);
+    s[len] = 0;
+    return s;
+}
+
+/**
+ * Read the site table.
+ * @param p the start of the site table
+ */
+static void read_sites(const uint8_t *p)
+{
+    uint32_t i;
+
+    sites = calloc(nsites, sizeof(*sites));
+    for (i = 0; i < nsites; ++i) {
+        const struct trace_site_entry *e = (const void *) p;
+        int flen = get16(&e->file_len), fmlen = get16(&e->format_len), alen = get16(&e->args_len);
+        const uint8_t *str = p + sizeof(*e);
+
+        sites[i].level = get16(&e->level);
+        sites[i].hexdump = get16(&e->hexdump);
+        sites[i].line = get32(&e->line);
+        sites[i].file = strndup_raw(str, flen);
+        sites[i].format = strndup_raw(str + flen, fmlen);
+        sites[i].args = strndup_raw(str + flen + fmlen, alen);
+
+        p += (sizeof(*e) + flen + fmlen + alen + 3) & ~3;
+    }
+}
+
+/**
+ * Format the message of a record like printf would have.
+ * @param s the call site
+ * @param p the raw arguments
+ * @param end the end of the record
+ * @param out the output
+ */
+static void format_record(const struct site *s, const uint8_t *p, const uint8_t *end, FILE *out)
+{
+    const char *f = s->format, *a = s->args;
+    char spec[64];
+
+    if (s->hexdump) {
+        int len = get16(p), i;
+
+        fputs(s->format, out);
+        fputs("[ ", out);
+        for (i = 0; i < len && p + 2 + i < end; ++i)
+            fprintf(out, "%02x ", p[2 + i]);
+        fputs("]\n", out);
+        return;
+    }
+
+    /* An untraceable format has no arguments */
+    if (!*a && strchr(f, '%')) {
+        fprintf(out, "%s (arguments not traced)\n", f);
+        return;
+    }
+
+    while (*f) {
+        int n = 0, star[2], nstar = 0;
+        char conv;
+
+        if (*f != '%') {
+            if (*f != '\r')
+                fputc(*f, out);
+            ++f;
+            continue;
+        }
+
+        if (f[1] == '%') {
+            fputc('%', out);
+            f += 2;
+            continue;
+        }
+
+        /* Copy flags, width and precision, fill in '*' from the arguments */
+        spec[n++] = *f++;
+        while (strchr("-+ #0123456789.*", *f) && *f && n < (int) sizeof(spec) - 8) {
+            if (*f == '*' && *a == 'i' && nstar < 2) {
+                star[nstar++] = (int32_t) get32(p);
+                p += 4;
+                ++a;
+            }
+            spec[n++] = *f++;
+        }
+
+        /* Skip the length modifier, the trace stores 32 or 64 bits */
+        while (strchr("hlzjtL", *f) && *f)
+            ++f;
+        conv = *f++;
+        if (!*a || p > end)
+            break;
+
+        switch (*a++) {
+            case 'i':
+                spec[n++] = conv;
+                spec[n] = 0;
+                if (nstar == 2) fprintf(out, spec, star[0], star[1], (int32_t) get32(p));
+                else if (nstar == 1) fprintf(out, spec, star[0], (int32_t) get32(p));
+                else fprintf(out, spec, (int32_t) get32(p));
+                p += 4;
+                break;
+            case 'l': case 'q': case 'z':
+                spec[n++] = 'l';
+                spec[n++] = 'l';
+                spec[n++] = conv;
+                spec[n] = 0;
+                if (nstar == 1) fprintf(out, spec, star[0], (long long) get64(p));
+                else fprintf(out, spec, (long long) get64(p));
+                p += 8;
+                break;
+            case 'p':
+                fprintf(out, "0x%llx", (unsigned long long) get64(p));
+                p += 8;
+                break;
+            case 'd': {
+                uint64_t v = get64(p);
+                double d;
+
+                memcpy(&d, &v, sizeof(d));
+                spec[n++] = conv;
+                spec[n] = 0;
+                if (nstar == 1) fprintf(out, spec, star[0], d);
+                else fprintf(out, spec, d);
+                p += 8;
+                break;
+            }
+            case 's': {
+                int len = get16(p);
+                char *str = strndup_raw(p + 2, len);
+
+                spec[n++] = 's';
+                spec[n] = 0;
+                if (nstar == 1) fprintf(out, spec, star[0], str);
+                else fprintf(out, spec, str);
+                free(str);
+                p += 2 + len;
+                break;
+            }
+        }
+    }
+}
+
+/**
+ * Print a record.
+ * @param off the offset of the record in the ring
+ */
+static void print_record(uint32_t off)
+{
+    const struct trace_record *r = (const void *) (ring + off);
+    const struct site *s = &sites[get16(&r->site)];
+    time_t sec = get32(&r->sec);
+    struct tm tm;
+
+    localtime_r(&sec, &tm);
+    printf("[%s][%d-%d-%d %d:%d:%d.%06u] %s:%d ", s->level <= LOG_DEBUG ? levels[s->level] : "?",
+            tm.tm_year + 1900, tm.tm_mon + 1, tm.tm_mday, tm.tm_hour, tm.tm_min, tm.tm_sec,
+            get32(&r->nsec) / 1000, s->file, s->line);
+    format_record(s, (const uint8_t *) (r + 1), ring + off + get16(&r->len), stdout);
+}
+
+/**
+ * Check if a valid record of a lap starts at an offset.
+ * @param off the offset in the ring
+ * @param lap the lap of the record
+ * @return the length of the record, 0 for the end of the lap, -1 when invalid
+ */
+static int check_record(uint32_t off, uint8_t lap)
+{
+    const struct trace_record *r = (const void *) (ring + off);
+    uint16_t site, len;
+
+    if (off + sizeof(*r) > ring_size || r->lap != lap)
+        return -1;
+
+    site = get16(&r->site);
+    len = get16(&r->len);
+    if (site == TRACE_SITE_PAD)
+        return 0;
+    if (site >= nsites || len < sizeof(*r) || len & 7 || off + len > ring_size)
+        return -1;
+
+    return len;
+}
+
+/**
+ * Print the records of a lap from an offset up to an end offset.
+ * @param off the first record
+ * @param end the end of the lap, the ring size for a complete lap
+ * @param lap the lap of the records
+ * @param print false to only check that the records chain to the end
+ * @return true when the records chain up to the end of the lap
+ */
+static bool walk_lap(uint32_t off, uint32_t end, uint8_t lap, bool print)
+{
+    int len;
+
+    while (off < end) {
+        len = check_record(off, lap);
+        if (len == 0)
+            return true;
+        if (len < 0)
+            return end == ring_size && ring_size - off < sizeof(struct trace_record);
+        if (print)
+            print_record(off);
+        off += len;
+    }
+
+    return off == end;
+}
+
+int main(int argc, char **argv)
+{
+    struct trace_header hdr;
+    uint8_t *data;
+    long size;
+    FILE *f;
+    uint32_t head, off, wp;
+    uint8_t lap;
+
+    if (argc != 2) {
+        fprintf(stderr, "Usage: %s <trace file>\n", argv[0]);
+        return 1;
+    }
+
+    f = fopen(argv[1], "rb");
+    if (!f) {
+        perror(argv[1]);
+        return 1;
+    }
+
+    fseek(f, 0, SEEK_END);
+    size = ftell(f);
+    rewind(f);
+    data = malloc(size);
+    if (size < (long) sizeof(hdr) || fread(data, 1, size, f) != (size_t) size) {
+        fprintf(stderr, "%s: short trace file\n", argv[1]);
+        return 1;
+    }
+    fclose(f);
+
+    memcpy(&hdr, data, sizeof(hdr));
+    if (hdr.magic == __builtin_bswap32(TRACE_MAGIC)) {
+        swap = true;
+    } else if (hdr.magic != TRACE_MAGIC) {
+        fprintf(stderr, "%s: not a trace file\n", argv[1]);
+        return 1;
+    }
+
+    if (get32(&hdr.version) != TRACE_VERSION) {
+        fprintf(stderr, "%s: unsupported trace version %u\n", argv[1], get32(&hdr.version));
+        return 1;
+    }
+
+    nsites = get32(&hdr.nsites);
+    ring_size = get32(&hdr.ring_size);
+    ring = data + get32(&hdr.ring_offset);
+    if (get32(&hdr.ring_offset) + ring_size > (uint32_t) size) {
+        fprintf(stderr, "%s: truncated trace file\n", argv[1]);
+        return 1;
+    }
+    read_sites(data + get32(&hdr.sites_offset));
+
+    head = get32(&hdr.head);
+    wp = head & TRACE_OFFSET_MASK;
+    lap = head >> TRACE_OFFSET_BITS;
+
+    /* The rest of the previous lap holds the oldest records, find the first one */
+    for (off = (wp + 7) & ~7; off < ring_size; off += 8) {
+        if (check_record(off, lap - 1) > 0 && walk_lap(off, ring_size, lap - 1, false)) {
+            walk_lap(off, ring_size, lap - 1, true);
+            break;
+        }
+    }
+
+    walk_lap(0, wp, lap, true);
+    return 0;
+}
@@ -0,0 +1,422 @@
+/* 
+ * Copyright (c) 2014, Daan Pape
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without 
+ * modification, are permitted provided that the following conditions are met:
+ * 
+ *     1. Redistributions of source code must retain the above copyright 
+ *        notice, this list of conditions and the following disclaimer.
+ *
+ *     2. Redistributions in binary form must reproduce the above copyright 
+ *        notice, this list of conditions and the following disclaimer in the 
+ *        documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" 
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE 
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE 
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE 
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR 
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF 
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS 
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN 
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) 
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE 
+ * POSSIBILITY OF SUCH DAMAGE.
+ * 
+ * File:   trace.c
+ * Created on October 18, 2026, 6:31 PM
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+
+#include "config.h"
+#include "logger.h"
+#include "trace.h"
+
+/* The call site descriptors collected by the linker */
+extern struct log_site *__start_log_sites[];
+extern struct log_site *__stop_log_sites[];
+
+/* Messages with a level above this threshold are not traced, -1 when tracing is off */
+int trace_level = -1;
+
+/* The mapped trace file */
+static struct trace_header *trace_hdr;
+
+/* The ring inside the mapped trace file */
+static uint8_t *trace_ring;
+
+/**
+ * Round a length up to the record alignment.
+ * @param len the length
+ * @return the aligned length
+ */
+static inline int trace_align(int len)
+{
+    return (len + 7) & ~7;
+}
+
+/**
+ * Parse the argument types of a format string.
+ * @param format the format string.
+ * @param args buffer for LOG_MAX_ARGS types and the terminating zero.
+ * @return true when all conversions of the format can be traced.
+ */
+bool trace_parse_format(const char *format, char *args)
+{
+    const char *p = format;
+    int n = 0;
+    char size;
+
+    while ((p = strchr(p, '%'))) {
+        ++p;
+        if (*p == '%') {
+            ++p;
+            continue;
+        }
+
+        /* Flags, a width or precision from the arguments is an int */
+        p += strspn(p, "-+ #0");
+        while (*p == '*' || *p == '.' || (*p >= '0' && *p <= '9')) {
+            if (*p == '*') {
+                if (n == LOG_MAX_ARGS)
+                    goto bad;
+                args[n++] = 'i';
+            }
+            ++p;
+        }
+
+        /* Length modifier */
+        size = 'i';
+        if (*p == 'h') {
+            p += p[1] == 'h' ? 2 : 1;
+        } else if (*p == 'l') {
+            size = p[1] == 'l' ? 'q' : 'l';
+            p += p[1] == 'l' ? 2 : 1;
+        } else if (*p == 'z' || *p == 't') {
+            size = 'z';
+            ++p;
+        } else if (*p == 'j') {
+            size = 'q';
+            ++p;
+        }
+
+        if (n == LOG_MAX_ARGS)
+            goto bad;
+
+        switch (*p) {
+            case 'd': case 'i': case 'u': case 'x': case 'X': case 'o': case 'c':
+                args[n++] = size;
+                break;
+            case 'f': case 'F': case 'e': case 'E': case 'g': case 'G': case 'a': case 'A':
+                args[n++] = 'd';
+                break;
+            case 's':
+                args[n++] = 's';
+                break;
+            case 'p':
+                args[n++] = 'p';
+                break;
+            default:
+                goto bad;
+        }
+        ++p;
+    }
+
+    args[n] = 0;
+    return true;
+
+bad:
+    args[0] = 0;
+    return false;
+}
+
+/**
+ * Write the site table and assign the trace IDs.
+ * @param out the start of the site table, NULL to only measure it
+ * @return the size of the site table
+ */
+static int trace_write_sites(uint8_t *out)
+{
+    struct log_site **ref;
+    struct trace_site_entry entry;
+    int size = 0, id = 0;
+
+    for (ref = __start_log_sites; ref < __stop_log_sites; ++ref, ++id) {
+        struct log_site *site = *ref;
+
+        entry.level = site->level;
+        entry.hexdump = site->hexdump;
+        entry.line = site->line;
+        entry.file_len = strlen(site->file);
+        entry.format_len = strlen(site->format);
+        entry.args_len = strlen(site->args);
+        entry.reserved = 0;
+
+        if (out) {
+            uint8_t *p = out + size;
+
+            memcpy(p, &entry, sizeof(entry));
+            p += sizeof(entry);
+            memcpy(p, site->file, entry.file_len);
+            p += entry.file_len;
+            memcpy(p, site->format, entry.format_len);
+            p += entry.format_len;
+            memcpy(p, site->args, entry.args_len);
+        }
+
+        size += (sizeof(entry) + entry.file_len + entry.format_len + entry.args_len + 3) & ~3;
+    }
+
+    return size;
+}
+
+/**
+ * Open the trace file and start tracing.
+ * @param path the trace file, it is truncated.
+ * @param size the size of the ring in bytes.
+ * @param level messages above this loglevel are not traced.
+ * @return true when tracing started.
+ */
+bool trace_init(const char *path, int size, int level)
+{
+    struct log_site **ref;
+    int fd, sites_size, file_size;
+    void *map;
+
+    /* Parse the argument types of every call site once */
+    for (ref = __start_log_sites; ref < __stop_log_sites; ++ref) {
+        struct log_site *site = *ref;
+
+        site->id = ref - __start_log_sites;
+        if (site->hexdump) {
+            strcpy(site->args, "s");
+        } else if (!trace_parse_format(site->format, site->args)) {
+            log_message(LOG_WARNING, "Format at %s:%d can not be traced\r\n", site->file, site->line);
+        }
+    }
+
+    if (size < TRACE_MIN_SIZE)
+        size = TRACE_MIN_SIZE;
+    if (size > TRACE_OFFSET_MASK)
+        size = TRACE_OFFSET_MASK & ~7;
+    size = trace_align(size);
+
+    sites_size = trace_write_sites(NULL);
+    file_size = sizeof(struct trace_header) + sites_size + size;
+
+    fd = open(path, O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (fd < 0) {
+        log_message(LOG_ERROR, "Could not open trace file %s\r\n", path);
+        return false;
+    }
+
+    if (ftruncate(fd, file_size) < 0) {
+        log_message(LOG_ERROR, "Could not size trace file %s\r\n", path);
+        close(fd);
+        return false;
+    }
+
+    map = mmap(NULL, file_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED) {
+        log_message(LOG_ERROR, "Could not map trace file %s\r\n", path);
+        return false;
+    }
+
+    trace_hdr = map;
+    trace_hdr->version = TRACE_VERSION;
+    trace_hdr->nsites = __stop_log_sites - __start_log_sites;
+    trace_hdr->sites_offset = sizeof(struct trace_header);
+    trace_hdr->ring_offset = sizeof(struct trace_header) + sites_size;
+    trace_hdr->ring_size = size;
+    trace_hdr->head = 0;
+    trace_write_sites((uint8_t *) map + trace_hdr->sites_offset);
+    trace_ring = (uint8_t *) map + trace_hdr->ring_offset;
+
+    /* A valid magic marks a complete header */
+    __atomic_store_n(&trace_hdr->magic, TRACE_MAGIC, __ATOMIC_RELEASE);
+
+    __atomic_store_n(&trace_level, level, __ATOMIC_RELEASE);
+    if (level > log_threshold)
+        log_threshold = level;
+
+    log_message(LOG_INFO, "Tracing %d call sites to %s\r\n", trace_hdr->nsites, path);
+    return true;
+}
+
+/**
+ * Reserve space for a record in the ring.
+ * @param len the aligned length of the record
+ * @param lap the lap the record is written in
+ * @return the record, NULL when tracing is off
+ */
+static struct trace_record* trace_reserve(int len, uint8_t *lap)
+{
+    uint32_t head, next, offset;
+    struct trace_record pad;
+
+    if (!trace_ring)
+        return NULL;
+
+    head = __atomic_load_n(&trace_hdr->head, __ATOMIC_RELAXED);
+    do {
+        offset = head & TRACE_OFFSET_MASK;
+        *lap = head >> TRACE_OFFSET_BITS;
+
+        if (offset + len > trace_hdr->ring_size) {
+            /* Start the next lap */
+            ++*lap;
+            offset = 0;
+        }
+
+        next = ((uint32_t) *lap << TRACE_OFFSET_BITS) | (offset + len);
+    } while (!__atomic_compare_exchange_n(&trace_hdr->head, &head, next, true,
+            __ATOMIC_RELAXED, __ATOMIC_RELAXED));
+
+    /* Close the previous lap with a padding record */
+    if (offset == 0 && (head & TRACE_OFFSET_MASK) + sizeof(pad) <= trace_hdr->ring_size) {
+        uint32_t end = head & TRACE_OFFSET_MASK;
+
+        if (end) {
+            memset(&pad, 0, sizeof(pad));
+            pad.site = TRACE_SITE_PAD;
+            pad.len = 0;
+            pad.lap = head >> TRACE_OFFSET_BITS;
+            memcpy(trace_ring + end, &pad, sizeof(pad));
+        }
+    }
+
+    return (struct trace_record *) (trace_ring + offset);
+}
+
+/**
+ * Write a record, the header is written last so a reader never
+ * sees a header with an unwritten payload.
+ * @param site the call site
+ * @param payload the raw arguments
+ * @param len the length of the arguments
+ */
+static void trace_commit(struct log_site *site, const uint8_t *payload, int len)
+{
+    struct trace_record hdr, *rec;
+    struct timespec ts;
+    int total = trace_align(sizeof(hdr) + len);
+    uint8_t lap;
+
+    rec = trace_reserve(total, &lap);
+    if (!rec)
+        return;
+
+    clock_gettime(CLOCK_REALTIME, &ts);
+    memcpy(rec + 1, payload, len);
+
+    memset(&hdr, 0, sizeof(hdr));
+    hdr.sec = ts.tv_sec;
+    hdr.nsec = ts.tv_nsec;
+    hdr.site = site->id;
+    hdr.len = total;
+    hdr.lap = lap;
+
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+    memcpy(rec, &hdr, sizeof(hdr));
+}
+
+/**
+ * Append a string or byte array argument.
+ * @param out the payload buffer
+ * @param n the used length of the payload
+ * @param data the bytes
+ * @param len the number of bytes
+ * @return the new length of the payload
+ */
+static int trace_put_bytes(uint8_t *out, int n, const void *data, int len)
+{
+    uint16_t l;
+
+    if (len > TRACE_STRING_MAX)
+        len = TRACE_STRING_MAX;
+
+    l = len;
+    memcpy(out + n, &l, sizeof(l));
+    memcpy(out + n + sizeof(l), data, len);
+    return n + sizeof(l) + len;
+}
+
+/**
+ * Write a record with the raw arguments of a call site.
+ * @param site the call site.
+ * @param args the arguments of the format string.
+ */
+void trace_vwrite(struct log_site *site, va_list args)
+{
+    uint8_t payload[LOG_MAX_ARGS * (TRACE_STRING_MAX + 2)];
+    const char *t, *str;
+    int n = 0;
+    int32_t i;
+    int64_t q;
+    double d;
+
+    for (t = site->args; *t; ++t) {
+        switch (*t) {
+            case 'i':
+                i = va_arg(args, int);
+                memcpy(payload + n, &i, sizeof(i));
+                n += sizeof(i);
+                break;
+            case 'l':
+                q = va_arg(args, long);
+                memcpy(payload + n, &q, sizeof(q));
+                n += sizeof(q);
+                break;
+            case 'q':
+                q = va_arg(args, long long);
+                memcpy(payload + n, &q, sizeof(q));
+                n += sizeof(q);
+                break;
+            case 'z':
+                q = va_arg(args, size_t);
+                memcpy(payload + n, &q, sizeof(q));
+                n += sizeof(q);
+                break;
+            case 'p':
+                q = (uintptr_t) va_arg(args, void *);
+                memcpy(payload + n, &q, sizeof(q));
+                n += sizeof(q);
+                break;
+            case 'd':
+                d = va_arg(args, double);
+                memcpy(payload + n, &d, sizeof(d));
+                n += sizeof(d);
+                break;
+            case 's':
+                str = va_arg(args, const char *);
+                if (!str)
+                    str = "(null)";
+                n = trace_put_bytes(payload, n, str, strlen(str));
+                break;
+        }
+    }
+
+    trace_commit(site, payload, n);
+}
+
+/**
+ * Write a hexdump record.
+ * @param site the hexdump call site.
+ * @param buf the bytes.
+ * @param len the number of bytes.
+ */
+void trace_write_blob(struct log_site *site, const uint8_t *buf, int len)
+{
+    uint8_t payload[TRACE_STRING_MAX + 2];
+
+    trace_commit(site, payload, trace_put_bytes(payload, 0, buf, len));
+}
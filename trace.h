@@ -0,0 +1,126 @@
+/* 
+ * Copyright (c) 2014, Daan Pape
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without 
+ * modification, are permitted provided that the following conditions are met:
+ * 
+ *     1. Redistributions of source code must retain the above copyright 
+ *        notice, this list of conditions and the following disclaimer.
+ *
+ *     2. Redistributions in binary form must reproduce the above copyright 
+ *        notice, this list of conditions and the following disclaimer in the 
+ *        documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" 
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE 
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE 
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE 
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR 
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF 
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS 
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN 
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) 
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE 
+ * POSSIBILITY OF SUCH DAMAGE.
+ * 
+ * File:   trace.h
+ * Created on October 18, 2026, 6:31 PM
+ */
+
+#ifndef TRACE_H_
+#define TRACE_H_
+
+#include <stdarg.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "logger.h"
+
+/*
+ * Layout of a trace file, all fields are in the byte order of the board
+ * which is recorded by the magic number:
+ *
+ *   struct trace_header
+ *   site table: nsites entries of struct trace_site_entry, each followed
+ *               by the file name, format and argument types (not terminated)
+ *   ring:       ring_size bytes of 8 byte aligned records
+ *
+ * Records start with a struct trace_record followed by the raw arguments
+ * of the call site: 'i' int32, 'l', 'q' and 'z' int64, 'd' double, 'p'
+ * pointer as uint64, 's' and hexdumps as an uint16 length and the bytes.
+ * The ring restarts at offset 0 when a record does not fit, the lap number
+ * in every record tells the current round of the ring from the previous.
+ */
+#define TRACE_MAGIC             0x44505454      /* "DPTT" */
+#define TRACE_VERSION           1
+#define TRACE_SITE_PAD          0xffff          /* Site of the padding record at the end of a lap */
+#define TRACE_OFFSET_BITS       24              /* Bits of the write offset in the head */
+#define TRACE_OFFSET_MASK       ((1 << TRACE_OFFSET_BITS) - 1)
+
+struct trace_header {
+    uint32_t magic;             /* TRACE_MAGIC */
+    uint32_t version;           /* TRACE_VERSION */
+    uint32_t nsites;            /* Number of call sites in the site table */
+    uint32_t sites_offset;      /* File offset of the site table */
+    uint32_t ring_offset;       /* File offset of the ring */
+    uint32_t ring_size;         /* Size of the ring in bytes */
+    uint32_t head;              /* Lap << TRACE_OFFSET_BITS | offset of the next record */
+    uint32_t reserved;
+};
+
+struct trace_site_entry {
+    uint16_t level;             /* The loglevel of the call site */
+    uint16_t hexdump;           /* 1 for a hexdump call site */
+    uint32_t line;              /* The source line */
+    uint16_t file_len;          /* Length of the source file name */
+    uint16_t format_len;        /* Length of the format string */
+    uint16_t args_len;          /* Length of the argument types */
+    uint16_t reserved;
+};
+
+struct trace_record {
+    uint32_t sec;               /* Realtime seconds */
+    uint32_t nsec;              /* Realtime nanoseconds */
+    uint16_t site;              /* Trace ID of the call site */
+    uint16_t len;               /* Length of the record including this header */
+    uint8_t lap;                /* Round of the ring this record was written in */
+    uint8_t reserved[3];
+};
+
+/* Messages with a level above this threshold are not traced, -1 when tracing is off */
+extern int trace_level;
+
+/**
+ * Parse the argument types of a format string.
+ * @param format the format string.
+ * @param args buffer for LOG_MAX_ARGS types and the terminating zero.
+ * @return true when all conversions of the format can be traced.
+ */
+bool trace_parse_format(const char *format, char *args);
+
+/**
+ * Open the trace file and start tracing.
+ * @param path the trace file, it is truncated.
+ * @param size the size of the ring in bytes.
+ * @param level messages above this loglevel are not traced.
+ * @return true when tracing started.
+ */
+bool trace_init(const char *path, int size, int level);
+
+/**
+ * Write a record with the raw arguments of a call site.
+ * @param site the call site.
+ * @param args the arguments of the format string.
+ */
+void trace_vwrite(struct log_site *site, va_list args);
+
+/**
+ * Write a hexdump record.
+ * @param site the hexdump call site.
+ * @param buf the bytes.
+ * @param len the number of bytes.
+ */
+void trace_write_blob(struct log_site *site, const uint8_t *buf, int len);
+
+#endif /* TRACE_H_ */
@@ -30,12 +30,10 @@
 #include <libubox/blob.h>
 #include <libubox/utils.h>
 
-#ifdef HAVE_TLS
-#include <libubox/ustream-ssl.h>
-#endif
-
 #include "utils.h"
 #include "config.h"
+#include "tls.h"
+#include "metrics.h"
 
 #define UH_LIMIT_CLIENTS	64
 
@@ -43,6 +41,8 @@
 #define __blobmsg_header(_name, _val) [HDR_##_name] = { .name = #_val, .type = BLOBMSG_TYPE_STRING },
 
 struct client;
+struct h2_conn;
+struct h2_stream;
 
 struct auth_realm {
     struct list_head list;
@@ -167,6 +167,7 @@ struct dispatch {
     void (*req_free)(struct client *cl);
 
     bool data_blocked;
+    bool parked;            /* True while an API request waits to be answered */
 
     union {
 
@@ -204,9 +205,14 @@ struct client {
 
     enum client_state state;
     bool tls;
+#ifdef HAVE_TLS
+    struct uh_tls_stream ssl;
+#endif
 
     struct http_request request;
     struct uh_addr srv_addr, peer_addr;
+    bool local;                     /* True if connected over the unix domain socket */
+    struct uh_cred peer_cred;       /* Credentials of the peer process of a local client */
 
     struct blob_buf hdr;
     struct dispatch dispatch;
@@ -215,6 +221,14 @@ struct client {
     int readidx;
     bool ispostdata;
     char *postdata;
+    struct h2_conn *h2;             /* HTTP/2 state of the connection, NULL for HTTP/1.x */
+    struct h2_stream *h2_stream;    /* The HTTP/2 stream of a virtual client */
+    void (*close_virtual)(struct client *cl); /* Releases the stream of a virtual client */
+    struct metrics_route *route;    /* The route of the current request for metrics */
+    struct metrics_timing timing;   /* Time stamps of the current request */
+    struct metrics_timing sending;  /* Time stamps of the last response still being written */
+    bool flush_pending;             /* True while the last response is being written */
+    int status;                     /* The status code of the current response */
 };
 
 extern char uh_buf[WORKING_BUFF_SIZE];
@@ -233,6 +247,8 @@ uh_chunk_printf(struct client *cl, const char *format, ...);
 
 void uh_chunk_eof(struct client *cl);
 void uh_handle_request(struct client *cl);
+char *canonpath(const char *path, char *path_resolved);
+const char *file_mime_lookup(const char *path);
 
 void uh_auth_add(const char *path, const char *user, const char *pass);
 bool uh_auth_check(struct client *cl, struct path_info *pi);
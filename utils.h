@@ -41,6 +41,12 @@ struct uh_addr {
 	};
 };
 
+struct uh_cred {
+	pid_t pid;
+	uid_t uid;
+	gid_t gid;
+};
+
 #define min(x, y) (((x) < (y)) ? (x) : (y))
 #define max(x, y) (((x) > (y)) ? (x) : (y))
 